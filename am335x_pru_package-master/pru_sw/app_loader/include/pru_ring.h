@@ -0,0 +1,200 @@
+/*
+ * pru_ring.h
+ *
+ * Single producer, single consumer ring buffer shared between a PRU and
+ * the ARM host
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*
+ * The ring is a 32 byte header followed by a power of 2 number of entries,
+ * each a power of 2 bytes long (4 or more). It can live in PRU data RAM,
+ * shared RAM or extmem. pru_ring.hp describes the same layout for pasm.
+ *
+ * head and tail are free running entry counts. Only the producer writes
+ * head and overruns, only the consumer writes tail. The ring holds
+ * head - tail entries. A producer that finds the ring full drops the
+ * new entry and counts it in overruns, so it never has to stop.
+ *
+ * Ordering rules:
+ *   - The producer writes the entry, then head.
+ *   - The consumer reads head, then the entries, then writes tail.
+ *   - On the ARM a barrier separates each of these steps. The PRU needs
+ *     none: its stores to one memory complete in order, so the header
+ *     and entries must be in the same memory.
+ *   - prussdrv maps the PRU memories and extmem uncached, so no cache
+ *     maintenance is needed. A ring in cached memory is not supported.
+ */
+
+#ifndef _PRU_RING_H
+#define _PRU_RING_H
+
+#include <stdint.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define PRU_RING_HEADER_SIZE    32
+
+#define PRU_RING_BARRIER()      __sync_synchronize()
+
+    typedef struct __pru_ring {
+        volatile uint32_t head;     //Entries produced
+        volatile uint32_t tail;     //Entries consumed
+        uint32_t mask;              //Number of entries - 1
+        uint32_t entry_shift;       //log2 of the entry size in bytes
+        volatile uint32_t overruns; //Entries dropped because the ring was full
+        uint32_t reserved[3];
+    } tpru_ring;
+
+    /** Return the bytes needed for a ring, or 0 if entries or entry_size is
+     * not a power of 2, or entry_size is less than 4. */
+    static inline unsigned int pru_ring_bytes(unsigned int entries,
+                                              unsigned int entry_size)
+    {
+        if (entries == 0 || (entries & (entries - 1)) ||
+            entry_size < 4 || (entry_size & (entry_size - 1)))
+            return 0;
+        return PRU_RING_HEADER_SIZE + entries * entry_size;
+    }
+
+    /** Lay out an empty ring at mem, which must hold pru_ring_bytes().
+     * Do this before the producer starts.
+     * @return the ring, or NULL if the sizes are invalid. */
+    static inline tpru_ring *pru_ring_init(void *mem, unsigned int entries,
+                                           unsigned int entry_size)
+    {
+        tpru_ring *ring = (tpru_ring *) mem;
+        unsigned int shift;
+
+        if (!pru_ring_bytes(entries, entry_size))
+            return 0;
+        for (shift = 2; (1u << shift) < entry_size; shift++);
+
+        ring->head = 0;
+        ring->tail = 0;
+        ring->mask = entries - 1;
+        ring->entry_shift = shift;
+        ring->overruns = 0;
+        ring->reserved[0] = ring->reserved[1] = ring->reserved[2] = 0;
+        PRU_RING_BARRIER();
+        return ring;
+    }
+
+    static inline volatile uint32_t *pru_ring_entry(tpru_ring *ring,
+                                                    uint32_t index)
+    {
+        return (volatile uint32_t *) ((volatile char *) ring +
+            PRU_RING_HEADER_SIZE + ((index & ring->mask) << ring->entry_shift));
+    }
+
+    /** Return the number of entries waiting to be consumed. */
+    static inline unsigned int pru_ring_count(tpru_ring *ring)
+    {
+        return ring->head - ring->tail;
+    }
+
+    /** Copy up to max entries out of the ring into entries, which must be
+     * 4 byte aligned. The ring memory is read a word at a time, as PRU
+     * memory requires.
+     * @return the number of entries copied. */
+    static inline unsigned int pru_ring_read(tpru_ring *ring, void *entries,
+                                             unsigned int max)
+    {
+        uint32_t *dst = (uint32_t *) entries;
+        volatile uint32_t *src;
+        uint32_t head, tail, i, w, words;
+
+        head = ring->head;
+        PRU_RING_BARRIER();
+        tail = ring->tail;
+        if (head - tail < max)
+            max = head - tail;
+
+        words = (1u << ring->entry_shift) >> 2;
+        for (i = 0; i < max; i++) {
+            src = pru_ring_entry(ring, tail + i);
+            for (w = 0; w < words; w++)
+                *dst++ = src[w];
+        }
+
+        PRU_RING_BARRIER();
+        ring->tail = tail + max;
+        return max;
+    }
+
+    /** Copy one entry out of the ring.
+     * @return 1 if an entry was copied, 0 if the ring is empty. */
+    static inline int pru_ring_get(tpru_ring *ring, void *entry)
+    {
+        return pru_ring_read(ring, entry, 1);
+    }
+
+    /** Add one entry, for a ring the ARM produces into.
+     * @return 0 on success, -1 if the ring was full and the entry was
+     * counted as an overrun. */
+    static inline int pru_ring_put(tpru_ring *ring, const void *entry)
+    {
+        const uint32_t *src = (const uint32_t *) entry;
+        volatile uint32_t *dst;
+        uint32_t head, w, words;
+
+        head = ring->head;
+        if (head - ring->tail > ring->mask) {
+            ring->overruns = ring->overruns + 1;
+            return -1;
+        }
+        PRU_RING_BARRIER();
+
+        dst = pru_ring_entry(ring, head);
+        words = (1u << ring->entry_shift) >> 2;
+        for (w = 0; w < words; w++)
+            dst[w] = src[w];
+
+        PRU_RING_BARRIER();
+        ring->head = head + 1;
+        return 0;
+    }
+
+    /** Return the number of entries the producer has dropped. */
+    static inline unsigned int pru_ring_overruns(tpru_ring *ring)
+    {
+        return ring->overruns;
+    }
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
@@ -77,6 +77,9 @@ extern "C" {
 #define	PRUSS0_MDIO            10
 //Available in AM33xx series - end
 
+//Host DDR shared with the PRUs, see prussdrv_map_extmem
+#define PRUSS0_EXTMEM          11
+
 #define PRU_EVTOUT_0            0
 #define PRU_EVTOUT_1            1
 #define PRU_EVTOUT_2            2
@@ -108,6 +111,67 @@ extern "C" {
         unsigned int host_enable_bitmask;
     } tpruss_intc_initdata;
 
+    typedef struct __prussdrv_image tprussdrv_image;
+
+    /** Called by prussdrv_event_dispatch for a host interrupt, after its
+     * system event has been cleared. count is the number of interrupts
+     * since the previous call (1 on the first). */
+    typedef void (*prussdrv_event_handler)(unsigned int host_interrupt,
+                                           unsigned int count, void *arg);
+
+    /** Interrupt coalescing for prussdrv_pru_wait_events. After the
+     * first interrupt, a wakeup waits until max_events events have
+     * arrived or max_usecs have passed, whichever comes first. When the
+     * PRU program counts its events in a word of PRU memory, counter
+     * points at it: the host interrupt then stays masked for the window
+     * and every event is counted, even those that raised no interrupt.
+     * Without a counter, the interrupts themselves are counted. */
+    typedef struct __prussdrv_coalesce {
+        unsigned int max_events;    //Events that end the window early, 0 for none
+        unsigned int max_usecs;     //Length of the window, 0 to wake at once
+        const volatile unsigned int *counter;   //Event count kept by the PRU, or NULL
+    } tprussdrv_coalesce;
+
+    typedef struct __prussdrv_event_stats {
+        unsigned long long wakeups;     //prussdrv_pru_wait_events returns with events
+        unsigned long long events;      //Events reported by those wakeups
+        unsigned long long interrupts;  //Host interrupts read from the driver
+        unsigned long long missed;      //Events that raised no interrupt of their own
+        unsigned long long polled;      //Wakeups that found events without blocking
+        unsigned int max_batch;         //Most events reported by one wakeup
+    } tprussdrv_event_stats;
+
+    /** Busy polling for prussdrv_pru_poll_event. A wait spins on the
+     * INTC raw status of its system event, or on doorbell when the PRU
+     * program counts its events in a word of PRU memory, for up to
+     * spin_usecs before it blocks on the host interrupt as
+     * prussdrv_pru_wait_event does. The PRU must still raise the system
+     * event with a doorbell, for the blocking wait. Spinning only pays
+     * off from a thread pinned to a core of its own. */
+    typedef struct __prussdrv_poll {
+        unsigned int spin_usecs;    //Spin before blocking, 0 to block at once, ~0 never to block
+        const volatile unsigned int *doorbell;  //Event count kept by the PRU, or NULL
+    } tprussdrv_poll;
+
+    typedef void *(*prussdrv_function_handler) (void *);
+
+    /** How prussdrv_start_irqthread_attr runs an interrupt thread. With
+     * lock_memory the whole process is locked in RAM, and the thread's
+     * stack is touched before it starts, so a wakeup never waits on a
+     * page fault. */
+    typedef struct __prussdrv_irqthread_attr {
+        int priority;       //SCHED_FIFO priority, 0 to keep the default policy
+        int cpu;            //CPU to keep the thread on, -1 for any
+        int lock_memory;    //mlockall the process before the thread starts
+        size_t stack_size;  //Stack size, 0 for PRUSSDRV_IRQTHREAD_STACK
+    } tprussdrv_irqthread_attr;
+
+    typedef struct __prussdrv_memvec {
+        unsigned int offset;    //Byte offset into the PRU memory
+        const void *data;
+        unsigned int length;    //Length in bytes
+    } tprussdrv_memvec;
+
     int prussdrv_init(void);
 
     int prussdrv_open(unsigned int host_interrupt);
@@ -125,13 +189,46 @@ extern "C" {
     int prussdrv_pru_enable(unsigned int prunum);
     int prussdrv_pru_enable_at(unsigned int prunum, size_t addr);
 
+    /** Read the program counter of a PRU (a word address in IRAM) from
+     * its STATUS register, without stopping it.
+     * @return 1 if the PRU is running, 0 if it is halted, or -1 if
+     * prunum is not valid.
+     */
+    int prussdrv_pru_read_pc(unsigned int prunum, unsigned int *pc);
+
+    /** Copy bytelength bytes into a PRU memory, starting wordoffset words
+     * in.  A trailing partial word is padded with zeros.
+     * @return the number of words written.
+     * @return -1 if the write does not fit in the memory.
+     */
     int prussdrv_pru_write_memory(unsigned int pru_ram_id,
                                   unsigned int wordoffset,
                                   const unsigned int *memarea,
                                   unsigned int bytelength);
 
+    /** Copy several buffers into a PRU memory, each at its own byte offset.
+     * Nothing is written unless every piece fits.
+     * @return the total number of bytes written, or -1 on error.
+     */
+    int prussdrv_pru_write_memory_v(unsigned int pru_ram_id,
+                                    const tprussdrv_memvec *vec, int count);
+
+    /** Copy bytelength bytes out of a PRU memory, starting offset bytes in.
+     * @return the number of bytes read, or -1 on error.
+     */
+    int prussdrv_pru_read_memory(unsigned int pru_ram_id, unsigned int offset,
+                                 void *buffer, unsigned int bytelength);
+
     int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data);
 
+    /** Route one system event to a channel, or disable it with channel -1,
+     * while every other event stays live. Pending instances of the event
+     * are dropped. Use after prussdrv_pruintc_init. */
+    int prussdrv_pruintc_map_event(unsigned int sysevt, int channel);
+
+    /** Route one channel to a host, and enable the host interrupt. */
+    int prussdrv_pruintc_map_channel(unsigned int channel, unsigned int host);
+
     /** Find and return the channel a specified event is mapped to.
      * Note that this only searches for the first channel mapped and will not
      * detect error cases where an event is mapped erroneously to multiple
@@ -187,6 +284,75 @@ extern "C" {
                                            unsigned int host_interrupt,
                                            unsigned int ack_eventnum);
 
+    /** Set the interrupt coalescing of a host interrupt, or go back to
+     * one wakeup per interrupt with NULL. Clears its statistics. */
+    int prussdrv_pru_set_coalesce(unsigned int host_interrupt,
+                                  const tprussdrv_coalesce *coalesce);
+
+    /** Wait up to timeout_ms (-1 for ever) for a host interrupt, wait out
+     * the coalescing window, then clear sysevent and re-enable the host
+     * interrupt.
+     * @return the number of events since the previous wakeup, 0 on
+     * timeout, or -1 on error. */
+    int prussdrv_pru_wait_events(unsigned int host_interrupt,
+                                 unsigned int sysevent, int timeout_ms);
+
+    /** Set the busy polling of a host interrupt, or go back to blocking
+     * at once on the INTC status with NULL. Clears its statistics. */
+    int prussdrv_pru_set_poll(unsigned int host_interrupt,
+                              const tprussdrv_poll *poll);
+
+    /** Wait up to timeout_ms (-1 for ever) for sysevent, spinning first,
+     * then clear it. The host interrupt stays disabled while spinning
+     * and between calls, so an event caught by spinning never enters the
+     * kernel.
+     * @return the number of events since the previous wakeup (1 without
+     * a doorbell), 0 on timeout, or -1 on error. */
+    int prussdrv_pru_poll_event(unsigned int host_interrupt,
+                                unsigned int sysevent, int timeout_ms);
+
+    /** Copy the wakeup and missed event counts of a host interrupt. */
+    int prussdrv_pru_event_stats(unsigned int host_interrupt,
+                                 tprussdrv_event_stats *stats);
+
+    /** Add an opened host interrupt to the event set. When it fires,
+     * prussdrv_event_dispatch clears sysevent and calls handler.
+     * Registering a host interrupt again replaces its handler. */
+    int prussdrv_event_register(unsigned int host_interrupt,
+                                unsigned int sysevent,
+                                prussdrv_event_handler handler, void *arg);
+
+    int prussdrv_event_unregister(unsigned int host_interrupt);
+
+    /** Wait up to timeout_ms (-1 for ever) for registered host interrupts
+     * and call the handler of each one that fired.
+     * @return the number of handlers called, or -1 on error. */
+    int prussdrv_event_dispatch(int timeout_ms);
+
+    /** Return the epoll fd of the event set, to wait on it in another
+     * poll loop, or -1 if nothing is registered. */
+    int prussdrv_event_fd(void);
+
+    /** Start irqhandler in a thread of its own for host_interrupt, at
+     * SCHED_FIFO priority with memory locked. */
+    int prussdrv_start_irqthread(unsigned int host_interrupt, int priority,
+                                 prussdrv_function_handler irqhandler);
+
+    /** Start irqhandler(arg) in a thread for host_interrupt as attr says,
+     * and come back once it runs with its settings in place.
+     * @return 0, or -1 with errno set if a setting could not be applied. */
+    int prussdrv_start_irqthread_attr(unsigned int host_interrupt,
+                                      const tprussdrv_irqthread_attr *attr,
+                                      prussdrv_function_handler irqhandler,
+                                      void *arg);
+
+    /** Ask the thread of host_interrupt to stop, and wait for it to
+     * return. From then on its waits on host_interrupt return 0 at once,
+     * so the thread should loop until prussdrv_irqthread_stopping. */
+    int prussdrv_stop_irqthread(unsigned int host_interrupt);
+
+    int prussdrv_irqthread_stopping(unsigned int host_interrupt);
+
     int prussdrv_exit(void);
 
     int prussdrv_exec_program(int prunum, const char *filename);
@@ -197,6 +363,88 @@ extern "C" {
     int prussdrv_load_data(int prunum, const unsigned int *code, int codelen);
     int prussdrv_load_datafile(int prunum, const char *filename);
 
+    /** Map a program or data file and keep it resident, so that it can be
+     * loaded again with a single copy into PRU memory.
+     * @return image handle, or NULL if the file can not be mapped.
+     */
+    tprussdrv_image *prussdrv_image_open(const char *filename);
+    void prussdrv_image_close(tprussdrv_image *image);
+    size_t prussdrv_image_size(const tprussdrv_image *image);
+
+    /** Load a mapped image into IRAM (exec) or data RAM (load_data).
+     * @return -1 if the image is larger than the memory.
+     */
+    int prussdrv_exec_image(int prunum, const tprussdrv_image *image);
+    int prussdrv_exec_image_at(int prunum, const tprussdrv_image *image, size_t addr);
+    int prussdrv_load_data_image(int prunum, const tprussdrv_image *image);
+
+    /** Overlay store written by pasmlink (*.ovl), opened with
+     * prussdrv_image_open. All fields are little endian words: the
+     * header, one entry per overlay, then the code of each overlay.
+     * Addresses are IRAM word addresses. */
+#define PRUSSDRV_OVERLAY_MAGIC 0x4c564f50
+    typedef struct __prussdrv_overlay_header {
+        unsigned int magic;
+        unsigned int count;         //Overlays in the store
+        unsigned int window;        //First word of the overlay window
+        unsigned int window_words;  //Words in the window
+    } tprussdrv_overlay_header;
+
+    typedef struct __prussdrv_overlay_entry {
+        unsigned int offset;        //Byte offset of the code in the store
+        unsigned int words;
+        unsigned int entry;         //Address to start the PRU at
+    } tprussdrv_overlay_entry;
+
+    /** @return the number of overlays in a store, or -1 if the image
+     * is not an overlay store. */
+    int prussdrv_overlay_count(const tprussdrv_image *store);
+
+    /** Stop the PRU, copy an overlay into its window in IRAM, and start
+     * the PRU again at the overlay's entry point. The registers are
+     * kept. Call it when the PRU program asks for the overlay, e.g.
+     * from a prussdrv_event_register handler.
+     * @return the number of words written, or -1 if the store or index
+     * is not valid or the overlay does not fit in IRAM.
+     */
+    int prussdrv_pru_load_overlay(unsigned int prunum,
+                                  const tprussdrv_image *store,
+                                  unsigned int index);
+
+    /** Mailbox a swappable firmware keeps in its data RAM, at an offset
+     * the old and new firmware agree on. pru_swap.hp describes the same
+     * layout for pasm: SWAP_INIT fills it in when the firmware starts,
+     * and SWAP_POINT marks the safe label where it halts on request. */
+#define PRUSSDRV_SWAP_REQUEST 1
+#define PRUSSDRV_SWAP_ACK     2
+    typedef struct __prussdrv_swap_mailbox {
+        unsigned int request;       //PRUSSDRV_SWAP_REQUEST from the ARM,
+                                    //PRUSSDRV_SWAP_ACK from the PRU
+        unsigned int layout;        //Data RAM layout version in use
+    } tprussdrv_swap_mailbox;
+
+    typedef struct __prussdrv_firmware {
+        const unsigned int *code;   //Program for IRAM from word 0
+        unsigned int codelen;       //Its length in bytes
+        size_t entry;               //Byte address to resume at
+        unsigned int layout;        //Data RAM layout version it expects
+    } tprussdrv_firmware;
+
+    /** Replace a running firmware, keeping data RAM as it is. Checks
+     * that the new firmware expects the data RAM layout in the mailbox
+     * at byte offset mailbox, asks the old one to halt at its safe
+     * label, waiting up to timeout_us (-1 for ever) for it to
+     * acknowledge, then loads the new code and starts it at its entry.
+     * The registers are kept. A PRU that is not running is swapped at
+     * once.
+     * @return 0, or -1 if the layouts differ, the code does not fit,
+     * the entry is not a word within the code, or the firmware did not
+     * reach its safe label in time; it is then left running as it
+     * was. */
+    int prussdrv_pru_swap_firmware(unsigned int prunum, unsigned int mailbox,
+                                   const tprussdrv_firmware *firmware,
+                                   int timeout_us);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -53,9 +53,16 @@
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
+#include <sys/select.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -75,6 +82,8 @@
 #define PRUSS_MAX_IRAM_SIZE                  8192
 
 #define AM33XX_PRUSS_IRAM_SIZE               8192
+#define AM33XX_PRUSS_DATARAM_SIZE            8192
+#define AM33XX_PRUSS_SHAREDRAM_SIZE          12288
 #define AM33XX_PRUSS_MMAP_SIZE               0x40000
 #define AM33XX_DATARAM0_PHYS_BASE            0x4a300000
 #define AM33XX_DATARAM1_PHYS_BASE            0x4a302000
@@ -94,6 +103,7 @@
 #define	AM33XX_PRUSS_MDIO_BASE               0x4a332400
 
 #define AM18XX_PRUSS_IRAM_SIZE               4096
+#define AM18XX_PRUSS_DATARAM_SIZE            512
 #define AM18XX_PRUSS_MMAP_SIZE               0x7C00
 #define AM18XX_DATARAM0_PHYS_BASE            0x01C30000
 #define AM18XX_DATARAM1_PHYS_BASE            0x01C32000
@@ -160,6 +170,13 @@
 
 #define PRU_INTC_HIER_REG    0x1500
 
+//PRU control register offsets
+#define PRU_CONTROL_REG      0x000
+#define PRU_STATUS_REG       0x004
+
+#define PRU_CONTROL_RUNSTATE 0x00008000
+#define PRU_STATUS_PCOUNTER  0x0000FFFF
+
 
 #define MAX_HOSTS_SUPPORTED	10
 
@@ -190,7 +207,43 @@
 #endif
 
 
+//Set to a directory to run on the simulated PRUSS in prussdrv_sim.c
+#define PRUSSDRV_SIM_ENV                "PRUSSDRV_SIM"
+#define PRUSSDRV_SIM_EXTRAM_PHYS_BASE   0x9f000000
+#define PRUSSDRV_SIM_EXTRAM_SIZE        0x40000
+
+//How often a coalescing window looks at the PRU event counter
+#define PRUSSDRV_COALESCE_POLL_USECS    20
+//How many times a busy poll spins between looks at the clock
+#define PRUSSDRV_POLL_CLOCK_SPINS       64
+//How long a withdrawn swap request may still be acknowledged. The PRU
+//needs a few instructions from loading the request to its HALT
+#define PRUSSDRV_SWAP_ACK_USECS         10
+
+//Interrupt thread stack, and how much of it is left untouched for the
+//thread's own bookkeeping when it is prefaulted
+#define PRUSSDRV_IRQTHREAD_STACK        (256 * 1024)
+#define PRUSSDRV_IRQTHREAD_STACK_SLACK  (32 * 1024)
+
+/* The INTC set up as register values, so prussdrv_pruintc_init() writes
+ * each register once, and the maps as tables for the lookups */
+typedef struct __prussdrv_intc {
+    unsigned int cmr[NUM_PRU_SYS_EVTS / 4];     //CMR1..16, event to channel
+    unsigned int hmr[(NUM_PRU_HOSTS + 3) / 4];  //HMR1..3, channel to host
+    unsigned int esr[2];                        //ESR1/2, enabled events
+    unsigned int host_enable;                   //Bitmask of hosts
+    signed char event_channel[NUM_PRU_SYS_EVTS];    //-1 when not mapped
+    signed char channel_host[NUM_PRU_CHANNELS];     //-1 when not mapped
+    signed char event_host[NUM_PRU_SYS_EVTS];   //As prussdrv_get_event_to_host_map
+} tprussdrv_intc;
+
+struct __prussdrv_backend;
+
 typedef struct __prussdrv {
+    const struct __prussdrv_backend *backend;
+    const char *sim_dir;
+    unsigned int sim_count[NUM_PRU_HOSTIRQS];
+    unsigned int sim_status[2];     //Raw status of the simulated INTC
     int version;
     int fd[NUM_PRU_HOSTIRQS];
     void *pru0_dataram_base;
@@ -236,11 +289,67 @@ typedef struct __prussdrv {
     unsigned int l3ram_map_size;
     unsigned int extram_phys_base;
     unsigned int extram_map_size;
-    tpruss_intc_initdata intc_data;
+    unsigned int iram_size;
+    unsigned int dataram_size;
+    unsigned int sharedram_size;
+    tprussdrv_intc intc;
+    int epoll_fd;
+    struct __prussdrv_event {
+        prussdrv_event_handler handler;
+        void *arg;
+        unsigned int sysevent;
+        unsigned int count;     //Last interrupt count read from the fd
+    } events[NUM_PRU_HOSTIRQS];
+    struct __prussdrv_coalesce_state {
+        tprussdrv_coalesce config;
+        int started;            //count holds a reading
+        unsigned int count;     //Last interrupt count read from the fd
+        unsigned int counter;   //Last value of config.counter
+    } coalesce[NUM_PRU_HOSTIRQS];
+    struct __prussdrv_poll_state {
+        tprussdrv_poll config;
+        unsigned int doorbell;  //Last value of config.doorbell
+    } poll[NUM_PRU_HOSTIRQS];
+    tprussdrv_event_stats stats[NUM_PRU_HOSTIRQS];
+    struct __prussdrv_irqthread {
+        pthread_t thread;
+        int wake_fd;            //eventfd that ends the thread's waits, 0 if none
+        volatile int stopping;
+        int started;            //The thread is running its handler
+        prussdrv_function_handler handler;
+        void *arg;
+        size_t prefault;        //Bytes of stack to touch first
+    } irqthread[NUM_PRU_HOSTIRQS];
 } tprussdrv;
 
-
-int __pruss_detect_hw_version(unsigned int *pruss_io)
+/* Access to the PRUSS: UIO on the target, or the simulation */
+typedef struct __prussdrv_backend {
+    const char *name;
+    /* Return the fd for a host interrupt */
+    int (*open)(tprussdrv *drv, unsigned int host_interrupt);
+    /* Map the PRUSS and extmem, and fill in the layout */
+    int (*memmap_init)(tprussdrv *drv);
+    /* Read the running total of interrupts for a host interrupt */
+    int (*read_count)(tprussdrv *drv, unsigned int host_interrupt,
+                      unsigned int *count);
+    /* Called after the ARM raises a system event, may be NULL */
+    void (*send_event)(tprussdrv *drv, unsigned int eventnum);
+    /* Called after the ARM clears a system event, may be NULL */
+    void (*clear_event)(tprussdrv *drv, unsigned int eventnum);
+} tprussdrv_backend;
+
+extern const tprussdrv_backend __prussdrv_uio_backend;
+extern const tprussdrv_backend __prussdrv_sim_backend;
+
+void __prussdrv_memmap_layout(void);
+
+struct __prussdrv_image {
+    const void *data;
+    size_t size;
+};
+
+
+static inline int __pruss_detect_hw_version(unsigned int *pruss_io)
 {
 
     if (pruss_io[(AM18XX_INTC_PHYS_BASE - AM18XX_DATARAM0_PHYS_BASE) >> 2]
@@ -255,22 +364,3 @@ int __pruss_detect_hw_version(unsigned int *pruss_io)
             return -1;
     }
 }
-
-void __prussintc_set_cmr(volatile unsigned int *pruintc_io, 
-                         unsigned short sysevt, unsigned short channel)
-{
-    pruintc_io[(PRU_INTC_CMR1_REG + (sysevt & ~(0x3))) >> 2] |=
-        ((channel & 0xF) << ((sysevt & 0x3) << 3));
-
-}
-
-
-void __prussintc_set_hmr(volatile unsigned int *pruintc_io, 
-                         unsigned short channel, unsigned short host)
-{
-    pruintc_io[(PRU_INTC_HMR1_REG + (channel & ~(0x3))) >> 2] =
-        pruintc_io[(PRU_INTC_HMR1_REG +
-                    (channel & ~(0x3))) >> 2] | (((host) & 0xF) <<
-                                                 (((channel) & 0x3) << 3));
-
-}
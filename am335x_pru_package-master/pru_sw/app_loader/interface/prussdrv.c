@@ -47,6 +47,9 @@
  */
 
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     //CPU affinity of the interrupt threads
+#endif
 #include <prussdrv.h>
 #include "__prussdrv.h"
 #include <stdio.h>
@@ -63,41 +66,10 @@
 
 static tprussdrv prussdrv;
 
-int __prussdrv_memmap_init(void)
+/* Work out the PRUSS version and the address of each region from the
+ * mapping at pru0_dataram_base */
+void __prussdrv_memmap_layout(void)
 {
-    int i, fd;
-    char hexstring[PRUSS_UIO_PARAM_VAL_LEN];
-
-    if (prussdrv.mmap_fd == 0) {
-        for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
-            if (prussdrv.fd[i])
-                break;
-        }
-        if (i == NUM_PRU_HOSTIRQS)
-            return -1;
-        else
-            prussdrv.mmap_fd = prussdrv.fd[i];
-    }
-    fd = open(PRUSS_UIO_DRV_PRUSS_BASE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.pruss_phys_base =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
-        return -1;
-    fd = open(PRUSS_UIO_DRV_PRUSS_SIZE, O_RDONLY);
-    if (fd >= 0) {
-        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
-        prussdrv.pruss_map_size =
-            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
-        close(fd);
-    } else
-        return -1;
-
-    prussdrv.pru0_dataram_base =
-        mmap(0, prussdrv.pruss_map_size, PROT_READ | PROT_WRITE,
-             MAP_SHARED, prussdrv.mmap_fd, PRUSS_UIO_MAP_OFFSET_PRUSS);
     prussdrv.version =
         __pruss_detect_hw_version(prussdrv.pru0_dataram_base);
 
@@ -114,6 +86,8 @@ int __prussdrv_memmap_init(void)
             prussdrv.pru1_debug_phy_base = AM18XX_PRU1DEBUG_PHYS_BASE;
             prussdrv.pru0_iram_phy_base = AM18XX_PRU0IRAM_PHYS_BASE;
             prussdrv.pru1_iram_phy_base = AM18XX_PRU1IRAM_PHYS_BASE;
+            prussdrv.iram_size = AM18XX_PRUSS_IRAM_SIZE;
+            prussdrv.dataram_size = AM18XX_PRUSS_DATARAM_SIZE;
         }
         break;
     case PRUSS_V2:
@@ -136,6 +110,9 @@ int __prussdrv_memmap_init(void)
             prussdrv.pruss_ecap_phy_base = AM33XX_PRUSS_ECAP_BASE;
             prussdrv.pruss_miirt_phy_base = AM33XX_PRUSS_MIIRT_BASE;
             prussdrv.pruss_mdio_phy_base = AM33XX_PRUSS_MDIO_BASE;
+            prussdrv.iram_size = AM33XX_PRUSS_IRAM_SIZE;
+            prussdrv.dataram_size = AM33XX_PRUSS_DATARAM_SIZE;
+            prussdrv.sharedram_size = AM33XX_PRUSS_SHAREDRAM_SIZE;
         }
         break;
     default:
@@ -190,6 +167,45 @@ int __prussdrv_memmap_init(void)
             prussdrv.pru0_dataram_base + prussdrv.pruss_mdio_phy_base -
             prussdrv.pru0_dataram_phy_base;
     }
+}
+
+static int __prussdrv_uio_memmap_init(tprussdrv *drv)
+{
+    int i, fd;
+    char hexstring[PRUSS_UIO_PARAM_VAL_LEN];
+
+    if (prussdrv.mmap_fd == 0) {
+        for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+            if (prussdrv.fd[i])
+                break;
+        }
+        if (i == NUM_PRU_HOSTIRQS)
+            return -1;
+        else
+            prussdrv.mmap_fd = prussdrv.fd[i];
+    }
+    fd = open(PRUSS_UIO_DRV_PRUSS_BASE, O_RDONLY);
+    if (fd >= 0) {
+        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
+        prussdrv.pruss_phys_base =
+            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
+        close(fd);
+    } else
+        return -1;
+    fd = open(PRUSS_UIO_DRV_PRUSS_SIZE, O_RDONLY);
+    if (fd >= 0) {
+        read(fd, hexstring, PRUSS_UIO_PARAM_VAL_LEN);
+        prussdrv.pruss_map_size =
+            strtoul(hexstring, NULL, HEXA_DECIMAL_BASE);
+        close(fd);
+    } else
+        return -1;
+
+    prussdrv.pru0_dataram_base =
+        mmap(0, prussdrv.pruss_map_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED, prussdrv.mmap_fd, PRUSS_UIO_MAP_OFFSET_PRUSS);
+    __prussdrv_memmap_layout();
+
 #ifndef DISABLE_L3RAM_SUPPORT
     fd = open(PRUSS_UIO_DRV_L3RAM_BASE, O_RDONLY);
     if (fd >= 0) {
@@ -242,19 +258,58 @@ int __prussdrv_memmap_init(void)
 
 }
 
+static int __prussdrv_uio_open(tprussdrv *drv, unsigned int host_interrupt)
+{
+    char name[PRUSS_UIO_PRAM_PATH_LEN];
+
+    sprintf(name, "/dev/uio%d", host_interrupt);
+    return open(name, O_RDWR | O_SYNC);
+}
+
+static int __prussdrv_uio_read_count(tprussdrv *drv,
+                                     unsigned int host_interrupt,
+                                     unsigned int *count)
+{
+    if (read(drv->fd[host_interrupt], count, sizeof(*count)) != sizeof(*count))
+        return -1;
+    return 0;
+}
+
+const tprussdrv_backend __prussdrv_uio_backend = {
+    "uio",
+    __prussdrv_uio_open,
+    __prussdrv_uio_memmap_init,
+    __prussdrv_uio_read_count,
+    NULL,
+    NULL
+};
+
+int __prussdrv_memmap_init(void)
+{
+    return prussdrv.backend->memmap_init(&prussdrv);
+}
+
 int prussdrv_init(void)
 {
     memset(&prussdrv, 0, sizeof(prussdrv));
+    memset(prussdrv.intc.event_channel, -1, sizeof(prussdrv.intc.event_channel));
+    memset(prussdrv.intc.channel_host, -1, sizeof(prussdrv.intc.channel_host));
+    memset(prussdrv.intc.event_host, -1, sizeof(prussdrv.intc.event_host));
+    prussdrv.sim_dir = getenv(PRUSSDRV_SIM_ENV);
+    if (prussdrv.sim_dir && *prussdrv.sim_dir)
+        prussdrv.backend = &__prussdrv_sim_backend;
+    else
+        prussdrv.backend = &__prussdrv_uio_backend;
+    DEBUG_PRINTF("prussdrv backend: %s\n", prussdrv.backend->name);
     return 0;
 
 }
 
 int prussdrv_open(unsigned int host_interrupt)
 {
-    char name[PRUSS_UIO_PRAM_PATH_LEN];
     if (!prussdrv.fd[host_interrupt]) {
-        sprintf(name, "/dev/uio%d", host_interrupt);
-        prussdrv.fd[host_interrupt] = open(name, O_RDWR | O_SYNC);
+        prussdrv.fd[host_interrupt] =
+            prussdrv.backend->open(&prussdrv, host_interrupt);
         return __prussdrv_memmap_init();
     } else {
         return -1;
@@ -312,6 +367,20 @@ int prussdrv_pru_enable_at(unsigned int prunum, size_t addr)
 
 }
 
+int prussdrv_pru_read_pc(unsigned int prunum, unsigned int *pc)
+{
+    volatile uint32_t *prucontrolregs;
+    if (prunum == 0)
+        prucontrolregs = (volatile uint32_t *) prussdrv.pru0_control_base;
+    else if (prunum == 1)
+        prucontrolregs = (volatile uint32_t *) prussdrv.pru1_control_base;
+    else
+        return -1;
+
+    *pc = prucontrolregs[PRU_STATUS_REG >> 2] & PRU_STATUS_PCOUNTER;
+    return (prucontrolregs[PRU_CONTROL_REG >> 2] & PRU_CONTROL_RUNSTATE) ? 1 : 0;
+}
+
 int prussdrv_pru_disable(unsigned int prunum)
 {
     unsigned int *prucontrolregs;
@@ -326,147 +395,465 @@ int prussdrv_pru_disable(unsigned int prunum)
 
 }
 
-int prussdrv_pru_write_memory(unsigned int pru_ram_id,
-                              unsigned int wordoffset,
-                              const unsigned int *memarea,
-                              unsigned int bytelength)
+/* Look up the mapping and size in bytes of a PRU memory */
+static void *__prussdrv_ram_area(unsigned int pru_ram_id, unsigned int *size)
 {
-    unsigned int *pruramarea, i, wordlength;
     switch (pru_ram_id) {
     case PRUSS0_PRU0_IRAM:
-        pruramarea = (unsigned int *) prussdrv.pru0_iram_base;
-        break;
+        *size = prussdrv.iram_size;
+        return prussdrv.pru0_iram_base;
     case PRUSS0_PRU1_IRAM:
-        pruramarea = (unsigned int *) prussdrv.pru1_iram_base;
-        break;
+        *size = prussdrv.iram_size;
+        return prussdrv.pru1_iram_base;
     case PRUSS0_PRU0_DATARAM:
-        pruramarea = (unsigned int *) prussdrv.pru0_dataram_base;
-        break;
+        *size = prussdrv.dataram_size;
+        return prussdrv.pru0_dataram_base;
     case PRUSS0_PRU1_DATARAM:
-        pruramarea = (unsigned int *) prussdrv.pru1_dataram_base;
-        break;
+        *size = prussdrv.dataram_size;
+        return prussdrv.pru1_dataram_base;
     case PRUSS0_SHARED_DATARAM:
         if (prussdrv.version != PRUSS_V2)
-            return -1;
-        pruramarea = (unsigned int *) prussdrv.pruss_sharedram_base;
-        break;
+            return NULL;
+        *size = prussdrv.sharedram_size;
+        return prussdrv.pruss_sharedram_base;
+    case PRUSS0_EXTMEM:
+        *size = prussdrv.extram_map_size;
+        return prussdrv.extram_base;
     default:
-        return -1;
+        return NULL;
+    }
+}
+
+/* Check that [offset, offset+length) lies within a memory of ramsize bytes */
+static int __prussdrv_ram_fits(unsigned int ramsize, unsigned int offset,
+                               unsigned int length)
+{
+    return offset <= ramsize && length <= ramsize - offset;
+}
+
+/* Widest single access used for PRU memory copies. GCC vector types give
+ * NEON (or SSE) width loads and stores where the target has them. */
+#if defined(__GNUC__)
+typedef uint32_t __prussdrv_burst __attribute__ ((vector_size (16)));
+#else
+typedef uint64_t __prussdrv_burst;
+#endif
+#define BURST_WORDS (sizeof(__prussdrv_burst) / sizeof(uint32_t))
+
+/* Copy whole words into PRU memory. The PRU memories only take aligned
+ * accesses, so single words are stored until the destination is burst
+ * aligned, then two bursts at a time. The source may have any alignment. */
+static void __prussdrv_write_words(volatile uint32_t *dst,
+                                   const unsigned char *src,
+                                   unsigned int words)
+{
+    volatile __prussdrv_burst *burst;
+    __prussdrv_burst b0, b1;
+    uint32_t w;
+    unsigned int i, bursts;
+
+    for (; words && ((uintptr_t) dst & (sizeof(b0) - 1)); words--) {
+        memcpy(&w, src, sizeof(w));
+        *dst++ = w;
+        src += sizeof(w);
+    }
+
+    burst = (volatile __prussdrv_burst *) dst;
+    bursts = words / BURST_WORDS;
+    for (i = 0; i + 2 <= bursts; i += 2) {
+        memcpy(&b0, src, sizeof(b0));
+        memcpy(&b1, src + sizeof(b0), sizeof(b1));
+        burst[i] = b0;
+        burst[i + 1] = b1;
+        src += 2 * sizeof(b0);
+    }
+    if (i < bursts) {
+        memcpy(&b0, src, sizeof(b0));
+        burst[i] = b0;
+        src += sizeof(b0);
+    }
+
+    for (i = bursts * BURST_WORDS; i < words; i++) {
+        memcpy(&w, src, sizeof(w));
+        dst[i] = w;
+        src += sizeof(w);
+    }
+}
+
+/* Copy whole words out of PRU memory, the reverse of the above */
+static void __prussdrv_read_words(unsigned char *dst,
+                                  const volatile uint32_t *src,
+                                  unsigned int words)
+{
+    const volatile __prussdrv_burst *burst;
+    __prussdrv_burst b0, b1;
+    uint32_t w;
+    unsigned int i, bursts;
+
+    for (; words && ((uintptr_t) src & (sizeof(b0) - 1)); words--) {
+        w = *src++;
+        memcpy(dst, &w, sizeof(w));
+        dst += sizeof(w);
+    }
+
+    burst = (const volatile __prussdrv_burst *) src;
+    bursts = words / BURST_WORDS;
+    for (i = 0; i + 2 <= bursts; i += 2) {
+        b0 = burst[i];
+        b1 = burst[i + 1];
+        memcpy(dst, &b0, sizeof(b0));
+        memcpy(dst + sizeof(b0), &b1, sizeof(b1));
+        dst += 2 * sizeof(b0);
+    }
+    if (i < bursts) {
+        b0 = burst[i];
+        memcpy(dst, &b0, sizeof(b0));
+        dst += sizeof(b0);
+    }
+
+    for (i = bursts * BURST_WORDS; i < words; i++) {
+        w = src[i];
+        memcpy(dst, &w, sizeof(w));
+        dst += sizeof(w);
+    }
+}
+
+/* Copy bytes to any byte offset in a PRU memory. Partial words at either
+ * end are merged into the existing contents. Host DDR is ordinary memory
+ * and takes a plain memcpy. */
+static void __prussdrv_write_bytes(unsigned int pru_ram_id, void *base,
+                                   unsigned int offset,
+                                   const unsigned char *src,
+                                   unsigned int length)
+{
+    volatile uint32_t *pruramarea;
+    unsigned int lead, words;
+    uint32_t w;
+
+    if (pru_ram_id == PRUSS0_EXTMEM) {
+        memcpy((unsigned char *) base + offset, src, length);
+        return;
+    }
+
+    pruramarea = (volatile uint32_t *) base + (offset >> 2);
+    lead = offset & 3;
+    if (lead && length) {
+        w = *pruramarea;
+        words = 4 - lead < length ? 4 - lead : length;
+        memcpy((unsigned char *) &w + lead, src, words);
+        *pruramarea++ = w;
+        src += words;
+        length -= words;
+    }
+
+    words = length >> 2;
+    __prussdrv_write_words(pruramarea, src, words);
+
+    if (length & 3) {
+        w = pruramarea[words];
+        memcpy(&w, src + (words << 2), length & 3);
+        pruramarea[words] = w;
     }
+}
+
+int prussdrv_pru_write_memory(unsigned int pru_ram_id,
+                              unsigned int wordoffset,
+                              const unsigned int *memarea,
+                              unsigned int bytelength)
+{
+    volatile uint32_t *pruramarea;
+    unsigned int wordlength, fullwords, ramsize;
+    uint32_t lastword;
 
+    pruramarea = __prussdrv_ram_area(pru_ram_id, &ramsize);
+    if (pruramarea == NULL)
+        return -1;
 
     wordlength = (bytelength + 3) >> 2; //Adjust length as multiple of 4 bytes
-    for (i = 0; i < wordlength; i++) {
-        *(pruramarea + i + wordoffset) = *(memarea + i);
+    if (wordoffset > ramsize >> 2 || wordlength > (ramsize >> 2) - wordoffset) {
+        DEBUG_PRINTF("Write of %u bytes at word %u exceeds %u byte RAM\n",
+                     bytelength, wordoffset, ramsize);
+        return -1;
+    }
+
+    if (pru_ram_id == PRUSS0_EXTMEM) {
+        memcpy((void *) (pruramarea + wordoffset), memarea, bytelength);
+        return wordlength;
+    }
+
+    // Pad a trailing partial word with zeros rather than reading past
+    // the end of the caller's buffer
+    pruramarea += wordoffset;
+    fullwords = bytelength >> 2;
+    __prussdrv_write_words(pruramarea, (const unsigned char *) memarea,
+                           fullwords);
+    if (fullwords != wordlength) {
+        lastword = 0;
+        memcpy(&lastword, memarea + fullwords, bytelength & 3);
+        pruramarea[fullwords] = lastword;
     }
     return wordlength;
 
 }
 
+int prussdrv_pru_write_memory_v(unsigned int pru_ram_id,
+                                const tprussdrv_memvec *vec, int count)
+{
+    void *base;
+    unsigned int ramsize, total;
+    int i;
 
-int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data)
+    base = __prussdrv_ram_area(pru_ram_id, &ramsize);
+    if (base == NULL || count < 0)
+        return -1;
+
+    // Check every piece before writing any of them
+    total = 0;
+    for (i = 0; i < count; i++) {
+        if (!__prussdrv_ram_fits(ramsize, vec[i].offset, vec[i].length)) {
+            DEBUG_PRINTF("Write of %u bytes at %u exceeds %u byte RAM\n",
+                         vec[i].length, vec[i].offset, ramsize);
+            return -1;
+        }
+        total += vec[i].length;
+    }
+
+    for (i = 0; i < count; i++)
+        __prussdrv_write_bytes(pru_ram_id, base, vec[i].offset,
+                               (const unsigned char *) vec[i].data,
+                               vec[i].length);
+    return total;
+}
+
+int prussdrv_pru_read_memory(unsigned int pru_ram_id, unsigned int offset,
+                             void *buffer, unsigned int bytelength)
 {
-    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
-    unsigned int i, mask1, mask2;
+    const volatile uint32_t *pruramarea;
+    unsigned char *dst = buffer;
+    unsigned int ramsize, lead, words, length = bytelength;
+    uint32_t w;
+    void *base;
+
+    base = __prussdrv_ram_area(pru_ram_id, &ramsize);
+    if (base == NULL)
+        return -1;
+    if (!__prussdrv_ram_fits(ramsize, offset, length)) {
+        DEBUG_PRINTF("Read of %u bytes at %u exceeds %u byte RAM\n",
+                     length, offset, ramsize);
+        return -1;
+    }
 
-    pruintc_io[PRU_INTC_SIPR1_REG >> 2] = 0xFFFFFFFF;
-    pruintc_io[PRU_INTC_SIPR2_REG >> 2] = 0xFFFFFFFF;
+    if (pru_ram_id == PRUSS0_EXTMEM) {
+        memcpy(dst, (unsigned char *) base + offset, length);
+        return bytelength;
+    }
 
-    for (i = 0; i < (NUM_PRU_SYS_EVTS + 3) >> 2; i++)
-        pruintc_io[(PRU_INTC_CMR1_REG >> 2) + i] = 0;
-    for (i = 0;
-         ((prussintc_init_data->sysevt_to_channel_map[i].sysevt != -1)
-          && (prussintc_init_data->sysevt_to_channel_map[i].channel !=
-              -1)); i++) {
-        __prussintc_set_cmr(pruintc_io,
-                            prussintc_init_data->sysevt_to_channel_map[i].
-                            sysevt,
-                            prussintc_init_data->sysevt_to_channel_map[i].
-                            channel);
-    }
-    for (i = 0; i < (NUM_PRU_HOSTS + 3) >> 2; i++)
-        pruintc_io[(PRU_INTC_HMR1_REG >> 2) + i] = 0;
-    for (i = 0;
-         ((prussintc_init_data->channel_to_host_map[i].channel != -1)
-          && (prussintc_init_data->channel_to_host_map[i].host != -1));
-         i++) {
-
-        __prussintc_set_hmr(pruintc_io,
-                            prussintc_init_data->channel_to_host_map[i].
-                            channel,
-                            prussintc_init_data->channel_to_host_map[i].
-                            host);
+    pruramarea = (const volatile uint32_t *) base + (offset >> 2);
+    lead = offset & 3;
+    if (lead && length) {
+        w = *pruramarea++;
+        words = 4 - lead < length ? 4 - lead : length;
+        memcpy(dst, (unsigned char *) &w + lead, words);
+        dst += words;
+        length -= words;
     }
 
-    pruintc_io[PRU_INTC_SITR1_REG >> 2] = 0x0;
-    pruintc_io[PRU_INTC_SITR2_REG >> 2] = 0x0;
+    words = length >> 2;
+    __prussdrv_read_words(dst, pruramarea, words);
+
+    if (length & 3) {
+        w = pruramarea[words];
+        memcpy(dst + (words << 2), &w, length & 3);
+    }
+    return bytelength;
+}
+
 
+/* Fill in the host interrupt lookup of every event on channel */
+static void __prussdrv_intc_route(tprussdrv_intc *intc, int channel)
+{
+    unsigned int i;
+
+    for (i = 0; i < NUM_PRU_SYS_EVTS; i++) {
+        if (intc->event_channel[i] != channel)
+            continue;
+        if (channel < 0 || intc->channel_host[channel] < 0)
+            intc->event_host[i] = -1;
+        else
+            intc->event_host[i] = intc->channel_host[channel] - 2;
+    }
+}
 
-    mask1 = mask2 = 0;
-    for (i = 0; prussintc_init_data->sysevts_enabled[i] != 255; i++) {
-        if (prussintc_init_data->sysevts_enabled[i] < 32) {
-            mask1 =
-                mask1 + (1 << (prussintc_init_data->sysevts_enabled[i]));
-        } else if (prussintc_init_data->sysevts_enabled[i] < 64) {
-            mask2 =
-                mask2 +
-                (1 << (prussintc_init_data->sysevts_enabled[i] - 32));
-        } else {
-            DEBUG_PRINTF("Error: SYS_EVT%d out of range\n",
-			 prussintc_init_data->sysevts_enabled[i]);
+/* Turn the init tables into register values and lookup tables. Only the
+ * first mapping of an event or a channel counts */
+static int __prussdrv_intc_compile(tprussdrv_intc *intc,
+                                   const tpruss_intc_initdata *data)
+{
+    unsigned int i;
+    unsigned char sysevt;
+    short event, channel, host;
+
+    memset(intc, 0, sizeof(*intc));
+    memset(intc->event_channel, -1, sizeof(intc->event_channel));
+    memset(intc->channel_host, -1, sizeof(intc->channel_host));
+    memset(intc->event_host, -1, sizeof(intc->event_host));
+
+    for (i = 0; i < NUM_PRU_SYS_EVTS &&
+                (event = data->sysevt_to_channel_map[i].sysevt) != -1 &&
+                (channel = data->sysevt_to_channel_map[i].channel) != -1; i++) {
+        if (event < 0 || event >= NUM_PRU_SYS_EVTS
+            || channel < 0 || channel >= NUM_PRU_CHANNELS) {
+            DEBUG_PRINTF("Error: SYS_EVT%d to channel %d out of range\n",
+                         event, channel);
             return -1;
         }
+        if (intc->event_channel[event] >= 0)
+            continue;
+        intc->event_channel[event] = channel;
+        intc->cmr[event >> 2] |= channel << ((event & 3) << 3);
     }
-    pruintc_io[PRU_INTC_ESR1_REG >> 2] = mask1;
-    pruintc_io[PRU_INTC_SECR1_REG >> 2] = mask1;
-    pruintc_io[PRU_INTC_ESR2_REG >> 2] = mask2;
-    pruintc_io[PRU_INTC_SECR2_REG >> 2] = mask2;
 
-    for (i = 0; i < MAX_HOSTS_SUPPORTED; i++)
-        if (prussintc_init_data->host_enable_bitmask & (1 << i)) {
-            pruintc_io[PRU_INTC_HIEISR_REG >> 2] = i;
+    for (i = 0; i < NUM_PRU_CHANNELS &&
+                (channel = data->channel_to_host_map[i].channel) != -1 &&
+                (host = data->channel_to_host_map[i].host) != -1; i++) {
+        if (channel < 0 || channel >= NUM_PRU_CHANNELS
+            || host < 0 || host >= NUM_PRU_HOSTS) {
+            DEBUG_PRINTF("Error: channel %d to host %d out of range\n",
+                         channel, host);
+            return -1;
         }
+        if (intc->channel_host[channel] >= 0)
+            continue;
+        intc->channel_host[channel] = host;
+        intc->hmr[channel >> 2] |= host << ((channel & 3) << 3);
+    }
+    for (i = 0; i < NUM_PRU_CHANNELS; i++)
+        __prussdrv_intc_route(intc, i);
+
+    // The list is char, which is signed on x86, so read it as unsigned
+    // for the (char)-1 terminator to compare as 255
+    for (i = 0; i < NUM_PRU_SYS_EVTS &&
+                (sysevt = data->sysevts_enabled[i]) != 255; i++) {
+        if (sysevt >= NUM_PRU_SYS_EVTS) {
+            DEBUG_PRINTF("Error: SYS_EVT%d out of range\n", sysevt);
+            return -1;
+        }
+        intc->esr[sysevt >> 5] |= 1 << (sysevt & 31);
+    }
+
+    intc->host_enable = data->host_enable_bitmask &
+        ((1 << MAX_HOSTS_SUPPORTED) - 1);
+    return 0;
+}
+
+int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    tprussdrv_intc intc;
+    unsigned int i;
+
+    if (__prussdrv_intc_compile(&intc, prussintc_init_data))
+        return -1;
 
+    // One store per register, in the order the INTC wants them
+    pruintc_io[PRU_INTC_SIPR1_REG >> 2] = 0xFFFFFFFF;
+    pruintc_io[PRU_INTC_SIPR2_REG >> 2] = 0xFFFFFFFF;
+    for (i = 0; i < NUM_PRU_SYS_EVTS / 4; i++)
+        pruintc_io[(PRU_INTC_CMR1_REG >> 2) + i] = intc.cmr[i];
+    for (i = 0; i < (NUM_PRU_HOSTS + 3) / 4; i++)
+        pruintc_io[(PRU_INTC_HMR1_REG >> 2) + i] = intc.hmr[i];
+    pruintc_io[PRU_INTC_SITR1_REG >> 2] = 0x0;
+    pruintc_io[PRU_INTC_SITR2_REG >> 2] = 0x0;
+    pruintc_io[PRU_INTC_ESR1_REG >> 2] = intc.esr[0];
+    pruintc_io[PRU_INTC_SECR1_REG >> 2] = intc.esr[0];
+    pruintc_io[PRU_INTC_ESR2_REG >> 2] = intc.esr[1];
+    pruintc_io[PRU_INTC_SECR2_REG >> 2] = intc.esr[1];
+    for (i = 0; i < MAX_HOSTS_SUPPORTED; i++)
+        if (intc.host_enable & (1 << i))
+            pruintc_io[PRU_INTC_HIEISR_REG >> 2] = i;
     pruintc_io[PRU_INTC_GER_REG >> 2] = 0x1;
 
-    // Stash a copy of the intc settings
-    memcpy( &prussdrv.intc_data, prussintc_init_data,
-            sizeof(prussdrv.intc_data) );
+    prussdrv.intc = intc;
+    return 0;
+}
+
+int prussdrv_pruintc_map_event(unsigned int sysevt, int channel)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    tprussdrv_intc *intc = &prussdrv.intc;
+    unsigned int shift;
+
+    if (sysevt >= NUM_PRU_SYS_EVTS || channel < -1
+        || channel >= NUM_PRU_CHANNELS)
+        return -1;
+
+    // Quiet the event while it moves, then drop anything it left pending
+    pruintc_io[PRU_INTC_EICR_REG >> 2] = sysevt;
+    shift = (sysevt & 3) << 3;
+    intc->cmr[sysevt >> 2] &= ~(0xF << shift);
+    if (channel >= 0)
+        intc->cmr[sysevt >> 2] |= channel << shift;
+    pruintc_io[(PRU_INTC_CMR1_REG >> 2) + (sysevt >> 2)] =
+        intc->cmr[sysevt >> 2];
+    pruintc_io[PRU_INTC_SICR_REG >> 2] = sysevt;
+
+    intc->event_channel[sysevt] = channel;
+    intc->event_host[sysevt] = channel < 0 || intc->channel_host[channel] < 0
+                               ? -1 : intc->channel_host[channel] - 2;
+    if (channel < 0) {
+        intc->esr[sysevt >> 5] &= ~(1 << (sysevt & 31));
+        return 0;
+    }
+    intc->esr[sysevt >> 5] |= 1 << (sysevt & 31);
+    pruintc_io[PRU_INTC_EISR_REG >> 2] = sysevt;
+    return 0;
+}
+
+int prussdrv_pruintc_map_channel(unsigned int channel, unsigned int host)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    tprussdrv_intc *intc = &prussdrv.intc;
+    unsigned int shift;
+
+    if (channel >= NUM_PRU_CHANNELS || host >= NUM_PRU_HOSTS)
+        return -1;
 
+    shift = (channel & 3) << 3;
+    intc->hmr[channel >> 2] &= ~(0xF << shift);
+    intc->hmr[channel >> 2] |= host << shift;
+    pruintc_io[(PRU_INTC_HMR1_REG >> 2) + (channel >> 2)] =
+        intc->hmr[channel >> 2];
+    intc->channel_host[channel] = host;
+    __prussdrv_intc_route(intc, channel);
+
+    if (!(intc->host_enable & (1 << host))) {
+        intc->host_enable |= 1 << host;
+        pruintc_io[PRU_INTC_HIEISR_REG >> 2] = host;
+    }
     return 0;
 }
 
 short prussdrv_get_event_to_channel_map( unsigned int eventnum )
 {
-    unsigned int i;
-    for (i = 0; i < NUM_PRU_SYS_EVTS &&
-                prussdrv.intc_data.sysevt_to_channel_map[i].sysevt  !=-1 &&
-                prussdrv.intc_data.sysevt_to_channel_map[i].channel !=-1; ++i) {
-        if ( eventnum == prussdrv.intc_data.sysevt_to_channel_map[i].sysevt )
-            return prussdrv.intc_data.sysevt_to_channel_map[i].channel;
-    }
-    return -1;
+    if (eventnum >= NUM_PRU_SYS_EVTS)
+        return -1;
+    return prussdrv.intc.event_channel[eventnum];
 }
 
 short prussdrv_get_channel_to_host_map( unsigned int channel )
 {
-    unsigned int i;
-    for (i = 0; i < NUM_PRU_CHANNELS &&
-                prussdrv.intc_data.channel_to_host_map[i].channel != -1 &&
-                prussdrv.intc_data.channel_to_host_map[i].host    != -1; ++i) {
-        if ( channel == prussdrv.intc_data.channel_to_host_map[i].channel )
-            /** -2 is because first two host interrupts are reserved
-             * for PRU0 and PRU1 */
-            return prussdrv.intc_data.channel_to_host_map[i].host - 2;
-    }
-    return -1;
+    if (channel >= NUM_PRU_CHANNELS || prussdrv.intc.channel_host[channel] < 0)
+        return -1;
+    /** -2 is because first two host interrupts are reserved
+     * for PRU0 and PRU1 */
+    return prussdrv.intc.channel_host[channel] - 2;
 }
 
 short prussdrv_get_event_to_host_map( unsigned int eventnum )
 {
-    short ans = prussdrv_get_event_to_channel_map( eventnum );
-    if (ans < 0) return ans;
-    return prussdrv_get_channel_to_host_map( ans );
+    if (eventnum >= NUM_PRU_SYS_EVTS)
+        return -1;
+    return prussdrv.intc.event_host[eventnum];
 }
 
 int prussdrv_pru_send_event(unsigned int eventnum)
@@ -476,13 +863,58 @@ int prussdrv_pru_send_event(unsigned int eventnum)
         pruintc_io[PRU_INTC_SRSR1_REG >> 2] = 1 << eventnum;
     else
         pruintc_io[PRU_INTC_SRSR2_REG >> 2] = 1 << (eventnum - 32);
+    if (prussdrv.backend->send_event)
+        prussdrv.backend->send_event(&prussdrv, eventnum);
     return 0;
 }
 
+static long long __prussdrv_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* Wait up to usecs (-1 for ever) for a host interrupt and read its count.
+ * Returns 1 if it fired, 0 on timeout or once its thread is stopped, -1
+ * on error */
+static int __prussdrv_wait_count(unsigned int host_interrupt, long long usecs,
+                                 unsigned int *count)
+{
+    int fd = prussdrv.fd[host_interrupt];
+    int wake_fd = prussdrv.irqthread[host_interrupt].wake_fd;
+    struct timeval tv;
+    fd_set fds;
+    int n;
+
+    do {
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        if (wake_fd)
+            FD_SET(wake_fd, &fds);
+        tv.tv_sec = usecs / 1000000;
+        tv.tv_usec = usecs % 1000000;
+        n = select((fd > wake_fd ? fd : wake_fd) + 1, &fds, NULL, NULL,
+                   usecs < 0 ? NULL : &tv);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return n;
+    // A stopped interrupt thread finds every wait over
+    if (wake_fd && FD_ISSET(wake_fd, &fds))
+        return 0;
+    if (prussdrv.backend->read_count(&prussdrv, host_interrupt, count))
+        return -1;
+    return 1;
+}
+
 unsigned int prussdrv_pru_wait_event(unsigned int host_interrupt)
 {
-    unsigned int event_count;
-    read(prussdrv.fd[host_interrupt], &event_count, sizeof(int));
+    unsigned int event_count = 0;
+    if (prussdrv.irqthread[host_interrupt].wake_fd)
+        __prussdrv_wait_count(host_interrupt, -1, &event_count);
+    else
+        prussdrv.backend->read_count(&prussdrv, host_interrupt, &event_count);
     return event_count;
 }
 
@@ -494,13 +926,21 @@ int prussdrv_pru_event_fd(unsigned int host_interrupt)
         return -1;
 }
 
-int prussdrv_pru_clear_event(unsigned int host_interrupt, unsigned int sysevent)
+static void __prussdrv_clear_sysevent(unsigned int sysevent)
 {
     volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
     if (sysevent < 32)
         pruintc_io[PRU_INTC_SECR1_REG >> 2] = 1 << sysevent;
     else
         pruintc_io[PRU_INTC_SECR2_REG >> 2] = 1 << (sysevent - 32);
+    if (prussdrv.backend->clear_event)
+        prussdrv.backend->clear_event(&prussdrv, sysevent);
+}
+
+int prussdrv_pru_clear_event(unsigned int host_interrupt, unsigned int sysevent)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    __prussdrv_clear_sysevent(sysevent);
 
     // Re-enable the host interrupt.  Note that we must do this _after_ the
     // system event has been cleared so as to not re-tigger the interrupt line.
@@ -522,6 +962,318 @@ int prussdrv_pru_send_wait_clear_event(unsigned int send_eventnum,
 
 }
 
+int prussdrv_pru_set_coalesce(unsigned int host_interrupt,
+                              const tprussdrv_coalesce *coalesce)
+{
+    struct __prussdrv_coalesce_state *state;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    state = &prussdrv.coalesce[host_interrupt];
+    memset(&state->config, 0, sizeof(state->config));
+    memset(&prussdrv.stats[host_interrupt], 0, sizeof(tprussdrv_event_stats));
+    if (coalesce)
+        state->config = *coalesce;
+    // Events raised before now belong to no wakeup
+    if (state->config.counter)
+        state->counter = *state->config.counter;
+    return 0;
+}
+
+int prussdrv_pru_wait_events(unsigned int host_interrupt,
+                             unsigned int sysevent, int timeout_ms)
+{
+    struct __prussdrv_coalesce_state *state;
+    tprussdrv_event_stats *stats;
+    tprussdrv_coalesce *config;
+    unsigned int count, interrupts, events, counter;
+    long long now, end, nap, deadline, wait;
+    int rc, again = 0;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || !prussdrv.fd[host_interrupt]
+        || sysevent >= NUM_PRU_SYS_EVTS)
+        return -1;
+    state = &prussdrv.coalesce[host_interrupt];
+    stats = &prussdrv.stats[host_interrupt];
+    config = &state->config;
+
+    // Interrupts that bring no new events do not restart the timeout
+    deadline = __prussdrv_usecs() + timeout_ms * 1000LL;
+    for (;;) {
+        wait = -1;
+        if (timeout_ms >= 0) {
+            wait = deadline - __prussdrv_usecs();
+            if (wait <= 0) {
+                if (again)
+                    return 0;
+                wait = 0;
+            }
+        }
+        again = 1;
+        rc = __prussdrv_wait_count(host_interrupt, wait, &count);
+        if (rc <= 0)
+            return rc;
+        // The UIO driver hands back a running total of interrupts
+        interrupts = state->started ? count - state->count : 1;
+        state->count = count;
+        state->started = 1;
+
+        // Let more events pile up before waking the caller
+        end = __prussdrv_usecs() + config->max_usecs;
+        while (config->max_usecs) {
+            events = config->counter ? *config->counter - state->counter
+                                     : interrupts;
+            now = __prussdrv_usecs();
+            if ((config->max_events && events >= config->max_events)
+                || now >= end)
+                break;
+            if (config->counter) {
+                // The host interrupt stays masked; watch the counter
+                nap = end - now;
+                if (config->max_events && nap > PRUSSDRV_COALESCE_POLL_USECS)
+                    nap = PRUSSDRV_COALESCE_POLL_USECS;
+                usleep(nap);
+            } else {
+                prussdrv_pru_clear_event(host_interrupt, sysevent);
+                rc = __prussdrv_wait_count(host_interrupt, end - now, &count);
+                if (rc < 0)
+                    return -1;
+                if (rc == 0)
+                    break;
+                interrupts += count - state->count;
+                state->count = count;
+            }
+        }
+
+        // Count after the clear, so any later event interrupts again
+        prussdrv_pru_clear_event(host_interrupt, sysevent);
+        if (config->counter) {
+            counter = *config->counter;
+            events = counter - state->counter;
+            state->counter = counter;
+        } else
+            events = interrupts;
+
+        stats->interrupts += interrupts;
+        // An interrupt for events already reported wakes no one
+        if (!events)
+            continue;
+        stats->wakeups++;
+        stats->events += events;
+        if (events > interrupts)
+            stats->missed += events - interrupts;
+        if (events > stats->max_batch)
+            stats->max_batch = events;
+        return events > INT_MAX ? INT_MAX : (int) events;
+    }
+}
+
+int prussdrv_pru_set_poll(unsigned int host_interrupt,
+                          const tprussdrv_poll *poll)
+{
+    struct __prussdrv_poll_state *state;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    state = &prussdrv.poll[host_interrupt];
+    memset(&state->config, 0, sizeof(state->config));
+    memset(&prussdrv.stats[host_interrupt], 0, sizeof(tprussdrv_event_stats));
+    if (poll)
+        state->config = *poll;
+    if (state->config.doorbell)
+        state->doorbell = *state->config.doorbell;
+    return 0;
+}
+
+/* Take the events a poll can see without the kernel, clearing sysevent.
+ * Returns how many there were */
+static unsigned int __prussdrv_poll_take(struct __prussdrv_poll_state *state,
+                                         unsigned int sysevent)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    unsigned int doorbell, events;
+
+    if (state->config.doorbell) {
+        doorbell = *state->config.doorbell;
+        events = doorbell - state->doorbell;
+        if (!events)
+            return 0;
+        state->doorbell = doorbell;
+    } else {
+        if (!(pruintc_io[(sysevent < 32 ? PRU_INTC_SRSR1_REG
+                                        : PRU_INTC_SRSR2_REG) >> 2]
+              & (1 << (sysevent & 31))))
+            return 0;
+        events = 1;
+    }
+    __prussdrv_clear_sysevent(sysevent);
+    return events;
+}
+
+int prussdrv_pru_poll_event(unsigned int host_interrupt,
+                            unsigned int sysevent, int timeout_ms)
+{
+    volatile unsigned int *pruintc_io = (volatile unsigned int *) prussdrv.intc_base;
+    struct __prussdrv_poll_state *state;
+    tprussdrv_event_stats *stats;
+    unsigned int count, events, spins;
+    long long now, end, spin_end;
+    int rc, enabled = 0, polled = 1;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || !prussdrv.fd[host_interrupt]
+        || sysevent >= NUM_PRU_SYS_EVTS)
+        return -1;
+    state = &prussdrv.poll[host_interrupt];
+    stats = &prussdrv.stats[host_interrupt];
+
+    now = __prussdrv_usecs();
+    end = timeout_ms < 0 ? LLONG_MAX : now + timeout_ms * 1000LL;
+    spin_end = state->config.spin_usecs == UINT_MAX ? LLONG_MAX
+                                                    : now + state->config.spin_usecs;
+    if (spin_end > end)
+        spin_end = end;
+
+    // Keep the kernel out of it while spinning
+    pruintc_io[PRU_INTC_HIDISR_REG >> 2] = host_interrupt + 2;
+    spins = 0;
+    while (!(events = __prussdrv_poll_take(state, sysevent))) {
+        if (spins++ % PRUSSDRV_POLL_CLOCK_SPINS == 0
+            && (__prussdrv_usecs() >= spin_end
+                || prussdrv.irqthread[host_interrupt].stopping))
+            break;
+    }
+
+    // Block, looking again once the host interrupt is enabled, as an
+    // event may have come in just before. A wakeup can be for an event
+    // that was already taken; the UIO driver disables the host interrupt
+    // again on each one.
+    while (!events) {
+        pruintc_io[PRU_INTC_HIEISR_REG >> 2] = host_interrupt + 2;
+        enabled = 1;
+        if ((events = __prussdrv_poll_take(state, sysevent)))
+            break;
+        polled = 0;
+        now = __prussdrv_usecs();
+        rc = __prussdrv_wait_count(host_interrupt,
+                                   end == LLONG_MAX ? -1 :
+                                   end > now ? end - now : 0, &count);
+        if (rc <= 0) {
+            pruintc_io[PRU_INTC_HIDISR_REG >> 2] = host_interrupt + 2;
+            return rc;
+        }
+        stats->interrupts++;
+        events = __prussdrv_poll_take(state, sysevent);
+    }
+    if (enabled)
+        pruintc_io[PRU_INTC_HIDISR_REG >> 2] = host_interrupt + 2;
+
+    stats->wakeups++;
+    stats->polled += polled;
+    stats->events += events;
+    if (events > stats->max_batch)
+        stats->max_batch = events;
+    return events > INT_MAX ? INT_MAX : (int) events;
+}
+
+int prussdrv_pru_event_stats(unsigned int host_interrupt,
+                             tprussdrv_event_stats *stats)
+{
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    *stats = prussdrv.stats[host_interrupt];
+    return 0;
+}
+
+
+int prussdrv_event_register(unsigned int host_interrupt,
+                            unsigned int sysevent,
+                            prussdrv_event_handler handler, void *arg)
+{
+    struct epoll_event ev;
+    struct __prussdrv_event *event;
+    int op;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || !prussdrv.fd[host_interrupt]
+        || sysevent >= NUM_PRU_SYS_EVTS || handler == NULL)
+        return -1;
+
+    if (!prussdrv.epoll_fd) {
+        prussdrv.epoll_fd = epoll_create(NUM_PRU_HOSTIRQS);
+        if (prussdrv.epoll_fd < 0) {
+            prussdrv.epoll_fd = 0;
+            return -1;
+        }
+    }
+
+    event = &prussdrv.events[host_interrupt];
+    op = event->handler ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = host_interrupt;
+    if (epoll_ctl(prussdrv.epoll_fd, op, prussdrv.fd[host_interrupt], &ev))
+        return -1;
+
+    event->handler = handler;
+    event->arg = arg;
+    event->sysevent = sysevent;
+    return 0;
+}
+
+int prussdrv_event_unregister(unsigned int host_interrupt)
+{
+    struct epoll_event ev;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS
+        || !prussdrv.events[host_interrupt].handler)
+        return -1;
+    epoll_ctl(prussdrv.epoll_fd, EPOLL_CTL_DEL, prussdrv.fd[host_interrupt],
+              &ev);
+    memset(&prussdrv.events[host_interrupt], 0,
+           sizeof(prussdrv.events[host_interrupt]));
+    return 0;
+}
+
+int prussdrv_event_dispatch(int timeout_ms)
+{
+    struct epoll_event ready[NUM_PRU_HOSTIRQS];
+    struct __prussdrv_event *event;
+    unsigned int host_interrupt, count, delta;
+    int i, n, called = 0;
+
+    if (!prussdrv.epoll_fd)
+        return -1;
+
+    do {
+        n = epoll_wait(prussdrv.epoll_fd, ready, NUM_PRU_HOSTIRQS,
+                       timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        host_interrupt = ready[i].data.u32;
+        event = &prussdrv.events[host_interrupt];
+        if (!event->handler)
+            continue;
+
+        // The UIO driver hands back a running total of interrupts
+        if (prussdrv.backend->read_count(&prussdrv, host_interrupt, &count))
+            continue;
+        delta = event->count ? count - event->count : 1;
+        event->count = count;
+
+        prussdrv_pru_clear_event(host_interrupt, event->sysevent);
+        event->handler(host_interrupt, delta, event->arg);
+        called++;
+    }
+    return called;
+}
+
+int prussdrv_event_fd(void)
+{
+    return prussdrv.epoll_fd ? prussdrv.epoll_fd : -1;
+}
+
 
 int prussdrv_map_l3mem(void **address)
 {
@@ -558,6 +1310,9 @@ int prussdrv_map_prumem(unsigned int pru_ram_id, void **address)
             return -1;
         *address = prussdrv.pruss_sharedram_base;
         break;
+    case PRUSS0_EXTMEM:
+        *address = prussdrv.extram_base;
+        break;
     default:
         *address = 0;
         return -1;
@@ -629,32 +1384,174 @@ void *prussdrv_get_virt_addr(unsigned int phyaddr)
         && (phyaddr <
             prussdrv.pru0_dataram_phy_base + prussdrv.pruss_map_size)) {
         address =
-            (void *) ((unsigned int) prussdrv.pru0_dataram_base +
-                      (phyaddr - prussdrv.pru0_dataram_phy_base));
+            (char *) prussdrv.pru0_dataram_base +
+            (phyaddr - prussdrv.pru0_dataram_phy_base);
     } else if ((phyaddr >= prussdrv.l3ram_phys_base)
                && (phyaddr <
                    prussdrv.l3ram_phys_base + prussdrv.l3ram_map_size)) {
         address =
-            (void *) ((unsigned int) prussdrv.l3ram_base +
-                      (phyaddr - prussdrv.l3ram_phys_base));
+            (char *) prussdrv.l3ram_base +
+            (phyaddr - prussdrv.l3ram_phys_base);
     } else if ((phyaddr >= prussdrv.extram_phys_base)
                && (phyaddr <
                    prussdrv.extram_phys_base + prussdrv.extram_map_size)) {
         address =
-            (void *) ((unsigned int) prussdrv.extram_base +
-                      (phyaddr - prussdrv.extram_phys_base));
+            (char *) prussdrv.extram_base +
+            (phyaddr - prussdrv.extram_phys_base);
     }
     return address;
 
 }
 
 
+static pthread_mutex_t __prussdrv_irqthread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __prussdrv_irqthread_started = PTHREAD_COND_INITIALIZER;
+
+/* Touch the stack below the caller, so that with the memory locked the
+ * thread never takes a page fault there */
+static void __attribute__((noinline)) __prussdrv_prefault_stack(size_t size)
+{
+    volatile char *stack = alloca(size);
+    size_t page = sysconf(_SC_PAGESIZE), i;
+
+    for (i = 0; i < size; i += page)
+        stack[i] = 0;
+}
+
+static void *__prussdrv_irqthread(void *arg)
+{
+    struct __prussdrv_irqthread *irq = arg;
+
+    __prussdrv_prefault_stack(irq->prefault);
+    pthread_mutex_lock(&__prussdrv_irqthread_lock);
+    irq->started = 1;
+    pthread_cond_broadcast(&__prussdrv_irqthread_started);
+    pthread_mutex_unlock(&__prussdrv_irqthread_lock);
+    return irq->handler(irq->arg);
+}
+
+int prussdrv_start_irqthread(unsigned int host_interrupt, int priority,
+                             prussdrv_function_handler irqhandler)
+{
+    tprussdrv_irqthread_attr attr = { priority, -1, 1, 0 };
+
+    return prussdrv_start_irqthread_attr(host_interrupt, &attr, irqhandler,
+                                         NULL);
+}
+
+int prussdrv_start_irqthread_attr(unsigned int host_interrupt,
+                                  const tprussdrv_irqthread_attr *attr,
+                                  prussdrv_function_handler irqhandler,
+                                  void *arg)
+{
+    struct __prussdrv_irqthread *irq;
+    struct sched_param param;
+    pthread_attr_t thread_attr;
+    cpu_set_t cpus;
+    size_t stack_size;
+    int rc = 0;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS || !prussdrv.fd[host_interrupt]
+        || !irqhandler)
+        return -1;
+    irq = &prussdrv.irqthread[host_interrupt];
+    if (irq->wake_fd)
+        return -1;
+    stack_size = attr->stack_size ? attr->stack_size : PRUSSDRV_IRQTHREAD_STACK;
+    if (stack_size < 2 * PRUSSDRV_IRQTHREAD_STACK_SLACK) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (attr->lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE))
+        return -1;
+
+    pthread_attr_init(&thread_attr);
+    rc = pthread_attr_setstacksize(&thread_attr, stack_size);
+    if (!rc && attr->priority) {
+        param.sched_priority = attr->priority;
+        rc = pthread_attr_setinheritsched(&thread_attr,
+                                          PTHREAD_EXPLICIT_SCHED);
+        if (!rc)
+            rc = pthread_attr_setschedpolicy(&thread_attr, SCHED_FIFO);
+        if (!rc)
+            rc = pthread_attr_setschedparam(&thread_attr, &param);
+    }
+    if (!rc && attr->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(attr->cpu, &cpus);
+        rc = pthread_attr_setaffinity_np(&thread_attr, sizeof(cpus), &cpus);
+    }
+    if (!rc) {
+        irq->wake_fd = eventfd(0, 0);
+        if (irq->wake_fd < 0) {
+            irq->wake_fd = 0;
+            rc = errno;
+        }
+    }
+    if (!rc) {
+        irq->stopping = 0;
+        irq->started = 0;
+        irq->handler = irqhandler;
+        irq->arg = arg;
+        irq->prefault = stack_size - PRUSSDRV_IRQTHREAD_STACK_SLACK;
+        rc = pthread_create(&irq->thread, &thread_attr, __prussdrv_irqthread,
+                            irq);
+        if (rc) {
+            close(irq->wake_fd);
+            irq->wake_fd = 0;
+        }
+    }
+    pthread_attr_destroy(&thread_attr);
+    if (rc) {
+        errno = rc;
+        return -1;
+    }
+
+    pthread_mutex_lock(&__prussdrv_irqthread_lock);
+    while (!irq->started)
+        pthread_cond_wait(&__prussdrv_irqthread_started,
+                          &__prussdrv_irqthread_lock);
+    pthread_mutex_unlock(&__prussdrv_irqthread_lock);
+    return 0;
+}
+
+int prussdrv_stop_irqthread(unsigned int host_interrupt)
+{
+    struct __prussdrv_irqthread *irq;
+    uint64_t one = 1;
+
+    if (host_interrupt >= NUM_PRU_HOSTIRQS)
+        return -1;
+    irq = &prussdrv.irqthread[host_interrupt];
+    if (!irq->wake_fd)
+        return -1;
+    irq->stopping = 1;
+    if (write(irq->wake_fd, &one, sizeof(one)) != sizeof(one))
+        return -1;
+    pthread_join(irq->thread, NULL);
+    close(irq->wake_fd);
+    irq->wake_fd = 0;
+    return 0;
+}
+
+int prussdrv_irqthread_stopping(unsigned int host_interrupt)
+{
+    return host_interrupt < NUM_PRU_HOSTIRQS
+        && prussdrv.irqthread[host_interrupt].stopping;
+}
+
 int prussdrv_exit()
 {
     int i;
+    for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
+        if (prussdrv.irqthread[i].wake_fd)
+            prussdrv_stop_irqthread(i);
+    }
     munmap(prussdrv.pru0_dataram_base, prussdrv.pruss_map_size);
     munmap(prussdrv.l3ram_base, prussdrv.l3ram_map_size);
     munmap(prussdrv.extram_base, prussdrv.extram_map_size);
+    if (prussdrv.epoll_fd)
+        close(prussdrv.epoll_fd);
     for (i = 0; i < NUM_PRU_HOSTIRQS; i++) {
         if (prussdrv.fd[i])
             close(prussdrv.fd[i]);
@@ -669,40 +1566,15 @@ int prussdrv_exec_program(int prunum, const char *filename)
 
 int prussdrv_exec_program_at(int prunum, const char *filename, size_t addr)
 {
-    FILE *fPtr;
-    unsigned char fileDataArray[PRUSS_MAX_IRAM_SIZE];
-    int fileSize = 0;
-
-    // Open an File from the hard drive
-    fPtr = fopen(filename, "rb");
-    if (fPtr == NULL) {
-        DEBUG_PRINTF("File %s open failed\n", filename);
-	return -1;
-    } else {
-        DEBUG_PRINTF("File %s open passed\n", filename);
-    }
-    // Read file size
-    fseek(fPtr, 0, SEEK_END);
-    fileSize = ftell(fPtr);
+    tprussdrv_image *image;
+    int ret;
 
-    if (fileSize == 0) {
-        DEBUG_PRINTF("File read failed.. Closing program\n");
-        fclose(fPtr);
+    image = prussdrv_image_open(filename);
+    if (image == NULL)
         return -1;
-    }
-
-    fseek(fPtr, 0, SEEK_SET);
-
-    if (fileSize !=
-        fread((unsigned char *) fileDataArray, 1, fileSize, fPtr)) {
-        DEBUG_PRINTF("WARNING: File Size mismatch\n");
-	fclose(fPtr);
-	return -1;
-    }
-
-    fclose(fPtr);
-
-    return prussdrv_exec_code_at(prunum, (const unsigned int *) fileDataArray, fileSize, addr);
+    ret = prussdrv_exec_image_at(prunum, image, addr);
+    prussdrv_image_close(image);
+    return ret;
 }
 
 int prussdrv_exec_code(int prunum, const unsigned int *code, int codelen)
@@ -720,10 +1592,18 @@ int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen, siz
         pru_ram_id = PRUSS0_PRU1_IRAM;
     else
         return -1;
+    // Check the fit first, so a program that is too big leaves the PRU
+    // running
+    if (codelen < 0 || (unsigned int) codelen > prussdrv.iram_size) {
+        DEBUG_PRINTF("Program of %d bytes exceeds %u byte IRAM\n",
+                     codelen, prussdrv.iram_size);
+        return -1;
+    }
 
     // Make sure PRU sub system is first disabled/reset
     prussdrv_pru_disable(prunum);
-    prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen);
+    if (prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen) < 0)
+        return -1;
     prussdrv_pru_enable_at(prunum, addr);
 
     return 0;
@@ -731,57 +1611,254 @@ int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen, siz
 
 int prussdrv_load_datafile(int prunum, const char *filename)
 {
-    FILE *fPtr;
-    unsigned char fileDataArray[PRUSS_MAX_IRAM_SIZE];
-    int fileSize = 0;
+    tprussdrv_image *image;
+    int ret;
 
-    // Open an File from the hard drive
-    fPtr = fopen(filename, "rb");
-    if (fPtr == NULL) {
+    image = prussdrv_image_open(filename);
+    if (image == NULL)
+        return -1;
+    ret = prussdrv_load_data_image(prunum, image);
+    prussdrv_image_close(image);
+    return ret;
+}
+
+int prussdrv_load_data(int prunum, const unsigned int *code, int codelen)
+{
+    unsigned int pru_ram_id;
+
+    if (prunum == 0)
+        pru_ram_id = PRUSS0_PRU0_DATARAM;
+    else if (prunum == 1)
+        pru_ram_id = PRUSS0_PRU1_DATARAM;
+    else
+        return -1;
+    if (codelen < 0 || (unsigned int) codelen > prussdrv.dataram_size) {
+        DEBUG_PRINTF("Data of %d bytes exceeds %u byte data RAM\n",
+                     codelen, prussdrv.dataram_size);
+        return -1;
+    }
+
+    // Make sure PRU sub system is first disabled/reset
+    prussdrv_pru_disable(prunum);
+    if (prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen) < 0)
+        return -1;
+    //prussdrv_pru_enable(prunum);
+
+    return 0;
+}
+
+tprussdrv_image *prussdrv_image_open(const char *filename)
+{
+    tprussdrv_image *image;
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         DEBUG_PRINTF("File %s open failed\n", filename);
-	return -1;
-    } else {
-        DEBUG_PRINTF("File %s open passed\n", filename);
+        return NULL;
     }
-    // Read file size
-    fseek(fPtr, 0, SEEK_END);
-    fileSize = ftell(fPtr);
+    DEBUG_PRINTF("File %s open passed\n", filename);
 
-    if (fileSize == 0) {
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
         DEBUG_PRINTF("File read failed.. Closing program\n");
-        fclose(fPtr);
-        return -1;
+        close(fd);
+        return NULL;
     }
 
-    fseek(fPtr, 0, SEEK_SET);
+    // Fault the pages in now so that a later exec only pays for the copy
+    // into PRU memory
+    data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        DEBUG_PRINTF("File %s mmap failed\n", filename);
+        return NULL;
+    }
 
-    if (fileSize !=
-        fread((unsigned char *) fileDataArray, 1, fileSize, fPtr)) {
-        DEBUG_PRINTF("WARNING: File Size mismatch\n");
-	fclose(fPtr);
-	return -1;
+    image = malloc(sizeof(*image));
+    if (image == NULL) {
+        munmap((void *) data, st.st_size);
+        return NULL;
     }
+    image->data = data;
+    image->size = st.st_size;
+    return image;
+}
+
+void prussdrv_image_close(tprussdrv_image *image)
+{
+    if (image == NULL)
+        return;
+    munmap((void *) image->data, image->size);
+    free(image);
+}
 
-    fclose(fPtr);
+size_t prussdrv_image_size(const tprussdrv_image *image)
+{
+    return image->size;
+}
 
-    return prussdrv_load_data(prunum, (const unsigned int *) fileDataArray, fileSize);
+int prussdrv_exec_image(int prunum, const tprussdrv_image *image)
+{
+    return prussdrv_exec_image_at(prunum, image, 0);
 }
 
-int prussdrv_load_data(int prunum, const unsigned int *code, int codelen)
+int prussdrv_exec_image_at(int prunum, const tprussdrv_image *image, size_t addr)
+{
+    return prussdrv_exec_code_at(prunum, (const unsigned int *) image->data,
+                                 image->size, addr);
+}
+
+int prussdrv_load_data_image(int prunum, const tprussdrv_image *image)
+{
+    return prussdrv_load_data(prunum, (const unsigned int *) image->data,
+                              image->size);
+}
+
+/* Find an overlay in a store, checking that it lies within the file */
+static int __prussdrv_overlay_find(const tprussdrv_image *store,
+                                   unsigned int index,
+                                   tprussdrv_overlay_header *header,
+                                   tprussdrv_overlay_entry *entry)
+{
+    const unsigned char *data = store->data;
+    size_t table;
+
+    if (store->size < sizeof(*header))
+        return -1;
+    memcpy(header, data, sizeof(*header));
+    if (header->magic != PRUSSDRV_OVERLAY_MAGIC)
+        return -1;
+    table = (store->size - sizeof(*header)) / sizeof(*entry);
+    if (header->count > table)
+        return -1;
+    if (entry == NULL)
+        return 0;
+    if (index >= header->count)
+        return -1;
+
+    memcpy(entry, data + sizeof(*header) + index * sizeof(*entry),
+           sizeof(*entry));
+    if (entry->offset > store->size || entry->words > header->window_words ||
+        entry->words > (store->size - entry->offset) / sizeof(uint32_t))
+        return -1;
+    return 0;
+}
+
+int prussdrv_overlay_count(const tprussdrv_image *store)
+{
+    tprussdrv_overlay_header header;
+
+    if (__prussdrv_overlay_find(store, 0, &header, NULL) < 0)
+        return -1;
+    return header.count;
+}
+
+int prussdrv_pru_load_overlay(unsigned int prunum,
+                              const tprussdrv_image *store,
+                              unsigned int index)
 {
+    tprussdrv_overlay_header header;
+    tprussdrv_overlay_entry entry;
     unsigned int pru_ram_id;
+    int words;
 
     if (prunum == 0)
-        pru_ram_id = PRUSS0_PRU0_DATARAM;
+        pru_ram_id = PRUSS0_PRU0_IRAM;
     else if (prunum == 1)
-        pru_ram_id = PRUSS0_PRU1_DATARAM;
+        pru_ram_id = PRUSS0_PRU1_IRAM;
     else
         return -1;
+    if (__prussdrv_overlay_find(store, index, &header, &entry) < 0) {
+        DEBUG_PRINTF("Overlay %u not found in the store\n", index);
+        return -1;
+    }
+    if (header.window > prussdrv.iram_size >> 2 ||
+        entry.words > (prussdrv.iram_size >> 2) - header.window) {
+        DEBUG_PRINTF("Overlay %u at word %u exceeds %u byte IRAM\n",
+                     index, header.window, prussdrv.iram_size);
+        return -1;
+    }
+    if (entry.entry >= prussdrv.iram_size >> 2) {
+        DEBUG_PRINTF("Overlay %u entry at word %u is outside IRAM\n",
+                     index, entry.entry);
+        return -1;
+    }
 
-    // Make sure PRU sub system is first disabled/reset
+    // IRAM can only be written while the PRU is stopped
     prussdrv_pru_disable(prunum);
-    prussdrv_pru_write_memory(pru_ram_id, 0, code, codelen);
-    //prussdrv_pru_enable(prunum);
+    words = prussdrv_pru_write_memory(pru_ram_id, header.window,
+                (const unsigned int *) ((const unsigned char *) store->data +
+                                        entry.offset),
+                entry.words * sizeof(uint32_t));
+    if (words < 0)
+        return -1;
+    prussdrv_pru_enable_at(prunum, entry.entry * sizeof(uint32_t));
+    return words;
+}
+
+int prussdrv_pru_swap_firmware(unsigned int prunum, unsigned int mailbox,
+                               const tprussdrv_firmware *firmware,
+                               int timeout_us)
+{
+    volatile tprussdrv_swap_mailbox *box;
+    unsigned int pru_ram_id, pc;
+    long long end;
+    void *dataram;
 
+    if (prunum == 0) {
+        pru_ram_id = PRUSS0_PRU0_IRAM;
+        dataram = prussdrv.pru0_dataram_base;
+    } else if (prunum == 1) {
+        pru_ram_id = PRUSS0_PRU1_IRAM;
+        dataram = prussdrv.pru1_dataram_base;
+    } else
+        return -1;
+    if ((mailbox & 3) || mailbox + sizeof(*box) > prussdrv.dataram_size
+        || firmware->codelen > prussdrv.iram_size
+        || (firmware->entry & 3) || firmware->entry >= firmware->codelen)
+        return -1;
+    box = (volatile tprussdrv_swap_mailbox *) ((char *) dataram + mailbox);
+    if (box->layout != firmware->layout) {
+        DEBUG_PRINTF("Data RAM layout %u, firmware expects %u\n",
+                     box->layout, firmware->layout);
+        return -1;
+    }
+
+    // Everything is checked; the PRU stands still only from here on
+    if (prussdrv_pru_read_pc(prunum, &pc) == 1) {
+        box->request = PRUSSDRV_SWAP_REQUEST;
+        end = __prussdrv_usecs() + timeout_us;
+        while (prussdrv_pru_read_pc(prunum, &pc) == 1) {
+            // Once acknowledged, the halt is the next instruction
+            if (box->request == PRUSSDRV_SWAP_ACK || timeout_us < 0
+                || __prussdrv_usecs() < end)
+                continue;
+            // Withdraw it. The PRU may have loaded the request just
+            // before, and then still acknowledges it and halts; give it
+            // the time to, and go by its run state after that
+            box->request = 0;
+            end = __prussdrv_usecs() + PRUSSDRV_SWAP_ACK_USECS;
+            while (box->request != PRUSSDRV_SWAP_ACK
+                   && __prussdrv_usecs() < end)
+                ;
+            if (box->request != PRUSSDRV_SWAP_ACK
+                && prussdrv_pru_read_pc(prunum, &pc) == 1) {
+                DEBUG_PRINTF("PRU%u did not reach its safe label\n", prunum);
+                return -1;
+            }
+        }
+    }
+
+    // IRAM can only be written while the PRU is stopped
+    prussdrv_pru_disable(prunum);
+    if (prussdrv_pru_write_memory(pru_ram_id, 0, firmware->code,
+                                  firmware->codelen) < 0) {
+        box->request = 0;
+        return -1;
+    }
+    box->request = 0;
+    prussdrv_pru_enable_at(prunum, firmware->entry);
     return 0;
 }
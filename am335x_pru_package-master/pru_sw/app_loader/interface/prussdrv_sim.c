@@ -0,0 +1,193 @@
+/*
+ * prussdrv_sim.c
+ *
+ * Simulated PRUSS backend for the user space driver
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+
+/*
+ * ============================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+
+
+
+/*
+ * The simulation stands in for the PRUSS of an AM33XX without any
+ * hardware. Setting PRUSSDRV_SIM to a directory before prussdrv_init()
+ * selects it.
+ *
+ *   - The PRUSS address space (IRAM, data RAM, shared RAM and the INTC
+ *     and control register files) is the file "pruss" in that directory,
+ *     and extmem is the file "extmem". Both are mapped shared, so another
+ *     process can inspect or drive the same memory.
+ *   - Each host interrupt is an eventfd. A system event raised with
+ *     prussdrv_pru_send_event() is routed through the INTC map given to
+ *     prussdrv_pruintc_init() and signals the host interrupt it reaches.
+ *   - The registers are plain memory. Nothing executes the PRU code, so
+ *     a program that waits for a PRU event needs another thread to raise
+ *     it in place of the PRU. Only the raw status registers (SRSR1/2)
+ *     follow the events raised and cleared, for busy polling.
+ */
+
+#include <prussdrv.h>
+#include "__prussdrv.h"
+#include <stdio.h>
+#include <sys/eventfd.h>
+
+#ifdef __DEBUG
+#define DEBUG_PRINTF(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+#else
+#define DEBUG_PRINTF(FORMAT, ...)
+#endif
+
+#define PRUSS_SIM_PATH_LEN 256
+
+/* Map a backing file of the given size, creating it if needed */
+static void *__prussdrv_sim_map(const char *dir, const char *name,
+                                size_t size)
+{
+    char path[PRUSS_SIM_PATH_LEN];
+    struct stat st;
+    void *base;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 ||
+        (st.st_size < size && ftruncate(fd, size) < 0)) {
+        close(fd);
+        return NULL;
+    }
+    base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return base == MAP_FAILED ? NULL : base;
+}
+
+static int __prussdrv_sim_open(tprussdrv *drv, unsigned int host_interrupt)
+{
+    return eventfd(0, 0);
+}
+
+static int __prussdrv_sim_memmap_init(tprussdrv *drv)
+{
+    unsigned int *pruss_io;
+
+    // Every host interrupt shares the one mapping
+    if (drv->pru0_dataram_base)
+        return 0;
+
+    if (mkdir(drv->sim_dir, 0700) < 0 && errno != EEXIST)
+        return -1;
+
+    drv->pruss_phys_base = AM33XX_DATARAM0_PHYS_BASE;
+    drv->pruss_map_size = AM33XX_PRUSS_MMAP_SIZE;
+    pruss_io = __prussdrv_sim_map(drv->sim_dir, "pruss", drv->pruss_map_size);
+    if (pruss_io == NULL)
+        return -1;
+
+    // Answer the version check the way an AM33XX INTC would
+    pruss_io[(AM33XX_INTC_PHYS_BASE - AM33XX_DATARAM0_PHYS_BASE) >> 2] =
+        AM33XX_PRUSS_INTC_REV;
+    drv->pru0_dataram_base = pruss_io;
+    __prussdrv_memmap_layout();
+
+    drv->extram_phys_base = PRUSSDRV_SIM_EXTRAM_PHYS_BASE;
+    drv->extram_map_size = PRUSSDRV_SIM_EXTRAM_SIZE;
+    drv->extram_base =
+        __prussdrv_sim_map(drv->sim_dir, "extmem", drv->extram_map_size);
+    if (drv->extram_base == NULL)
+        return -1;
+
+    return 0;
+}
+
+/* An eventfd reads back the interrupts since the last read, while UIO
+ * reports a running total; keep the total here */
+static int __prussdrv_sim_read_count(tprussdrv *drv,
+                                     unsigned int host_interrupt,
+                                     unsigned int *count)
+{
+    uint64_t value;
+
+    if (read(drv->fd[host_interrupt], &value, sizeof(value)) != sizeof(value))
+        return -1;
+    drv->sim_count[host_interrupt] += value;
+    *count = drv->sim_count[host_interrupt];
+    return 0;
+}
+
+static void __prussdrv_sim_send_event(tprussdrv *drv, unsigned int eventnum)
+{
+    uint64_t one = 1;
+    short host;
+
+    // The registers are plain memory, so keep the raw status here
+    __sync_fetch_and_or(&drv->sim_status[eventnum >> 5], 1 << (eventnum & 31));
+    ((volatile unsigned int *) drv->intc_base)
+        [(eventnum < 32 ? PRU_INTC_SRSR1_REG : PRU_INTC_SRSR2_REG) >> 2] =
+        drv->sim_status[eventnum >> 5];
+
+    host = prussdrv_get_event_to_host_map(eventnum);
+    if (host < 0 || host >= NUM_PRU_HOSTIRQS || !drv->fd[host])
+        return;
+    if (write(drv->fd[host], &one, sizeof(one)) != sizeof(one))
+        DEBUG_PRINTF("Host interrupt %d signal failed\n", host);
+}
+
+static void __prussdrv_sim_clear_event(tprussdrv *drv, unsigned int eventnum)
+{
+    __sync_fetch_and_and(&drv->sim_status[eventnum >> 5],
+                         ~(1 << (eventnum & 31)));
+    ((volatile unsigned int *) drv->intc_base)
+        [(eventnum < 32 ? PRU_INTC_SRSR1_REG : PRU_INTC_SRSR2_REG) >> 2] =
+        drv->sim_status[eventnum >> 5];
+}
+
+const tprussdrv_backend __prussdrv_sim_backend = {
+    "sim",
+    __prussdrv_sim_open,
+    __prussdrv_sim_memmap_init,
+    __prussdrv_sim_read_count,
+    __prussdrv_sim_send_event,
+    __prussdrv_sim_clear_event
+};
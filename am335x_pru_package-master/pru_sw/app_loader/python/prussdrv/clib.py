@@ -49,6 +49,8 @@ prototype( 'pru_write_memory',         [c_uint,         # pru_ram_id
                                         POINTER(c_uint),# memarea
                                         c_uint] )       # bytelength
 prototype( 'pruintc_init',             [POINTER(tpruss_intc_initdata)] )
+prototype( 'pruintc_map_event',        [c_uint, c_int]      )
+prototype( 'pruintc_map_channel',      [c_uint, c_uint]     )
 prototype( 'get_event_to_channel_map', [c_uint],  c_short   )
 prototype( 'get_channel_to_host_map',  [c_uint],  c_short   )
 prototype( 'get_event_to_host_map',    [c_uint],  c_short   )
@@ -0,0 +1,231 @@
+/*
+ * eventtest.c
+ *
+ * Drives the prussdrv event dispatcher, interrupt coalescing, busy
+ * polling and interrupt threads with pipes standing in for the /dev/uio*
+ * host interrupt fds, and a plain buffer for the INTC.
+ */
+
+#include "../interface/prussdrv.c"
+
+static unsigned int intc[0x1600 / 4];
+static int writer[NUM_PRU_HOSTIRQS];
+static unsigned int total[NUM_PRU_HOSTIRQS];
+static unsigned int seen[NUM_PRU_HOSTIRQS];
+static int failed;
+
+#define CHECK(COND) \
+    do { if (!(COND)) { printf("FAILED: %s (line %d)\n", #COND, __LINE__); \
+                        failed = 1; } } while (0)
+
+/* Stand in for the UIO driver: the fd reads back a running total */
+static void fire(unsigned int host_interrupt, unsigned int times)
+{
+    total[host_interrupt] += times;
+    if (write(writer[host_interrupt], &total[host_interrupt],
+              sizeof(total[host_interrupt])) < 0)
+        perror("write");
+}
+
+static void handler(unsigned int host_interrupt, unsigned int count,
+                    void *arg)
+{
+    CHECK(arg == &seen[host_interrupt]);
+    // The system event must already be cleared and the host re-enabled
+    CHECK(intc[PRU_INTC_HIEISR_REG >> 2] == host_interrupt + 2);
+    seen[host_interrupt] += count;
+}
+
+/* Interrupts that bring no new events, every 30 ms for 300 ms */
+static void *stray(void *arg)
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        usleep(30000);
+        fire(0, 1);
+    }
+    return NULL;
+}
+
+static volatile unsigned int woken;
+static int policy, cpu;
+
+/* An interrupt thread the way a program would write one */
+static void *irqthread(void *arg)
+{
+    CHECK(arg == (void *) &woken);
+    policy = sched_getscheduler(0);
+    cpu = sched_getcpu();
+    while (!prussdrv_irqthread_stopping(1)) {
+        if (prussdrv_pru_wait_event(1))
+            woken++;
+        prussdrv_pru_clear_event(1, 20);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    tprussdrv_irqthread_attr attr = { 0, 0, 0, 0 };
+    tprussdrv_coalesce config;
+    tprussdrv_event_stats stats;
+    tprussdrv_poll poll;
+    unsigned int counter;
+    long long start;
+    pthread_t thread;
+    int fds[2], i;
+
+    prussdrv_init();
+    prussdrv.intc_base = intc;
+    for (i = 0; i < 3; i++) {
+        if (pipe(fds) < 0) {
+            perror("pipe");
+            return 1;
+        }
+        prussdrv.fd[i] = fds[0];
+        writer[i] = fds[1];
+    }
+
+    CHECK(prussdrv_event_fd() == -1);
+    CHECK(prussdrv_event_dispatch(0) == -1);
+    CHECK(prussdrv_event_register(3, 21, handler, NULL) == -1);
+    CHECK(prussdrv_event_register(0, 64, handler, NULL) == -1);
+    for (i = 0; i < 3; i++)
+        CHECK(prussdrv_event_register(i, 19 + i, handler, &seen[i]) == 0);
+    CHECK(prussdrv_event_fd() >= 0);
+
+    CHECK(prussdrv_event_dispatch(0) == 0);
+
+    // One dispatch hands back every ready host interrupt
+    fire(0, 1);
+    fire(2, 1);
+    CHECK(prussdrv_event_dispatch(0) == 2);
+    CHECK(seen[0] == 1 && seen[1] == 0 && seen[2] == 1);
+    CHECK(intc[PRU_INTC_SECR1_REG >> 2] & ((1 << 19) | (1 << 21)));
+
+    // Interrupts that arrive between dispatches come back as one count
+    fire(1, 1);
+    CHECK(prussdrv_event_dispatch(-1) == 1);
+    fire(1, 5);
+    CHECK(prussdrv_event_dispatch(-1) == 1);
+    CHECK(seen[1] == 6);
+
+    // Once unregistered, a host interrupt is no longer waited on
+    CHECK(prussdrv_event_unregister(2) == 0);
+    CHECK(prussdrv_event_unregister(2) == -1);
+    fire(2, 1);
+    CHECK(prussdrv_event_dispatch(0) == 0);
+    CHECK(seen[2] == 1);
+
+    // Without coalescing, a wakeup reports the interrupts since the last
+    CHECK(prussdrv_pru_wait_events(0, 19, 0) == 0);
+    fire(0, 1);
+    CHECK(prussdrv_pru_wait_events(0, 19, -1) == 1);
+    fire(0, 4);
+    CHECK(prussdrv_pru_wait_events(0, 19, -1) == 4);
+    CHECK(intc[PRU_INTC_HIEISR_REG >> 2] == 2);
+
+    // A window gathers the interrupts that follow the first one
+    memset(&config, 0, sizeof(config));
+    config.max_usecs = 20000;
+    CHECK(prussdrv_pru_set_coalesce(0, &config) == 0);
+    fire(0, 1);
+    fire(0, 2);
+    start = __prussdrv_usecs();
+    CHECK(prussdrv_pru_wait_events(0, 19, -1) == 3);
+    CHECK(__prussdrv_usecs() - start >= 20000);
+
+    // The PRU's own count takes in events that raised no interrupt, and
+    // reaching max_events ends the window
+    counter = 100;
+    config.max_events = 8;
+    config.max_usecs = 10000;
+    config.counter = &counter;
+    CHECK(prussdrv_pru_set_coalesce(0, &config) == 0);
+    counter += 9;
+    fire(0, 1);
+    CHECK(prussdrv_pru_wait_events(0, 19, -1) == 9);
+
+    // An interrupt for events that were already reported wakes no one
+    fire(0, 1);
+    CHECK(prussdrv_pru_wait_events(0, 19, 0) == 0);
+    CHECK(prussdrv_pru_event_stats(0, &stats) == 0);
+    CHECK(stats.wakeups == 1 && stats.events == 9 && stats.interrupts == 2);
+    CHECK(stats.missed == 8 && stats.max_batch == 9);
+
+    // Such interrupts do not restart the timeout
+    pthread_create(&thread, NULL, stray, NULL);
+    start = __prussdrv_usecs();
+    CHECK(prussdrv_pru_wait_events(0, 19, 100) == 0);
+    CHECK(__prussdrv_usecs() - start >= 100000);
+    CHECK(__prussdrv_usecs() - start < 200000);
+    pthread_join(thread, NULL);
+    CHECK(prussdrv_pru_wait_events(0, 19, 0) == 0);
+
+    // Busy polling takes a raised event from the INTC status, with the
+    // host interrupt left disabled
+    CHECK(prussdrv_pru_set_poll(0, NULL) == 0);
+    intc[PRU_INTC_SRSR1_REG >> 2] = 1 << 19;
+    CHECK(prussdrv_pru_poll_event(0, 19, 0) == 1);
+    CHECK(intc[PRU_INTC_SECR1_REG >> 2] == 1 << 19);
+    CHECK(intc[PRU_INTC_HIDISR_REG >> 2] == 2);
+    intc[PRU_INTC_SRSR1_REG >> 2] = 0;
+    CHECK(prussdrv_pru_poll_event(0, 19, 0) == 0);
+    CHECK(intc[PRU_INTC_HIDISR_REG >> 2] == 2);
+
+    // A doorbell reports how many events came in since the last wakeup
+    memset(&poll, 0, sizeof(poll));
+    poll.spin_usecs = 1000;
+    poll.doorbell = &counter;
+    CHECK(prussdrv_pru_set_poll(0, &poll) == 0);
+    counter += 3;
+    CHECK(prussdrv_pru_poll_event(0, 19, -1) == 3);
+
+    // Once spinning gives up, an interrupt for nothing new wakes no one
+    start = __prussdrv_usecs();
+    fire(0, 1);
+    CHECK(prussdrv_pru_poll_event(0, 19, 10) == 0);
+    CHECK(__prussdrv_usecs() - start >= 10000);
+    CHECK(prussdrv_pru_event_stats(0, &stats) == 0);
+    CHECK(stats.wakeups == 1 && stats.polled == 1 && stats.events == 3);
+    CHECK(stats.interrupts == 1 && stats.max_batch == 3);
+
+    // An interrupt thread runs until it is stopped, even while it waits
+    CHECK(prussdrv_start_irqthread_attr(1, &attr, irqthread, (void *) &woken) == 0);
+    CHECK(prussdrv_start_irqthread_attr(1, &attr, irqthread, (void *) &woken) == -1);
+    CHECK(policy == SCHED_OTHER && cpu == 0);
+    fire(1, 1);
+    fire(1, 1);
+    for (i = 0; i < 1000 && woken < 2; i++)
+        usleep(1000);
+    CHECK(woken == 2);
+    CHECK(prussdrv_stop_irqthread(1) == 0);
+    CHECK(prussdrv_stop_irqthread(1) == -1);
+    CHECK(prussdrv_irqthread_stopping(1));
+
+    // Real-time, where the system allows it
+    attr.priority = 1;
+    attr.lock_memory = 1;
+    if (prussdrv_start_irqthread_attr(1, &attr, irqthread, (void *) &woken) == 0) {
+        CHECK(policy == SCHED_FIFO);
+        CHECK(!prussdrv_irqthread_stopping(1));
+        CHECK(prussdrv_stop_irqthread(1) == 0);
+        munlockall();
+    } else
+        printf("eventtest: no SCHED_FIFO or mlockall here (%s)\n",
+               strerror(errno));
+    CHECK(prussdrv_start_irqthread_attr(3, &attr, irqthread, NULL) == -1);
+    attr.stack_size = 1024;
+    CHECK(prussdrv_start_irqthread_attr(1, &attr, irqthread, NULL) == -1);
+
+    CHECK(prussdrv_pru_set_poll(NUM_PRU_HOSTIRQS, NULL) == -1);
+    CHECK(prussdrv_pru_poll_event(3, 22, 0) == -1);
+    CHECK(prussdrv_pru_set_coalesce(NUM_PRU_HOSTIRQS, NULL) == -1);
+    CHECK(prussdrv_pru_wait_events(3, 22, 0) == -1);
+    CHECK(prussdrv_pru_wait_events(0, 64, 0) == -1);
+
+    if (!failed)
+        printf("eventtest ok\n");
+    return failed;
+}
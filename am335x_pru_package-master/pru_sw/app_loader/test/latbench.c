@@ -0,0 +1,221 @@
+/*
+ * latbench.c
+ *
+ * Times how long a PRU event takes to reach the ARM on each of the ways
+ * prussdrv can wait for one: a blocking read of the host interrupt, the
+ * epoll event set, and busy polling the INTC status or a doorbell in PRU
+ * data RAM. A thread raises the same stream of events for each, in place
+ * of the PRU, on the simulated PRUSS.
+ *
+ * usage: latbench [-n events] [-s spin_usecs] [-c cpu]  (with PRUSSDRV_SIM set)
+ */
+
+#define _GNU_SOURCE
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define GAP_USECS       200     //Mean gap between events
+#define BUCKETS         12      //Under 1, 2, 4 ... 1024 us, and the rest
+
+enum { MODE_UIO, MODE_EPOLL, MODE_POLL, MODE_DOORBELL, MODES };
+
+static const char *mode_name[MODES] = { "uio", "epoll", "poll", "doorbell" };
+
+static unsigned int events = 2000;
+static volatile unsigned int *doorbell;
+static volatile long long raised;       //When the last event was raised
+static volatile unsigned int taken;     //Events the waiter is done with
+
+static long long now_nsecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Stands in for the PRU: one event at a time, at irregular gaps */
+static void *pru0(void *arg)
+{
+    unsigned int i;
+
+    srand(1);
+    for (i = 0; i < events; i++) {
+        while (taken != i)
+            sched_yield();
+        usleep(GAP_USECS / 2 + rand() % GAP_USECS);
+        raised = now_nsecs();
+        __sync_synchronize();
+        (*doorbell)++;
+        prussdrv_pru_send_event(PRU0_ARM_INTERRUPT);
+    }
+    return NULL;
+}
+
+static void handler(unsigned int host_interrupt, unsigned int count,
+                    void *arg)
+{
+}
+
+static int compare(const void *a, const void *b)
+{
+    long long x = *(const long long *) a, y = *(const long long *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Wait for every event of the stream the given way, and keep the
+ * latencies sorted */
+static void run(int mode, long long *latency)
+{
+    pthread_t thread;
+    unsigned int i;
+
+    taken = 0;
+    if (mode == MODE_EPOLL)
+        prussdrv_event_register(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT, handler,
+                                NULL);
+    pthread_create(&thread, NULL, pru0, NULL);
+    for (i = 0; i < events; i++) {
+        switch (mode) {
+        case MODE_UIO:
+            prussdrv_pru_wait_event(PRU_EVTOUT_0);
+            prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
+            break;
+        case MODE_EPOLL:
+            prussdrv_event_dispatch(-1);
+            break;
+        default:
+            prussdrv_pru_poll_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT, -1);
+            break;
+        }
+        latency[i] = now_nsecs() - raised;
+        taken = i + 1;
+    }
+    pthread_join(thread, NULL);
+    if (mode == MODE_EPOLL)
+        prussdrv_event_unregister(PRU_EVTOUT_0);
+    qsort(latency, events, sizeof(*latency), compare);
+}
+
+static double usecs(long long *latency, double fraction)
+{
+    return latency[(unsigned int) ((events - 1) * fraction)] / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    unsigned int histogram[MODES][BUCKETS];
+    unsigned long long polled[MODES];
+    tprussdrv_event_stats stats;
+    tprussdrv_poll poll;
+    long long *latency[MODES];
+    cpu_set_t cpus;
+    int opt, mode, b, first, last, cpu = -1;
+    unsigned int i, spin_usecs = 2 * GAP_USECS;
+
+    while ((opt = getopt(argc, argv, "n:s:c:")) != -1) {
+        switch (opt) {
+        case 'n': events = atoi(optarg); break;
+        case 's': spin_usecs = atoi(optarg); break;
+        case 'c': cpu = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: latbench [-n events] [-s spin_usecs] [-c cpu]\n");
+            return 1;
+        }
+    }
+    if (!events)
+        return 1;
+
+    // Pin the waiter, as a busy poll wants a core of its own
+    if (cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+            fprintf(stderr, "Cannot run on CPU %d\n", cpu);
+            return 1;
+        }
+    }
+
+    prussdrv_init();
+    if (prussdrv_open(PRU_EVTOUT_0)) {
+        fprintf(stderr, "prussdrv_open failed\n");
+        return 1;
+    }
+    prussdrv_pruintc_init(&intc);
+    prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, (void **) &doorbell);
+
+    memset(histogram, 0, sizeof(histogram));
+    for (mode = 0; mode < MODES; mode++) {
+        memset(&poll, 0, sizeof(poll));
+        poll.spin_usecs = spin_usecs;
+        if (mode == MODE_DOORBELL)
+            poll.doorbell = doorbell;
+        prussdrv_pru_set_poll(PRU_EVTOUT_0, &poll);
+
+        latency[mode] = malloc(events * sizeof(long long));
+        run(mode, latency[mode]);
+        prussdrv_pru_event_stats(PRU_EVTOUT_0, &stats);
+        polled[mode] = stats.polled;
+        for (i = 0; i < events; i++) {
+            for (b = 0; b < BUCKETS - 1; b++)
+                if (latency[mode][i] < 1000LL << b)
+                    break;
+            histogram[mode][b]++;
+        }
+    }
+
+    printf("%u events per mode, %ld CPU(s), spinning for %u us",
+           events, sysconf(_SC_NPROCESSORS_ONLN), spin_usecs);
+    if (cpu >= 0)
+        printf(", waiter on CPU %d", cpu);
+    printf("\n\n%-10s %9s %9s %9s %9s %9s\n",
+           "(us)", "p50", "p99", "p99.9", "max", "polled");
+    for (mode = 0; mode < MODES; mode++) {
+        printf("%-10s %9.1f %9.1f %9.1f %9.1f", mode_name[mode],
+               usecs(latency[mode], 0.5), usecs(latency[mode], 0.99),
+               usecs(latency[mode], 0.999), usecs(latency[mode], 1.0));
+        if (mode >= MODE_POLL)
+            printf(" %8.1f%%", 100.0 * polled[mode] / events);
+        printf("\n");
+    }
+
+    // Only the buckets from the first to the last one used
+    for (first = 0; first < BUCKETS - 1; first++)
+        for (mode = 0; mode < MODES; mode++)
+            if (histogram[mode][first])
+                goto found_first;
+found_first:
+    for (last = BUCKETS - 1; last > first; last--)
+        for (mode = 0; mode < MODES; mode++)
+            if (histogram[mode][last])
+                goto found_last;
+found_last:
+    printf("\n%-10s", "events");
+    for (mode = 0; mode < MODES; mode++)
+        printf(" %9s", mode_name[mode]);
+    printf("\n");
+    for (b = first; b <= last; b++) {
+        if (b < BUCKETS - 1)
+            printf("< %-4d us ", 1 << b);
+        else
+            printf(">= %-4d us", 1 << (b - 1));
+        for (mode = 0; mode < MODES; mode++)
+            printf(" %9u", histogram[mode][b]);
+        printf("\n");
+    }
+
+    for (mode = 0; mode < MODES; mode++)
+        free(latency[mode]);
+    prussdrv_exit();
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * membench.c
+ *
+ * Checks and times the PRU memory copy routines in prussdrv.c against
+ * file-backed mappings that stand in for /dev/uio0.
+ */
+
+#include "../interface/prussdrv.c"
+
+#include <sys/time.h>
+
+#define EXTMEM_SIZE     (1 << 20)
+#define BENCH_BYTES     (64 << 20)
+#define CHECK_LOOPS     20000
+
+static unsigned char shadow[EXTMEM_SIZE];
+static unsigned char buffer[EXTMEM_SIZE];
+
+static void *map_standin(const char *path, size_t size)
+{
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        perror(path);
+        exit(1);
+    }
+    base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    unlink(path);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    return base;
+}
+
+/* Lay the stand-in out the way __prussdrv_memmap_init() does for AM33XX */
+static void setup_standin(void)
+{
+    unsigned char *base;
+
+    prussdrv_init();
+    base = map_standin("membench.pruss", AM33XX_PRUSS_MMAP_SIZE);
+    prussdrv.version = PRUSS_V2;
+    prussdrv.pruss_map_size = AM33XX_PRUSS_MMAP_SIZE;
+    prussdrv.pru0_dataram_base = base;
+    prussdrv.pru1_dataram_base =
+        base + AM33XX_DATARAM1_PHYS_BASE - AM33XX_DATARAM0_PHYS_BASE;
+    prussdrv.pruss_sharedram_base =
+        base + AM33XX_PRUSS_SHAREDRAM_BASE - AM33XX_DATARAM0_PHYS_BASE;
+    prussdrv.pru0_iram_base =
+        base + AM33XX_PRU0IRAM_PHYS_BASE - AM33XX_DATARAM0_PHYS_BASE;
+    prussdrv.pru1_iram_base =
+        base + AM33XX_PRU1IRAM_PHYS_BASE - AM33XX_DATARAM0_PHYS_BASE;
+    prussdrv.iram_size = AM33XX_PRUSS_IRAM_SIZE;
+    prussdrv.dataram_size = AM33XX_PRUSS_DATARAM_SIZE;
+    prussdrv.sharedram_size = AM33XX_PRUSS_SHAREDRAM_SIZE;
+    prussdrv.extram_base = map_standin("membench.extmem", EXTMEM_SIZE);
+    prussdrv.extram_map_size = EXTMEM_SIZE;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Random byte-granular writes and reads, checked against a shadow copy */
+static int check_region(unsigned int id, const char *name)
+{
+    tprussdrv_memvec vec[3];
+    unsigned int size = 0, offset, length, i, j;
+    void *base;
+
+    base = __prussdrv_ram_area(id, &size);
+    memset(shadow, 0, size);
+    memset(base, 0, size);
+
+    for (i = 0; i < CHECK_LOOPS; i++) {
+        for (j = 0; j < 3; j++) {
+            offset = rand() % size;
+            length = rand() % (size - offset + 1);
+            if (length > 64 && (rand() & 1))
+                length = rand() % 64;
+            memset(buffer + j * 64, rand(), 64);
+            buffer[j * 64] = rand();
+            vec[j].offset = offset;
+            vec[j].data = buffer + (j * 64) + (rand() & 7);
+            vec[j].length = length < 56 ? length : 56;
+        }
+        if (prussdrv_pru_write_memory_v(id, vec, 3) < 0)
+            goto fail;
+        for (j = 0; j < 3; j++)
+            memcpy(shadow + vec[j].offset, vec[j].data, vec[j].length);
+
+        offset = rand() % size;
+        length = rand() % (size - offset + 1);
+        if (prussdrv_pru_read_memory(id, offset, buffer + 1, length) < 0
+            || memcmp(buffer + 1, shadow + offset, length))
+            goto fail;
+    }
+    if (memcmp(base, shadow, size))
+        goto fail;
+
+    if (prussdrv_pru_read_memory(id, size - 3, buffer, 4) != -1)
+        goto fail;
+    vec[0].offset = 0;
+    vec[0].length = 4;
+    vec[1].offset = size;
+    vec[1].length = 1;
+    if (prussdrv_pru_write_memory_v(id, vec, 2) != -1)
+        goto fail;
+    printf("%-14s ok\n", name);
+    return 0;
+
+  fail:
+    printf("%-14s FAILED at iteration %u\n", name, i);
+    return 1;
+}
+
+/* The copy loop prussdrv_pru_write_memory() used before */
+static void old_write(unsigned int *pruramarea, const unsigned int *memarea,
+                      unsigned int bytelength)
+{
+    unsigned int i, wordlength = (bytelength + 3) >> 2;
+    for (i = 0; i < wordlength; i++)
+        *(pruramarea + i) = *(memarea + i);
+}
+
+static double mbps(double seconds)
+{
+    return BENCH_BYTES / seconds / (1 << 20);
+}
+
+static void bench_region(unsigned int id, const char *name)
+{
+    unsigned int size = 0, loops, i;
+    double t0, tw, tr, to, tm;
+    void *base;
+
+    base = __prussdrv_ram_area(id, &size);
+    if (size > 8192)
+        size = 8192;
+    loops = BENCH_BYTES / size;
+
+    t0 = now();
+    for (i = 0; i < loops; i++)
+        prussdrv_pru_write_memory(id, 0, (const unsigned int *) buffer, size);
+    tw = now() - t0;
+
+    t0 = now();
+    for (i = 0; i < loops; i++)
+        prussdrv_pru_read_memory(id, 0, buffer, size);
+    tr = now() - t0;
+
+    t0 = now();
+    for (i = 0; i < loops; i++)
+        old_write(base, (const unsigned int *) buffer, size);
+    to = now() - t0;
+
+    t0 = now();
+    for (i = 0; i < loops; i++)
+        memcpy(base, buffer, size);
+    tm = now() - t0;
+
+    printf("%-14s write %8.0f  read %8.0f  old write %8.0f  memcpy %8.0f\n",
+           name, mbps(tw), mbps(tr), mbps(to), mbps(tm));
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        unsigned int id;
+        const char *name;
+    } regions[] = {
+        { PRUSS0_PRU0_DATARAM, "PRU0 DRAM" },
+        { PRUSS0_PRU1_DATARAM, "PRU1 DRAM" },
+        { PRUSS0_SHARED_DATARAM, "Shared RAM" },
+        { PRUSS0_PRU0_IRAM, "PRU0 IRAM" },
+        { PRUSS0_EXTMEM, "DDR extmem" },
+    };
+    unsigned int i;
+    int failed = 0;
+
+    setup_standin();
+    srand(1);
+    for (i = 0; i < sizeof(regions) / sizeof(regions[0]); i++)
+        failed |= check_region(regions[i].id, regions[i].name);
+    if (failed || (argc > 1 && !strcmp(argv[1], "-c")))
+        return failed;
+
+    printf("MB/s against a file-backed mmap stand-in\n");
+    for (i = 0; i < sizeof(regions) / sizeof(regions[0]); i++)
+        bench_region(regions[i].id, regions[i].name);
+    return 0;
+}
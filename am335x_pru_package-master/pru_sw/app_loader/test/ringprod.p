@@ -0,0 +1,24 @@
+// Streams DMTIMER2 timestamps into a pru_ring in PRU data RAM without
+// ever halting. Used by ringtest to check that pru_ring.hp assembles.
+
+.origin 0
+.entrypoint START
+
+#include <pru_ring.hp>
+
+#define TCRR 0x3c
+
+START:
+    // Clear STANDBY_INIT in SYSCFG so PRU can access main memory.
+    LBCO    r0, C4, 4, 4
+    CLR     r0, r0, 4
+    SBCO    r0, C4, 4, 4
+
+    MOV     r1, 0                       // r1 = ring at start of data RAM
+    RING_OPEN r1, r2                    // r2 = head
+
+SAMPLE:
+    LBCO    r4, C1, TCRR, 4             // r4 = timestamp
+    ADD     r5, r5, 1                   // r5 = sequence number
+    RING_PUT r1, r2, r4, 8, r6, r7
+    QBA     SAMPLE
@@ -0,0 +1,140 @@
+/*
+ * ringtest.c
+ *
+ * Runs a pru_ring between two threads. The producer thread follows the
+ * RING_PUT macro in pru_ring.hp step by step, standing in for the PRU.
+ * The consumer uses the ARM side API from pru_ring.h.
+ */
+
+#include <pru_ring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define ENTRIES         4096
+
+typedef struct {
+    uint32_t timestamp;
+    uint32_t sequence;
+} tsample;
+
+static tpru_ring *ring;
+static uint32_t produced;
+static uint32_t burst;   /* Samples between producer yields */
+
+/* The PRU producer: same loads, tests and stores as RING_PUT */
+static void pru_put(uint32_t *head, const tsample *sample)
+{
+    volatile uint32_t *slot;
+    uint32_t used, tmp;
+
+    used = *head - ring->tail;
+    tmp = ring->mask;
+    if (used > tmp) {
+        ring->overruns = ring->overruns + 1;
+        return;
+    }
+    used = (*head & tmp) << ring->entry_shift;
+    slot = (volatile uint32_t *) ((char *) ring + PRU_RING_HEADER_SIZE + used);
+    slot[0] = sample->timestamp;
+    slot[1] = sample->sequence;
+    /* The PRU's stores complete in order; a host thread needs a barrier */
+    PRU_RING_BARRIER();
+    *head = *head + 1;
+    ring->head = *head;
+}
+
+static void *producer(void *arg)
+{
+    uint32_t head = ring->head;
+    tsample sample;
+    uint32_t i;
+
+    for (i = 1; i <= produced; i++) {
+        if (i % burst == 0)
+            sched_yield();
+        sample.timestamp = i * 7;
+        sample.sequence = i;
+        pru_put(&head, &sample);
+    }
+    return NULL;
+}
+
+/* Consume until the producer is done, checking order and that every
+ * sample was either delivered or counted as an overrun. The producer
+ * yields every burst samples so that the two threads interleave even
+ * on one CPU. */
+static int run(unsigned int entries, unsigned int count, unsigned int batch,
+               unsigned int yield)
+{
+    static tsample samples[ENTRIES];
+    pthread_t thread;
+    uint32_t last = 0, got = 0, n, i;
+    void *mem;
+
+    mem = malloc(pru_ring_bytes(entries, sizeof(tsample)));
+    ring = pru_ring_init(mem, entries, sizeof(tsample));
+    produced = count;
+    burst = yield;
+    pthread_create(&thread, NULL, producer, NULL);
+
+    while (got + pru_ring_overruns(ring) < count) {
+        n = pru_ring_read(ring, samples, batch);
+        for (i = 0; i < n; i++) {
+            if (samples[i].sequence <= last ||
+                samples[i].timestamp != samples[i].sequence * 7) {
+                printf("FAILED: sample %u after %u\n",
+                       samples[i].sequence, last);
+                return 1;
+            }
+            last = samples[i].sequence;
+        }
+        got += n;
+        if (n == 0)
+            sched_yield();
+    }
+    pthread_join(thread, NULL);
+    got += pru_ring_read(ring, samples, entries);
+
+    printf("%5u entries, batch %4u, burst %5u: %7u delivered, %7u overruns\n",
+           entries, batch, yield, got, pru_ring_overruns(ring));
+    if (got + pru_ring_overruns(ring) != count || pru_ring_count(ring)) {
+        printf("FAILED: %u samples lost\n",
+               count - got - pru_ring_overruns(ring));
+        return 1;
+    }
+    free(mem);
+    return 0;
+}
+
+int main(void)
+{
+    tsample sample = { 1, 1 };
+    char mem[PRU_RING_HEADER_SIZE + 4 * sizeof(tsample)];
+    int failed = 0, i;
+
+    if (sizeof(tpru_ring) != PRU_RING_HEADER_SIZE ||
+        pru_ring_bytes(3, 8) || pru_ring_bytes(4, 6) || pru_ring_bytes(4, 2)) {
+        printf("FAILED: ring layout\n");
+        return 1;
+    }
+
+    /* ARM side producer: a full ring refuses entries and counts them */
+    ring = pru_ring_init(mem, 4, sizeof(tsample));
+    for (i = 0; i < 4; i++)
+        failed |= pru_ring_put(ring, &sample) != 0;
+    failed |= pru_ring_put(ring, &sample) != -1;
+    failed |= pru_ring_overruns(ring) != 1 || pru_ring_count(ring) != 4;
+    if (failed) {
+        printf("FAILED: pru_ring_put\n");
+        return 1;
+    }
+
+    failed |= run(ENTRIES, 1000000, ENTRIES, 1000);
+    failed |= run(ENTRIES, 1000000, 1, 1000);
+    failed |= run(16, 1000000, 4, 16);
+    failed |= run(16, 1000000, 4, 20);
+    return failed;
+}
@@ -0,0 +1,342 @@
+/*
+ * simtest.c
+ *
+ * Runs a host program against the simulated PRUSS backend through the
+ * public prussdrv API, and checks the result in the backing files.
+ *
+ * usage: simtest program.bin swap.bin  (with PRUSSDRV_SIM set)
+ */
+
+#include <prussdrv.h>
+#include <pruss_intc_mapping.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* AM33XX offsets from the start of the PRUSS mapping */
+#define IRAM0_OFFSET        0x34000
+#define CONTROL0_OFFSET     0x22000
+#define DATARAM1_OFFSET     0x2000
+#define CONTROL1_OFFSET     0x24000
+#define INTC_OFFSET         0x20000
+
+/* An INTC register, as the simulated PRUSS holds it */
+#define INTC(dataram, reg)  (dataram)[(INTC_OFFSET + (reg)) >> 2]
+
+static int failed;
+
+#define CHECK(COND) \
+    do { if (!(COND)) { printf("FAILED: %s (line %d)\n", #COND, __LINE__); \
+                        failed = 1; } } while (0)
+
+/* Stands in for PRU0 signalling the ARM when it is done */
+static void *pru0(void *arg)
+{
+    usleep(10000);
+    prussdrv_pru_send_event(PRU0_ARM_INTERRUPT);
+    return NULL;
+}
+
+/* swapprog.p's mailbox, and where it resumes after a swap */
+#define SWAP_MAILBOX        0x40
+#define SWAP_LAYOUT         3
+#define SWAP_RESUME         (4 * 4)
+#define SWAP_TIMEOUT_US     50000
+
+/* Stands in for PRU1 reaching its safe label: once the ARM asks for a
+ * swap, it acknowledges the request and halts. A slow one halts only
+ * well after the ARM would have given up, were it not for the ACK. */
+static int swap_slow;
+
+static void *swap_point(void *arg)
+{
+    volatile unsigned int *pruss = arg;
+
+    while (pruss[(DATARAM1_OFFSET + SWAP_MAILBOX) >> 2]
+           != PRUSSDRV_SWAP_REQUEST)
+        usleep(100);
+    pruss[(DATARAM1_OFFSET + SWAP_MAILBOX) >> 2] = PRUSSDRV_SWAP_ACK;
+    if (swap_slow)
+        usleep(SWAP_TIMEOUT_US * 2);
+    pruss[(CONTROL1_OFFSET + 4) >> 2] = 0x10;
+    pruss[CONTROL1_OFFSET >> 2] &= ~0x8000;
+    return NULL;
+}
+
+/* An overlay store as pasmlink writes it: two overlays for a window at
+ * word 0x100 */
+static const unsigned int store_words[] = {
+    PRUSSDRV_OVERLAY_MAGIC, 2, 0x100, 3,
+    40, 2, 0x100,
+    48, 3, 0x101,
+    0x11111111, 0x22222222,
+    0x33333333, 0x44444444, 0x55555555,
+};
+
+static void handler(unsigned int host_interrupt, unsigned int count,
+                    void *arg)
+{
+    *(unsigned int *) arg += count;
+}
+
+/* Map a backing file the way a second process would see it */
+static unsigned char *map_backing(const char *name, size_t *size)
+{
+    char path[256];
+    struct stat st;
+    void *base;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", getenv("PRUSSDRV_SIM"), name);
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0)
+        return NULL;
+    base = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    *size = st.st_size;
+    return base == MAP_FAILED ? NULL : base;
+}
+
+int main(int argc, char *argv[])
+{
+    static tpruss_intc_initdata intc = PRUSS_INTC_INITDATA;
+    static unsigned int big[4096];
+    static unsigned char program[8192];
+    unsigned char *pruss, *extmem;
+    FILE *file;
+    size_t length = 0;
+    unsigned int *dataram, *dataram1, count = 0, iram[3], pc;
+    tprussdrv_image *store, *image;
+    tprussdrv_firmware firmware;
+    char path[256];
+    void *ddr;
+    size_t size;
+    pthread_t thread;
+
+    CHECK(prussdrv_init() == 0);
+    CHECK(prussdrv_open(PRU_EVTOUT_0) == 0);
+    CHECK(prussdrv_open(PRU_EVTOUT_1) == 0);
+    CHECK(prussdrv_version() == PRUSS_V2);
+    CHECK(prussdrv_pruintc_init(&intc) == 0);
+
+    CHECK(prussdrv_map_prumem(PRUSS0_PRU0_DATARAM, (void **) &dataram) == 0);
+    dataram[0] = 0x12345678;
+    CHECK(prussdrv_map_extmem(&ddr) == 0);
+    memcpy(ddr, "extmem", 7);
+    CHECK(prussdrv_get_virt_addr(prussdrv_get_phys_addr(ddr)) == ddr);
+
+    // Load and start the program, as the example apps do
+    CHECK(prussdrv_exec_program(0, argv[1]) == 0);
+    // An image that does not fit is refused before the PRU is stopped
+    CHECK(prussdrv_exec_code(0, big, sizeof(big)) == -1);
+    CHECK(prussdrv_load_data(0, big, sizeof(big)) == -1);
+    CHECK(dataram[CONTROL0_OFFSET >> 2] == 2);
+
+    // The PRU finishing is the only part that needs a stand-in
+    pthread_create(&thread, NULL, pru0, NULL);
+    CHECK(prussdrv_pru_wait_event(PRU_EVTOUT_0) == 1);
+    CHECK(prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT) == 0);
+    pthread_join(thread, NULL);
+
+    // Events for the other PRU arrive on the other host interrupt
+    CHECK(prussdrv_event_register(PRU_EVTOUT_1, PRU1_ARM_INTERRUPT,
+                                  handler, &count) == 0);
+    prussdrv_pru_send_event(PRU1_ARM_INTERRUPT);
+    prussdrv_pru_send_event(PRU1_ARM_INTERRUPT);
+    CHECK(prussdrv_event_dispatch(0) == 1);
+    CHECK(count == 1);
+    prussdrv_pru_send_event(PRU1_ARM_INTERRUPT);
+    CHECK(prussdrv_event_dispatch(0) == 1);
+    CHECK(count == 2);
+
+    // The init data ends up as whole CMR and HMR words, and as lookups
+    CHECK(INTC(dataram, 0x410) == 0x02000100);
+    CHECK(INTC(dataram, 0x414) == 0x00010003);
+    CHECK(INTC(dataram, 0x800) == 0x03020100);
+    CHECK(INTC(dataram, 0x300) == 0x7e0000);
+    CHECK(prussdrv_get_event_to_channel_map(PRU0_ARM_INTERRUPT) == CHANNEL2);
+    CHECK(prussdrv_get_channel_to_host_map(CHANNEL3) == PRU_EVTOUT_1);
+    CHECK(prussdrv_get_channel_to_host_map(CHANNEL4) == -1);
+    CHECK(prussdrv_get_event_to_host_map(PRU0_ARM_INTERRUPT) == PRU_EVTOUT_0);
+    CHECK(prussdrv_get_event_to_host_map(5) == -1);
+    CHECK(prussdrv_get_event_to_host_map(NUM_PRU_SYS_EVTS) == -1);
+
+    // One event moves to another host interrupt while the rest stay live
+    CHECK(prussdrv_pruintc_map_event(PRU0_ARM_INTERRUPT, CHANNEL3) == 0);
+    CHECK(INTC(dataram, 0x410) == 0x03000100);
+    CHECK(INTC(dataram, 0x028) == PRU0_ARM_INTERRUPT);
+    CHECK(prussdrv_get_event_to_host_map(PRU0_ARM_INTERRUPT) == PRU_EVTOUT_1);
+    prussdrv_pru_send_event(PRU0_ARM_INTERRUPT);
+    prussdrv_pru_send_event(PRU1_ARM_INTERRUPT);
+    CHECK(prussdrv_event_dispatch(0) == 1);
+    CHECK(count == 4);
+    CHECK(prussdrv_pruintc_map_event(PRU0_ARM_INTERRUPT, -1) == 0);
+    CHECK(INTC(dataram, 0x02C) == PRU0_ARM_INTERRUPT);
+    CHECK(prussdrv_get_event_to_host_map(PRU0_ARM_INTERRUPT) == -1);
+    CHECK(prussdrv_pruintc_map_event(PRU0_ARM_INTERRUPT, CHANNEL2) == 0);
+    CHECK(prussdrv_pruintc_map_event(NUM_PRU_SYS_EVTS, CHANNEL2) == -1);
+    CHECK(prussdrv_pruintc_map_event(PRU0_ARM_INTERRUPT, NUM_PRU_CHANNELS) == -1);
+
+    // So does a channel, taking its events along
+    CHECK(prussdrv_pruintc_map_channel(CHANNEL3, PRU_EVTOUT2) == 0);
+    CHECK(INTC(dataram, 0x800) == 0x04020100);
+    CHECK(INTC(dataram, 0x034) == PRU_EVTOUT2);
+    CHECK(prussdrv_get_event_to_host_map(PRU1_ARM_INTERRUPT) == PRU_EVTOUT_2);
+    CHECK(prussdrv_pruintc_map_channel(CHANNEL3, PRU_EVTOUT1) == 0);
+    CHECK(prussdrv_get_event_to_host_map(PRU1_ARM_INTERRUPT) == PRU_EVTOUT_1);
+    CHECK(prussdrv_pruintc_map_channel(NUM_PRU_CHANNELS, PRU_EVTOUT1) == -1);
+    CHECK(prussdrv_pruintc_map_channel(CHANNEL3, NUM_PRU_HOSTS) == -1);
+
+    // Overlays go into the window and restart the PRU at their entry
+    snprintf(path, sizeof(path), "%s/test.ovl", getenv("PRUSSDRV_SIM"));
+    file = fopen(path, "wb");
+    if (file) {
+        fwrite(store_words, 1, sizeof(store_words), file);
+        fclose(file);
+    }
+    store = prussdrv_image_open(path);
+    image = prussdrv_image_open(argv[1]);
+    CHECK(store != NULL && image != NULL);
+    if (failed)
+        return 1;
+    CHECK(prussdrv_overlay_count(store) == 2);
+    CHECK(prussdrv_overlay_count(image) == -1);
+    CHECK(prussdrv_pru_load_overlay(0, store, 2) == -1);
+    CHECK(prussdrv_pru_load_overlay(0, image, 0) == -1);
+    CHECK(prussdrv_pru_load_overlay(0, store, 1) == 3);
+    CHECK(prussdrv_pru_read_memory(PRUSS0_PRU0_IRAM, 0x100 * 4, iram,
+                                   sizeof(iram)) == sizeof(iram));
+    CHECK(!memcmp(iram, store_words + 12, sizeof(iram)));
+    pruss = map_backing("pruss", &size);
+    CHECK(pruss != NULL);
+    if (failed)
+        return 1;
+    CHECK(*(unsigned int *) (pruss + CONTROL0_OFFSET) == ((0x101 << 16) | 2));
+    CHECK(prussdrv_pru_load_overlay(0, store, 0) == 2);
+    CHECK(*(unsigned int *) (pruss + CONTROL0_OFFSET) == ((0x100 << 16) | 2));
+    prussdrv_image_close(store);
+    prussdrv_image_close(image);
+
+    // A window that runs past the end of IRAM leaves the PRU running
+    memcpy(big, store_words, sizeof(store_words));
+    big[2] = 0x7ff;
+    file = fopen(path, "wb");
+    if (file) {
+        fwrite(big, 1, sizeof(store_words), file);
+        fclose(file);
+    }
+    store = prussdrv_image_open(path);
+    CHECK(store != NULL);
+    if (failed)
+        return 1;
+    CHECK(prussdrv_pru_load_overlay(0, store, 0) == -1);
+    CHECK(*(unsigned int *) (pruss + CONTROL0_OFFSET) == ((0x100 << 16) | 2));
+    prussdrv_image_close(store);
+
+    // So does an entry outside IRAM
+    big[2] = 0x100;
+    big[6] = 0x800;
+    file = fopen(path, "wb");
+    if (file) {
+        fwrite(big, 1, sizeof(store_words), file);
+        fclose(file);
+    }
+    store = prussdrv_image_open(path);
+    CHECK(store != NULL);
+    if (failed)
+        return 1;
+    CHECK(prussdrv_pru_load_overlay(0, store, 0) == -1);
+    CHECK(*(unsigned int *) (pruss + CONTROL0_OFFSET) == ((0x100 << 16) | 2));
+    prussdrv_image_close(store);
+
+    // The program counter is sampled from the STATUS register, and the
+    // run state from CONTROL, where the PRU itself would put them
+    dataram[(CONTROL0_OFFSET + 4) >> 2] = 0x1234;
+    CHECK(prussdrv_pru_read_pc(0, &pc) == 0);
+    CHECK(pc == 0x1234);
+    dataram[CONTROL0_OFFSET >> 2] |= 0x8000;
+    CHECK(prussdrv_pru_read_pc(0, &pc) == 1);
+    CHECK(prussdrv_pru_read_pc(2, &pc) == -1);
+
+    // A firmware swap on the other PRU keeps its data RAM, and waits for
+    // the safe label
+    file = fopen(argv[2], "rb");
+    if (file) {
+        length = fread(program, 1, sizeof(program), file);
+        fclose(file);
+    }
+    firmware.code = (const unsigned int *) program;
+    firmware.codelen = length;
+    firmware.entry = SWAP_RESUME;
+    firmware.layout = SWAP_LAYOUT + 1;
+    dataram1 = dataram + (DATARAM1_OFFSET >> 2);
+    dataram1[1] = 0xabcd;
+    dataram1[(SWAP_MAILBOX + 4) >> 2] = SWAP_LAYOUT;
+    dataram[CONTROL1_OFFSET >> 2] |= 0x8000;
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, -1) == -1);
+    CHECK(dataram1[SWAP_MAILBOX >> 2] == 0);
+    firmware.layout = SWAP_LAYOUT;
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, 1000) == -1);
+    CHECK(dataram1[SWAP_MAILBOX >> 2] == 0);
+    CHECK(prussdrv_pru_read_pc(1, &pc) == 1);
+    pthread_create(&thread, NULL, swap_point, dataram);
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, -1) == 0);
+    pthread_join(thread, NULL);
+    CHECK(prussdrv_pru_read_memory(PRUSS0_PRU1_IRAM, 0, big, length) == length);
+    CHECK(!memcmp(big, program, length));
+    CHECK(dataram[CONTROL1_OFFSET >> 2] == (((SWAP_RESUME / 4) << 16) | 2));
+    CHECK(dataram1[1] == 0xabcd);
+    CHECK(dataram1[SWAP_MAILBOX >> 2] == 0);
+    // An acknowledged request is not withdrawn at the timeout
+    dataram[CONTROL1_OFFSET >> 2] |= 0x8000;
+    swap_slow = 1;
+    pthread_create(&thread, NULL, swap_point, dataram);
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware,
+                                     SWAP_TIMEOUT_US) == 0);
+    pthread_join(thread, NULL);
+    CHECK(dataram1[SWAP_MAILBOX >> 2] == 0);
+    CHECK(dataram[CONTROL1_OFFSET >> 2] == (((SWAP_RESUME / 4) << 16) | 2));
+    // A PRU that is not running is swapped at once
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, 0) == 0);
+    firmware.codelen = sizeof(big);
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, 0) == -1);
+    firmware.codelen = length;
+    firmware.entry = SWAP_RESUME + 2;
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, 0) == -1);
+    firmware.entry = length;
+    CHECK(prussdrv_pru_swap_firmware(1, SWAP_MAILBOX, &firmware, 0) == -1);
+    firmware.entry = SWAP_RESUME;
+    CHECK(dataram[CONTROL1_OFFSET >> 2] == (((SWAP_RESUME / 4) << 16) | 2));
+    CHECK(prussdrv_pru_swap_firmware(1, 0x2001, &firmware, 0) == -1);
+    CHECK(prussdrv_pru_swap_firmware(2, SWAP_MAILBOX, &firmware, 0) == -1);
+    prussdrv_pru_disable(1);
+
+    prussdrv_pru_disable(0);
+    prussdrv_exit();
+
+    // Everything the program did is in the backing files
+    pruss = map_backing("pruss", &size);
+    extmem = map_backing("extmem", &size);
+    file = fopen(argv[1], "rb");
+    if (file) {
+        length = fread(program, 1, sizeof(program), file);
+        fclose(file);
+    }
+    CHECK(pruss != NULL && extmem != NULL && length != 0);
+    if (failed)
+        return 1;
+    CHECK(!memcmp(pruss + IRAM0_OFFSET, program, length));
+    CHECK(*(unsigned int *) pruss == 0x12345678);
+    CHECK(*(unsigned int *) (pruss + CONTROL0_OFFSET) == 1);
+    CHECK(!strcmp((char *) extmem, "extmem"));
+
+    if (!failed)
+        printf("simtest ok\n");
+    return failed;
+}
@@ -0,0 +1,27 @@
+// A pulse train that can be swapped while it runs: the pulse and gap
+// lengths come from data RAM, and it stops for a swap only between
+// pulses. Used by simtest to check that pru_swap.hp assembles.
+
+.origin 0
+.entrypoint START
+
+#include <pru_swap.hp>
+
+#define MAILBOX     0x40        // After the delays
+#define LAYOUT      3
+
+START:
+    SWAP_INIT MAILBOX, LAYOUT, r0
+
+RESUME:                                 // Where a swap starts it
+    LBCO    r1, C24, 0, 8               // r1 = high loops, r2 = low loops
+    SET     r30.t15
+HIGH:
+    SUB     r1, r1, 1
+    QBNE    HIGH, r1, 0
+    CLR     r30.t15
+LOW:
+    SUB     r2, r2, 1
+    QBNE    LOW, r2, 0
+    SWAP_POINT MAILBOX, r0
+    QBA     RESUME
@@ -1,3 +1,8 @@
-cl -W3 -D_CRT_SECURE_NO_WARNINGS pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c path_utils.c /Fe..\pasm.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS pasmmain.c pasmdep.c pasmtime.c pasmopt.c pasmobj.c pasmout.c prusim.c pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c pasmsym.c pasmhash.c pasmlib.c prudis.c path_utils.c /Fe..\pasm.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS prusimmain.c prusim.c pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c pasmsym.c pasmhash.c pasmlib.c prudis.c path_utils.c /Fe..\prusim.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS prudismain.c prusim.c pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c pasmsym.c pasmhash.c pasmlib.c prudis.c path_utils.c /Fe..\prudis.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS pruprofmain.c pruprof.c prusim.c pasm.c pasmpp.c pasmexp.c pasmop.c pasmdot.c pasmstruct.c pasmmacro.c pasmsym.c pasmhash.c pasmlib.c prudis.c path_utils.c /Fe..\pruprof.exe
+cl -W3 -D_CRT_SECURE_NO_WARNINGS pasmlink.c /Fe..\pasmlink.exe
+lib /OUT:..\pasm.lib pasm.obj pasmpp.obj pasmexp.obj pasmop.obj pasmdot.obj pasmstruct.obj pasmmacro.obj pasmsym.obj pasmhash.obj pasmlib.obj prudis.obj path_utils.obj prusim.obj
 del *.obj
 
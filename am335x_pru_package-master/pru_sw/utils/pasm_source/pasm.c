@@ -50,17 +50,21 @@
 //
 // Description:
 //     Main assembler control program.
-//         - Processes command line and flags
+//         - Creates the assembler context
 //         - Runs the main assembler engine (dual pass)
 //         - Handles error reporting
 //         - Handles label creation and matching
-//         - Handle output file generation
+//
+//     The command line and output files are handled in pasmmain.c
 //
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
 //     03-Mar-15: 0.85 - Modified to build using Visual Studio 2008
 //     07-Jul-14: 0.86 - Fixed -L listing generation and improved listing speed
+//     17-Oct-26: 0.86 - Moved engine state into a per thread context
+//     17-Oct-26: 0.86 - Added relocation records for -r objects
+//     18-Oct-26: 0.86 - Source lines parsed into a fixed token arena
 ============================================================================*/
 
 #include <stdio.h>
@@ -72,6 +76,13 @@
 #include <stdlib.h>
 #endif
 #include <ctype.h>
+#ifdef _MSC_VER
+#include <io.h>
+#define ftruncate _chsize
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
 #include "pasm.h"
 #include "pasmdbg.h"
 #include "path_utils.h"
@@ -99,621 +110,166 @@
 */
 
 
-/* ---------- Local Macro Definitions ----------- */
-
-#define PROCESSOR_NAME_STRING ("PRU")
-#define VERSION_STRING        ("0.86")
-
-#define MAXFILE               (256)     /* Max file length for output files */
-#define MAX_PROGRAM           (16384)   /* Max instruction count */
-#define MAX_CMD_EQUATE        (8)       /* Max equates that can be put on command line */
-
-#define RET_ERROR             (1)
-#define RET_SUCCESS           (0)
-
-/* Big/Little Endian Conversions */
-#define HNC16(a) ((((a)>>8)&0xff)+(((a)<<8)&0xff00))
-#define HNC32(a) ((((a)>>24)&0xff)+(((a)>>8)&0xff00)+(((a)<<8)&0xff0000)+(((a)<<24)&0xff000000))
-
-/* User Options */
-unsigned int Options = 0;
-unsigned int Core    = CORE_NONE;
-FILE *ListingFile = 0;
-
-/* Assembler Engine */
-int  Pass;                  /* Pass 1 or 2 of parser */
-int  HaveEntry;             /* Entrypont flag (init to 0) */
-int  EntryPoint;            /* Entrypont (init to -1) */
-int  CodeOffset;            /* Current instruction "word" offset (zero based) */
-int  Errors;                /* Total number or errors */
-int  FatalError;            /* Set on fatal error */
-int  Warnings;              /* Total number of warnings */
-uint RetRegValue;           /* Return register index */
-uint RetRegField;           /* Return register field */
-
-LABEL   *pLabelList=0;       /* List of installed labels */
-int     LabelCount=0;
-
-CODEGEN ProgramImage[MAX_PROGRAM];
+/* Assembler Context */
+PASM_THREAD PASMCTX *pCtx = 0;
+
+/* Fixup Record (single pass mode) */
+#define FIXUP_CODE          0   /* Encode the line again at its offset */
+#define FIXUP_ENTRYPOINT    1   /* Evaluate the .entrypoint again */
+typedef struct _FIXUP {
+    struct _FIXUP   *pNext;         /* Next in FIXUP list */
+    int             Type;           /* Fixup type */
+    uint            FileIndex;      /* Source file index */
+    uint            Line;           /* The line number */
+    int             Offset;         /* Offset of first code word */
+    int             Words;          /* Number of code words */
+    long            ListPos;        /* Listing file position of first word */
+    int             Terms;          /* Number of terms */
+    char            Term[1];        /* Terms (allocated to length) */
+} FIXUP;
 
 SOURCEFILE cmdLine = { 0, 0, 0, 0, 0, 0, 0, 0, "[CommandLine]", "" };
-char cmdLineName[MAX_CMD_EQUATE][EQUATE_NAME_LEN];
-char cmdLineData[MAX_CMD_EQUATE][EQUATE_DATA_LEN];
-int cmdLineEquates = 0;
-
-char nameCArray[EQUATE_DATA_LEN];
-int  nameCArraySet = 0;
 
 /* Local Support Funtions */
 static int ValidateOffset( SOURCEFILE *ps );
-static int PrintLine( FILE *pfOut, SOURCEFILE *ps );
-static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, uint *pCodeWord );
-static int ListFile( FILE *pfOut, SOURCEFILE *ps );
+static int FixupCreate( SOURCEFILE *ps, int TermCnt, char **pTerms );
+static int FixupResolve();
+static int RelocCreate( SOURCEFILE *ps, uint opcode );
 
 /*
-// Main Assembler Entry Point
+// ContextCreate
 //
+// Allocates a context with the default settings
+//
+// Returns PASMCTX * on success, 0 on error
 */
-int main(int argc, char *argv[])
+PASMCTX *ContextCreate()
 {
-    int i,j;
-    int CodeOffsetPass1 = 0;
-    char *infile, *outfile, *flags;
-    SOURCEFILE *mainsource;
-    char outbase[MAXFILE],outfilename[MAXFILE];
-
-    printf("\n\n%s Assembler Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
-    printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+    PASMCTX *pc;
 
-    /* Scan argv[0] to the final '/' in program name */
-    i=0;
-    j=-1;
-    while( argv[0][i] )
-    {
-        if( argv[0][i] == '/' || argv[0][i] == '\\')
-            j=i;
-        i++;
-    }
-    argv[0]+=(j+1);
-
-    /*
-    // Process command line
-    */
-    infile=0;
-    flags=0;
-    outfile=0;
+    pc = malloc(sizeof(PASMCTX));
+    if( !pc )
+        return(0);
+    memset( pc, 0, sizeof(PASMCTX) );
 
-    if( argc<2 )
-    {
-USAGE:
-        printf("Usage: %s [-V#EBbcmLldz] [-Idir] [-Dname=value] [-Cname] InFile [OutFileBase]\n\n",argv[0]);
-        printf("    V# - Specify core version (V0,V1,V2,V3). (Default is V1)\n");
-        printf("    E  - Assemble for big endian core\n");
-        printf("    B  - Create big endian binary output (*.bib)\n");
-        printf("    b  - Create little endian binary output (*.bin)\n");
-        printf("    c  - Create 'C array' binary output (*_bin.h)\n");
-        printf("    m  - Create 'image' binary output (*.img)\n");
-        printf("    L  - Create annotated source file style listing (*.txt)\n");
-        printf("    l  - Create raw listing file (*.lst)\n");
-        printf("    d  - Create pView debug file (*.dbg)\n");
-        printf("    z  - Enable debug messages\n");
-        printf("    I  - Add the directory dir to search path for \n"
-               "         #include <filename> type of directives (where \n"
-               "         angled brackets are used instead of quotes).\n");
-        printf("\n    D  - Set equate 'name' to 1 using '-Dname', or to any\n");
-        printf("         value using '-Dname=value'\n");
-        printf("    C  - Name the C array in 'C array' binary output\n");
-        printf("         to 'name' using '-Cname'\n");
-        printf("\n");
-        return(RET_ERROR);
-    }
+    pc->Core        = CORE_NONE;
+    pc->ppFixupTail = &pc->pFixupList;
 
-    /* Get all non-flag arguments */
-    for( i=1; i<argc; i++ )
-    {
-        if( argv[i][0] != '-' )
-        {
-            if( !infile )
-                infile = argv[i];
-            else if( !outfile )
-                outfile = argv[i];
-            else
-                goto USAGE;
-        }
-    }
-
-    /* Get all flag arguments */
-    for( i=1; i<argc; i++ )
-    {
-        if( argv[i][0] == '-' )
-        {
-            flags = argv[i];
-            flags++;
-            while( *flags )
-            {
-                if( *flags == 'I' )
-                {
-                    add_include_dir(++flags);
-                    break;
-                }
-                else if( *flags == 'D' )
-                {
-                    flags++;
-                    if( cmdLineEquates==MAX_CMD_EQUATE )
-                    {
-                        printf("\nToo many command line equates\n\n");
-                        goto USAGE;
-                    }
-                    j=0;
-                    while( j<EQUATE_NAME_LEN && *flags && *flags!='=' )
-                        cmdLineName[cmdLineEquates][j++]=*flags++;
-                    if( j==EQUATE_NAME_LEN )
-                    {
-                        printf("\nCommand line equate name too long\n\n");
-                        goto USAGE;
-                    }
-                    strcpy( cmdLineData[cmdLineEquates], "1" );
-                    if( *flags=='=' )
-                    {
-                        flags++;
-                        j=0;
-                        while( j<EQUATE_DATA_LEN && *flags )
-                            cmdLineData[cmdLineEquates][j++]=*flags++;
-                        if( j==EQUATE_DATA_LEN )
-                        {
-                            printf("\nCommand line equate data too long\n\n");
-                            goto USAGE;
-                        }
-                    }
-                    cmdLineEquates++;
-                    break;
-                }
-                else if( *flags == 'C' )
-                {
-                    flags++;
-                    j = 0;
-                    while( j<EQUATE_DATA_LEN && *flags )
-                    {
-                        nameCArray[j++]=*flags++;
-                    }
-                    if( j==EQUATE_DATA_LEN )
-                    {
-                        printf("\nCArray name too long\n\n");
-                        goto USAGE;
-                    }
-                    nameCArraySet = 1;
-                    break;
-                }
-                else if( *flags == 'V' )
-                {
-                    flags++;
-                    if( *flags<'0' || *flags>'3' )
-                    {
-                        printf("\nExpected a number (0-3) after option 'V'\n\n");
-                        goto USAGE;
-                    }
-                    if( Core != CORE_NONE )
-                    {
-                        printf("\nDo not specify more than one core version or use -V with -X or -x\n\n");
-                        goto USAGE;
-                    }
-                    Core = CORE_V0 + *flags - '0';
-                }
-                else if( *flags == 'x' )
-                {
-                    if( Core != CORE_NONE )
-                    {
-                        printf("\nDo not use -x with -X or -V\n\n");
-                        goto USAGE;
-                    }
-                    Core = CORE_V0;
-                }
-                else if( *flags == 'X' )
-                {
-                    if( Core != CORE_NONE )
-                    {
-                        printf("\nDo not use -X with -x or -V\n\n");
-                        goto USAGE;
-                    }
-                    Core = CORE_V2;
-                }
-                else if( *flags == 'E' )
-                    Options |= OPTION_BIGENDIAN;
-                else if( *flags == 'b' )
-                    Options |= OPTION_BINARY;
-                else if( *flags == 'B' )
-                    Options |= OPTION_BINARYBIG;
-                else if( *flags == 'c' )
-                    Options |= OPTION_CARRAY;
-                else if( *flags == 'm' )
-                    Options |= OPTION_IMGFILE;
-                else if( *flags == 'l' )
-                    Options |= OPTION_LISTING;
-                else if( *flags == 'L' )
-                    Options |= OPTION_SOURCELISTING;
-                else if( *flags == 'd' )
-                    Options |= OPTION_DBGFILE;
-                else if( *flags == 'z' )
-                    Options |= OPTION_DEBUG;
-                else
-                {
-                    printf("\nUnknown flag '%c'\n\n",*flags);
-                    goto USAGE;
-                }
-                flags++;
-            }
-        }
-    }
-
-    if( Core==CORE_NONE )
-        Core = CORE_V1;
+    pc->TimingCosts.LocalLoad   = PRUSIM_COST_LOCAL_LOAD;
+    pc->TimingCosts.LocalStore  = PRUSIM_COST_LOCAL_STORE;
+    pc->TimingCosts.SystemLoad  = PRUSIM_COST_SYSTEM_LOAD;
+    pc->TimingCosts.SystemStore = PRUSIM_COST_SYSTEM_STORE;
+    return(pc);
+}
 
-    /* Check input file */
-    if( !infile )
-        goto USAGE;
 
-    /* Check output file base - make sure no '.' */
-    if( outfile )
-    {
-        if( strlen(outfile) > (MAXFILE-5) )
-            { Report(0,REP_ERROR,"Outfile name too long"); return(RET_ERROR); }
-        i=0;
-        while( outfile[i] )
-        {
-            if( outfile[i]=='.' )
-            {
-                if( outfile[i+1]=='.' )
-                    i++;
-                else
-                    { Report(0,REP_ERROR,"Outfile should be basename only - no '.'"); return(RET_ERROR); }
-            }
-            i++;
-        }
-        strcpy( outbase, outfile );
-    }
+/*
+// ContextDestroy
+//
+// Frees a context along with its labels and symbol tables. Clears pCtx
+// when it points to this context.
+//
+// void
+*/
+void ContextDestroy( PASMCTX *pc )
+{
+    PASMCTX *pSave = pCtx;
 
-    /* Test opening the main source file */
-    if( !(mainsource=InitSourceFile(0,infile,0)) )
-        return(RET_ERROR);
+    /* The cleanup functions work on the current context */
+    pCtx = pc;
+    while( pc->pLabelList )
+        LabelDestroy( pc->pLabelList );
+    SymCleanup();
+    free(pc->pRelocList);
 
-    /* Setup outfile base */
-    if( !outfile )
-    {
-        for(i=0; mainsource->SourceName[i] && mainsource->SourceName[i]!='.'; i++ )
-            outbase[i]=mainsource->SourceName[i];
-        outbase[i] = 0;
-    }
-    if( Options & OPTION_DEBUG )
-        printf("Output base filename: '%s'\n",outbase);
+    pCtx = (pSave==pc) ? 0 : pSave;
+    free(pc);
+}
 
-    /* Close the source file for now */
-    CloseSourceFile( mainsource );
 
-    /* If no output specified, default to 'C' array */
-    if( !(Options & (OPTION_BINARY|OPTION_CARRAY|OPTION_BINARYBIG|OPTION_IMGFILE|OPTION_DBGFILE)) )
-    {
-        printf("Note: Using default output '-c' (C array *_bin.h)\n\n");
-        Options |= OPTION_CARRAY;
-    }
+/*
+// Assemble
+//
+// Makes the assembler passes (or single pass with fixups) over the main
+// source. When pText is set, the main source is read from memory and
+// Name is only used in messages. The code image and labels are left in
+// the current context.
+//
+// Returns 1 on success, 0 on error
+*/
+int Assemble( char *Name, const char *pText, uint Length )
+{
+    SOURCEFILE *mainsource;
+    int i;
+    int CodeOffsetPass1 = 0;
+    int PassCount;
 
-    /* Open listing file */
-    if( Options & OPTION_LISTING )
-    {
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".lst" );
-        if (!(ListingFile = fopen(outfilename,"wb")))
-            { Report(0,REP_ERROR,"Unable to open output file: %s",outfilename); return(RET_ERROR); }
-    }
+    if( pCtx->Core==CORE_NONE )
+        pCtx->Core = CORE_V1;
 
     /* Clear the binary image */
-    memset( ProgramImage, 0, sizeof(ProgramImage) );
-
-    /* Make 2 assembler passes */
-    Pass        = 0;
-    Errors      = 0;
-    Warnings    = 0;
-    FatalError  = 0;
-    RetRegValue = DEFAULT_RETREGVAL;
-    RetRegField = DEFAULT_RETREGFLD;
-    while( !Errors && Pass<2 )
+    memset( pCtx->ProgramImage, 0, sizeof(pCtx->ProgramImage) );
+
+    /* Make 2 assembler passes (or 1 pass with fixups) */
+    PassCount         = (pCtx->Options & OPTION_SINGLEPASS) ? 1 : 2;
+    pCtx->Pass        = 0;
+    pCtx->Errors      = 0;
+    pCtx->Warnings    = 0;
+    pCtx->FatalError  = 0;
+    pCtx->RelocCount  = 0;
+    pCtx->RetRegValue = DEFAULT_RETREGVAL;
+    pCtx->RetRegField = DEFAULT_RETREGFLD;
+    while( !pCtx->Errors && pCtx->Pass<PassCount )
     {
-        Pass++;
-        CodeOffset = -1;
-        HaveEntry = 0;
-        EntryPoint = -1;
+        pCtx->Pass++;
+        pCtx->CodeOffset = -1;
+        pCtx->HaveEntry = 0;
+        pCtx->EntryPoint = -1;
 
         /* Initialize the PP and DOT modules */
-        for(i=0; i<cmdLineEquates; i++ )
-            EquateCreate( &cmdLine, cmdLineName[i], cmdLineData[i] );
-        DotInitialize(Pass);
+        for(i=0; i<pCtx->cmdLineEquates; i++ )
+            EquateCreate( &cmdLine, pCtx->cmdLineName[i], pCtx->cmdLineData[i] );
+        DotInitialize(pCtx->Pass);
 
         /* Process the main source file */
-        if( !(mainsource=InitSourceFile(0,infile,0)) )
-            break;
-        ProcessSourceFile( mainsource );
-        CloseSourceFile( mainsource );
-
-        /* Cleanup the PP and DOT modules */
-        ppCleanup(Pass);
-        DotCleanup(Pass);
-
-        if( Pass==1 )
-        {
-            CodeOffsetPass1 = CodeOffset;
-        }
-    }
-
-    /* Close the listing file */
-    if( ListingFile )
-        fclose( ListingFile );
-
-    /* Make sure user didn't do something silly */
-    if( CodeOffsetPass1!=CodeOffset )
-    {
-        printf("Error: Offset changed between pass 1 and pass 2\n");
-        Errors++;
-    }
-
-    /* Process the results */
-    printf("\nPass %d : %d Error(s), %d Warning(s)\n\n",Pass,Errors,Warnings);
-    if( Errors || CodeOffset<=0 )
-        Options = 0;
-    else
-        printf("Writing Code Image of %d word(s)\n\n",CodeOffset);
-
-    /* Create the output files */
-    if( Options & OPTION_CARRAY )
-    {
-        FILE *Outfile;
-
-        strcpy( outfilename, outbase );
-        strcat( outfilename, "_bin.h" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
+        if( pText )
+            mainsource = InitSourceBuffer(0,Name,pText,Length);
         else
+            mainsource = InitSourceFile(0,Name,0);
+        if( !mainsource )
         {
-            fprintf( Outfile, "\n\n"
-                    "/* This file contains the %s instructions in a C array which are to  */\n"
-                    "/* be downloaded from the host CPU to the %s instruction memory.     */\n"
-                    "/* This file is generated by the %s assembler.                       */\n",
-                    PROCESSOR_NAME_STRING, PROCESSOR_NAME_STRING, PROCESSOR_NAME_STRING);
-            if( !nameCArraySet )
-                fprintf(Outfile,"\nconst unsigned int %scode[] =  {\n",PROCESSOR_NAME_STRING);
-            else
-                fprintf(Outfile,"\nconst unsigned int %s[] =  {\n",nameCArray);
-            for(i=0;i<(CodeOffset-1);i++)
-                fprintf(Outfile,"     0x%08x,\n",ProgramImage[i].CodeWord);
-            fprintf(Outfile,"     0x%08x };\n\n",ProgramImage[CodeOffset-1].CodeWord);
-            fclose( Outfile );
-        }
-    }
-    if( Options & OPTION_IMGFILE )
-    {
-        FILE *Outfile;
-
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".img" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
-        else
-        {
-            for(i=0;i<CodeOffset;i++)
-                fprintf(Outfile,"%08x\n",ProgramImage[i].CodeWord);
-            fclose( Outfile );
-        }
-    }
-    if( Options & OPTION_DBGFILE )
-    {
-        FILE *Outfile;
-        uint BigEndian;
-
-        BigEndian = 0;
-        *(unsigned char *)&BigEndian = 1;
-        if( BigEndian != 1 )
-            BigEndian = 1;
-        else
-            BigEndian = 0;
-
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".dbg" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
-        else
-        {
-            DBGFILE_HEADER hdr;
-            DBGFILE_HEADER hdr_write;
-            DBGFILE_LABEL  lbl;
-            DBGFILE_FILE   file;
-            DBGFILE_CODE   code;
-            LABEL          *pLabel;
-            unsigned int file_offset;
-            int i;
-
-            memset( &hdr, 0, sizeof(DBGFILE_HEADER) );
-            hdr.FileID      = DBGFILE_FILEID_VER3;
-            file_offset     = sizeof(DBGFILE_HEADER);
-            hdr.LabelCount  = LabelCount;
-            hdr.LabelOffset = file_offset;
-            file_offset += hdr.LabelCount * sizeof(DBGFILE_LABEL);
-            hdr.FileCount   = sfIndex;
-            hdr.FileOffset  = file_offset;
-            file_offset += hdr.FileCount * sizeof(DBGFILE_FILE);
-            hdr.CodeCount   = CodeOffset;
-            hdr.CodeOffset  = file_offset;
-            hdr.EntryPoint  = EntryPoint;
-
-            if( Options & OPTION_BIGENDIAN )
-                hdr.Flags |= DBGHDR_FLAGS_BIGENDIAN;
-
-            if(!BigEndian)
-                hdr_write = hdr;
-            else
-            {
-                hdr_write.FileID      = HNC32(hdr.FileID);
-                hdr_write.LabelCount  = HNC32(hdr.LabelCount);
-                hdr_write.LabelOffset = HNC32(hdr.LabelOffset);
-                hdr_write.FileCount   = HNC32(hdr.FileCount);
-                hdr_write.FileOffset  = HNC32(hdr.FileOffset);
-                hdr_write.CodeCount   = HNC32(hdr.CodeCount);
-                hdr_write.CodeOffset  = HNC32(hdr.CodeOffset);
-                hdr_write.EntryPoint  = HNC32(hdr.EntryPoint);
-                hdr_write.Flags       = HNC32(hdr.Flags);
-            }
-            if( fwrite(&hdr_write,1,sizeof(DBGFILE_HEADER),Outfile) != sizeof(DBGFILE_HEADER) )
-                Report(0,REP_ERROR,"File write error");
-
-            pLabel = pLabelList;
-            for( i=0; i<(int)hdr.LabelCount; i++ )
-            {
-                memset( &lbl, 0, sizeof(DBGFILE_LABEL) );
-                if( !pLabel )
-                    Report(0,REP_ERROR,"Fatal label tracking error");
-                else
-                {
-                    lbl.AddrOffset = pLabel->Offset;
-                    strcpy(lbl.Name,pLabel->Name);
-                    if(BigEndian)
-                        lbl.AddrOffset = HNC32(lbl.AddrOffset);
-                    if( fwrite(&lbl,1,sizeof(DBGFILE_LABEL),Outfile) != sizeof(DBGFILE_LABEL) )
-                        Report(0,REP_ERROR,"File write error");
-                    pLabel = pLabel->pNext;
-                }
-            }
-
-            for(i=0; i<(int)hdr.FileCount; i++)
-            {
-                memset( &file, 0, sizeof(DBGFILE_FILE) );
-                if( !strcmp( sfArray[i].SourceBaseDir,"./") ||
-                    ((strlen(sfArray[i].SourceName)+strlen(sfArray[i].SourceBaseDir)) >= DBGFILE_NAMELEN_SHORT) )
-                    strcpy(file.SourceName,sfArray[i].SourceName);
-                else
-                {
-                    strcpy(file.SourceName,sfArray[i].SourceBaseDir);
-                    strcat(file.SourceName,sfArray[i].SourceName);
-                }
-                if( fwrite(&file,1,sizeof(DBGFILE_FILE),Outfile) != sizeof(DBGFILE_FILE) )
-                    Report(0,REP_ERROR,"File write error");
-            }
-
-            for(i=0; i<(int)hdr.CodeCount; i++)
-            {
-                memset( &code, 0, sizeof(DBGFILE_CODE) );
-                code.Flags      = ProgramImage[i].Flags;
-                code.Resv8      = ProgramImage[i].Resv8;
-                code.FileIndex  = ProgramImage[i].FileIndex;
-                code.Line       = ProgramImage[i].Line;
-                code.AddrOffset = ProgramImage[i].AddrOffset;
-                code.CodeWord   = ProgramImage[i].CodeWord;
-                if(BigEndian)
-                {
-                    code.FileIndex  = HNC16(code.FileIndex);
-                    code.Line       = HNC32(code.Line);
-                    code.AddrOffset = HNC32(code.AddrOffset);
-                    code.CodeWord   = HNC32(code.CodeWord);
-                }
-                if( fwrite(&code,1,sizeof(DBGFILE_CODE),Outfile) != sizeof(DBGFILE_CODE) )
-                    Report(0,REP_ERROR,"File write error");
-            }
-            fclose( Outfile );
+            ppCleanup(pCtx->Pass);
+            DotCleanup(pCtx->Pass);
+            break;
         }
-    }
-    if( Options & OPTION_SOURCELISTING )
-    {
-        FILE *Outfile;
+        ProcessSourceFile( mainsource );
+        CloseSourceFile( mainsource );
 
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".txt" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
-        else
+        /* Patch the forward references. On an error this leaves the
+           pass, offset and listing where pass 2 would have stopped. */
+        if( pCtx->Options & OPTION_SINGLEPASS )
         {
-            char FullPath[SOURCE_BASE_DIR+SOURCE_NAME];
-
-            for( i=0; i<(int)sfIndex; i++ )
-            {
-                fprintf(Outfile, "Source File %d : '%s' ", i+1, sfArray[i].SourceName);
-                strcpy(FullPath,sfArray[i].SourceBaseDir);
-                strcat(FullPath, "/");
-                strcat(FullPath,sfArray[i].SourceName);
-                sfArray[i].FilePtr=fopen(FullPath,"rb");
-                if( sfArray[i].FilePtr!=0 )
-                {
-                    sfArray[i].CurrentLine   = 1;
-                    sfArray[i].CurrentColumn = 1;
-                    sfArray[i].LastChar      = 0;
-                    ListFile(Outfile,&sfArray[i]);
-                    fclose(sfArray[i].FilePtr);
-                    fprintf(Outfile, "\n\n");
-                }
-                else
-                    fprintf(Outfile, "(File Not Found '%s')\n\n",FullPath);
-            }
-
-            fclose(Outfile);
+            CodeOffsetPass1 = pCtx->CodeOffset;
+            FixupResolve();
         }
-    }
-    if( Options & OPTION_BINARY )
-    {
-        FILE *Outfile;
 
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".bin" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
-        else
-        {
-            unsigned char tmp;
-
-            /* Write out as Little Endian */
-            for(i=0;i<CodeOffset;i++)
-            {
-                tmp = (unsigned char)ProgramImage[i].CodeWord;
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>8);
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>16);
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>24);
-                fwrite(&tmp,1,1,Outfile);
-            }
-            fclose( Outfile );
-        }
-    }
-    if( Options & OPTION_BINARYBIG )
-    {
-        FILE *Outfile;
+        /* Cleanup the PP and DOT modules */
+        ppCleanup(pCtx->Pass);
+        DotCleanup(pCtx->Pass);
 
-        strcpy( outfilename, outbase );
-        strcat( outfilename, ".bib" );
-        if (!(Outfile = fopen(outfilename,"wb")))
-            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
-        else
+        if( pCtx->Pass==1 )
         {
-            unsigned char tmp;
-
-            /* Write out as Big Endian */
-            for(i=0;i<CodeOffset;i++)
-            {
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>24);
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>16);
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)(ProgramImage[i].CodeWord>>8);
-                fwrite(&tmp,1,1,Outfile);
-                tmp = (unsigned char)ProgramImage[i].CodeWord;
-                fwrite(&tmp,1,1,Outfile);
-            }
-            fclose( Outfile );
+            CodeOffsetPass1 = pCtx->CodeOffset;
         }
     }
 
-    /* Assember label cleanup */
-    while( pLabelList )
-        LabelDestroy( pLabelList );
+    /* Make sure user didn't do something silly */
+    if( CodeOffsetPass1!=pCtx->CodeOffset )
+        Report(0,REP_ERROR,"Offset changed between pass 1 and pass 2");
 
-    if( Errors || CodeOffset<=0 )
-        return(RET_ERROR);
-    return(RET_SUCCESS);
+    if( pCtx->Errors )
+        return(0);
+    return(1);
 }
 
 
@@ -733,8 +289,13 @@ int ProcessSourceFile( SOURCEFILE *ps )
     for(;;)
     {
         /* Abort on a total disaster */
-        if( FatalError || Errors >= 25 )
-            { printf("Aborting...\n"); return(0); }
+        if( pCtx->FatalError || pCtx->Errors >= 25 )
+        {
+            if( !pCtx->pfnMessage )
+                printf("Aborting...\n");
+            free(src);
+            return(0);
+        }
 
         /* Get a line of source code */
         i = GetSourceLine( ps, src, MAX_SOURCE_LINE );
@@ -746,7 +307,7 @@ int ProcessSourceFile( SOURCEFILE *ps )
         if( i<0 )
             continue;
 
-        if( !ProcessSourceLine(ps, i, src, MAX_SOURCE_LINE) && Pass==2 )
+        if( !ProcessSourceLine(ps, i, src, MAX_SOURCE_LINE) && pCtx->Pass==2 )
         {
             free(src);
             return(0);
@@ -764,9 +325,9 @@ int ProcessSourceFile( SOURCEFILE *ps )
 */
 int ProcessSourceLine( SOURCEFILE *ps, int length, char *src, int MaxLen )
 {
-    char    *pParams[MAX_TOKENS];
+    char    **pParams;
     SRCLINE sl;
-    int     i,rc;
+    int     i,rc,fMacro;
 
 REPEAT:
     if( !ParseSourceLine(ps,length,src,&sl) )
@@ -780,42 +341,54 @@ REPEAT:
             return(0);
 
         /* Create Label */
-        if( Pass==1 )
+        if( pCtx->Pass==1 )
         {
-            LabelCreate(ps, sl.Label, CodeOffset);
+            LabelCreate(ps, sl.Label, pCtx->CodeOffset);
         }
 
         /* Note it in listing file */
-        if( Pass==2 && (Options & OPTION_LISTING) )
+        if( PASS_LISTING && (pCtx->Options & OPTION_LISTING) )
         {
-            fprintf(ListingFile,"%s(%5d) : 0x%04x = Label      : %s:\n",
-                    ps->SourceName,ps->CurrentLine,CodeOffset,sl.Label);
+            fprintf(pCtx->ListingFile,"%s(%5d) : 0x%04x = Label      : %s:\n",
+                    ps->SourceName,ps->CurrentLine,pCtx->CodeOffset,sl.Label);
         }
     }
 
     /* Process Command/Opcode */
     if( sl.Terms )
     {
-        /* Get the parameters into a collection of string pointers */
-        for(i=0; i<(int)sl.Terms; i++)
-            pParams[i]=sl.Term[i];
-        for( ; i<MAX_TOKENS; i++ )
-            pParams[i]=0;
-
-        /* Perform structure processing */
-        if (!CheckMacro(pParams[0]))
+        pParams = sl.Term;
+        fMacro  = !sl.TermId && CheckMacro(pParams[0]);
+
+        /* Perform structure processing, rewritten terms go in the arena */
+        if( !fMacro )
+        {
             for(i=0; i<(int)sl.Terms; i++)
-                if( StructParamProcess(ps, i, pParams[i])<0 )
+            {
+                rc = StructParamProcess(ps, i, pParams[i], sl.Arena+sl.ArenaUsed);
+                if( rc<0 )
                     { Report(ps,REP_ERROR,"Error in struct parsing parameter %d",i); return(0); }
+                if( rc>0 )
+                {
+                    pParams[i] = sl.Arena+sl.ArenaUsed;
+                    sl.ArenaUsed += strlen(pParams[i])+1;
+                }
+            }
+        }
 
         /* Process a dot command */
         if( sl.Flags & SRC_FLG_DOTCMD1 )
         {
             src[0] = 0;
 
+            pCtx->FixupPending = 0;
+            pCtx->FixupOffset  = -1;
+            pCtx->Reloc        = RELOC_NONE;
             rc = DotCommand(ps,sl.Terms,pParams,src,MaxLen);
             if( rc<0 )
                 return(0);
+            if( pCtx->FixupPending && (pCtx->Options & OPTION_SINGLEPASS) && !FixupCreate(ps, sl.Terms, pParams) )
+                return(0);
             if( !rc )
                 return(1);
             /*
@@ -826,7 +399,7 @@ REPEAT:
         else
         {
             /* Process the macro or opcode */
-            if (CheckMacro(pParams[0]))
+            if( fMacro )
             {
                 // Process Macros
                 if ( !ProcessMacro(ps, sl.Terms, pParams) )
@@ -835,11 +408,17 @@ REPEAT:
             else
             {
                 // Process Opcodes
+                pCtx->FixupPending = 0;
+                pCtx->FixupOffset  = -1;
+                pCtx->LabelRef     = 0;
+                pCtx->Reloc        = RELOC_NONE;
                 if( !ProcessOp(ps, sl.Terms, pParams) )
                 {
                     GenOp( ps, sl.Terms, pParams, 0xFFFFFFFF );
                     return (0);
                 }
+                if( pCtx->FixupPending && (pCtx->Options & OPTION_SINGLEPASS) && !FixupCreate(ps, sl.Terms, pParams) )
+                    return(0);
             }
         }
     }
@@ -856,13 +435,16 @@ REPEAT:
 */
 int ParseSourceLine( SOURCEFILE *ps, int length, char *src, SRCLINE *pa )
 {
-    char    c;
+    char    c, *pTerm;
     int     srcIdx,wordIdx;
     int     parmCnt;
 
     srcIdx = 0;
-    pa->Flags = 0;
-    pa->Terms = 0;
+    pa->Flags  = 0;
+    pa->Terms  = 0;
+    pa->TermId = TOKID_NONE;
+    pa->Label  = 0;
+    pa->ArenaUsed = 0;
 
 PROCESS_LINE:
     /* Make sure character 1 is legal */
@@ -874,15 +456,18 @@ PROCESS_LINE:
     }
 
     /* Get the Opcode or Command */
+    pTerm = pa->Arena+pa->ArenaUsed;
     wordIdx = 0;
     while( LabelChar(c,0) || c=='.' )
     {
         if( wordIdx>=(TOKEN_MAX_LEN-1) )
             { Report(ps,REP_ERROR,"Cmd/Opcode too long"); return(0); }
-        pa->Term[0][wordIdx++] = c;
+        pTerm[wordIdx++] = c;
         c = src[srcIdx++];
     }
-    pa->Term[0][wordIdx]=0;
+    pTerm[wordIdx]=0;
+    pa->Term[0] = pTerm;
+    pa->ArenaUsed += wordIdx+1;
 
     /* See if it is a label */
     if( c==':' )
@@ -890,7 +475,7 @@ PROCESS_LINE:
         if( pa->Flags & SRC_FLG_LABEL )
             { Report(ps,REP_ERROR,"Two labels found on the same line"); return(0); }
         pa->Flags |= SRC_FLG_LABEL;
-        strcpy(pa->Label,pa->Term[0]);
+        pa->Label = pTerm;
 
         /* Process any assembly after the label */
         c = src[srcIdx];
@@ -921,6 +506,7 @@ PROCESS_LINE:
         /* Trim off leading white space */
         while( c==' ' || c==0x9 )
             c = src[srcIdx++];
+        pTerm = pa->Arena+pa->ArenaUsed;
 
         if( !LabelChar(c,0) &&
                     c!='.' && c!='#' && c!='-' && c!='(' && c!='"' && c!='&' && c!='*' )
@@ -932,7 +518,7 @@ PROCESS_LINE:
             {
                 if( wordIdx>=(TOKEN_MAX_LEN-1) )
                     { Report(ps,REP_ERROR,"Parameter %d too long",parmCnt); return(0); }
-                pa->Term[parmCnt][wordIdx++] = c;
+                pTerm[wordIdx++] = c;
                 c = src[srcIdx++];
 
             }
@@ -947,15 +533,17 @@ PROCESS_LINE:
             {
                 if( wordIdx>=(TOKEN_MAX_LEN-1) )
                     { Report(ps,REP_ERROR,"Parameter %d too long",parmCnt); return(0); }
-                pa->Term[parmCnt][wordIdx++] = c;
+                pTerm[wordIdx++] = c;
                 c = src[srcIdx++];
             }
         }
-        pa->Term[parmCnt][wordIdx] = 0;
 
         /* Trim off trailing white space */
-        while( wordIdx && (pa->Term[parmCnt][wordIdx-1]==0x9 || pa->Term[parmCnt][wordIdx-1]==' ') )
-            pa->Term[parmCnt][--wordIdx]=0;
+        while( wordIdx && (pTerm[wordIdx-1]==0x9 || pTerm[wordIdx-1]==' ') )
+            wordIdx--;
+        pTerm[wordIdx] = 0;
+        pa->Term[parmCnt] = pTerm;
+        pa->ArenaUsed += wordIdx+1;
 
         /* This character must be a comma or NULL */
         if( c==',' )
@@ -966,6 +554,9 @@ PROCESS_LINE:
 
     parmCnt++;
     pa->Terms = parmCnt;
+    for( wordIdx=parmCnt; wordIdx<MAX_TOKENS; wordIdx++ )
+        pa->Term[wordIdx] = 0;
+    pa->TermId = KeywordFind(pa->Term[0]);
 
     /* If its a dot command, mark it */
     if( pa->Term[0][0]=='.' )
@@ -992,29 +583,43 @@ void GenOp( SOURCEFILE *ps, int TermCnt, char **pTerms, uint opcode )
     if( !ValidateOffset(ps) )
         return;
 
-    if( (Options & OPTION_LISTING) && Pass==2 )
+    /* Remember where a line with a forward reference starts */
+    if( pCtx->FixupPending && pCtx->FixupOffset<0 )
+    {
+        pCtx->FixupOffset = pCtx->CodeOffset;
+        if( pCtx->ListingFile )
+            pCtx->FixupListPos = ftell( pCtx->ListingFile );
+    }
+
+    /* Relocatable object: note which words use a label address */
+    if( pCtx->Reloc!=RELOC_NONE && pCtx->Pass==2 && opcode!=0xFFFFFFFF && !RelocCreate(ps, opcode) )
+        opcode = 0xFFFFFFFF;
+
+    if( (pCtx->Options & OPTION_LISTING) && PASS_LISTING )
     {
-        fprintf(ListingFile,"%s(%5d) : 0x%04x = 0x%08x :     ",
-               ps->SourceName,ps->CurrentLine,CodeOffset,opcode);
-        fprintf(ListingFile,"%-8s ",pTerms[0]);
+        fprintf(pCtx->ListingFile,"%s(%5d) : 0x%04x = 0x%08x :     ",
+               ps->SourceName,ps->CurrentLine,pCtx->CodeOffset,opcode);
+        fprintf(pCtx->ListingFile,"%-8s ",pTerms[0]);
         for(i=1; i<TermCnt; i++)
         {
             if( i>1 )
-                fprintf(ListingFile,", %s",pTerms[i]);
+                fprintf(pCtx->ListingFile,", %s",pTerms[i]);
             else
-                fprintf(ListingFile,"%s",pTerms[i]);
+                fprintf(pCtx->ListingFile,"%s",pTerms[i]);
         }
         if( opcode==0xFFFFFFFF )
-            fprintf(ListingFile,"  // *** ERROR ***");
+            fprintf(pCtx->ListingFile,"  // *** ERROR ***");
 
-        fprintf(ListingFile,"\n");
+        fprintf(pCtx->ListingFile,"\n");
     }
 
-    ProgramImage[CodeOffset].Flags      = CODEGEN_FLG_FILEINFO|CODEGEN_FLG_CANMAP;
-    ProgramImage[CodeOffset].FileIndex  = ps->FileIndex;
-    ProgramImage[CodeOffset].Line       = ps->CurrentLine;
-    ProgramImage[CodeOffset].AddrOffset = CodeOffset;
-    ProgramImage[CodeOffset++].CodeWord = opcode;
+    pCtx->ProgramImage[pCtx->CodeOffset].Flags      = CODEGEN_FLG_FILEINFO|CODEGEN_FLG_CANMAP;
+    if( pCtx->LabelRef )
+        pCtx->ProgramImage[pCtx->CodeOffset].Flags |= CODEGEN_FLG_LABELREF;
+    pCtx->ProgramImage[pCtx->CodeOffset].FileIndex  = ps->FileIndex;
+    pCtx->ProgramImage[pCtx->CodeOffset].Line       = ps->CurrentLine;
+    pCtx->ProgramImage[pCtx->CodeOffset].AddrOffset = pCtx->CodeOffset;
+    pCtx->ProgramImage[pCtx->CodeOffset++].CodeWord = opcode;
 }
 
 
@@ -1026,34 +631,51 @@ void GenOp( SOURCEFILE *ps, int TermCnt, char **pTerms, uint opcode )
 void Report( SOURCEFILE *ps, int Level, char *fmt, ... )
 {
     va_list arg_ptr;
+    char    *Type;
 
-    if( Pass==1 && Level==REP_WARN2 )
+    if( !PASS_CHECKING && Level==REP_WARN2 )
         return;
-    if( Pass==2 && (Level==REP_INFO || Level==REP_WARN1) )
+    if( pCtx->Pass==2 && (Level==REP_INFO || Level==REP_WARN1) )
         return;
 
-    /* Log to stdout */
-    if( ps )
-        printf("%s(%d) ",ps->SourceName,ps->CurrentLine);
-
     if( Level == REP_FATAL )
     {
-       printf("Fatal Error: ");
-        FatalError=1;
-        Errors++;
+        Type = "Fatal Error: ";
+        pCtx->FatalError=1;
+        pCtx->Errors++;
     }
     else if( Level == REP_ERROR )
     {
-        printf("Error: ");
-        Errors++;
+        Type = "Error: ";
+        pCtx->Errors++;
     }
     else if( Level==REP_WARN1 || Level==REP_WARN2 )
     {
-        printf("Warning: ");
-        Warnings++;
+        Type = "Warning: ";
+        pCtx->Warnings++;
     }
     else
-        printf("Note: ");
+        Type = "Note: ";
+
+    /* Pass to the library caller */
+    if( pCtx->pfnMessage )
+    {
+        char Text[REPORT_TEXT_MAX];
+
+        va_start( arg_ptr, fmt );
+        vsnprintf( Text, REPORT_TEXT_MAX, fmt, arg_ptr );
+        va_end( arg_ptr );
+        Text[REPORT_TEXT_MAX-1] = 0;
+
+        pCtx->pfnMessage( pCtx->pMessageArg, Level, ps ? ps->SourceName : 0,
+                          ps ? ps->CurrentLine : 0, Text );
+        return;
+    }
+
+    /* Log to stdout */
+    if( ps )
+        printf("%s(%d) ",ps->SourceName,ps->CurrentLine);
+    printf("%s",Type);
 
     va_start( arg_ptr, fmt );
     vprintf( fmt, arg_ptr );
@@ -1114,16 +736,21 @@ int LabelCreate( SOURCEFILE *ps, char *label, int value )
 
     strcpy( pl->Name, label );
     pl->Offset = value;
+    pl->Flags  = 0;
+
+    /* Index it by name */
+    if( SymInsert( SYMKIND_LABEL, 0, pl->Name, pl ) )
+        { free(pl); Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
 
     /* Put this label in the master list */
     pl->pPrev  = 0;
-    pl->pNext  = pLabelList;
-    if( pLabelList )
-        pLabelList->pPrev = pl;
-    pLabelList = pl;
-    LabelCount++;
+    pl->pNext  = pCtx->pLabelList;
+    if( pCtx->pLabelList )
+        pCtx->pLabelList->pPrev = pl;
+    pCtx->pLabelList = pl;
+    pCtx->LabelCount++;
 
-    if( (Options & OPTION_DEBUG) )
+    if( (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : LABEL  : '%s' = %05d\n", ps->SourceName,ps->CurrentLine,label,value);
 
     return(1);
@@ -1139,16 +766,7 @@ int LabelCreate( SOURCEFILE *ps, char *label, int value )
 */
 LABEL *LabelFind( char *name )
 {
-    LABEL *pl;
-
-    pl = pLabelList;
-    while( pl )
-    {
-        if( !strcmp( name, pl->Name ) )
-            break;
-        pl = pl->pNext;
-    }
-    return(pl);
+    return( (LABEL *)SymLookup( SYMKIND_LABEL, 0, name ) );
 }
 
 
@@ -1162,15 +780,16 @@ LABEL *LabelFind( char *name )
 void LabelDestroy( LABEL *pl )
 {
     if( !pl->pPrev )
-        pLabelList = pl->pNext;
+        pCtx->pLabelList = pl->pNext;
     else
         pl->pPrev->pNext = pl->pNext;
 
     if( pl->pNext )
         pl->pNext->pPrev = pl->pPrev;
 
-    LabelCount--;
+    pCtx->LabelCount--;
 
+    SymRemove( SYMKIND_LABEL, 0, pl->Name, pl );
     free(pl);
 }
 
@@ -1214,158 +833,254 @@ static int ValidateOffset( SOURCEFILE *ps )
 {
     uint opcode;
 
-    if( CodeOffset==-1 )
+    if( pCtx->CodeOffset==-1 )
     {
-        CodeOffset = 8;
-        if( EntryPoint<0 )
-            EntryPoint = 8;
-        if( Core != CORE_V0 )
+        pCtx->CodeOffset = 8;
+        if( pCtx->EntryPoint<0 )
+            pCtx->EntryPoint = 8;
+        if( pCtx->Core != CORE_V0 )
             Report(ps,REP_WARN1,"Using default code origin of 8");
         else
         {
             opcode = 0x21000900;
 
             /* Note it in listing file */
-            if( Pass==2 && (Options & OPTION_LISTING) )
+            if( PASS_LISTING && (pCtx->Options & OPTION_LISTING) )
             {
-                fprintf(ListingFile,
+                fprintf(pCtx->ListingFile,
                         "%s(%5d) : 0x%04x = 0x%08x :     JMP      #0x9 // Legacy Mode\n",
-                        ps->SourceName,ps->CurrentLine,CodeOffset,opcode);
+                        ps->SourceName,ps->CurrentLine,pCtx->CodeOffset,opcode);
             }
 
-            ProgramImage[CodeOffset].Flags      = CODEGEN_FLG_FILEINFO;
-            ProgramImage[CodeOffset].FileIndex  = ps->FileIndex;
-            ProgramImage[CodeOffset].Line       = ps->CurrentLine;
-            ProgramImage[CodeOffset].AddrOffset = CodeOffset;
-            ProgramImage[CodeOffset++].CodeWord = opcode;
+            pCtx->ProgramImage[pCtx->CodeOffset].Flags      = CODEGEN_FLG_FILEINFO;
+            pCtx->ProgramImage[pCtx->CodeOffset].FileIndex  = ps->FileIndex;
+            pCtx->ProgramImage[pCtx->CodeOffset].Line       = ps->CurrentLine;
+            pCtx->ProgramImage[pCtx->CodeOffset].AddrOffset = pCtx->CodeOffset;
+            pCtx->ProgramImage[pCtx->CodeOffset++].CodeWord = opcode;
         }
     }
 
-    if( CodeOffset >= MAX_PROGRAM )
+    if( pCtx->CodeOffset >= MAX_PROGRAM )
         { Report(ps,REP_FATAL,"Max program size exceeded"); return(0); }
 
     return(1);
 }
 
 /*
-// PrintLine
+// FixupCreate
 //
-// Prints out a line of the source file for source listings
+// Single pass mode: Record a line that used a forward reference so that
+// it can be encoded again once all the labels are known.
 //
-// Returns 1 on success, 0 on EOF
+// Returns 1 on success, 0 on error
 */
-static int PrintLine( FILE *pfOut, SOURCEFILE *ps )
+static int FixupCreate( SOURCEFILE *ps, int TermCnt, char **pTerms )
 {
-    int i;
-    char c;
+    FIXUP *pf;
+    int   i,len,type;
 
-AGAIN:
-    i = fread( &c, 1, 1, ps->FilePtr );
-    if( i != 1 )
-        return(0);
-    if( c == 0xd )
-        goto AGAIN;
-    if( c == 0xa )
+    type = FIXUP_CODE;
+    if( pTerms[0][0]=='.' )
     {
-        ps->CurrentLine++;
-        fprintf(pfOut,"\n");
-        return(1);
+        if( !stricmp( pTerms[0], ".entrypoint" ) )
+            type = FIXUP_ENTRYPOINT;
+        else if( stricmp( pTerms[0], ".codeword" ) )
+            { Report(ps,REP_ERROR,"Forward reference not allowed in %s with single pass",pTerms[0]); return(0); }
     }
-    fprintf(pfOut,"%c",c);
-    goto AGAIN;
-}
 
-/*
-// GetInfoFromAddr
-//
-// Returns the SourceFileIndex, Line Number, and CodeWord for a given address offset
-//
-// Returns 0 on success, -1 on error
-*/
-static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, uint *pCodeWord )
-{
-    // Return data if within written portion of array and entry has been set
-    if (address < CodeOffset && ProgramImage[address].AddrOffset == address) {
-       *pIndex = ProgramImage[address].FileIndex;
-       *pLineNo = ProgramImage[address].Line;
-       *pCodeWord = ProgramImage[address].CodeWord;
-       return 0;
+    len = 0;
+    for( i=0; i<TermCnt; i++ )
+        len += strlen(pTerms[i])+1;
+
+    /* Allocate a new record */
+    pf = malloc(sizeof(FIXUP)+len);
+    if( !pf )
+        { Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
+
+    pf->Type      = type;
+    pf->FileIndex = ps->FileIndex;
+    pf->Line      = ps->CurrentLine;
+    if( pCtx->FixupOffset<0 )
+    {
+        /* No code: note where the line is, in case it fails */
+        pf->Offset  = pCtx->CodeOffset;
+        pf->Words   = 0;
+        pf->ListPos = pCtx->ListingFile ? ftell( pCtx->ListingFile ) : 0;
+    }
+    else
+    {
+        pf->Offset  = pCtx->FixupOffset;
+        pf->Words   = pCtx->CodeOffset-pCtx->FixupOffset;
+        pf->ListPos = pCtx->FixupListPos;
     }
-    return -1;
+    pf->Terms     = TermCnt;
+    len = 0;
+    for( i=0; i<TermCnt; i++ )
+    {
+        strcpy( pf->Term+len, pTerms[i] );
+        len += strlen(pTerms[i])+1;
+    }
+
+    /* Put this fixup at the end of the list */
+    pf->pNext    = 0;
+    *pCtx->ppFixupTail = pf;
+    pCtx->ppFixupTail  = &pf->pNext;
+
+    return(1);
 }
 
+
 /*
-// ListFile
+// FixupResolve
 //
-// Prints out an object code annotated listing of an original source file
+// Single pass mode: Encode each recorded line again at its original
+// offset, as pass 2 would, and patch the code image and listing.
+// Stops on the first error, like pass 2: the failed line gets an error
+// word, the listing ends after it, and the pass and code offset are
+// left as pass 2 would leave them.
 //
-// Returns 1 on success
+// Returns 1 on success, 0 on error
 */
-static int ListFile( FILE *pfOut, SOURCEFILE *ps )
+static int FixupResolve()
 {
-    uint addr, index, line, code, count, output, cline;
-
-    count = 0;
-    for( addr=0; addr<(uint)CodeOffset; addr++ )
-    {
-        if( GetInfoFromAddr( addr, &index, &line, &code ) >= 0 )
-        {
-            if( index == ps->FileIndex )
-                count++;
-        }
-    }
-
-    if( !count )
+    FIXUP      *pf;
+    SOURCEFILE sf;
+    char       *pTerms[MAX_TOKENS];
+    char       src[TOKEN_MAX_LEN];
+    uint       val;
+    int        i,len,tmp,rc;
+    int        SaveOffset = pCtx->CodeOffset;
+    int        Failed = 0;
+    long       ListEnd = 0;
+
+    pCtx->Pass = 2;
+    while( pCtx->pFixupList )
     {
-        // No code section
-        fprintf(pfOut,"(No Output Generated)\n\n");
+        pf = pCtx->pFixupList;
+        pCtx->pFixupList = pf->pNext;
 
-        for(;;)
+        if( !pCtx->Errors && !Failed )
         {
-            fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
-            if( !PrintLine(pfOut,ps) )
-                return(1);
-        }
-    }
-    else
-    {
-        fprintf(pfOut,"(%d Instructions Generated)\n\n",count);
-
-        for(;;)
-        {
-            output = 0;
-            cline = ps->CurrentLine;
+            sf = pCtx->sfArray[pf->FileIndex];
+            sf.CurrentLine = pf->Line;
 
-            for( addr=0; addr<(uint)CodeOffset; addr++ )
+            len = 0;
+            for( i=0; i<pf->Terms; i++ )
             {
-                if( (GetInfoFromAddr( addr, &index, &line, &code ) < 0) || index!=ps->FileIndex || line<cline )
-                    continue;
+                pTerms[i] = pf->Term+len;
+                len += strlen(pTerms[i])+1;
+            }
+            for( ; i<MAX_TOKENS; i++ )
+                pTerms[i] = 0;
 
-                if( line == cline )
+            pCtx->FixupPending = 0;
+            pCtx->LabelRef     = 0;
+            if( pf->Type==FIXUP_ENTRYPOINT )
+            {
+                strcpy( src, pTerms[1] );
+                if( Expression(&sf, src, &val, &tmp)<0 )
                 {
-                    if( !output )
-                    {
-                        fprintf(pfOut,"%5d : 0x%04x 0x%08x : ",line,addr,code );
-                        if( !PrintLine(pfOut,ps) )
-                            return(1);
-                        output = 1;
-                    }
-                    else
-                    {
-                        fprintf(pfOut,"      : 0x%04x 0x%08x : \n",addr,code );
-                    }
+                    Report(&sf,REP_ERROR,"Error in processing .entrypoint value");
+                    Failed = 1;
+                    pCtx->CodeOffset = pf->Offset;
+                    ListEnd = pf->ListPos;
                 }
+                else
+                    pCtx->EntryPoint = val;
             }
-
-            if( !output )
+            else
             {
-                fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
-                if( !PrintLine(pfOut,ps) )
-                    return(1);
+                pCtx->CodeOffset = pf->Offset;
+                if( pCtx->ListingFile )
+                    fseek( pCtx->ListingFile, pf->ListPos, SEEK_SET );
+                if( pTerms[0][0]=='.' )
+                    rc = DotCommand(&sf, pf->Terms, pTerms, src, TOKEN_MAX_LEN)>=0;
+                else if( !(rc = ProcessOp(&sf, pf->Terms, pTerms)) )
+                    GenOp( &sf, pf->Terms, pTerms, 0xFFFFFFFF );
+                if( rc && pCtx->CodeOffset!=pf->Offset+pf->Words )
+                    Report(&sf,REP_ERROR,"Code size changed by forward reference");
+                if( !rc || pCtx->Errors )
+                {
+                    Failed = 1;
+                    ListEnd = pCtx->ListingFile ? ftell( pCtx->ListingFile ) : 0;
+                }
             }
         }
+        free(pf);
     }
+    pCtx->ppFixupTail = &pCtx->pFixupList;
+
+    if( Failed )
+    {
+        /* Drop the listing of the lines pass 2 would not have reached */
+        if( pCtx->ListingFile )
+        {
+            fflush( pCtx->ListingFile );
+            if( ftruncate( fileno(pCtx->ListingFile), ListEnd ) )
+                Report(0,REP_WARN2,"Unable to truncate the listing file");
+            fseek( pCtx->ListingFile, 0, SEEK_END );
+        }
+        return(0);
+    }
+
+    if( pCtx->ListingFile )
+        fseek( pCtx->ListingFile, 0, SEEK_END );
+    pCtx->CodeOffset = SaveOffset;
+    pCtx->Pass = 1;
+
+    if( pCtx->Errors )
+        return(0);
     return(1);
 }
 
 
+/*
+// RelocCreate
+//
+// Records the relocation of the word at the current offset, for a line
+// that used a label address in a relocatable object (-r). Jumps, calls,
+// and LDI get the address added to their 16 bit immediate. Quick
+// branches within the module are already relative, and those to an
+// external label get their offset from the linker.
+//
+// Returns 1 on success, 0 on error
+*/
+static int RelocCreate( SOURCEFILE *ps, uint opcode )
+{
+    RELOC *pr;
+    uint  type, sub = (opcode>>25)&0xF;
+
+    if( pCtx->Reloc==RELOC_BAD )
+        { Report(ps,REP_ERROR,"Label address can not be relocated (use one label plus or minus a constant)"); return(0); }
+
+    if( (opcode>>29)==1 && (sub==2 || (sub<=1 && (opcode & (1<<24)))) )
+        type = RELOC_TYPE_IMM16;
+    else if( (opcode>>29)==2 || (opcode>>29)==3 ||
+             ((opcode>>29)==6 && (((opcode>>27)&0x1F)==0x19 || ((opcode>>27)&0x1F)==0x1A)) )
+    {
+        if( pCtx->Reloc==RELOC_LOCAL )
+            return(1);
+        type = RELOC_TYPE_BRANCH;
+    }
+    else if( (opcode>>29)==1 && sub==8 && pCtx->Reloc==RELOC_LOCAL )
+        return(1);
+    else
+        { Report(ps,REP_ERROR,"Label address can not be relocated in this instruction"); return(0); }
+
+    if( pCtx->RelocCount == pCtx->RelocSize )
+    {
+        pr = realloc( pCtx->pRelocList, (pCtx->RelocSize+256)*sizeof(RELOC) );
+        if( !pr )
+            { Report(ps,REP_FATAL,"Memory allocation failed"); return(0); }
+        pCtx->pRelocList = pr;
+        pCtx->RelocSize += 256;
+    }
+    pr = &pCtx->pRelocList[pCtx->RelocCount++];
+    pr->Type       = type;
+    pr->AddrOffset = pCtx->CodeOffset;
+    pr->pExtern    = (pCtx->Reloc==RELOC_EXTERN) ? pCtx->pRelocExtern : 0;
+
+    /* Only one word of a line can be relocated */
+    pCtx->Reloc = RELOC_BAD;
+    return(1);
+}
@@ -60,6 +60,9 @@
 typedef unsigned int uint;
 
 #include "pru_ins.h"
+#include "pasmlib.h"
+#include "prusim.h"
+#include "prudis.h"
 
 #define TOKEN_MAX_LEN   128
 
@@ -69,6 +72,9 @@ typedef struct _LABEL {
     struct _LABEL   *pPrev;         /* Previous in LABEL list */
     struct _LABEL   *pNext;         /* Next in LABEL list */
     int             Offset;         /* Offset Value */
+    int             Flags;          /* Label flags */
+#define LABEL_FLG_EXTERN    (1<<0)  /* Declared by .extern, defined elsewhere */
+#define LABEL_FLG_GLOBAL    (1<<1)  /* Exported by .global */
     char            Name[LABEL_NAME_LEN];
 } LABEL;
 
@@ -86,18 +92,31 @@ typedef struct _SOURCEFILE {
     char            LastChar;       /* Last character read from file */
     char            SourceName[SOURCE_NAME];
     char            SourceBaseDir[SOURCE_BASE_DIR];
+    const char      *pBuffer;       /* Source text in memory (instead of FilePtr) */
+    unsigned int    BufferLength;   /* Length of the source text */
+    unsigned int    BufferIndex;    /* The next character to read */
 } SOURCEFILE;
 
-/* Source Line Record */
+/*
+// Source Line Record
+//
+// The label and terms are packed one after another in the line arena,
+// which also holds terms rewritten by struct processing. Unused terms
+// are 0. TermId is the token ID of the first term (see KeywordFind).
+*/
 #define MAX_TOKENS      12
 #define SRC_FLG_LABEL       (1<<0)
 #define SRC_FLG_DOTCMD1     (1<<1)
 #define SRC_FLG_DOTCMD2     (1<<2)
+#define SRC_ARENA_LEN   ((2*MAX_TOKENS+1)*TOKEN_MAX_LEN)
 typedef struct _SRCLINE {
     uint    Flags;
     uint    Terms;
-    char    Label[TOKEN_MAX_LEN];
-    char    Term[MAX_TOKENS][TOKEN_MAX_LEN];
+    int     TermId;
+    char    *Label;
+    char    *Term[MAX_TOKENS];
+    uint    ArenaUsed;
+    char    Arena[SRC_ARENA_LEN];
 } SRCLINE;
 
 /* CodeGen Record */
@@ -105,6 +124,7 @@ typedef struct _CODEGEN {
     unsigned char   Flags;          /* Record flags */
 #define CODEGEN_FLG_FILEINFO 0x01
 #define CODEGEN_FLG_CANMAP   0x02
+#define CODEGEN_FLG_LABELREF 0x04   /* Operand used the value of a label */
     unsigned char   Resv8;          /* Reserved */
     unsigned short  FileIndex;      /* Source file index */
     unsigned int    Line;           /* The line number */
@@ -112,8 +132,22 @@ typedef struct _CODEGEN {
     unsigned int    CodeWord;       /* Code */
 } CODEGEN;
 
+/* Relocation Record (-r), types as in pasmdbg.h */
+typedef struct _RELOC {
+    uint            Type;
+#define RELOC_TYPE_IMM16    1       /* 16 bit address in bits 8-23 */
+#define RELOC_TYPE_BRANCH   2       /* 10 bit quick branch offset */
+    uint            AddrOffset;     /* Code word to patch */
+    LABEL           *pExtern;       /* External label, or 0 for this module */
+} RELOC;
+
+/* Relocation State of the Current Line */
+#define RELOC_NONE          0       /* No label address used */
+#define RELOC_LOCAL         1       /* Uses one address in this module */
+#define RELOC_EXTERN        2       /* Uses one external address */
+#define RELOC_BAD           3       /* Uses addresses that can not be relocated */
+
 /* User Options */
-extern unsigned int Options;
 #define OPTION_BINARY               (1<<0)
 #define OPTION_BINARYBIG            (1<<1)
 #define OPTION_CARRAY               (1<<2)
@@ -124,36 +158,40 @@ extern unsigned int Options;
 #define OPTION_BIGENDIAN            (1<<7)
 #define OPTION_RETREGSET            (1<<8)
 #define OPTION_SOURCELISTING        (1<<9)
-extern unsigned int Core;
+#define OPTION_SINGLEPASS           (1<<10)
+#define OPTION_DEPEND               (1<<11)
+#define OPTION_TIMING               (1<<12)
+#define OPTION_OPTIMIZE             (1<<13)
+#define OPTION_RELOC                (1<<14)
 #define CORE_NONE                   0
 #define CORE_V0                     1
 #define CORE_V1                     2
 #define CORE_V2                     3
 #define CORE_V3                     4
-extern FILE         *CArrayFile;
-extern FILE         *ListingFile;
-
-/* Assembler Engine */
-extern int  Pass;                   /* Pass 1 or 2 of parser */
-extern int  HaveEntry;              /* Entrypont flag (init to 0) */
-extern int  EntryPoint;             /* Entrypont (init to -1) */
-extern int  CodeOffset;             /* Current instruction "word" offset (zero based) */
-extern int  Errors;                 /* Total number or errors */
-extern int  FatalError;             /* Set on fatal error */
-extern int  Warnings;               /* Total number of warnings */
-extern uint RetRegValue;            /* Return register index */
-extern uint RetRegField;            /* Return register field */
+
+/*
+// With OPTION_SINGLEPASS there is only pass 1, but it also writes the
+// listing, and lines without forward references get the pass 2 checks.
+// Lines with forward references are checked when their fixups are
+// resolved.
+*/
+#define PASS_LISTING    (pCtx->Pass==2 || (pCtx->Options & OPTION_SINGLEPASS))
+#define PASS_CHECKING   (pCtx->Pass==2 || ((pCtx->Options & OPTION_SINGLEPASS) && !pCtx->FixupPending))
 
 #define DEFAULT_RETREGVAL   30
 #define DEFAULT_RETREGFLD   FIELDTYPE_15_0
 
 #define SOURCEFILE_MAX      64
-extern SOURCEFILE sfArray[SOURCEFILE_MAX];
-extern unsigned int sfIndex;
+#define MAX_PROGRAM         (16384)     /* Max instruction count */
+#define MAX_CMD_EQUATE      (8)         /* Max equates that can be put on command line */
+#define CC_MAX_DEPTH        8           /* Max #ifdef nesting */
 
 /* Use platform appropriate function for case-insensitive string compare */
 #ifdef _MSC_VER
   #define stricmp _stricmp
+  #if _MSC_VER < 1900
+    #define vsnprintf _vsnprintf
+  #endif
 #elif defined(__GNUC__)
   #define stricmp strcasecmp
 #endif
@@ -236,6 +274,31 @@ int GetRegister( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, int fBitOk, ch
 //
 //====================================================================*/
 
+#define DOTCMD_MAIN         0
+#define DOTCMD_END          1
+#define DOTCMD_PROC         2
+#define DOTCMD_RET          3
+#define DOTCMD_ORIGIN       4
+#define DOTCMD_ENTRYPOINT   5
+#define DOTCMD_STRUCT       6
+#define DOTCMD_ENDS         7
+#define DOTCMD_U32          8
+#define DOTCMD_U16          9
+#define DOTCMD_U8           10
+#define DOTCMD_ASSIGN       11
+#define DOTCMD_SETCALLREG   12
+#define DOTCMD_ENTER        13
+#define DOTCMD_LEAVE        14
+#define DOTCMD_USING        15
+#define DOTCMD_MACRO        16
+#define DOTCMD_MPARAM       17
+#define DOTCMD_ENDM         18
+#define DOTCMD_CODEWORD     19
+#define DOTCMD_GLOBAL       20
+#define DOTCMD_EXTERN       21
+#define DOTCMD_MAX          21
+extern char *DotCmds[];
+
 /*
 // CheckDotCommand
 //
@@ -384,13 +447,14 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
 // operations. When found, the structure definition is used to substitute
 // in the proper register or numeric value.
 //
-// The string 'source' is assumed to be be able to hold a length of
-// at least 'TOKEN_MAX_LEN' bytes.
+// The rewritten argument is written to 'dest', which must be able to
+// hold 'TOKEN_MAX_LEN' bytes. It is only written when something was
+// substituted.
 //
-// Returns 0 for OK, or -1 for Fatal Error
+// Returns 1 if rewritten, 0 if unchanged, or -1 for Fatal Error
 //
 */
-int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source );
+int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source, char *dest );
 
 
 /*
@@ -447,6 +511,7 @@ int ParseSourceLine( SOURCEFILE *ps, int length, char *src, SRCLINE *pa );
 #define REP_WARN2   2   /* Warn on pass2 */
 #define REP_ERROR   3
 #define REP_FATAL   4
+#define REPORT_TEXT_MAX 1024    /* Max message text passed to pfnMessage */
 void Report( SOURCEFILE *ps, int Level, char *fmt, ... );
 
 /*
@@ -543,6 +608,17 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex );
 SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename, int
                             use_include_path );
 
+/*
+// InitSourceBuffer
+//
+// Initializes all the fields in SOURCEFILE to read source text from
+// memory. The text must stay valid until the file is closed.
+//
+// Returns SOURCEFILE * on success, 0 on error
+*/
+SOURCEFILE *InitSourceBuffer( SOURCEFILE *pParent, char *name,
+                              const char *pText, uint Length );
+
 /*
 // CloseSourceFile
 //
@@ -644,3 +720,492 @@ void MacroCleanup();
 */
 int CheckMacro( char *name );
 
+
+
+/*=======================================================================
+//
+// Symbol Table Functions
+//
+=======================================================================*/
+
+/* Symbol kinds - each kind is a separate namespace */
+#define SYMKIND_LABEL       0
+#define SYMKIND_EQUATE      1
+#define SYMKIND_MACRO       2
+#define SYMKIND_STRUCT      3
+#define SYMKIND_SCOPE       4
+#define SYMKIND_ASSIGN      5   /* Keyed by scope as well as by name */
+#define SYMKIND_MAX         6
+
+/*
+// SymIntern
+//
+// Returns the unique copy of the supplied name, creating it if needed.
+// Interned names are kept until SymCleanup().
+//
+// Returns char * on success, 0 on error
+*/
+char *SymIntern( char *Name );
+
+
+/*
+// SymInsert
+//
+// Indexes a record under the supplied kind, scope, and name. A record
+// inserted later hides an earlier one with the same key until removed.
+//
+// Returns 0 on success, -1 on error
+*/
+int SymInsert( int Kind, void *pScope, char *Name, void *pData );
+
+
+/*
+// SymLookup
+//
+// Searches for a record by kind, scope, and name.
+//
+// Returns the record pointer on success, 0 if not found
+*/
+void *SymLookup( int Kind, void *pScope, char *Name );
+
+
+/*
+// SymRemove
+//
+// Removes the index entry for the supplied record.
+//
+// void
+*/
+void SymRemove( int Kind, void *pScope, char *Name, void *pData );
+
+
+/*
+// SymCleanup
+//
+// Frees all index entries and interned names. The caller must have
+// destroyed the indexed records first.
+//
+// void
+*/
+void SymCleanup();
+
+
+/*=====================================================================
+//
+// Name Table Functions (pasmhash.c)
+//
+// Mnemonics, dot commands, register fields and constant table entries
+// are looked up through perfect hash tables generated by pasmhashgen.c.
+// The same tables give the text of a name from its ID, so that the
+// assembler and disassembler always agree.
+//
+=======================================================================*/
+
+/* Token IDs */
+#define TOKID_NONE          0
+#define TOKID_OPCODE        0x100   /* + OP_xxx */
+#define TOKID_DOTCMD        0x200   /* + DOTCMD_xxx */
+#define TOKID_REGISTER      0x300   /* + register number */
+#define TOKID_CONSTANT      0x400   /* + constant table index */
+#define TOKID_BIT           0x500   /* + bit number */
+#define TOKID_FIELD         0x600   /* + FIELDTYPE_xxx */
+#define TOKID_KIND(id)      ((id) & ~0xff)
+
+/* RegisterFind() flags and error code */
+#define REGFIND_FLG_NOBIT   0x0001  /* .Txx is not allowed */
+#define REGFIND_FLG_SINGLE  0x0002  /* Only one modifier (CORE_V0) */
+#define REGFIND_ERR_BIT     (-1)    /* Found .Txx with REGFIND_FLG_NOBIT */
+
+/* Buffer size for RegisterText() */
+#define REGTEXT_LEN         16
+
+/*
+// KeywordFind
+//
+// Looks up a mnemonic or dot command, ignoring case.
+//
+// Returns the token ID (TOKID_xxx), or TOKID_NONE
+*/
+int KeywordFind( char *word );
+
+
+/*
+// KeywordText
+//
+// Gets the lower case text of a mnemonic or dot command
+//
+// Returns the text, or 0 if id is not a keyword
+*/
+char *KeywordText( int id );
+
+
+/*
+// RegisterFind
+//
+// Parses a register name of the form Rxx[.Wx|.Bx]...[.Txx], ignoring
+// case. Each field selects within the one before it. The name ends at
+// termC, which must be present.
+//
+// Fills in the Type, Value, Field, and Bit of the argument record.
+//
+// Returns 1 on success, 0 if not a register, or REGFIND_ERR_BIT
+*/
+int RegisterFind( char *src, char termC, int flags, PRU_ARG *pa );
+
+
+/*
+// RegisterText
+//
+// Formats a register or register bit argument. The buffer must hold
+// REGTEXT_LEN characters.
+//
+// Returns buf
+*/
+char *RegisterText( PRU_ARG *pa, char *buf );
+
+
+/*
+// ConstantFind
+//
+// Parses a constant table entry of the form Cxx, ignoring case
+//
+// Returns the entry number, or -1 if src is not a constant table entry
+*/
+int ConstantFind( char *src );
+
+
+/*
+// ConstantText
+//
+// Returns the text of a constant table entry, or 0 if out of range
+*/
+char *ConstantText( uint idx );
+
+
+
+/*=======================================================================
+//
+// Dependency File Functions
+//
+=======================================================================*/
+
+/*
+// DependWrite
+//
+// Writes a make dependency file (*.d) with the output files as targets
+// and every source file that was read as prerequisites.
+//
+// Returns 1 on success, 0 on error
+*/
+int DependWrite( char *outbase );
+
+
+
+/*=======================================================================
+//
+// Timing Analysis Functions
+//
+=======================================================================*/
+
+/*
+// TimingWrite
+//
+// Writes the timing report (*.tim): the best and worst cycles between
+// labels, and along the paths given with -Tfrom:to.
+//
+// Returns 1 on success, 0 on error
+*/
+#define MAX_TIMING_QUERY    16
+int TimingWrite( char *outbase );
+
+/*=======================================================================
+//
+// Optimizer Functions
+//
+=======================================================================*/
+
+/*
+// OptimizeImage
+//
+// Runs the peephole optimizer (-O) on the code image, and checks the
+// result in the simulator against the original code.
+//
+// Returns 1 if the code changed, 0 if not
+*/
+int OptimizeImage();
+
+
+/*=======================================================================
+//
+// Output Functions
+//
+=======================================================================*/
+
+/*
+// Output Writer
+//
+// Buffered writer to a file, stdout, or memory (see pasmout.c)
+*/
+#define OUTWRITER_BUFFER    (32*1024)
+typedef struct _OUTWRITER {
+    FILE            *pFile;         /* File or stdout (0 for memory) */
+    unsigned char   *pMem;          /* Memory output, freed by the caller */
+    uint            MemLength;
+    uint            MemSize;
+    uint            Used;           /* Bytes in Buffer */
+    int             Error;          /* Set on a write or allocation error */
+    unsigned char   Buffer[OUTWRITER_BUFFER];
+} OUTWRITER;
+
+/* Code Image Formats */
+#define OUTFMT_CARRAY       0       /* *_bin.h (-c) */
+#define OUTFMT_IMG          1       /* *.img (-m) */
+#define OUTFMT_DBG          2       /* *.dbg (-d) */
+#define OUTFMT_BIN          3       /* *.bin (-b) */
+#define OUTFMT_BIB          4       /* *.bib (-B) */
+#define OUTFMT_MAX          5
+
+/*
+// OutOpen
+//
+// Opens a writer on the file Path, on stdout when Path is "-", or on
+// memory when Path is 0
+//
+// Returns 1 on success, 0 on error
+*/
+int OutOpen( OUTWRITER *pw, char *Path );
+
+/*
+// OutWrite
+//
+// Adds data to a writer
+//
+// void
+*/
+void OutWrite( OUTWRITER *pw, const void *pData, uint Length );
+
+/*
+// OutClose
+//
+// Writes out the buffered data and closes the writer. A memory writer
+// leaves its data in pMem and MemLength.
+//
+// Returns 1 when all the data was written, 0 on error
+*/
+int OutClose( OUTWRITER *pw );
+
+/*
+// ImageWrite
+//
+// Serializes the code image to each writer in ppWriter[OUTFMT_MAX] that
+// is set, in one sweep over the image. ArrayName names the C array (0
+// for the default name).
+//
+// Returns 1 on success, 0 on error
+*/
+int ImageWrite( OUTWRITER *ppWriter[OUTFMT_MAX], char *ArrayName );
+
+/*
+// OutputWrite
+//
+// Writes the code image files requested in the options. When outbase is
+// "-", the one requested format is written to stdout.
+//
+// Returns 1 on success, 0 on error
+*/
+int OutputWrite( char *outbase, char *ArrayName );
+
+/*
+// OutSourceName
+//
+// Gets the name of a source file as the debug and object files record it:
+// the path it was opened by, or the bare name when the path does not fit
+// in DBGFILE_NAMELEN_SHORT characters
+//
+// void
+*/
+void OutSourceName( uint FileIndex, char *Name );
+
+
+/*=======================================================================
+//
+// Object File Functions
+//
+=======================================================================*/
+
+/*
+// ObjectWrite
+//
+// Writes the relocatable object file (*.pobj) for pasmlink: the debug
+// file records, plus the .global and .extern symbols and relocations.
+//
+// Returns 1 on success, 0 on error
+*/
+int ObjectWrite( char *outbase );
+
+
+
+/*
+// Known Register Values
+//
+// Tracks which register bits hold a value known at assembly time.
+// KnownApply() steps the values over one instruction, and KnownResult()
+// finds the value an instruction would write to its destination field.
+*/
+typedef struct _KNOWNREGS {
+    uint            Val[32];
+    uint            Known[32];      /* Mask of the known bits */
+} KNOWNREGS;
+int  KnownGet( KNOWNREGS *pk, uint reg, uint field, uint *pVal );
+int  KnownResult( KNOWNREGS *pk, uint pc, uint op, uint *pVal );
+void KnownApply( KNOWNREGS *pk, uint pc, uint op );
+
+
+/*=====================================================================
+//
+// Assembler Context
+//
+//====================================================================*/
+
+/*
+// All the state of one assembly lives in a PASMCTX. The engine reaches
+// it through pCtx, which is kept per thread, so separate threads can
+// assemble at the same time. Set pCtx to a context from ContextCreate()
+// before calling into the engine.
+*/
+#ifdef _MSC_VER
+  #define PASM_THREAD __declspec(thread)
+#else
+  #define PASM_THREAD __thread
+#endif
+
+/*
+// Source Reader
+//
+// When set, InitSourceFile() gets the text of each file from the front
+// end instead of reading the file itself. The text must stay valid until
+// the context is destroyed.
+//
+// Returns 0 on success, -1 if the file can not be read
+*/
+typedef int (*PASM_SOURCE_READER)( void *pArg, const char *Path,
+                                   const char **ppText, uint *pLength );
+
+/* Hash Table (see pasmsym.c) */
+typedef struct _SYMTABLE {
+    uint            Size;           /* Number of buckets */
+    uint            Count;          /* Number of entries */
+    void            **pBucket;      /* Bucket array */
+} SYMTABLE;
+
+struct _EQUATE;
+struct _MACRO;
+struct _STRUCT;
+struct _SCOPE;
+struct _FIXUP;
+
+typedef struct _PASMCTX {
+    /* User Options */
+    unsigned int    Options;
+    unsigned int    Core;
+    FILE            *ListingFile;
+    char            cmdLineName[MAX_CMD_EQUATE][EQUATE_NAME_LEN];
+    char            cmdLineData[MAX_CMD_EQUATE][EQUATE_DATA_LEN];
+    int             cmdLineEquates;
+    PRUSIM_COSTS    TimingCosts;    /* Transfer costs for the timing report */
+    char            *TimingQuery[MAX_TIMING_QUERY]; /* -Tfrom:to paths */
+    int             TimingQueries;
+
+    /* Library Callbacks */
+    PASM_INCLUDE_RESOLVER pfnInclude;   /* Supplies #include text (or 0) */
+    void            *pIncludeArg;
+    PASM_MESSAGE_HANDLER pfnMessage;    /* Receives Report() text (or 0) */
+    void            *pMessageArg;
+    PASM_SOURCE_READER pfnReadSource;   /* Supplies source file text (or 0) */
+    void            *pReadSourceArg;
+
+    /* Assembler Engine */
+    int             Pass;           /* Pass 1 or 2 of parser */
+    int             FixupPending;   /* Current line has a forward reference */
+    int             LabelRef;       /* Current line used the value of a label */
+    int             Reloc;          /* Current line relocation state (RELOC_xxx) */
+    LABEL           *pRelocExtern;  /* External label of RELOC_EXTERN */
+    int             HaveEntry;      /* Entrypont flag (init to 0) */
+    int             EntryPoint;     /* Entrypont (init to -1) */
+    int             CodeOffset;     /* Current instruction "word" offset (zero based) */
+    int             Errors;         /* Total number or errors */
+    int             FatalError;     /* Set on fatal error */
+    int             Warnings;       /* Total number of warnings */
+    uint            RetRegValue;    /* Return register index */
+    uint            RetRegField;    /* Return register field */
+
+    LABEL           *pLabelList;    /* List of installed labels */
+    int             LabelCount;
+
+    RELOC           *pRelocList;    /* Relocations of a -r object */
+    int             RelocCount;
+    int             RelocSize;
+
+    struct _FIXUP   *pFixupList;    /* List of pending fixups (in source order) */
+    struct _FIXUP   **ppFixupTail;
+    int             FixupOffset;    /* Offset of first word on current line */
+    long            FixupListPos;   /* Listing position of first word on current line */
+
+    /* Preprocessor */
+    int             OpenFiles;      /* Total number of open files */
+    struct _EQUATE  *pEqList;       /* List of installed equates */
+    SOURCEFILE      sfArray[SOURCEFILE_MAX];
+    unsigned int    sfIndex;
+    uint            ccDepth;
+    uint            ccStateFlags[CC_MAX_DEPTH];
+
+    /* Macros */
+    int             MacroId;
+    struct _MACRO   *pMacroList;    /* List of declared macros */
+    struct _MACRO   *pMacroCurrent;
+
+    /* Structures and Scopes */
+    struct _STRUCT  *pStructList;   /* List of declared structs */
+    struct _STRUCT  *pStructCurrent;
+    struct _SCOPE   *pScopeList;    /* List of declared scopes */
+    struct _SCOPE   *pScopeCurrent;
+
+    /* Symbol Tables */
+    SYMTABLE        NameTable;      /* Interned names */
+    SYMTABLE        KindTable[SYMKIND_MAX]; /* One namespace per kind */
+
+    CODEGEN         ProgramImage[MAX_PROGRAM];
+} PASMCTX;
+
+extern PASM_THREAD PASMCTX *pCtx;
+
+/*
+// ContextCreate
+//
+// Allocates a context with the default settings
+//
+// Returns PASMCTX * on success, 0 on error
+*/
+PASMCTX *ContextCreate();
+
+/*
+// ContextDestroy
+//
+// Frees a context along with its labels and symbol tables. Clears pCtx
+// when it points to this context.
+//
+// void
+*/
+void ContextDestroy( PASMCTX *pc );
+
+/*
+// Assemble
+//
+// Makes the assembler passes (or single pass with fixups) over the main
+// source. When pText is set, the main source is read from memory and
+// Name is only used in messages. The code image and labels are left in
+// the current context.
+//
+// Returns 1 on success, 0 on error
+*/
+int Assemble( char *Name, const char *pText, uint Length );
@@ -52,10 +52,12 @@
 //
 // Description:
 //     File format for pView debugger debug file
+//     File format for relocatable object file (pasm -r)
 //
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     17-Oct-26: 0.86 - Added relocatable object file
 ============================================================================*/
 
 #define DBGFILE_NAMELEN_SHORT   64
@@ -95,3 +97,35 @@ typedef struct _DBGFILE_CODE {
 } DBGFILE_CODE;
 
 
+/*
+// A relocatable object file is a debug file assembled at address 0, with
+// the symbol and relocation records added. All fields are little endian.
+*/
+typedef struct _OBJFILE_HEADER {
+    DBGFILE_HEADER  Dbg;            /* FileID is OBJFILE_FILEID_VER1 */
+#define OBJFILE_FILEID_VER1     (0x10150100 | 0x01)
+    unsigned int    SymbolCount;    /* Number of symbol records */
+    unsigned int    SymbolOffset;   /* File offset to symbol records */
+    unsigned int    RelocCount;     /* Number of relocation records */
+    unsigned int    RelocOffset;    /* File offset to relocation records */
+} OBJFILE_HEADER;
+
+typedef struct _OBJFILE_SYMBOL {
+    unsigned int    Flags;
+#define OBJFILE_SYM_FLG_GLOBAL  0x00000001  /* Defined here (.global) */
+#define OBJFILE_SYM_FLG_EXTERN  0x00000002  /* Defined elsewhere (.extern) */
+    unsigned int    AddrOffset;     /* Address of a global symbol */
+    char            Name[DBGFILE_NAMELEN_SHORT];
+} OBJFILE_SYMBOL;
+
+typedef struct _OBJFILE_RELOC {
+    unsigned int    Type;
+#define OBJFILE_RELOC_IMM16     1   /* Add the address to bits 8-23 */
+#define OBJFILE_RELOC_BRANCH    2   /* Quick branch: the 10 bit offset holds
+                                       the addend, and becomes target-pc */
+    unsigned int    AddrOffset;     /* Code word to patch */
+    unsigned int    Symbol;         /* Symbol index, or OBJFILE_RELOC_LOCAL */
+#define OBJFILE_RELOC_LOCAL     0xFFFFFFFF  /* Add the module load address */
+} OBJFILE_RELOC;
+
+
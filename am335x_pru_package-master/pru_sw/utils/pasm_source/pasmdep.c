@@ -0,0 +1,188 @@
+/*
+ * pasmdep.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmdep.c
+//
+// Description:
+//     Make dependency file (-M)
+//
+//     pasm reads every include again on each run. The dependency file
+//     lets make skip the run when neither the source nor any of its
+//     includes changed, and redo it when one of them did.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added dependency file
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "pasm.h"
+
+/* Local Macro Definitions */
+#define DEPEND_PATH_MAX     (SOURCE_BASE_DIR+SOURCE_NAME+64)
+
+/* Output Files (as named in pasmmain.c) */
+static struct {
+    uint    Option;
+    char    *Ext;
+} OutputFiles[] = {
+    { OPTION_CARRAY,        "_bin.h" },
+    { OPTION_IMGFILE,       ".img" },
+    { OPTION_DBGFILE,       ".dbg" },
+    { OPTION_SOURCELISTING, ".txt" },
+    { OPTION_BINARY,        ".bin" },
+    { OPTION_BINARYBIG,     ".bib" },
+    { OPTION_LISTING,       ".lst" },
+    { OPTION_TIMING,        ".tim" },
+    { OPTION_RELOC,         ".pobj" },
+    { OPTION_DEPEND,        ".d" },
+    { 0, 0 }
+};
+
+/* Local Support Funtions */
+static void SourcePath( SOURCEFILE *ps, char *Path );
+static void DependName( FILE *pf, char *Path );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// DependWrite
+//
+// Writes a make dependency file (*.d) with the output files as targets
+// and every source file that was read as prerequisites.
+//
+// Returns 1 on success, 0 on error
+*/
+int DependWrite( char *outbase )
+{
+    char Path[DEPEND_PATH_MAX];
+    FILE *pf;
+    int  i, first;
+
+    sprintf( Path, "%s.d", outbase );
+    if( !(pf = fopen(Path,"wb")) )
+        { Report(0,REP_ERROR,"Unable to open output file: %s",Path); return(0); }
+
+    first = 1;
+    for( i=0; OutputFiles[i].Option; i++ )
+    {
+        if( OutputFiles[i].Option==OPTION_DEPEND || !(pCtx->Options & OutputFiles[i].Option) )
+            continue;
+        if( !first )
+            fprintf( pf, " " );
+        sprintf( Path, "%s%s", outbase, OutputFiles[i].Ext );
+        DependName( pf, Path );
+        first = 0;
+    }
+    fprintf( pf, ":" );
+    for( i=0; i<(int)pCtx->sfIndex; i++ )
+    {
+        fprintf( pf, " \\\n " );
+        SourcePath( &pCtx->sfArray[i], Path );
+        DependName( pf, Path );
+    }
+    fprintf( pf, "\n" );
+
+    /* Empty rules so that make does not fail when an include is removed */
+    for( i=1; i<(int)pCtx->sfIndex; i++ )
+    {
+        fprintf( pf, "\n" );
+        SourcePath( &pCtx->sfArray[i], Path );
+        DependName( pf, Path );
+        fprintf( pf, ":\n" );
+    }
+
+    fclose( pf );
+    return(1);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// SourcePath
+//
+// Gets the path of a source file as it was opened
+//
+// void
+*/
+static void SourcePath( SOURCEFILE *ps, char *Path )
+{
+    if( !ps->SourceBaseDir[0] || !strcmp( ps->SourceBaseDir, "." ) )
+        strcpy( Path, ps->SourceName );
+    else
+        sprintf( Path, "%s/%s", ps->SourceBaseDir, ps->SourceName );
+}
+
+
+/*
+// DependName
+//
+// Writes a file name to a dependency file, escaping spaces for make
+//
+// void
+*/
+static void DependName( FILE *pf, char *Path )
+{
+    while( *Path )
+    {
+        if( *Path==' ' )
+            fputc( '\\', pf );
+        fputc( *Path++, pf );
+    }
+}
@@ -54,6 +54,8 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     17-Oct-26: 0.86 - Added .global and .extern for -r objects
+//     18-Oct-26: 0.86 - Dot commands found through the keyword table
 ============================================================================*/
 
 #include <stdio.h>
@@ -67,31 +69,12 @@
 #include <ctype.h>
 #include "pasm.h"
 
-#define DOTCMD_MAIN         0
-#define DOTCMD_END          1
-#define DOTCMD_PROC         2
-#define DOTCMD_RET          3
-#define DOTCMD_ORIGIN       4
-#define DOTCMD_ENTRYPOINT   5
-#define DOTCMD_STRUCT       6
-#define DOTCMD_ENDS         7
-#define DOTCMD_U32          8
-#define DOTCMD_U16          9
-#define DOTCMD_U8           10
-#define DOTCMD_ASSIGN       11
-#define DOTCMD_SETCALLREG   12
-#define DOTCMD_ENTER        13
-#define DOTCMD_LEAVE        14
-#define DOTCMD_USING        15
-#define DOTCMD_MACRO        16
-#define DOTCMD_MPARAM       17
-#define DOTCMD_ENDM         18
-#define DOTCMD_CODEWORD     19
-#define DOTCMD_MAX          19
+/* Dot commands, in DOTCMD_xxx order (pasm.h) */
 char *DotCmds[] = { ".main",".end",".proc",".ret",".origin",".entrypoint",
                     ".struct",".ends",".u32",".u16",".u8",".assign",
                     ".setcallreg", ".enter", ".leave", ".using",
-                    ".macro", ".mparam", ".endm", ".codeword" };
+                    ".macro", ".mparam", ".endm", ".codeword",
+                    ".global", ".extern" };
 
 /*===================================================================
 //
@@ -108,14 +91,9 @@ char *DotCmds[] = { ".main",".end",".proc",".ret",".origin",".entrypoint",
 */
 int CheckDotCommand( char *word )
 {
-    int i;
-
     /* Commands are reserved */
-    for(i=0; i<=DOTCMD_MAX; i++)
-    {
-        if( !stricmp( word, DotCmds[i] ) )
-            return(1);
-    }
+    if( TOKID_KIND(KeywordFind(word)) == TOKID_DOTCMD )
+        return(1);
     return(0);
 }
 
@@ -140,16 +118,13 @@ int DotCommand( SOURCEFILE *ps, int TermCnt, char **pTerms, char *Src, int MaxSr
 {
     int i;
 
-    for(i=0; i<=DOTCMD_MAX; i++)
-    {
-        if( !stricmp( pTerms[0], DotCmds[i] ) )
-            break;
-    }
-    if( i>DOTCMD_MAX )
+    i = KeywordFind( pTerms[0] );
+    if( TOKID_KIND(i) != TOKID_DOTCMD )
     {
         Report(ps,REP_ERROR,"Unrecognized dot command");
         return(-1);
     }
+    i -= TOKID_DOTCMD;
 
     if( i==DOTCMD_MAIN )
     {
@@ -234,9 +209,9 @@ NO_MATCH:
         */
         if( TermCnt != 1 )
             { Report(ps,REP_ERROR,"Expected no operands"); return(-1); }
-        if( Options & OPTION_RETREGSET )
+        if( pCtx->Options & OPTION_RETREGSET )
             { Report(ps,REP_ERROR,".ret incompatible with .setcallreg, use ret"); return(-1); }
-        if( Core > CORE_V1 )
+        if( pCtx->Core > CORE_V1 )
             { Report(ps,REP_ERROR,".ret illegal with specified core version, use ret"); return(-1); }
         strcpy( Src, "jmp     r30.w0" );
         return(strlen(Src));
@@ -257,16 +232,18 @@ NO_MATCH:
         strcpy( tstr, pTerms[1] );
         if( Expression(ps, tstr, (uint *)&val, &tmp)<0 )
             { Report(ps,REP_ERROR,"Error in processing .origin value"); return(-1); }
-        if( Core == CORE_V0 )
+        if( pCtx->Core == CORE_V0 )
             { Report(ps,REP_ERROR,".origin illegal with specified core version"); return(-1); }
-        if( val<CodeOffset )
+        if( val<pCtx->CodeOffset )
             { Report(ps,REP_ERROR,".origin value is less than current offset"); return(-1); }
-        if( CodeOffset>=0 )
+        if( val && (pCtx->Options & OPTION_RELOC) )
+            { Report(ps,REP_ERROR,".origin must be 0 in a relocatable object"); return(-1); }
+        if( pCtx->CodeOffset>=0 )
             Report(ps,REP_WARN1,"Resetting .origin value after use");
-        if( EntryPoint<0 )
-            EntryPoint = val;
+        if( pCtx->EntryPoint<0 )
+            pCtx->EntryPoint = val;
 
-        CodeOffset = val;
+        pCtx->CodeOffset = val;
         return(0);
     }
     else if( i==DOTCMD_ENTRYPOINT )
@@ -286,14 +263,17 @@ NO_MATCH:
         if( Expression(ps, tstr, (uint *)&val, &tmp)<0 )
             { Report(ps,REP_ERROR,"Error in processing .entrypoint value"); return(-1); }
 
-        if( Core == CORE_V0 )
+        if( pCtx->Core == CORE_V0 )
             { Report(ps,REP_ERROR,".entrypoint illegal with specified core version"); return(-1); }
 
-        if( HaveEntry )
+        if( pCtx->HaveEntry )
             { Report(ps,REP_ERROR,"Multiple .entrypoint declarations"); return(-1); }
 
-        EntryPoint = val;
-        HaveEntry  = 1;
+        if( pCtx->Reloc==RELOC_EXTERN || pCtx->Reloc==RELOC_BAD )
+            { Report(ps,REP_ERROR,".entrypoint must be in this module"); return(-1); }
+
+        pCtx->EntryPoint = val;
+        pCtx->HaveEntry  = 1;
         return(0);
     }
     else if( i==DOTCMD_STRUCT )
@@ -339,11 +319,11 @@ NO_MATCH:
 
         if( TermCnt != 2 )
             { Report(ps,REP_ERROR,"Expected 1 operand"); return(-1); }
-        if( Core == CORE_V0 )
+        if( pCtx->Core == CORE_V0 )
             { Report(ps,REP_ERROR,".setcallreg illegal with specified core version"); return(-1); }
-        if( Pass==1 && (Options & OPTION_RETREGSET) )
+        if( pCtx->Pass==1 && (pCtx->Options & OPTION_RETREGSET) )
             { Report(ps,REP_ERROR,".setcallreg redefinition"); return(-1); }
-        if( CodeOffset>=0 )
+        if( pCtx->CodeOffset>=0 )
             { Report(ps,REP_ERROR,"Can not use .setcallreg after code generation"); return(-1); }
         if( !GetRegister( ps, 1, pTerms[1], &r, 0, 0 ) )
             return -1;
@@ -355,9 +335,9 @@ NO_MATCH:
         case FIELDTYPE_31_16:
             if( r.Value<31 )
             {
-                RetRegValue = r.Value;
-                RetRegField = r.Field;
-                Options |= OPTION_RETREGSET;
+                pCtx->RetRegValue = r.Value;
+                pCtx->RetRegField = r.Field;
+                pCtx->Options |= OPTION_RETREGSET;
                 return 0;
             }
         }
@@ -406,10 +386,65 @@ NO_MATCH:
         strcpy( tstr, pTerms[1] );
         if( Expression(ps, tstr, &opcode, &tmp)<0 )
             { Report(ps,REP_ERROR,"Error in processing .codeword value"); return(-1); }
+        if( pCtx->Reloc!=RELOC_NONE )
+            { Report(ps,REP_ERROR,".codeword value can not be relocated"); return(-1); }
 
         GenOp( ps, TermCnt, pTerms, opcode );
         return(0);
     }
+    else if( i==DOTCMD_GLOBAL )
+    {
+        LABEL *pl;
+        int   j;
+
+        /*
+        // .global command
+        //
+        // Export labels from a relocatable object (-r). Elsewhere it
+        // only checks the names, so the module still builds on its own.
+        */
+        if( TermCnt < 2 )
+            { Report(ps,REP_ERROR,"Expected 1 or more operands"); return(-1); }
+
+        /* All the labels are known on pass 2 */
+        if( pCtx->Pass==2 )
+        {
+            for( j=1; j<TermCnt; j++ )
+            {
+                pl = LabelFind(pTerms[j]);
+                if( !pl || (pl->Flags & LABEL_FLG_EXTERN) )
+                    { Report(ps,REP_ERROR,"'%s' is not a label of this module",pTerms[j]); return(-1); }
+                pl->Flags |= LABEL_FLG_GLOBAL;
+            }
+        }
+        return(0);
+    }
+    else if( i==DOTCMD_EXTERN )
+    {
+        int j;
+
+        /*
+        // .extern command
+        //
+        // Declare labels of other modules, given their address by
+        // pasmlink. Only in a relocatable object (-r).
+        */
+        if( TermCnt < 2 )
+            { Report(ps,REP_ERROR,"Expected 1 or more operands"); return(-1); }
+        if( !(pCtx->Options & OPTION_RELOC) )
+            { Report(ps,REP_ERROR,".extern needs a relocatable object (-r)"); return(-1); }
+
+        if( pCtx->Pass==1 )
+        {
+            for( j=1; j<TermCnt; j++ )
+            {
+                if( !LabelCreate(ps, pTerms[j], 0) )
+                    return(-1);
+                pCtx->pLabelList->Flags = LABEL_FLG_EXTERN;
+            }
+        }
+        return(0);
+    }
 
     Report(ps,REP_ERROR,"Dot command - Internal Error");
     return(-1);
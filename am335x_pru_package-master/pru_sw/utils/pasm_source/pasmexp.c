@@ -55,9 +55,15 @@
 //
 //     Note that the expression analyzer will only report errors on pass 2
 //
+//     For relocatable objects (-r), each term also counts the label
+//     addresses it adds or subtracts. A result that is one address plus
+//     a constant can be relocated by the linker.
+//
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     17-Oct-26: 0.86 - Track label addresses for relocation
+//     18-Oct-26: 0.86 - Register offsets found through the name tables
 ============================================================================*/
 
 #include <stdio.h>
@@ -97,8 +103,19 @@ uint prec[] = { 999,
                 6 };/* EOP_OR         */
 
 
-int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue );
+/* Label Addresses in a Term */
+typedef struct _EXPREL {
+    int     Local;          /* Count of addresses in this module */
+    int     Extern;         /* Count of the address of pExtern */
+    LABEL   *pExtern;
+    int     Bad;            /* Combined in a way that can not be relocated */
+} EXPREL;
+
+int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue, EXPREL *pRel );
 int EXP_getOperation( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue );
+static int ExpressionRel( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex, EXPREL *pRel );
+static void ExpRelCombine( EXPREL *pa, EXPREL *pb, int Sign );
+static void ExpRelNote( EXPREL *pRel );
 static int GetRegisterOffset( char *src, uint *pValue );
 
 /*
@@ -107,9 +124,29 @@ static int GetRegisterOffset( char *src, uint *pValue );
 // Returns 0 on success, <0 on error
 */
 int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
+{
+    EXPREL  rel;
+    int     rc;
+
+    rc = ExpressionRel( ps, s, pResult, pIndex, &rel );
+    if( !rc && (pCtx->Options & OPTION_RELOC) )
+        ExpRelNote( &rel );
+    return(rc);
+}
+
+
+/*
+// ExpressionRel
+//
+// Expression parser that also returns the label addresses used
+//
+// Returns 0 on success, <0 on error
+*/
+static int ExpressionRel( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex, EXPREL *pRel )
 {
     uint    values[MAXTERM];
     uint    ops[MAXTERM];
+    EXPREL  rels[MAXTERM];
     int     maxprec;
     int     i;
     int     validx,opidx,stridx;
@@ -120,7 +157,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
 
     while( validx<MAXTERM )
     {
-        i= EXP_getValue(ps, s, &stridx, &values[validx]);
+        i= EXP_getValue(ps, s, &stridx, &values[validx], &rels[validx]);
         if( !i )
             break;
         if( i<0 )
@@ -164,6 +201,13 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
             if( prec[ops[i]] < prec[ops[maxprec]] )
                 maxprec = i;
 
+        if( ops[maxprec]==EOP_ADD )
+            ExpRelCombine( &rels[maxprec], &rels[maxprec+1], 1 );
+        else if( ops[maxprec]==EOP_SUBTRACT )
+            ExpRelCombine( &rels[maxprec], &rels[maxprec+1], -1 );
+        else
+            ExpRelCombine( &rels[maxprec], &rels[maxprec+1], 0 );
+
         switch( ops[maxprec] )
         {
         case EOP_MULTIPLY:
@@ -172,7 +216,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         case EOP_DIVIDE:
             if( !values[maxprec+1] )
             {
-                if( Pass==2 )
+                if( PASS_CHECKING )
                 {
                     Report(ps,REP_ERROR,"Divide by zero");
                     return(-1);
@@ -186,7 +230,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         case EOP_MOD:
             if( !values[maxprec+1] )
             {
-                if( Pass==2 )
+                if( PASS_CHECKING )
                 {
                     Report(ps,REP_ERROR,"Mod by zero");
                     return(-1);
@@ -225,6 +269,7 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         if( i>0 )
         {
             memcpy( &values[maxprec+1], &values[maxprec+2], i*sizeof(uint));
+            memcpy( &rels[maxprec+1], &rels[maxprec+2], i*sizeof(EXPREL));
             memcpy( &ops[maxprec], &ops[maxprec+1], i*sizeof(uint));
         }
 
@@ -236,16 +281,75 @@ int Expression( SOURCEFILE *ps, char *s, uint *pResult, int *pIndex )
         { Report(ps,REP_ERROR,"Exp internal error"); return(-1); }
 
     *pResult = values[0];
+    *pRel = rels[0];
     return(0);
 }
 
 
+/*
+// ExpRelCombine
+//
+// Combines the label addresses of two terms. Sign is 1 to add, -1 to
+// subtract, or 0 for any other operation.
+//
+// void
+*/
+static void ExpRelCombine( EXPREL *pa, EXPREL *pb, int Sign )
+{
+    pa->Bad |= pb->Bad;
+    if( !Sign )
+    {
+        if( pa->Local || pa->Extern || pb->Local || pb->Extern )
+            pa->Bad = 1;
+        return;
+    }
+    pa->Local += Sign*pb->Local;
+    if( pb->Extern )
+    {
+        if( pa->Extern && pa->pExtern!=pb->pExtern )
+            pa->Bad = 1;
+        pa->Extern += Sign*pb->Extern;
+        pa->pExtern = pb->pExtern;
+    }
+}
+
+
+/*
+// ExpRelNote
+//
+// Adds the label addresses of an expression to the relocation state
+// of the current line. Only one expression per line may be relocated.
+//
+// void
+*/
+static void ExpRelNote( EXPREL *pRel )
+{
+    int kind;
+
+    if( pRel->Bad )
+        kind = RELOC_BAD;
+    else if( !pRel->Local && !pRel->Extern )
+        return;
+    else if( pRel->Local==1 && !pRel->Extern )
+        kind = RELOC_LOCAL;
+    else if( !pRel->Local && pRel->Extern==1 )
+        kind = RELOC_EXTERN;
+    else
+        kind = RELOC_BAD;
+
+    if( pCtx->Reloc != RELOC_NONE )
+        kind = RELOC_BAD;
+    pCtx->Reloc = kind;
+    pCtx->pRelocExtern = (kind==RELOC_EXTERN) ? pRel->pExtern : 0;
+}
+
+
 /*
 // EXP_getValue - Get a value from the supplied string
 //
 // Returns 0 no value, 1 on success, <0 on error
 */
-int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
+int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue, EXPREL *pRel )
 {
     int     base = 10,index,i,j,k;
     int     rc = 1;
@@ -253,6 +357,7 @@ int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
     char    c;
 
     index = *pIdx;
+    memset( pRel, 0, sizeof(EXPREL) );
 
     c = s[index];
     while( c==' ' || c==9 )
@@ -291,33 +396,54 @@ int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
             }
         }
         pl = LabelFind(lblstr);
-        if(!pl && Pass==1)
+        pCtx->LabelRef = 1;
+        if(!pl && pCtx->Pass==1)
+        {
             *pValue = 0;
+            pCtx->FixupPending = 1;
+        }
         else if( !pl )
             { Report(ps,REP_ERROR,"Not found: '%s'",lblstr); return(0); }
         else
+        {
             *pValue = pl->Offset;
+            if( pl->Flags & LABEL_FLG_EXTERN )
+            {
+                pRel->Extern  = 1;
+                pRel->pExtern = pl;
+            }
+            else
+                pRel->Local = 1;
+        }
         return(1);
     }
 
     if( c=='-' )
     {
         index++;
-        i = EXP_getValue( ps, s, &index, &tval );
+        i = EXP_getValue( ps, s, &index, &tval, pRel );
         if( i<0 )
             rc = i;
         else
+        {
             tval = (uint)(-(int)tval);
+            pRel->Local  = -pRel->Local;
+            pRel->Extern = -pRel->Extern;
+        }
         goto EGV_EXIT;
     }
     if( c=='~' )
     {
         index++;
-        i = EXP_getValue( ps, s, &index, &tval );
+        i = EXP_getValue( ps, s, &index, &tval, pRel );
         if( i<0 )
             rc = i;
         else
+        {
             tval = ~tval;
+            if( pRel->Local || pRel->Extern )
+                pRel->Bad = 1;
+        }
         goto EGV_EXIT;
     }
     if( c=='(' )
@@ -343,7 +469,7 @@ int EXP_getValue( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
                 {
                     /* Terminate the string and eval the () */
                     *(s+j) = 0;
-                    i = Expression( 0, s+index, &tval, &k );
+                    i = ExpressionRel( 0, s+index, &tval, &k, pRel );
                     if( i<0 )
                     {
                         index+=k;
@@ -490,11 +616,10 @@ int EXP_getOperation( SOURCEFILE *ps, char *s, int *pIdx, uint *pValue )
 */
 static int GetRegisterOffset( char *src, uint *pValue )
 {
-    uint idx;
-    char c,field;
-    int  val,reg,width,offset;
+    PRU_ARG reg;
+    int     width,offset;
 
-    if( Core == CORE_V0 )
+    if( pCtx->Core == CORE_V0 )
         return(0);
 
     /*
@@ -502,83 +627,16 @@ static int GetRegisterOffset( char *src, uint *pValue )
     //   Raa            aa=(0-31)
     //   Raa.Wb         aa=(0-31) b=(0-2)
     //   Raa.Bc         aa=(0-31) c=(0-3)
-    //   Raa.Tdd        aa=(0-31) dd=(0-31)
     //   Raa.Wb.Be      aa=(0-31) b=(0-2) e=(0-1)
     */
-
-    idx=0;
-    c = src[idx++];
-    /* Get initial 'R##' */
-    if( toupper(c) != 'R' )
-        return(0);
-    c = src[idx++];
-    if( !isdigit(c) )
-        return(0);
-    val = 0;
-    while( isdigit(c) )
-    {
-        val *= 10;
-        val += c-'0';
-        c = src[idx++];
-    }
-    if( val>31 )
+    if( RegisterFind( src, 0, REGFIND_FLG_NOBIT, &reg )!=1 )
         return(0);
 
-    reg    = val;
-    width  = 32;
-    offset = 0;
-
-    for(;;)
-    {
-        /* This char must be '.', or terminator */
-
-        /* If terminated, we're done */
-        if( !c )
-            break;
-        if( c != '.' )
-            return(0);
-
-        c = src[idx++];
-
-        /* This char must be 'W', or 'B' */
-        c = toupper(c);
-        if( c!='W' && c!='B' )
-            return(0);
-        field=c;
-        c = src[idx++];
-        if( !isdigit(c) )
-            return(0);
-        val = 0;
-        while( isdigit(c) )
-        {
-            val *= 10;
-            val += c-'0';
-            c = src[idx++];
-        }
-        if( field=='W' )
-        {
-            if( ((val*8)+16)>width )
-                return(0);
-            width = 16;
-            offset += val;
-        }
-        if( field=='B' )
-        {
-            if( ((val*8)+8)>width )
-                return(0);
-            width = 8;
-            offset += val;
-        }
-    }
-
-    if( !(Options & OPTION_BIGENDIAN) )
-        *pValue = reg * 4 + offset;
-    else
-    {
-        width /= 8;
+    width  = FIELD_BYTES(reg.Field);
+    offset = FIELD_OFFSET(reg.Field);
+    if( pCtx->Options & OPTION_BIGENDIAN )
         offset = 4 - offset - width;
-        *pValue = reg * 4 + offset;
-    }
+    *pValue = reg.Value * 4 + offset;
 
     return(1);
 }
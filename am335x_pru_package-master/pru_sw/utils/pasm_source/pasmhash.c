@@ -0,0 +1,320 @@
+/*
+ * pasmhash.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmhash.c
+//
+// Description:
+//     Name tables
+//         - Mnemonics and dot commands
+//         - Register names, fields, and bits
+//         - Constant table entries
+//
+//     Each table is a perfect hash generated by pasmhashgen.c, so a
+//     lookup is one hash and one compare. The entries are kept in ID
+//     order, so the text of a name is found from its ID by index.
+//
+//     These functions do not use the assembler context, so they may
+//     also be used by the simulator and disassembler.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added perfect hash name tables
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "pasm.h"
+#include "pasmhash.h"
+#include "pasmhashtab.h"
+
+/* Local Support Funtions */
+static int NameFind( const NAMEENTRY *pTable, const unsigned char *pSlot,
+                     unsigned int seed, int bits, char *s, int len );
+static int OperandFind( char *s, int len );
+
+#define KeywordLookup(s,len) \
+    NameFind(KeywordTable,KeywordSlot,KEYWORD_SEED,KEYWORD_BITS,(s),(len))
+#define OperandLookup(s,len) \
+    NameFind(OperandTable,OperandSlot,OPERAND_SEED,OPERAND_BITS,(s),(len))
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// KeywordFind
+//
+// Looks up a mnemonic or dot command, ignoring case.
+//
+// Returns the token ID (TOKID_xxx), or TOKID_NONE
+*/
+int KeywordFind( char *word )
+{
+    return( KeywordLookup( word, strlen(word) ) );
+}
+
+
+/*
+// KeywordText
+//
+// Gets the lower case text of a mnemonic or dot command
+//
+// Returns the text, or 0 if id is not a keyword
+*/
+char *KeywordText( int id )
+{
+    int idx = id & 0xff;
+
+    if( TOKID_KIND(id)==TOKID_OPCODE && idx>=1 && idx<=OP_MAXIDX )
+        return( KeywordTable[idx-1].Name );
+    if( TOKID_KIND(id)==TOKID_DOTCMD && idx<=DOTCMD_MAX )
+        return( KeywordTable[OP_MAXIDX+idx].Name );
+    return(0);
+}
+
+
+/*
+// RegisterFind
+//
+// Parses a register name of the form Rxx[.Wx|.Bx]...[.Txx], ignoring
+// case. Each field selects within the one before it. The name ends at
+// termC, which must be present.
+//
+// Fills in the Type, Value, Field, and Bit of the argument record.
+//
+// Returns 1 on success, 0 if not a register, or REGFIND_ERR_BIT
+*/
+int RegisterFind( char *src, char termC, int flags, PRU_ARG *pa )
+{
+    int idx, len, id;
+    int reg, bit, width, offset;
+    char c;
+
+    /* Get initial 'R##' */
+    for( len=0; src[len]!='.' && src[len]!=termC; len++ )
+        if( !src[len] )
+            return(0);
+    id = OperandFind( src, len );
+    if( TOKID_KIND(id) != TOKID_REGISTER )
+        return(0);
+    reg    = id & 0xff;
+    bit    = -1;
+    width  = 4;
+    offset = 0;
+
+    /* Each modifier is '.W#', '.B#', or a final '.T##' */
+    for( idx=len; src[idx]!=termC; idx+=len )
+    {
+        if( src[idx]!='.' || bit>=0 )
+            return(0);
+        c = src[idx+1];
+        if( (c=='t' || c=='T') && (flags & REGFIND_FLG_NOBIT) && isdigit(src[idx+2]) )
+            return(REGFIND_ERR_BIT);
+        for( len=1; src[idx+len]!='.' && src[idx+len]!=termC; len++ )
+            if( !src[idx+len] )
+                return(0);
+        id = OperandFind( src+idx, len );
+        if( TOKID_KIND(id)==TOKID_FIELD )
+        {
+            id &= 0xff;
+            if( FIELD_OFFSET(id)+FIELD_BYTES(id) > width )
+                return(0);
+            width   = FIELD_BYTES(id);
+            offset += FIELD_OFFSET(id);
+        }
+        else if( TOKID_KIND(id)==TOKID_BIT )
+        {
+            bit = id & 0xff;
+            if( bit >= width*8 )
+                return(0);
+        }
+        else
+            return(0);
+        if( src[idx+len]!=termC && (flags & REGFIND_FLG_SINGLE) )
+            return(0);
+    }
+
+    pa->Type  = ARGTYPE_REGISTER;
+    pa->Value = reg;
+    if( width==4 )
+        pa->Field = FIELDTYPE_31_0;
+    else if( width==2 )
+        pa->Field = FIELDTYPE_15_0 + offset;
+    else
+        pa->Field = FIELDTYPE_7_0 + offset;
+    if( bit>=0 )
+    {
+        pa->Type = ARGTYPE_REGISTERBIT;
+        pa->Bit  = bit;
+    }
+
+    return(1);
+}
+
+
+/*
+// RegisterText
+//
+// Formats a register or register bit argument. The buffer must hold
+// REGTEXT_LEN characters.
+//
+// Returns buf
+*/
+char *RegisterText( PRU_ARG *pa, char *buf )
+{
+    if( pa->Value>31 || pa->Field>FIELDTYPE_31_0 ||
+            (pa->Type==ARGTYPE_REGISTERBIT && pa->Bit>31) )
+    {
+        strcpy( buf, "r?" );
+        return(buf);
+    }
+    strcpy( buf, OperandTable[OPERAND_REG_BASE+pa->Value].Name );
+    strcat( buf, OperandTable[OPERAND_FIELD_BASE+pa->Field].Name );
+    if( pa->Type==ARGTYPE_REGISTERBIT )
+        strcat( buf, OperandTable[OPERAND_BIT_BASE+pa->Bit].Name );
+    return(buf);
+}
+
+
+/*
+// ConstantFind
+//
+// Parses a constant table entry of the form Cxx, ignoring case
+//
+// Returns the entry number, or -1 if src is not a constant table entry
+*/
+int ConstantFind( char *src )
+{
+    int id = OperandFind( src, strlen(src) );
+
+    if( TOKID_KIND(id) != TOKID_CONSTANT )
+        return(-1);
+    return( id & 0xff );
+}
+
+
+/*
+// ConstantText
+//
+// Returns the text of a constant table entry, or 0 if out of range
+*/
+char *ConstantText( uint idx )
+{
+    if( idx>31 )
+        return(0);
+    return( OperandTable[OPERAND_CONST_BASE+idx].Name );
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// OperandFind
+//
+// Looks up len characters of s in the operand table. Leading zeros on
+// the number are allowed, so "r01" is found as "r1".
+//
+// Returns the token ID, or TOKID_NONE if not found
+*/
+static int OperandFind( char *s, int len )
+{
+    char name[16];
+    int  i, j;
+
+    for( i=0; i<len && !isdigit(s[i]); i++ );
+    if( i+1>=len || s[i]!='0' )
+        return( OperandLookup( s, len ) );
+
+    for( j=i; j+1<len && s[j]=='0'; j++ );
+    if( i+len-j >= (int)sizeof(name) )
+        return(TOKID_NONE);
+    memcpy( name, s, i );
+    memcpy( name+i, s+j, len-j );
+    return( OperandLookup( name, i+len-j ) );
+}
+
+
+/*
+// NameFind
+//
+// Looks up len characters of s in a perfect hash table, ignoring case
+//
+// Returns the token ID, or TOKID_NONE if not found
+*/
+static int NameFind( const NAMEENTRY *pTable, const unsigned char *pSlot,
+                     unsigned int seed, int bits, char *s, int len )
+{
+    const NAMEENTRY *pe;
+    int  i, idx;
+    char c;
+
+    idx = pSlot[ NameHash( s, len, seed, bits ) ];
+    if( !idx )
+        return(TOKID_NONE);
+
+    /* The slot holds the only name that can match */
+    pe = &pTable[idx-1];
+    for( i=0; i<len; i++ )
+    {
+        c = s[i];
+        if( c>='A' && c<='Z' )
+            c += 'a'-'A';
+        if( c != pe->Name[i] )
+            return(TOKID_NONE);
+    }
+    if( pe->Name[len] )
+        return(TOKID_NONE);
+    return(pe->Id);
+}
@@ -0,0 +1,89 @@
+/*
+ * pasmhash.h
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmhash.h
+//
+// Description:
+//     Perfect hash function and entry record shared by the name tables
+//     (pasmhash.c) and their generator (pasmhashgen.c)
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added perfect hash name tables
+============================================================================*/
+
+/* Name Table Entry */
+typedef struct _NAMEENTRY {
+    char        *Name;              /* Lower case name */
+    int         Id;                 /* Token ID (TOKID_xxx) */
+} NAMEENTRY;
+
+/*
+// NameHash
+//
+// Hashes len characters of a name, ignoring case. The seed of each
+// table is chosen by pasmhashgen so that its names do not collide.
+//
+// Returns the slot number for a table of (1<<bits) entries
+*/
+static unsigned int NameHash( char *s, int len, unsigned int seed, int bits )
+{
+    unsigned int h = seed;
+    unsigned int c;
+
+    while( len-- )
+    {
+        c = (unsigned char)*s++;
+        if( c>='A' && c<='Z' )
+            c += 'a'-'A';
+        h = (h ^ c) * 0x01000193;
+    }
+    h ^= h>>15;
+    h *= 0x2c1b3c6d;
+    h ^= h>>12;
+    return( h & ((1<<bits)-1) );
+}
@@ -0,0 +1,263 @@
+/*
+ * pasmhashgen.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmhashgen.c
+//
+// Description:
+//     Generates pasmhashtab.h, the perfect hash name tables used by
+//     pasmhash.c. For each table it searches for the first seed with
+//     which NameHash() (pasmhash.h) gives every name its own slot.
+//
+//     Rebuild the tables after changing any of the names below:
+//         gcc -D_UNIX_ pasmhashgen.c -o pasmhashgen
+//         ./pasmhashgen > pasmhashtab.h
+//
+//     test/hashtest checks that pasmhashtab.h is up to date.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added perfect hash name tables
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+#include "pasmhash.h"
+
+#define MAX_NAMES       256
+#define MAX_SEED        0x1000000
+
+/* Generator Name Record */
+typedef struct _GENNAME {
+    char        Name[16];           /* Lower case name */
+    char        IdText[64];         /* Token ID as C source */
+} GENNAME;
+
+/* Generator Table Record */
+typedef struct _GENTABLE {
+    char        *Prefix;            /* Prefix of the generated defines */
+    char        *Array;             /* Prefix of the generated arrays */
+    int         Bits;               /* Table has (1<<Bits) slots */
+    int         Count;
+    GENNAME     Names[MAX_NAMES];
+    unsigned int Seed;
+    int         Slot[1<<9];         /* Name index+1, or 0 if empty */
+} GENTABLE;
+
+/* Mnemonics, in OP_xxx order (pru_ins.h) */
+#define OP(n)   #n
+static char *OpNames[] = {
+    OP(ADD), OP(ADC), OP(SUB), OP(SUC), OP(LSL), OP(LSR), OP(RSB), OP(RSC),
+    OP(AND), OP(OR), OP(XOR), OP(NOT), OP(MIN), OP(MAX), OP(CLR), OP(SET),
+    OP(LDI), OP(LBBO), OP(LBCO), OP(SBBO), OP(SBCO), OP(LFC), OP(STC),
+    OP(JAL), OP(JMP), OP(QBGT), OP(QBLT), OP(QBEQ), OP(QBGE), OP(QBLE),
+    OP(QBNE), OP(QBA), OP(QBBS), OP(QBBC), OP(LMBD), OP(CALL), OP(WBC),
+    OP(WBS), OP(MOV), OP(MVIB), OP(MVIW), OP(MVID), OP(SCAN), OP(HALT),
+    OP(SLP), OP(RET), OP(ZERO), OP(FILL), OP(XIN), OP(XOUT), OP(XCHG),
+    OP(SXIN), OP(SXOUT), OP(SXCHG), OP(LOOP), OP(ILOOP), OP(NOP0), OP(NOP1),
+    OP(NOP2), OP(NOP3), OP(NOP4), OP(NOP5), OP(NOP6), OP(NOP7), OP(NOP8),
+    OP(NOP9), OP(NOPA), OP(NOPB), OP(NOPC), OP(NOPD), OP(NOPE), OP(NOPF) };
+
+/* Dot commands, in DOTCMD_xxx order (pasm.h) */
+static char *DotNames[] = {
+    "MAIN", "END", "PROC", "RET", "ORIGIN", "ENTRYPOINT", "STRUCT", "ENDS",
+    "U32", "U16", "U8", "ASSIGN", "SETCALLREG", "ENTER", "LEAVE", "USING",
+    "MACRO", "MPARAM", "ENDM", "CODEWORD", "GLOBAL", "EXTERN" };
+
+/* Register fields, in FIELDTYPE_xxx order (pru_ins.h) */
+static char *FieldNames[] = { ".b0",".b1",".b2",".b3",".w0",".w1",".w2","" };
+static char *FieldTypes[] = { "7_0","15_8","23_16","31_24","15_0","23_8","31_16","31_0" };
+
+
+/* Local Support Funtions */
+static void AddName( GENTABLE *pt, char *prefix, char *name, char *idfmt, char *idarg );
+static int  FindSeed( GENTABLE *pt );
+static void PrintTable( GENTABLE *pt );
+
+static GENTABLE Keywords = { "KEYWORD", "Keyword", 9 };
+static GENTABLE Operands = { "OPERAND", "Operand", 9 };
+
+
+int main()
+{
+    char arg[16];
+    int  i;
+
+    if( sizeof(OpNames)/sizeof(char *) != OP_MAXIDX ||
+            sizeof(DotNames)/sizeof(char *) != DOTCMD_MAX+1 )
+        { fprintf(stderr,"pasmhashgen: name lists do not match pasm.h\n"); return(1); }
+
+    /* Keywords, in token ID order */
+    for( i=0; i<OP_MAXIDX; i++ )
+        AddName( &Keywords, "", OpNames[i], "TOKID_OPCODE+OP_%s", OpNames[i] );
+    for( i=0; i<=DOTCMD_MAX; i++ )
+        AddName( &Keywords, ".", DotNames[i], "TOKID_DOTCMD+DOTCMD_%s", DotNames[i] );
+
+    /* Operand names, in the order given by the OPERAND_xxx_BASE defines */
+    for( i=0; i<32; i++ )
+    {
+        sprintf( arg, "%d", i );
+        AddName( &Operands, "r", arg, "TOKID_REGISTER+%s", arg );
+    }
+    for( i=0; i<32; i++ )
+    {
+        sprintf( arg, "%d", i );
+        AddName( &Operands, "c", arg, "TOKID_CONSTANT+%s", arg );
+    }
+    for( i=0; i<32; i++ )
+    {
+        sprintf( arg, "%d", i );
+        AddName( &Operands, ".t", arg, "TOKID_BIT+%s", arg );
+    }
+    for( i=0; i<8; i++ )
+        AddName( &Operands, "", FieldNames[i], "TOKID_FIELD+FIELDTYPE_%s", FieldTypes[i] );
+
+    if( !FindSeed(&Keywords) || !FindSeed(&Operands) )
+        return(1);
+
+    printf("/*\n");
+    printf("// pasmhashtab.h\n");
+    printf("//\n");
+    printf("// Generated by pasmhashgen.c - do not edit\n");
+    printf("*/\n\n");
+    PrintTable( &Keywords );
+    printf("#define OPERAND_REG_BASE    0\n");
+    printf("#define OPERAND_CONST_BASE  32\n");
+    printf("#define OPERAND_BIT_BASE    64\n");
+    printf("#define OPERAND_FIELD_BASE  96\n\n");
+    PrintTable( &Operands );
+    return(0);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// AddName
+//
+// Adds prefix+name (in lower case) to a table, with the token ID text
+// formed from idfmt and idarg
+//
+// void
+*/
+static void AddName( GENTABLE *pt, char *prefix, char *name, char *idfmt, char *idarg )
+{
+    GENNAME *pn = &pt->Names[pt->Count++];
+    int     i;
+
+    sprintf( pn->Name, "%s%s", prefix, name );
+    for( i=0; pn->Name[i]; i++ )
+        if( pn->Name[i]>='A' && pn->Name[i]<='Z' )
+            pn->Name[i] += 'a'-'A';
+    sprintf( pn->IdText, idfmt, idarg );
+}
+
+
+/*
+// FindSeed
+//
+// Finds the first seed that gives every name in the table its own slot
+//
+// Returns 1 on success, 0 on error
+*/
+static int FindSeed( GENTABLE *pt )
+{
+    unsigned int seed;
+    int i, slot;
+
+    for( seed=1; seed<MAX_SEED; seed++ )
+    {
+        memset( pt->Slot, 0, sizeof(pt->Slot) );
+        for( i=0; i<pt->Count; i++ )
+        {
+            slot = NameHash( pt->Names[i].Name, strlen(pt->Names[i].Name), seed, pt->Bits );
+            if( pt->Slot[slot] )
+                break;
+            pt->Slot[slot] = i+1;
+        }
+        if( i==pt->Count )
+        {
+            pt->Seed = seed;
+            return(1);
+        }
+    }
+    fprintf(stderr,"pasmhashgen: no perfect hash seed for the %s table\n",pt->Prefix);
+    return(0);
+}
+
+
+/*
+// PrintTable
+//
+// Writes the seed, entries and slots of a table as C source
+//
+// void
+*/
+static void PrintTable( GENTABLE *pt )
+{
+    int i;
+
+    printf("#define %s_SEED        0x%08x\n", pt->Prefix, pt->Seed);
+    printf("#define %s_BITS        %d\n", pt->Prefix, pt->Bits);
+    printf("#define %s_COUNT       %d\n\n", pt->Prefix, pt->Count);
+
+    printf("static const NAMEENTRY %sTable[%s_COUNT] = {\n", pt->Array, pt->Prefix);
+    for( i=0; i<pt->Count; i++ )
+        printf("    { \"%s\",%*s%s },\n", pt->Names[i].Name,
+               (int)(12-strlen(pt->Names[i].Name)), "", pt->Names[i].IdText);
+    printf("};\n\n");
+
+    printf("static const unsigned char %sSlot[1<<%s_BITS] = {", pt->Array, pt->Prefix);
+    for( i=0; i<(1<<pt->Bits); i++ )
+        printf("%s%3d%s", (i%16) ? "" : "\n    ", pt->Slot[i], (i+1<(1<<pt->Bits)) ? "," : "");
+    printf("\n};\n\n");
+}
@@ -0,0 +1,293 @@
+/*
+// pasmhashtab.h
+//
+// Generated by pasmhashgen.c - do not edit
+*/
+
+#define KEYWORD_SEED        0x00003033
+#define KEYWORD_BITS        9
+#define KEYWORD_COUNT       94
+
+static const NAMEENTRY KeywordTable[KEYWORD_COUNT] = {
+    { "add",         TOKID_OPCODE+OP_ADD },
+    { "adc",         TOKID_OPCODE+OP_ADC },
+    { "sub",         TOKID_OPCODE+OP_SUB },
+    { "suc",         TOKID_OPCODE+OP_SUC },
+    { "lsl",         TOKID_OPCODE+OP_LSL },
+    { "lsr",         TOKID_OPCODE+OP_LSR },
+    { "rsb",         TOKID_OPCODE+OP_RSB },
+    { "rsc",         TOKID_OPCODE+OP_RSC },
+    { "and",         TOKID_OPCODE+OP_AND },
+    { "or",          TOKID_OPCODE+OP_OR },
+    { "xor",         TOKID_OPCODE+OP_XOR },
+    { "not",         TOKID_OPCODE+OP_NOT },
+    { "min",         TOKID_OPCODE+OP_MIN },
+    { "max",         TOKID_OPCODE+OP_MAX },
+    { "clr",         TOKID_OPCODE+OP_CLR },
+    { "set",         TOKID_OPCODE+OP_SET },
+    { "ldi",         TOKID_OPCODE+OP_LDI },
+    { "lbbo",        TOKID_OPCODE+OP_LBBO },
+    { "lbco",        TOKID_OPCODE+OP_LBCO },
+    { "sbbo",        TOKID_OPCODE+OP_SBBO },
+    { "sbco",        TOKID_OPCODE+OP_SBCO },
+    { "lfc",         TOKID_OPCODE+OP_LFC },
+    { "stc",         TOKID_OPCODE+OP_STC },
+    { "jal",         TOKID_OPCODE+OP_JAL },
+    { "jmp",         TOKID_OPCODE+OP_JMP },
+    { "qbgt",        TOKID_OPCODE+OP_QBGT },
+    { "qblt",        TOKID_OPCODE+OP_QBLT },
+    { "qbeq",        TOKID_OPCODE+OP_QBEQ },
+    { "qbge",        TOKID_OPCODE+OP_QBGE },
+    { "qble",        TOKID_OPCODE+OP_QBLE },
+    { "qbne",        TOKID_OPCODE+OP_QBNE },
+    { "qba",         TOKID_OPCODE+OP_QBA },
+    { "qbbs",        TOKID_OPCODE+OP_QBBS },
+    { "qbbc",        TOKID_OPCODE+OP_QBBC },
+    { "lmbd",        TOKID_OPCODE+OP_LMBD },
+    { "call",        TOKID_OPCODE+OP_CALL },
+    { "wbc",         TOKID_OPCODE+OP_WBC },
+    { "wbs",         TOKID_OPCODE+OP_WBS },
+    { "mov",         TOKID_OPCODE+OP_MOV },
+    { "mvib",        TOKID_OPCODE+OP_MVIB },
+    { "mviw",        TOKID_OPCODE+OP_MVIW },
+    { "mvid",        TOKID_OPCODE+OP_MVID },
+    { "scan",        TOKID_OPCODE+OP_SCAN },
+    { "halt",        TOKID_OPCODE+OP_HALT },
+    { "slp",         TOKID_OPCODE+OP_SLP },
+    { "ret",         TOKID_OPCODE+OP_RET },
+    { "zero",        TOKID_OPCODE+OP_ZERO },
+    { "fill",        TOKID_OPCODE+OP_FILL },
+    { "xin",         TOKID_OPCODE+OP_XIN },
+    { "xout",        TOKID_OPCODE+OP_XOUT },
+    { "xchg",        TOKID_OPCODE+OP_XCHG },
+    { "sxin",        TOKID_OPCODE+OP_SXIN },
+    { "sxout",       TOKID_OPCODE+OP_SXOUT },
+    { "sxchg",       TOKID_OPCODE+OP_SXCHG },
+    { "loop",        TOKID_OPCODE+OP_LOOP },
+    { "iloop",       TOKID_OPCODE+OP_ILOOP },
+    { "nop0",        TOKID_OPCODE+OP_NOP0 },
+    { "nop1",        TOKID_OPCODE+OP_NOP1 },
+    { "nop2",        TOKID_OPCODE+OP_NOP2 },
+    { "nop3",        TOKID_OPCODE+OP_NOP3 },
+    { "nop4",        TOKID_OPCODE+OP_NOP4 },
+    { "nop5",        TOKID_OPCODE+OP_NOP5 },
+    { "nop6",        TOKID_OPCODE+OP_NOP6 },
+    { "nop7",        TOKID_OPCODE+OP_NOP7 },
+    { "nop8",        TOKID_OPCODE+OP_NOP8 },
+    { "nop9",        TOKID_OPCODE+OP_NOP9 },
+    { "nopa",        TOKID_OPCODE+OP_NOPA },
+    { "nopb",        TOKID_OPCODE+OP_NOPB },
+    { "nopc",        TOKID_OPCODE+OP_NOPC },
+    { "nopd",        TOKID_OPCODE+OP_NOPD },
+    { "nope",        TOKID_OPCODE+OP_NOPE },
+    { "nopf",        TOKID_OPCODE+OP_NOPF },
+    { ".main",       TOKID_DOTCMD+DOTCMD_MAIN },
+    { ".end",        TOKID_DOTCMD+DOTCMD_END },
+    { ".proc",       TOKID_DOTCMD+DOTCMD_PROC },
+    { ".ret",        TOKID_DOTCMD+DOTCMD_RET },
+    { ".origin",     TOKID_DOTCMD+DOTCMD_ORIGIN },
+    { ".entrypoint", TOKID_DOTCMD+DOTCMD_ENTRYPOINT },
+    { ".struct",     TOKID_DOTCMD+DOTCMD_STRUCT },
+    { ".ends",       TOKID_DOTCMD+DOTCMD_ENDS },
+    { ".u32",        TOKID_DOTCMD+DOTCMD_U32 },
+    { ".u16",        TOKID_DOTCMD+DOTCMD_U16 },
+    { ".u8",         TOKID_DOTCMD+DOTCMD_U8 },
+    { ".assign",     TOKID_DOTCMD+DOTCMD_ASSIGN },
+    { ".setcallreg", TOKID_DOTCMD+DOTCMD_SETCALLREG },
+    { ".enter",      TOKID_DOTCMD+DOTCMD_ENTER },
+    { ".leave",      TOKID_DOTCMD+DOTCMD_LEAVE },
+    { ".using",      TOKID_DOTCMD+DOTCMD_USING },
+    { ".macro",      TOKID_DOTCMD+DOTCMD_MACRO },
+    { ".mparam",     TOKID_DOTCMD+DOTCMD_MPARAM },
+    { ".endm",       TOKID_DOTCMD+DOTCMD_ENDM },
+    { ".codeword",   TOKID_DOTCMD+DOTCMD_CODEWORD },
+    { ".global",     TOKID_DOTCMD+DOTCMD_GLOBAL },
+    { ".extern",     TOKID_DOTCMD+DOTCMD_EXTERN },
+};
+
+static const unsigned char KeywordSlot[1<<KEYWORD_BITS] = {
+      0,  0,  0, 65, 66, 90,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0, 36,  0,  0,  0,  0,  0,  0,  0,  0,
+     27,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 16,  2, 88,
+      0, 53,  0,  0,  0,  0, 87, 86,  0,  0,  0,  0,  0,  0,  0, 22,
+      0, 25,  0,  0,  0,  0,  0,  0,  0,  0,  0, 58,  0,  0,  0,  0,
+      0,  0,  6, 48, 76,  0,  0,  0,  0, 67, 81, 82,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0, 41,  0,  0,
+      0,  0,  0,  0,  0,  0, 17,  0, 63,  0,  3,  0,  0,  0,  0,  0,
+      0,  0,  0,  0, 18,  0,  0, 74,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 15,  0,  0,  0, 59,  0,  0,  0,  0,  0, 24,  0,  0,  0,  0,
+      0,  0,  0,  0,  0, 50,  0,  0,  0,  0,  0,  0,  0,  0, 33,  0,
+     30,  0,  0,  0, 43,  0, 37,  0,  0,  0, 31,  0, 46,  0, 23,  0,
+      0,  0,  0,  0,  0, 84,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 61,  0,  0,  0,  0, 69, 38,  0,  0,  0, 52,  0,  0,  0, 26,
+      0,  0,  0,  0, 49,  0,  0,  0,  0, 39,  0,  0, 55,  0,  0,  0,
+      0,  0, 71,  0,  0,  4,  0,  0,  0,  0,  0,  0, 77,  0,  0, 40,
+      0,  0,  0,  0,  0,  0, 21,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0, 89,  0, 34,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0, 75,  0,  0, 35,  0,  0,  0, 14,
+      0,  0, 93,  0,  0,  0,  0, 80, 45,  0,  0,  0,  0, 44,  0,  0,
+     54,  0,  0,  0,  0,  0,  0,  0, 19,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 56,  0,  0,  0,  0, 42,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 60,  0,  0,  0,  0, 11,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0, 20,  0,  0,  0,  0,  0,  7,  0,  0,  0,  0,  0, 51,
+      0, 47,  0, 73,  0, 28,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  5,  0,  0,  0,  0,  0,  0,  0,  0, 62,  0,  0,  0,  0,
+      0,  0,  0,  0, 10,  0, 79,  0,  0,  0,  0,  0, 92,  0,  0, 57,
+      0,  0,  0,  0,  0, 83,  0,  0,  0,  0,  0, 64,  0,  0, 68,  0,
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 70,
+      0, 32, 29,  0,  0,  0,  0,  0,  0,  0,  0,  0, 13,  0,  0,  0,
+      0,  0, 91, 94, 85,  0,  0,  0,  0,  0,  0,  8,  0,  0,  0,  9,
+     72,  0,  0,  0,  0,  0,  0,  0,  0, 12,  0,  0,  0,  0, 78,  0
+};
+
+#define OPERAND_REG_BASE    0
+#define OPERAND_CONST_BASE  32
+#define OPERAND_BIT_BASE    64
+#define OPERAND_FIELD_BASE  96
+
+#define OPERAND_SEED        0x0000abd2
+#define OPERAND_BITS        9
+#define OPERAND_COUNT       104
+
+static const NAMEENTRY OperandTable[OPERAND_COUNT] = {
+    { "r0",          TOKID_REGISTER+0 },
+    { "r1",          TOKID_REGISTER+1 },
+    { "r2",          TOKID_REGISTER+2 },
+    { "r3",          TOKID_REGISTER+3 },
+    { "r4",          TOKID_REGISTER+4 },
+    { "r5",          TOKID_REGISTER+5 },
+    { "r6",          TOKID_REGISTER+6 },
+    { "r7",          TOKID_REGISTER+7 },
+    { "r8",          TOKID_REGISTER+8 },
+    { "r9",          TOKID_REGISTER+9 },
+    { "r10",         TOKID_REGISTER+10 },
+    { "r11",         TOKID_REGISTER+11 },
+    { "r12",         TOKID_REGISTER+12 },
+    { "r13",         TOKID_REGISTER+13 },
+    { "r14",         TOKID_REGISTER+14 },
+    { "r15",         TOKID_REGISTER+15 },
+    { "r16",         TOKID_REGISTER+16 },
+    { "r17",         TOKID_REGISTER+17 },
+    { "r18",         TOKID_REGISTER+18 },
+    { "r19",         TOKID_REGISTER+19 },
+    { "r20",         TOKID_REGISTER+20 },
+    { "r21",         TOKID_REGISTER+21 },
+    { "r22",         TOKID_REGISTER+22 },
+    { "r23",         TOKID_REGISTER+23 },
+    { "r24",         TOKID_REGISTER+24 },
+    { "r25",         TOKID_REGISTER+25 },
+    { "r26",         TOKID_REGISTER+26 },
+    { "r27",         TOKID_REGISTER+27 },
+    { "r28",         TOKID_REGISTER+28 },
+    { "r29",         TOKID_REGISTER+29 },
+    { "r30",         TOKID_REGISTER+30 },
+    { "r31",         TOKID_REGISTER+31 },
+    { "c0",          TOKID_CONSTANT+0 },
+    { "c1",          TOKID_CONSTANT+1 },
+    { "c2",          TOKID_CONSTANT+2 },
+    { "c3",          TOKID_CONSTANT+3 },
+    { "c4",          TOKID_CONSTANT+4 },
+    { "c5",          TOKID_CONSTANT+5 },
+    { "c6",          TOKID_CONSTANT+6 },
+    { "c7",          TOKID_CONSTANT+7 },
+    { "c8",          TOKID_CONSTANT+8 },
+    { "c9",          TOKID_CONSTANT+9 },
+    { "c10",         TOKID_CONSTANT+10 },
+    { "c11",         TOKID_CONSTANT+11 },
+    { "c12",         TOKID_CONSTANT+12 },
+    { "c13",         TOKID_CONSTANT+13 },
+    { "c14",         TOKID_CONSTANT+14 },
+    { "c15",         TOKID_CONSTANT+15 },
+    { "c16",         TOKID_CONSTANT+16 },
+    { "c17",         TOKID_CONSTANT+17 },
+    { "c18",         TOKID_CONSTANT+18 },
+    { "c19",         TOKID_CONSTANT+19 },
+    { "c20",         TOKID_CONSTANT+20 },
+    { "c21",         TOKID_CONSTANT+21 },
+    { "c22",         TOKID_CONSTANT+22 },
+    { "c23",         TOKID_CONSTANT+23 },
+    { "c24",         TOKID_CONSTANT+24 },
+    { "c25",         TOKID_CONSTANT+25 },
+    { "c26",         TOKID_CONSTANT+26 },
+    { "c27",         TOKID_CONSTANT+27 },
+    { "c28",         TOKID_CONSTANT+28 },
+    { "c29",         TOKID_CONSTANT+29 },
+    { "c30",         TOKID_CONSTANT+30 },
+    { "c31",         TOKID_CONSTANT+31 },
+    { ".t0",         TOKID_BIT+0 },
+    { ".t1",         TOKID_BIT+1 },
+    { ".t2",         TOKID_BIT+2 },
+    { ".t3",         TOKID_BIT+3 },
+    { ".t4",         TOKID_BIT+4 },
+    { ".t5",         TOKID_BIT+5 },
+    { ".t6",         TOKID_BIT+6 },
+    { ".t7",         TOKID_BIT+7 },
+    { ".t8",         TOKID_BIT+8 },
+    { ".t9",         TOKID_BIT+9 },
+    { ".t10",        TOKID_BIT+10 },
+    { ".t11",        TOKID_BIT+11 },
+    { ".t12",        TOKID_BIT+12 },
+    { ".t13",        TOKID_BIT+13 },
+    { ".t14",        TOKID_BIT+14 },
+    { ".t15",        TOKID_BIT+15 },
+    { ".t16",        TOKID_BIT+16 },
+    { ".t17",        TOKID_BIT+17 },
+    { ".t18",        TOKID_BIT+18 },
+    { ".t19",        TOKID_BIT+19 },
+    { ".t20",        TOKID_BIT+20 },
+    { ".t21",        TOKID_BIT+21 },
+    { ".t22",        TOKID_BIT+22 },
+    { ".t23",        TOKID_BIT+23 },
+    { ".t24",        TOKID_BIT+24 },
+    { ".t25",        TOKID_BIT+25 },
+    { ".t26",        TOKID_BIT+26 },
+    { ".t27",        TOKID_BIT+27 },
+    { ".t28",        TOKID_BIT+28 },
+    { ".t29",        TOKID_BIT+29 },
+    { ".t30",        TOKID_BIT+30 },
+    { ".t31",        TOKID_BIT+31 },
+    { ".b0",         TOKID_FIELD+FIELDTYPE_7_0 },
+    { ".b1",         TOKID_FIELD+FIELDTYPE_15_8 },
+    { ".b2",         TOKID_FIELD+FIELDTYPE_23_16 },
+    { ".b3",         TOKID_FIELD+FIELDTYPE_31_24 },
+    { ".w0",         TOKID_FIELD+FIELDTYPE_15_0 },
+    { ".w1",         TOKID_FIELD+FIELDTYPE_23_8 },
+    { ".w2",         TOKID_FIELD+FIELDTYPE_31_16 },
+    { "",            TOKID_FIELD+FIELDTYPE_31_0 },
+};
+
+static const unsigned char OperandSlot[1<<OPERAND_BITS] = {
+      0,  0,  0, 21,  0,  0, 86, 53,  0,  0,  0, 15,  0,  0, 22,  0,
+      0,  0, 76,  0,  0,  0, 36,  0,  0,  0,  0,  0, 17,  0,  0,  0,
+    101,  0,  0,  0,  0,  0, 24,  0,  0,  0, 55,  0,  0,  0,104,  0,
+      0,  0,  0,  0,  0, 98,  0,  0,  0,  0,  0, 96, 11, 40,  0,  0,
+      0,  0, 32,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     41,  0,  0,  0,  0,  0, 78,  0,  0,  0,  0,  0,  0, 82,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0, 26,  0, 19,  0,  0,  4,  0, 47, 34,  0,  0,
+     92,  0, 83,  0,  0,  0,  0,  0,  0,  0,  0, 97,  0,  0,  0,  0,
+      0,  0,  0, 48,  0,  0,103,  0,  0,  0, 12, 61,  0,  0, 30,  0,
+     99,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     42,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     45,  0,  0,102,  0,  0,  0, 57, 58,  0,  0,  0,  0,  0, 71,  0,
+     91,  0,  0,  0,  0,  0,  0,  0,  0, 31,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  8,  0,
+      0,  0,  0,  0, 60,  0,  0,  0,  0,  0,  0,  0, 88,  0,  0,  0,
+      0, 95,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 67,  0,  0,  0,
+      0,  0,  0,  0,  0,  0, 63,  0,  0,  0,  0, 33,  0, 27,  0, 62,
+      0,  0,  0, 89,  0,  0,  0,  0,  0, 87,  0,  0,  7,  0,  0, 94,
+      0,  0,  0,  0,  0,  0,  0, 59,  0, 93,  0,  0,  0,  0, 20,  0,
+      0,  0, 38,  0, 52,  0, 10,  0,  0, 65, 23,  0,  0,  0,  0,  0,
+      0,  0,  0,  0, 74,  0,  0,  0,  0, 84,  0, 75,  0,  0,  0,  0,
+     44,  0, 64,  0, 49,  0,  9,  0,  0,  0, 73,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,100,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     70,  0,  0,  0,  0, 46,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0, 72,  0,  0,  0,  0,  0,  0,  0,  5,  0,  0,  0,  0,
+      0,  0,  0,  0,  0, 25,  0, 14,  0,  0,  0,  0,  0,  0,  0,  0,
+     29, 39,  0, 54,  0,  0, 51, 37, 66,  0,  0,  0,  0,  0,  0, 28,
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 77, 68,  0,
+      0, 50,  0, 80,  0,  0,  0,  0,  0, 13,  0,  0, 56,  0,  0,  0,
+     90,  0,  0, 69, 43,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  2,  0,  1,  6, 79, 18,  0, 85,  0, 81, 16,  0, 35,  0
+};
+
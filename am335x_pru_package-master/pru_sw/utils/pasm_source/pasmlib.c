@@ -0,0 +1,534 @@
+/*
+ * pasmlib.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmlib.c
+//
+// Description:
+//     Library interface to the assembler (see pasmlib.h)
+//         - Sets up a private context for each call
+//         - Copies the code image, labels, and source lines out of the
+//           context
+//         - Loads .bin and .dbg files for the simulator and disassembler
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added library interface
+//     18-Oct-26: 0.86 - Added pasm_load_image() (from prusimmain.c)
+//     18-Oct-26: 0.86 - Copy out the source line of each code word
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "pasm.h"
+#include "pasmdbg.h"
+
+#define LIB_SOURCE_NAME     "[Buffer]"
+
+/* Little Endian File Words */
+#define LE32(p) ((p)[0]+((p)[1]<<8)+((p)[2]<<16)+((unsigned int)(p)[3]<<24))
+
+/* Local Support Funtions */
+static int LibDefine( const char *Define );
+static int LibImage( PASM_IMAGE *image );
+static unsigned char *LoadFile( const char *Name, unsigned int *pLength );
+static int LoadBin( const char *Name, PASM_IMAGE *image );
+static int LoadDbg( const char *Name, PASM_IMAGE *image );
+static const char **NewFiles( unsigned int count, unsigned int namelen );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// pasm_assemble_buffer
+//
+// Assembles the supplied source text. The main source may #include other
+// files through include_resolver. When include_resolver is 0, includes
+// are read from the file system as pasm does. Options may be 0 for the
+// defaults.
+//
+// The image is filled in even on error, so the error and warning counts
+// can be read. Free it with pasm_free_image().
+//
+// Returns 0 on success, -1 on error
+*/
+int pasm_assemble_buffer( const char *source, PASM_INCLUDE_RESOLVER include_resolver,
+                          const PASM_OPTIONS *options, PASM_IMAGE *image )
+{
+    PASMCTX *pSave = pCtx;
+    PASMCTX *pc;
+    int     i, rc;
+
+    memset( image, 0, sizeof(PASM_IMAGE) );
+    image->EntryPoint = -1;
+
+    if( !(pc = ContextCreate()) )
+        { image->Errors = 1; return(-1); }
+
+    /* All the engine calls below work on this context */
+    pCtx = pc;
+    pc->pfnInclude = include_resolver;
+
+    if( options )
+    {
+        pc->pIncludeArg = options->pResolverArg;
+        pc->pfnMessage  = options->pfnMessage;
+        pc->pMessageArg = options->pMessageArg;
+
+        if( options->Core > PASM_CORE_V3 )
+            Report(0,REP_ERROR,"Unknown core version %d",options->Core);
+        else
+            pc->Core = options->Core;
+        if( options->Flags & PASM_FLG_BIGENDIAN )
+            pc->Options |= OPTION_BIGENDIAN;
+        if( options->Flags & PASM_FLG_SINGLEPASS )
+            pc->Options |= OPTION_SINGLEPASS;
+
+        for( i=0; options->ppDefines && options->ppDefines[i]; i++ )
+            if( !LibDefine( options->ppDefines[i] ) )
+                break;
+    }
+
+    rc = 0;
+    if( !source )
+        Report(0,REP_ERROR,"No source text");
+    else if( !pc->Errors )
+        rc = Assemble( LIB_SOURCE_NAME, source, strlen(source) );
+
+    /* Copy out the results */
+    if( rc && !LibImage( image ) )
+        rc = 0;
+    image->Errors   = pc->Errors;
+    image->Warnings = pc->Warnings;
+
+    ContextDestroy( pc );
+    pCtx = pSave;
+
+    if( !rc )
+        return(-1);
+    return(0);
+}
+
+
+/*
+// pasm_free_image
+//
+// Frees the code, labels, and source lines of an image returned by
+// pasm_assemble_buffer() or pasm_load_image()
+//
+// void
+*/
+void pasm_free_image( PASM_IMAGE *image )
+{
+    free( image->pCode );
+    free( image->pLabels );
+    free( image->pLines );
+    free( image->ppFiles );
+    memset( image, 0, sizeof(PASM_IMAGE) );
+    image->EntryPoint = -1;
+}
+
+
+/*
+// pasm_load_image
+//
+// Loads the code of a pView debug file (*.dbg) or a little endian binary
+// (*.bin). With no extension, name.dbg is used if it exists, and name.bin
+// otherwise. Only the .dbg has labels, source lines, and an entry point.
+// Errors are printed to stdout. Free the image with pasm_free_image().
+//
+// Returns 0 on success, -1 on error
+*/
+int pasm_load_image( const char *name, PASM_IMAGE *image )
+{
+    char *pName;
+    FILE *pf;
+    int  len, rc;
+
+    memset( image, 0, sizeof(PASM_IMAGE) );
+    image->EntryPoint = -1;
+
+    len = strlen(name);
+    if( len>4 && !strcmp( name+len-4, ".dbg" ) )
+        rc = LoadDbg( name, image );
+    else if( len>4 && !strcmp( name+len-4, ".bin" ) )
+        rc = LoadBin( name, image );
+    else
+    {
+        if( !(pName = malloc( len+5 )) )
+            { printf("Memory allocation failed\n"); return(-1); }
+        strcpy( pName, name );
+        strcat( pName, ".dbg" );
+        if( (pf = fopen( pName, "rb" )) != 0 )
+        {
+            fclose( pf );
+            rc = LoadDbg( pName, image );
+        }
+        else
+        {
+            strcpy( pName+len, ".bin" );
+            rc = LoadBin( pName, image );
+        }
+        free( pName );
+    }
+
+    if( !rc )
+    {
+        pasm_free_image( image );
+        return(-1);
+    }
+    return(0);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// LibDefine
+//
+// Adds a "name" or "name=value" equate, as -D does on the command line
+//
+// Returns 1 on success, 0 on error
+*/
+static int LibDefine( const char *Define )
+{
+    char *pName, *pData;
+    int  j;
+
+    if( pCtx->cmdLineEquates==MAX_CMD_EQUATE )
+        { Report(0,REP_ERROR,"Too many defines"); return(0); }
+
+    pName = pCtx->cmdLineName[pCtx->cmdLineEquates];
+    pData = pCtx->cmdLineData[pCtx->cmdLineEquates];
+
+    j=0;
+    while( j<EQUATE_NAME_LEN && *Define && *Define!='=' )
+        pName[j++]=*Define++;
+    if( j==EQUATE_NAME_LEN )
+        { Report(0,REP_ERROR,"Define name too long"); return(0); }
+    pName[j]=0;
+
+    strcpy( pData, "1" );
+    if( *Define=='=' )
+    {
+        Define++;
+        j=0;
+        while( j<EQUATE_DATA_LEN && *Define )
+            pData[j++]=*Define++;
+        if( j==EQUATE_DATA_LEN )
+            { Report(0,REP_ERROR,"Define data too long"); return(0); }
+        pData[j]=0;
+    }
+
+    pCtx->cmdLineEquates++;
+    return(1);
+}
+
+
+/*
+// LibImage
+//
+// Copies the code image, labels, and source lines out of the current
+// context
+//
+// Returns 1 on success, 0 on error
+*/
+static int LibImage( PASM_IMAGE *image )
+{
+    LABEL *pl;
+    char  *pName;
+    int   i, len;
+
+    image->EntryPoint = pCtx->EntryPoint;
+
+    /* Code words */
+    if( pCtx->CodeOffset > 0 )
+    {
+        image->pCode = malloc( pCtx->CodeOffset * sizeof(unsigned int) );
+        if( !image->pCode )
+            { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+        for( i=0; i<pCtx->CodeOffset; i++ )
+            image->pCode[i] = pCtx->ProgramImage[i].CodeWord;
+        image->CodeCount = pCtx->CodeOffset;
+
+        image->pLines  = calloc( pCtx->CodeOffset, sizeof(PASM_LINE) );
+        image->ppFiles = NewFiles( pCtx->sfIndex, SOURCE_NAME );
+        if( !image->pLines || !image->ppFiles )
+            { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+        for( i=0; i<pCtx->CodeOffset; i++ )
+        {
+            if( !(pCtx->ProgramImage[i].Flags & CODEGEN_FLG_FILEINFO) )
+                continue;
+            image->pLines[i].File = pCtx->ProgramImage[i].FileIndex;
+            image->pLines[i].Line = pCtx->ProgramImage[i].Line;
+        }
+        for( i=0; i<(int)pCtx->sfIndex; i++ )
+            strcpy( (char *)image->ppFiles[i], pCtx->sfArray[i].SourceName );
+        image->FileCount = pCtx->sfIndex;
+    }
+
+    /* Labels, with the names stored after the array */
+    if( pCtx->LabelCount )
+    {
+        len = pCtx->LabelCount * sizeof(PASM_LABEL);
+        for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+            len += strlen(pl->Name)+1;
+
+        image->pLabels = malloc( len );
+        if( !image->pLabels )
+            { Report(0,REP_FATAL,"Memory allocation failed"); return(0); }
+
+        /* The label list is newest first */
+        pName = (char *)(image->pLabels + pCtx->LabelCount);
+        i = pCtx->LabelCount;
+        for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+        {
+            i--;
+            strcpy( pName, pl->Name );
+            image->pLabels[i].Name   = pName;
+            image->pLabels[i].Offset = pl->Offset;
+            pName += strlen(pl->Name)+1;
+        }
+        image->LabelCount = pCtx->LabelCount;
+    }
+
+    return(1);
+}
+
+
+/*
+// LoadFile
+//
+// Reads a whole file into memory
+//
+// Returns the file data on success, 0 on error
+*/
+static unsigned char *LoadFile( const char *Name, unsigned int *pLength )
+{
+    FILE *pf;
+    unsigned char *pData;
+    long len;
+
+    if( !(pf = fopen( Name, "rb" )) )
+        { printf("Unable to open input file: %s\n",Name); return(0); }
+    fseek( pf, 0, SEEK_END );
+    len = ftell( pf );
+    fseek( pf, 0, SEEK_SET );
+
+    pData = malloc( len ? len : 1 );
+    if( !pData )
+        { printf("Memory allocation failed\n"); fclose(pf); return(0); }
+    if( fread( pData, 1, len, pf ) != (size_t)len )
+        { printf("File read error: %s\n",Name); fclose(pf); free(pData); return(0); }
+    fclose( pf );
+
+    *pLength = (unsigned int)len;
+    return(pData);
+}
+
+
+/*
+// LoadBin
+//
+// Loads the code words of a little endian binary
+//
+// Returns 1 on success, 0 on error
+*/
+static int LoadBin( const char *Name, PASM_IMAGE *image )
+{
+    unsigned char *pData;
+    unsigned int  len, i;
+
+    if( !(pData = LoadFile( Name, &len )) )
+        return(0);
+    if( !len || (len & 3) )
+        { printf("%s: not a code image\n",Name); free(pData); return(0); }
+
+    image->pCode = malloc( len );
+    if( !image->pCode )
+        { printf("Memory allocation failed\n"); free(pData); return(0); }
+    image->CodeCount = len/4;
+    for( i=0; i<image->CodeCount; i++ )
+        image->pCode[i] = LE32( pData+i*4 );
+
+    free( pData );
+    return(1);
+}
+
+
+/*
+// LoadDbg
+//
+// Loads the code words, labels, source lines, and entry point of a pView
+// debug file. Code words are placed by their address, leaving zero in any
+// gaps.
+//
+// Returns 1 on success, 0 on error
+*/
+static int LoadDbg( const char *Name, PASM_IMAGE *image )
+{
+    unsigned char *pData, *p;
+    unsigned int  len, i, addr;
+    unsigned int  labelCount, labelOffset, codeCount, codeOffset;
+    unsigned int  fileCount, fileOffset;
+    char          *pName;
+
+    if( !(pData = LoadFile( Name, &len )) )
+        return(0);
+    if( len < sizeof(DBGFILE_HEADER) || LE32(pData) != DBGFILE_FILEID_VER3 )
+        goto BADFILE;
+    labelCount  = LE32(pData+4);
+    labelOffset = LE32(pData+8);
+    fileCount   = LE32(pData+12);
+    fileOffset  = LE32(pData+16);
+    codeCount   = LE32(pData+20);
+    codeOffset  = LE32(pData+24);
+    if( LE32(pData+32) & DBGHDR_FLAGS_BIGENDIAN )
+        { printf("%s: big endian code is not supported\n",Name); free(pData); return(0); }
+    if( labelOffset > len || labelCount > (len-labelOffset)/sizeof(DBGFILE_LABEL) ||
+        fileOffset > len || fileCount > (len-fileOffset)/sizeof(DBGFILE_FILE) ||
+        codeOffset > len || codeCount > (len-codeOffset)/sizeof(DBGFILE_CODE) || !codeCount )
+        goto BADFILE;
+
+    for( i=0; i<codeCount; i++ )
+    {
+        addr = LE32(pData+codeOffset+i*sizeof(DBGFILE_CODE)+8);
+        if( addr >= 0x10000 )
+            goto BADFILE;
+        if( addr >= image->CodeCount )
+            image->CodeCount = addr+1;
+    }
+    image->EntryPoint = LE32(pData+28);
+
+    /* Label names are stored after the label array, as in LibImage() */
+    image->pCode   = calloc( image->CodeCount, sizeof(unsigned int) );
+    image->pLabels = malloc( labelCount*(sizeof(PASM_LABEL)+DBGFILE_NAMELEN_SHORT) + 1 );
+    image->pLines  = calloc( image->CodeCount, sizeof(PASM_LINE) );
+    image->ppFiles = NewFiles( fileCount, DBGFILE_NAMELEN_SHORT );
+    if( !image->pCode || !image->pLabels || !image->pLines || !image->ppFiles )
+        { printf("Memory allocation failed\n"); free(pData); return(0); }
+    for( i=0; i<codeCount; i++ )
+    {
+        p = pData+codeOffset+i*sizeof(DBGFILE_CODE);
+        addr = LE32(p+8);
+        image->pCode[addr] = LE32(p+12);
+        if( (p[0] & DBGFILE_CODE_FLG_FILEINFO) && (unsigned int)(p[2]+(p[3]<<8)) < fileCount )
+        {
+            image->pLines[addr].File = p[2]+(p[3]<<8);
+            image->pLines[addr].Line = LE32(p+4);
+        }
+    }
+
+    for( i=0; i<fileCount; i++ )
+    {
+        memcpy( (char *)image->ppFiles[i], pData+fileOffset+i*sizeof(DBGFILE_FILE),
+                DBGFILE_NAMELEN_SHORT-1 );
+        ((char *)image->ppFiles[i])[DBGFILE_NAMELEN_SHORT-1] = 0;
+    }
+    image->FileCount = fileCount;
+
+    pName = (char *)(image->pLabels + labelCount);
+    for( i=0; i<labelCount; i++ )
+    {
+        p = pData+labelOffset+i*sizeof(DBGFILE_LABEL);
+        memcpy( pName, p+4, DBGFILE_NAMELEN_SHORT-1 );
+        pName[DBGFILE_NAMELEN_SHORT-1] = 0;
+        image->pLabels[i].Name   = pName;
+        image->pLabels[i].Offset = LE32(p);
+        pName += strlen(pName)+1;
+    }
+    image->LabelCount = labelCount;
+
+    free( pData );
+    return(1);
+
+BADFILE:
+    printf("%s: not a pView debug file\n",Name);
+    free(pData);
+    return(0);
+}
+
+
+/*
+// NewFiles
+//
+// Allocates a file name table of count entries, each pointing to its own
+// buffer of namelen characters stored after the table
+//
+// Returns the table on success, 0 on error
+*/
+static const char **NewFiles( unsigned int count, unsigned int namelen )
+{
+    const char **ppFiles;
+    char *pName;
+    unsigned int i;
+
+    ppFiles = malloc( count*(sizeof(char *)+namelen) + 1 );
+    if( !ppFiles )
+        return(0);
+    pName = (char *)(ppFiles + count);
+    for( i=0; i<count; i++ )
+    {
+        *pName = 0;
+        ppFiles[i] = pName;
+        pName += namelen;
+    }
+    return(ppFiles);
+}
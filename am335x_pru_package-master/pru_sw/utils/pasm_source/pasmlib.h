@@ -0,0 +1,186 @@
+/*
+ * pasmlib.h
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmlib.h
+//
+// Description:
+//     Library interface to the assembler
+//         - Assembles source text in memory into a code image
+//         - #include text is supplied by the caller
+//         - Loads the code image of a .bin or .dbg file
+//
+//     Each call works in its own context, so separate threads can
+//     assemble at the same time. Link with libpasm.a.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added library interface
+//     18-Oct-26: 0.86 - Added pasm_load_image()
+//     18-Oct-26: 0.86 - Added the source line of each code word
+============================================================================*/
+
+#ifndef _PASMLIB_H_
+#define _PASMLIB_H_
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/*
+// Include Resolver
+//
+// Called for each #include. Name is the file name as written between the
+// quotes or angle brackets, and fSystem is set for the <name> form. On
+// success, set *ppText and *pLength to the source text. The text must
+// stay valid until pasm_assemble_buffer() returns.
+//
+// Returns 0 on success, -1 if the file does not exist
+*/
+typedef int (*PASM_INCLUDE_RESOLVER)( void *pArg, const char *Name, int fSystem,
+                                      const char **ppText, unsigned int *pLength );
+
+/*
+// Message Handler
+//
+// Called for each error, warning, and note. File is 0 for messages that
+// are not about a source line.
+*/
+#define PASM_MSG_INFO       0   /* Information only */
+#define PASM_MSG_WARN1      1   /* Warning */
+#define PASM_MSG_WARN2      2   /* Warning (checked on the final pass) */
+#define PASM_MSG_ERROR      3
+#define PASM_MSG_FATAL      4
+typedef void (*PASM_MESSAGE_HANDLER)( void *pArg, int Level, const char *File,
+                                      unsigned int Line, const char *Text );
+
+/* Assembler Options */
+typedef struct _PASM_OPTIONS {
+    unsigned int    Core;           /* Core version (-V#) */
+#define PASM_CORE_DEFAULT   0       /* Same as PASM_CORE_V1 */
+#define PASM_CORE_V0        1
+#define PASM_CORE_V1        2
+#define PASM_CORE_V2        3
+#define PASM_CORE_V3        4
+    unsigned int    Flags;
+#define PASM_FLG_BIGENDIAN  0x0001  /* Assemble for big endian core (-E) */
+#define PASM_FLG_SINGLEPASS 0x0002  /* Single pass assembly (-s) */
+    const char      **ppDefines;    /* "name" or "name=value" (-D), 0 terminated (or 0) */
+    void            *pResolverArg;  /* Passed to the include resolver */
+    PASM_MESSAGE_HANDLER pfnMessage;/* Message handler (0 to print to stdout) */
+    void            *pMessageArg;   /* Passed to the message handler */
+} PASM_OPTIONS;
+
+/* Label Map Entry */
+typedef struct _PASM_LABEL {
+    const char      *Name;
+    unsigned int    Offset;         /* Code word offset */
+} PASM_LABEL;
+
+/* Source Line of a Code Word */
+typedef struct _PASM_LINE {
+    unsigned int    File;           /* Index into ppFiles */
+    unsigned int    Line;           /* Line number, or 0 if not known */
+} PASM_LINE;
+
+/* Assembled Image */
+typedef struct _PASM_IMAGE {
+    unsigned int    *pCode;         /* Code words (host byte order) */
+    unsigned int    CodeCount;      /* Number of code words */
+    int             EntryPoint;     /* Code word offset of .entrypoint, or -1 */
+    PASM_LABEL      *pLabels;       /* Labels in source order */
+    unsigned int    LabelCount;
+    PASM_LINE       *pLines;        /* Source line of each code word, or 0 */
+    const char      **ppFiles;      /* Source file names */
+    unsigned int    FileCount;
+    int             Errors;         /* Number of errors */
+    int             Warnings;       /* Number of warnings */
+} PASM_IMAGE;
+
+/*
+// pasm_assemble_buffer
+//
+// Assembles the supplied source text. The main source may #include other
+// files through include_resolver. When include_resolver is 0, includes
+// are read from the file system as pasm does. Options may be 0 for the
+// defaults.
+//
+// The image is filled in even on error, so the error and warning counts
+// can be read. Free it with pasm_free_image().
+//
+// Returns 0 on success, -1 on error
+*/
+int pasm_assemble_buffer( const char *source, PASM_INCLUDE_RESOLVER include_resolver,
+                          const PASM_OPTIONS *options, PASM_IMAGE *image );
+
+/*
+// pasm_free_image
+//
+// Frees the code, labels, and source lines of an image returned by
+// pasm_assemble_buffer() or pasm_load_image()
+//
+// void
+*/
+void pasm_free_image( PASM_IMAGE *image );
+
+/*
+// pasm_load_image
+//
+// Loads the code of a pView debug file (*.dbg) or a little endian binary
+// (*.bin). With no extension, name.dbg is used if it exists, and name.bin
+// otherwise. Only the .dbg has labels, source lines, and an entry point.
+// Errors are printed to stdout. Free the image with pasm_free_image().
+//
+// Returns 0 on success, -1 on error
+*/
+int pasm_load_image( const char *name, PASM_IMAGE *image );
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
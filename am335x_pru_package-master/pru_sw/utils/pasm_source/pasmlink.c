@@ -0,0 +1,1089 @@
+/*
+ * pasmlink.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmlink.c
+//
+// Description:
+//     Linker for PRU programs built from several modules
+//         - Places each resident module at its .origin in IRAM, and
+//           checks that they fit the IRAM budget without overlapping
+//         - Packs overlay modules into an overlay store, to be kept in
+//           host memory and copied into the overlay window on demand
+//         - Gives each relocatable object (pasm -r) a load address,
+//           resolves its .extern labels against the .global labels of
+//           the other objects, and patches its relocated words
+//         - Writes a size map by module and by label
+//
+//     Every overlay is assembled at the same .origin, which is the start
+//     of its window in IRAM. The window is as long as the largest
+//     overlay, and no resident code may use it. The store is read by
+//     prussdrv_pru_load_overlay() (see prussdrv.h for its layout).
+//
+//     Debug files are fixed at their .origin and are placed first. Each
+//     resident object then goes to the first free IRAM that holds it, in
+//     command line order, and overlay objects go to the overlay window.
+//     A shared routine can so be assembled once, and linked into any
+//     number of programs.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added linker
+//     17-Oct-26: 0.86 - Added relocatable objects
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasmdbg.h"
+
+
+/* ---------- Local Macro Definitions ----------- */
+
+#define PROCESSOR_NAME_STRING ("PRU")
+#define VERSION_STRING        ("0.86")
+
+#define MAXFILE               (256)     /* Max file length for input files */
+#define MAX_MODULES           (64)
+#define DEFAULT_IRAM_BYTES    (8192)    /* PRUSS_MAX_IRAM_SIZE */
+#define MAX_IRAM_BYTES        (0x40000) /* 16 bit word addresses */
+
+#define RET_ERROR             (1)
+#define RET_SUCCESS           (0)
+
+#define HALT_WORD             0x2a000000
+
+/* Overlay Store Layout (mirrored in prussdrv.h) */
+#define OVL_MAGIC             0x4c564f50    /* "POVL" */
+#define OVL_HEADER_WORDS      4             /* Magic, Count, Window, WindowWords */
+#define OVL_ENTRY_WORDS       3             /* Offset, Words, Entry */
+
+/* Little Endian File Words */
+#define LE32(p) ((p)[0]+((p)[1]<<8)+((p)[2]<<16)+((unsigned int)(p)[3]<<24))
+
+/* Code Record Fields */
+#define CODE_FLAGS(p)         ((p)[0])
+#define CODE_ADDR(p)          LE32((p)+8)
+#define CODE_WORD(p)          LE32((p)+12)
+
+/* Object Record Fields */
+#define SYM_FLAGS(p)          LE32(p)
+#define SYM_ADDR(p)           LE32((p)+4)
+#define SYM_NAME(p)           ((char *)(p)+8)
+#define RELOC_TYPE(p)         LE32(p)
+#define RELOC_ADDR(p)         LE32((p)+4)
+#define RELOC_SYMBOL(p)       LE32((p)+8)
+
+/* Loaded Module */
+typedef struct _MODULE {
+    char            *Name;          /* File name as given */
+    char            *BaseName;      /* File name without its path */
+    int             fOverlay;
+    int             fObject;        /* Relocatable object (*.pobj) */
+    unsigned char   *pData;         /* File data (records point into it) */
+    unsigned int    EntryPoint;
+    unsigned int    LabelCount;
+    unsigned char   *pLabels;       /* DBGFILE_LABEL records */
+    unsigned int    FileCount;
+    unsigned char   *pFiles;        /* DBGFILE_FILE records */
+    unsigned int    FileBase;       /* First file index in the linked .dbg */
+    unsigned int    CodeCount;
+    unsigned char   *pCode;         /* DBGFILE_CODE records */
+    unsigned int    SymbolCount;
+    unsigned char   *pSymbols;      /* Objects: OBJFILE_SYMBOL records */
+    unsigned int    RelocCount;
+    unsigned char   *pRelocs;       /* Objects: OBJFILE_RELOC records */
+    unsigned int    Base;           /* Objects: load address */
+    unsigned int    Start;          /* First code address */
+    unsigned int    End;            /* Last code address */
+    unsigned int    Words;          /* Code words */
+    unsigned int    Index;          /* Overlays: index in the store */
+    unsigned int    StoreOffset;    /* Overlays: byte offset in the store */
+} MODULE;
+
+/* Label for the Size Map */
+typedef struct _MAPLABEL {
+    char            *Name;
+    MODULE          *pModule;
+    unsigned int    Addr;
+    unsigned int    Words;
+    unsigned int    Order;          /* Keeps labels at one address in file order */
+} MAPLABEL;
+
+static MODULE       Modules[MAX_MODULES];
+static unsigned int ModuleCount;
+static unsigned int OverlayCount;
+static unsigned int Errors;
+
+/* Linked Image */
+static unsigned int IramWords;      /* IRAM budget */
+static unsigned int *pImage;        /* Resident code, by address */
+static unsigned char *pOwner;       /* Module index+1 of each word, 0 if free */
+static unsigned char **ppRecord;    /* Code record of each resident word */
+static unsigned int ImageWords;     /* Words of pImage written to the .bin */
+static unsigned int ResidentWords;
+static unsigned int WindowStart;
+static unsigned int WindowWords;
+static unsigned int EntryPoint;
+
+/* Local Support Funtions */
+static unsigned char *ReadFile( char *Name, unsigned int *pLength );
+static int LoadModule( MODULE *pm );
+static void PlaceResident( MODULE *pm );
+static void PlaceObjects();
+static void MoveObject( MODULE *pm, unsigned int Base );
+static void PlaceOverlays();
+static void LinkObjects();
+static int FindGlobal( char *Name, MODULE **ppm, unsigned char **ppSym );
+static void SetLE32( unsigned char *p, unsigned int Word );
+static int WriteImage( char *Name );
+static int WriteDbg( char *Name );
+static int WriteStore( char *Name );
+static int WriteMap( char *Name );
+static void PutWord( FILE *pf, unsigned int Word );
+static int CompareLabels( const void *a, const void *b );
+
+
+/*
+// Main Linker Entry Point
+//
+*/
+int main(int argc, char *argv[])
+{
+    char   *outbase, *flags;
+    char   outfilename[MAXFILE];
+    unsigned int iramBytes;
+    int    i, j;
+
+    printf("\n\n%s Linker Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
+    printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    /*
+    // Process command line
+    */
+    outbase = 0;
+    iramBytes = DEFAULT_IRAM_BYTES;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' )
+        {
+            if( !outbase )
+                outbase = argv[i];
+            else if( ModuleCount < MAX_MODULES )
+                Modules[ModuleCount++].Name = argv[i];
+            else
+                { printf("\nToo many modules (the limit is %d)\n\n",MAX_MODULES); goto USAGE; }
+            continue;
+        }
+        flags = argv[i]+1;
+        if( *flags == 'v' && flags[1] )
+        {
+            if( !outbase || ModuleCount >= MAX_MODULES )
+                goto USAGE;
+            Modules[ModuleCount].fOverlay = 1;
+            Modules[ModuleCount++].Name = flags+1;
+        }
+        else if( *flags == 'i' && flags[1] )
+        {
+            iramBytes = strtoul( flags+1, 0, 0 );
+            if( !iramBytes || (iramBytes & 3) || iramBytes > MAX_IRAM_BYTES )
+                { printf("\nExpected an IRAM size in bytes, a multiple of 4\n\n"); goto USAGE; }
+        }
+        else
+        {
+            printf("\nUnknown flag '%s'\n\n",argv[i]);
+            goto USAGE;
+        }
+    }
+    if( !ModuleCount || strlen(outbase) >= MAXFILE-8 )
+    {
+USAGE:
+        printf("Usage: %s [-iBytes] OutFileBase Module [Module ...] [-vOverlay ...]\n\n",argv[0]);
+        printf("    Each module is a pView debug file (*.dbg) from pasm -d, or a\n");
+        printf("    relocatable object (*.pobj) from pasm -r. The first module\n");
+        printf("    gives the entry point. Debug files are placed in IRAM at their\n");
+        printf("    .origin, then objects in the first free IRAM that holds them.\n");
+        printf("    Overlays all start at the overlay window, and are packed into\n");
+        printf("    a store that is loaded into the window on demand. The .extern\n");
+        printf("    labels of objects are found in the .global labels of others.\n\n");
+        printf("    i  - IRAM budget in bytes (Default is %d)\n",DEFAULT_IRAM_BYTES);
+        printf("    v  - Link the module as an overlay\n\n");
+        printf("    Writes OutFileBase.bin (IRAM image), .dbg, and .map (size map),\n");
+        printf("    and with overlays OutFileBase.ovl (overlay store)\n");
+        printf("\n");
+        return(RET_ERROR);
+    }
+
+    /* Load the modules */
+    for( i=0; i<(int)ModuleCount; i++ )
+    {
+        if( !LoadModule( &Modules[i] ) )
+            return(RET_ERROR);
+        if( Modules[i].fOverlay )
+            Modules[i].Index = OverlayCount++;
+    }
+
+    IramWords = iramBytes/4;
+    pImage = calloc( IramWords, sizeof(unsigned int) );
+    pOwner = calloc( IramWords, 1 );
+    ppRecord = calloc( IramWords, sizeof(unsigned char *) );
+    if( !pImage || !pOwner || !ppRecord )
+        { printf("Memory allocation failed\n"); return(RET_ERROR); }
+
+    /* Place the code */
+    for( i=0; i<(int)ModuleCount; i++ )
+        if( !Modules[i].fOverlay && !Modules[i].fObject )
+            PlaceResident( &Modules[i] );
+    PlaceObjects();
+    PlaceOverlays();
+    if( !Errors )
+        LinkObjects();
+
+    EntryPoint = Modules[0].fOverlay ? WindowStart : Modules[0].EntryPoint;
+    if( EntryPoint >= IramWords )
+        EntryPoint = Modules[0].Start;
+
+    printf("Link : %d Error(s)\n\n",Errors);
+    if( Errors )
+        return(RET_ERROR);
+
+    printf("IRAM : %u of %u word(s) resident",ResidentWords,IramWords);
+    if( OverlayCount )
+        printf(", %u overlay(s) in a %u word window",OverlayCount,WindowWords);
+    printf(", %u free\n\n",IramWords-ResidentWords-WindowWords);
+
+    /* Write the outputs */
+    strcpy( outfilename, outbase );
+    strcat( outfilename, ".bin" );
+    if( !WriteImage( outfilename ) )
+        return(RET_ERROR);
+    strcpy( outfilename, outbase );
+    strcat( outfilename, ".dbg" );
+    if( !WriteDbg( outfilename ) )
+        return(RET_ERROR);
+    if( OverlayCount )
+    {
+        strcpy( outfilename, outbase );
+        strcat( outfilename, ".ovl" );
+        if( !WriteStore( outfilename ) )
+            return(RET_ERROR);
+    }
+    strcpy( outfilename, outbase );
+    strcat( outfilename, ".map" );
+    if( !WriteMap( outfilename ) )
+        return(RET_ERROR);
+
+    for( i=0; i<(int)ModuleCount; i++ )
+        free( Modules[i].pData );
+    free( pImage );
+    free( pOwner );
+    free( ppRecord );
+    return(RET_SUCCESS);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// ReadFile
+//
+// Reads a whole file into memory
+//
+// Returns the file data on success, 0 on error
+*/
+static unsigned char *ReadFile( char *Name, unsigned int *pLength )
+{
+    FILE *pf;
+    unsigned char *pData;
+    long len;
+
+    if( !(pf = fopen( Name, "rb" )) )
+        { printf("Unable to open input file: %s\n",Name); return(0); }
+    fseek( pf, 0, SEEK_END );
+    len = ftell( pf );
+    fseek( pf, 0, SEEK_SET );
+
+    pData = malloc( len ? len : 1 );
+    if( !pData )
+        { printf("Memory allocation failed\n"); fclose(pf); return(0); }
+    if( fread( pData, 1, len, pf ) != (size_t)len )
+        { printf("File read error: %s\n",Name); fclose(pf); free(pData); return(0); }
+    fclose( pf );
+
+    *pLength = (unsigned int)len;
+    return(pData);
+}
+
+
+/*
+// LoadModule
+//
+// Loads a pView debug file or relocatable object, and finds the range
+// of its code. Words without source information are .origin fill, not
+// code.
+//
+// Returns 1 on success, 0 on error
+*/
+static int LoadModule( MODULE *pm )
+{
+    unsigned char *p;
+    unsigned int  len, i, labelOffset, fileOffset, codeOffset, symbolOffset, relocOffset;
+    int           j;
+
+    pm->BaseName = pm->Name;
+    for( j=0; pm->Name[j]; j++ )
+        if( pm->Name[j]=='/' || pm->Name[j]=='\\' )
+            pm->BaseName = pm->Name+j+1;
+
+    if( !(pm->pData = ReadFile( pm->Name, &len )) )
+        return(0);
+    p = pm->pData;
+    if( len >= sizeof(OBJFILE_HEADER) && LE32(p) == OBJFILE_FILEID_VER1 )
+    {
+        pm->fObject     = 1;
+        pm->SymbolCount = LE32(p+36);
+        symbolOffset    = LE32(p+40);
+        pm->RelocCount  = LE32(p+44);
+        relocOffset     = LE32(p+48);
+        if( symbolOffset > len || pm->SymbolCount > (len-symbolOffset)/sizeof(OBJFILE_SYMBOL) ||
+            relocOffset > len || pm->RelocCount > (len-relocOffset)/sizeof(OBJFILE_RELOC) )
+            goto BADFILE;
+        pm->pSymbols = p+symbolOffset;
+        pm->pRelocs  = p+relocOffset;
+        for( i=0; i<pm->SymbolCount; i++ )
+            pm->pSymbols[i*sizeof(OBJFILE_SYMBOL)+8+DBGFILE_NAMELEN_SHORT-1] = 0;
+    }
+    else if( len < sizeof(DBGFILE_HEADER) || LE32(p) != DBGFILE_FILEID_VER3 )
+        goto BADFILE;
+    pm->LabelCount = LE32(p+4);
+    labelOffset    = LE32(p+8);
+    pm->FileCount  = LE32(p+12);
+    fileOffset     = LE32(p+16);
+    pm->CodeCount  = LE32(p+20);
+    codeOffset     = LE32(p+24);
+    pm->EntryPoint = LE32(p+28);
+    if( LE32(p+32) & DBGHDR_FLAGS_BIGENDIAN )
+        { printf("%s: big endian code can not be linked\n",pm->Name); return(0); }
+    if( labelOffset > len || pm->LabelCount > (len-labelOffset)/sizeof(DBGFILE_LABEL) ||
+        fileOffset > len || pm->FileCount > (len-fileOffset)/sizeof(DBGFILE_FILE) ||
+        codeOffset > len || pm->CodeCount > (len-codeOffset)/sizeof(DBGFILE_CODE) )
+        goto BADFILE;
+    pm->pLabels = p+labelOffset;
+    pm->pFiles  = p+fileOffset;
+    pm->pCode   = p+codeOffset;
+
+    for( i=0; i<pm->LabelCount; i++ )
+        pm->pLabels[i*sizeof(DBGFILE_LABEL)+4+DBGFILE_NAMELEN_SHORT-1] = 0;
+
+    pm->Start = ~0u;
+    for( i=0; i<pm->CodeCount; i++ )
+    {
+        p = pm->pCode+i*sizeof(DBGFILE_CODE);
+        if( !(CODE_FLAGS(p) & DBGFILE_CODE_FLG_FILEINFO) )
+            continue;
+        if( CODE_ADDR(p) < pm->Start )
+            pm->Start = CODE_ADDR(p);
+        if( !pm->Words || CODE_ADDR(p) > pm->End )
+            pm->End = CODE_ADDR(p);
+        pm->Words++;
+    }
+    if( !pm->Words )
+        { printf("%s: no code\n",pm->Name); return(0); }
+    return(1);
+
+BADFILE:
+    printf("%s: not a pView debug file or object\n",pm->Name);
+    return(0);
+}
+
+
+/*
+// PlaceResident
+//
+// Copies the code of a resident module into the IRAM image
+//
+// void
+*/
+static void PlaceResident( MODULE *pm )
+{
+    unsigned char *p;
+    unsigned int  i, addr, mod = pm-Modules;
+
+    for( i=0; i<pm->CodeCount; i++ )
+    {
+        p = pm->pCode+i*sizeof(DBGFILE_CODE);
+        if( !(CODE_FLAGS(p) & DBGFILE_CODE_FLG_FILEINFO) )
+            continue;
+        addr = CODE_ADDR(p);
+        if( addr >= IramWords )
+        {
+            printf("%s: code at 0x%04x is past the end of IRAM (%u words)\n",
+                   pm->Name,addr,IramWords);
+            Errors++;
+            return;
+        }
+        if( pOwner[addr] )
+        {
+            printf("%s: code at 0x%04x overlaps %s\n",
+                   pm->Name,addr,Modules[pOwner[addr]-1].Name);
+            Errors++;
+            return;
+        }
+        pOwner[addr] = mod+1;
+        ppRecord[addr] = p;
+        pImage[addr] = CODE_WORD(p);
+        if( addr >= ImageWords )
+            ImageWords = addr+1;
+        ResidentWords++;
+    }
+}
+
+
+/*
+// PlaceObjects
+//
+// Gives each object a load address. Resident objects take the first
+// free IRAM that holds them, clear of the overlay window when debug
+// file overlays fix it. Otherwise the window follows the resident code.
+//
+// void
+*/
+static void PlaceObjects()
+{
+    MODULE       *pm;
+    unsigned int i, addr, words, start = 0, end = 0, window = 0;
+    int          fWindow = 0;
+
+    /* The window of debug file overlays, sized for all the overlays */
+    for( i=0; i<ModuleCount; i++ )
+    {
+        pm = &Modules[i];
+        if( !pm->fOverlay )
+            continue;
+        if( !pm->fObject && !fWindow )
+        {
+            start = pm->Start;
+            fWindow = 1;
+        }
+        words = pm->fObject ? pm->End+1 : pm->End-pm->Start+1;
+        if( words > window )
+            window = words;
+    }
+    end = start+window;
+
+    for( i=0; i<ModuleCount; i++ )
+    {
+        pm = &Modules[i];
+        if( !pm->fObject || pm->fOverlay )
+            continue;
+        words = pm->End+1;
+        for( addr=0; addr+words<=IramWords; addr++ )
+        {
+            unsigned int k;
+
+            for( k=0; k<words; k++ )
+                if( pOwner[addr+k] || (fWindow && addr+k>=start && addr+k<end) )
+                    break;
+            if( k==words )
+                break;
+            addr += k;
+        }
+        if( addr+words > IramWords )
+        {
+            printf("%s: no room for %u word(s) in IRAM (%u words)\n",pm->Name,words,IramWords);
+            Errors++;
+            continue;
+        }
+        MoveObject( pm, addr );
+        PlaceResident( pm );
+    }
+
+    if( !fWindow )
+        start = ImageWords;
+    for( i=0; i<ModuleCount; i++ )
+    {
+        pm = &Modules[i];
+        if( pm->fObject && pm->fOverlay )
+            MoveObject( pm, start );
+    }
+}
+
+
+/*
+// MoveObject
+//
+// Moves the code, labels, symbols, and entry point of an object from
+// address 0 to its load address
+//
+// void
+*/
+static void MoveObject( MODULE *pm, unsigned int Base )
+{
+    unsigned char *p;
+    unsigned int  i;
+
+    pm->Base = Base;
+    for( i=0; i<pm->CodeCount; i++ )
+    {
+        p = pm->pCode+i*sizeof(DBGFILE_CODE);
+        SetLE32( p+8, CODE_ADDR(p)+Base );
+    }
+    for( i=0; i<pm->LabelCount; i++ )
+    {
+        p = pm->pLabels+i*sizeof(DBGFILE_LABEL);
+        SetLE32( p, LE32(p)+Base );
+    }
+    for( i=0; i<pm->SymbolCount; i++ )
+    {
+        p = pm->pSymbols+i*sizeof(OBJFILE_SYMBOL);
+        if( SYM_FLAGS(p) & OBJFILE_SYM_FLG_GLOBAL )
+            SetLE32( p+4, SYM_ADDR(p)+Base );
+    }
+    pm->EntryPoint += Base;
+    pm->Start += Base;
+    pm->End += Base;
+}
+
+
+/*
+// PlaceOverlays
+//
+// Sizes the overlay window and assigns each overlay its place in the
+// store. The window must be clear of resident code.
+//
+// void
+*/
+static void PlaceOverlays()
+{
+    MODULE       *pm;
+    unsigned int i, addr, offset;
+
+    offset = (OVL_HEADER_WORDS + OverlayCount*OVL_ENTRY_WORDS) * 4;
+    for( i=0; i<ModuleCount; i++ )
+    {
+        pm = &Modules[i];
+        if( !pm->fOverlay )
+            continue;
+        if( !WindowWords )
+            WindowStart = pm->Start;
+        if( pm->Start != WindowStart )
+        {
+            printf("%s: overlay starts at 0x%04x, not at the window (0x%04x)\n",
+                   pm->Name,pm->Start,WindowStart);
+            Errors++;
+            continue;
+        }
+        if( pm->End-pm->Start+1 > WindowWords )
+            WindowWords = pm->End-pm->Start+1;
+        pm->StoreOffset = offset;
+        offset += (pm->End-pm->Start+1) * 4;
+    }
+    if( !OverlayCount )
+        return;
+
+    if( WindowStart+WindowWords > IramWords )
+    {
+        printf("Overlay window 0x%04x-0x%04x is past the end of IRAM (%u words)\n",
+               WindowStart,WindowStart+WindowWords-1,IramWords);
+        Errors++;
+        return;
+    }
+    for( addr=WindowStart; addr<WindowStart+WindowWords; addr++ )
+    {
+        if( pOwner[addr] )
+        {
+            printf("%s: code at 0x%04x is in the overlay window 0x%04x-0x%04x\n",
+                   Modules[pOwner[addr]-1].Name,addr,WindowStart,WindowStart+WindowWords-1);
+            Errors++;
+            return;
+        }
+        /* Until an overlay is loaded, the window halts the PRU */
+        pImage[addr] = HALT_WORD;
+    }
+    if( ImageWords < WindowStart+WindowWords )
+        ImageWords = WindowStart+WindowWords;
+}
+
+
+/*
+// LinkObjects
+//
+// Patches the relocated words of each object, once all the objects
+// have their load address
+//
+// void
+*/
+static void LinkObjects()
+{
+    MODULE        *pm, *pmDef;
+    unsigned char *p, *pCode, *pSym;
+    unsigned int  i, k, sym, addr, word, target, limit;
+    int           offset;
+    char          *name;
+
+    for( k=0; k<ModuleCount; k++ )
+    {
+        pm = &Modules[k];
+        for( i=0; i<pm->SymbolCount; i++ )
+        {
+            p = pm->pSymbols+i*sizeof(OBJFILE_SYMBOL);
+            if( (SYM_FLAGS(p) & OBJFILE_SYM_FLG_GLOBAL) && FindGlobal( SYM_NAME(p), &pmDef, &pSym ) && pSym!=p )
+            {
+                printf("%s: '%s' is also defined by %s\n",pm->Name,SYM_NAME(p),pmDef->Name);
+                Errors++;
+            }
+        }
+
+        for( i=0; i<pm->RelocCount; i++ )
+        {
+            p    = pm->pRelocs+i*sizeof(OBJFILE_RELOC);
+            sym  = RELOC_SYMBOL(p);
+            name = "(this module)";
+            if( RELOC_ADDR(p) >= pm->CodeCount )
+                { printf("%s: bad relocation record\n",pm->Name); Errors++; return; }
+            pCode = pm->pCode+RELOC_ADDR(p)*sizeof(DBGFILE_CODE);
+            addr  = CODE_ADDR(pCode);
+            word  = CODE_WORD(pCode);
+
+            /* The address the word refers to */
+            if( sym==OBJFILE_RELOC_LOCAL )
+                target = pm->Base;
+            else if( sym >= pm->SymbolCount )
+                { printf("%s: bad relocation record\n",pm->Name); Errors++; return; }
+            else
+            {
+                name = SYM_NAME(pm->pSymbols+sym*sizeof(OBJFILE_SYMBOL));
+                if( !FindGlobal( name, &pmDef, &pSym ) )
+                {
+                    printf("%s: '%s' at 0x%04x is not defined by any module\n",pm->Name,name,addr);
+                    Errors++;
+                    continue;
+                }
+                target = SYM_ADDR(pSym);
+            }
+
+            if( RELOC_TYPE(p)==OBJFILE_RELOC_IMM16 )
+            {
+                /* LDI to a byte field keeps to 8 bits */
+                limit = ( ((word>>25)&0xF)==2 && ((word>>5)&7)<4 ) ? 0xFF : 0xFFFF;
+                target += (word>>8)&0xFFFF;
+                if( target > limit )
+                {
+                    printf("%s: address 0x%x of %s at 0x%04x does not fit\n",pm->Name,target,name,addr);
+                    Errors++;
+                    continue;
+                }
+                word = (word & ~0x00FFFF00) | (target<<8);
+            }
+            else if( RELOC_TYPE(p)==OBJFILE_RELOC_BRANCH )
+            {
+                /* The offset holds the addend */
+                offset = (word & 0xFF) | ((word>>17) & 0x300);
+                if( offset & 0x200 )
+                    offset -= 0x400;
+                offset += (int)target - (int)addr;
+                if( offset<-512 || offset>511 )
+                {
+                    printf("%s: branch at 0x%04x to %s is out of range\n",pm->Name,addr,name);
+                    Errors++;
+                    continue;
+                }
+                word = (word & ~0x060000FF) | (offset & 0xFF) | ((offset & 0x300)<<17);
+            }
+            else
+                { printf("%s: bad relocation record\n",pm->Name); Errors++; return; }
+
+            SetLE32( pCode+12, word );
+            if( !pm->fOverlay )
+                pImage[addr] = word;
+        }
+    }
+}
+
+
+/*
+// FindGlobal
+//
+// Searches the objects for a .global symbol by name
+//
+// Returns 1 if found, 0 if not
+*/
+static int FindGlobal( char *Name, MODULE **ppm, unsigned char **ppSym )
+{
+    unsigned char *p;
+    unsigned int  i, k;
+
+    for( k=0; k<ModuleCount; k++ )
+    {
+        for( i=0; i<Modules[k].SymbolCount; i++ )
+        {
+            p = Modules[k].pSymbols+i*sizeof(OBJFILE_SYMBOL);
+            if( (SYM_FLAGS(p) & OBJFILE_SYM_FLG_GLOBAL) && !strcmp( SYM_NAME(p), Name ) )
+            {
+                *ppm   = &Modules[k];
+                *ppSym = p;
+                return(1);
+            }
+        }
+    }
+    return(0);
+}
+
+
+/*
+// WriteImage
+//
+// Writes the IRAM image as a little endian binary
+//
+// Returns 1 on success, 0 on error
+*/
+static int WriteImage( char *Name )
+{
+    FILE         *pf;
+    unsigned int i;
+
+    if( !(pf = fopen( Name, "wb" )) )
+        { printf("Unable to open output file: %s\n",Name); return(0); }
+    for( i=0; i<ImageWords; i++ )
+        PutWord( pf, pImage[i] );
+    if( fclose( pf ) )
+        { printf("File write error: %s\n",Name); return(0); }
+    return(1);
+}
+
+
+/*
+// WriteDbg
+//
+// Writes a pView debug file for the IRAM image, with the labels and
+// source lines of the resident modules
+//
+// Returns 1 on success, 0 on error
+*/
+static int WriteDbg( char *Name )
+{
+    FILE          *pf;
+    unsigned char rec[sizeof(DBGFILE_CODE)];
+    unsigned int  i, k, labels = 0, files = 0, file, off;
+
+    for( k=0; k<ModuleCount; k++ )
+    {
+        if( Modules[k].fOverlay )
+            continue;
+        Modules[k].FileBase = files;
+        labels += Modules[k].LabelCount;
+        files  += Modules[k].FileCount;
+    }
+
+    if( !(pf = fopen( Name, "wb" )) )
+        { printf("Unable to open output file: %s\n",Name); return(0); }
+
+    off = sizeof(DBGFILE_HEADER);
+    PutWord( pf, DBGFILE_FILEID_VER3 );
+    PutWord( pf, labels );
+    PutWord( pf, off );
+    off += labels*sizeof(DBGFILE_LABEL);
+    PutWord( pf, files );
+    PutWord( pf, off );
+    off += files*sizeof(DBGFILE_FILE);
+    PutWord( pf, ImageWords );
+    PutWord( pf, off );
+    PutWord( pf, EntryPoint );
+    PutWord( pf, 0 );
+
+    for( k=0; k<ModuleCount; k++ )
+        if( !Modules[k].fOverlay )
+            fwrite( Modules[k].pLabels, sizeof(DBGFILE_LABEL), Modules[k].LabelCount, pf );
+    for( k=0; k<ModuleCount; k++ )
+        if( !Modules[k].fOverlay )
+            fwrite( Modules[k].pFiles, sizeof(DBGFILE_FILE), Modules[k].FileCount, pf );
+
+    /* One record per image word, with file indexes moved past earlier modules */
+    for( i=0; i<ImageWords; i++ )
+    {
+        memset( rec, 0, sizeof(rec) );
+        if( ppRecord[i] )
+        {
+            memcpy( rec, ppRecord[i], sizeof(rec) );
+            file = Modules[pOwner[i]-1].FileBase + rec[2] + (rec[3]<<8);
+            rec[2] = (unsigned char)file;
+            rec[3] = (unsigned char)(file>>8);
+        }
+        else
+        {
+            rec[8]  = (unsigned char)i;
+            rec[9]  = (unsigned char)(i>>8);
+            rec[12] = (unsigned char)pImage[i];
+            rec[13] = (unsigned char)(pImage[i]>>8);
+            rec[14] = (unsigned char)(pImage[i]>>16);
+            rec[15] = (unsigned char)(pImage[i]>>24);
+        }
+        fwrite( rec, 1, sizeof(rec), pf );
+    }
+
+    if( fclose( pf ) )
+        { printf("File write error: %s\n",Name); return(0); }
+    return(1);
+}
+
+
+/*
+// WriteStore
+//
+// Writes the overlay store: a header, one entry per overlay, then the
+// code of each overlay from the window start
+//
+// Returns 1 on success, 0 on error
+*/
+static int WriteStore( char *Name )
+{
+    FILE          *pf;
+    MODULE        *pm;
+    unsigned char *p;
+    unsigned int  *pWords, i, k, words, entry;
+
+    if( !(pf = fopen( Name, "wb" )) )
+        { printf("Unable to open output file: %s\n",Name); return(0); }
+
+    PutWord( pf, OVL_MAGIC );
+    PutWord( pf, OverlayCount );
+    PutWord( pf, WindowStart );
+    PutWord( pf, WindowWords );
+    for( k=0; k<ModuleCount; k++ )
+    {
+        pm = &Modules[k];
+        if( !pm->fOverlay )
+            continue;
+        entry = pm->EntryPoint;
+        if( entry < pm->Start || entry > pm->End )
+            entry = pm->Start;
+        PutWord( pf, pm->StoreOffset );
+        PutWord( pf, pm->End-pm->Start+1 );
+        PutWord( pf, entry );
+    }
+
+    pWords = malloc( WindowWords*sizeof(unsigned int) );
+    if( !pWords )
+        { printf("Memory allocation failed\n"); fclose(pf); return(0); }
+    for( k=0; k<ModuleCount; k++ )
+    {
+        pm = &Modules[k];
+        if( !pm->fOverlay )
+            continue;
+        words = pm->End-pm->Start+1;
+        for( i=0; i<words; i++ )
+            pWords[i] = HALT_WORD;
+        for( i=0; i<pm->CodeCount; i++ )
+        {
+            p = pm->pCode+i*sizeof(DBGFILE_CODE);
+            if( CODE_FLAGS(p) & DBGFILE_CODE_FLG_FILEINFO )
+                pWords[CODE_ADDR(p)-pm->Start] = CODE_WORD(p);
+        }
+        for( i=0; i<words; i++ )
+            PutWord( pf, pWords[i] );
+    }
+    free( pWords );
+
+    if( fclose( pf ) )
+        { printf("File write error: %s\n",Name); return(0); }
+    return(1);
+}
+
+
+/*
+// WriteMap
+//
+// Writes the size map: the IRAM budget, each module, and each label
+// with the words up to the next label of its module
+//
+// Returns 1 on success, 0 on error
+*/
+static int WriteMap( char *Name )
+{
+    FILE         *pf;
+    MODULE       *pm;
+    MAPLABEL     *pLabels;
+    unsigned int i, k, count = 0, next;
+    char         kind[16];
+
+    for( k=0; k<ModuleCount; k++ )
+        count += Modules[k].LabelCount;
+    pLabels = malloc( (count+1)*sizeof(MAPLABEL) );
+    if( !pLabels )
+        { printf("Memory allocation failed\n"); return(0); }
+
+    count = 0;
+    for( k=0; k<ModuleCount; k++ )
+    {
+        pm = &Modules[k];
+        for( i=0; i<pm->LabelCount; i++ )
+        {
+            pLabels[count].Name    = (char *)pm->pLabels+i*sizeof(DBGFILE_LABEL)+4;
+            pLabels[count].pModule = pm;
+            pLabels[count].Addr    = LE32(pm->pLabels+i*sizeof(DBGFILE_LABEL));
+            pLabels[count].Order   = count;
+            count++;
+        }
+    }
+    qsort( pLabels, count, sizeof(MAPLABEL), CompareLabels );
+
+    /* A label runs to the next label of its module, or the module end.
+       Of several labels at one address, the last gets the words. */
+    for( i=0; i<count; i++ )
+    {
+        pm = pLabels[i].pModule;
+        if( i+1<count && pLabels[i+1].pModule==pm )
+            next = pLabels[i+1].Addr;
+        else
+            next = pm->End+1;
+        pLabels[i].Words = next>pLabels[i].Addr ? next-pLabels[i].Addr : 0;
+    }
+
+    if( !(pf = fopen( Name, "wb" )) )
+        { printf("Unable to open output file: %s\n",Name); free(pLabels); return(0); }
+
+    fprintf(pf,"IRAM budget : %5u words (%u bytes)\n",IramWords,IramWords*4);
+    fprintf(pf,"Resident    : %5u words\n",ResidentWords);
+    if( OverlayCount )
+        fprintf(pf,"Overlays    : %5u words, window 0x%04x-0x%04x, %u overlay(s)\n",
+                WindowWords,WindowStart,WindowStart+WindowWords-1,OverlayCount);
+    fprintf(pf,"Free        : %5u words\n",IramWords-ResidentWords-WindowWords);
+    fprintf(pf,"Entry point : 0x%04x\n\n",EntryPoint);
+
+    fprintf(pf,"%-28s %-10s   Start     End   Words   Bytes   Store\n","Module","Kind");
+    for( k=0; k<ModuleCount; k++ )
+    {
+        pm = &Modules[k];
+        if( pm->fOverlay )
+            sprintf(kind,"overlay %u",pm->Index);
+        else
+            strcpy(kind,"resident");
+        fprintf(pf,"%-28s %-10s  0x%04x  0x%04x  %6u  %6u",
+                pm->BaseName,kind,pm->Start,pm->End,pm->Words,pm->Words*4);
+        if( pm->fOverlay )
+            fprintf(pf,"  0x%04x\n",pm->StoreOffset);
+        else
+            fprintf(pf,"       -\n");
+    }
+
+    fprintf(pf,"\n%-28s %-28s   Addr   Words\n","Label","Module");
+    for( i=0; i<count; i++ )
+        fprintf(pf,"%-28s %-28s 0x%04x  %6u\n",pLabels[i].Name,pLabels[i].pModule->BaseName,
+                pLabels[i].Addr,pLabels[i].Words);
+
+    free( pLabels );
+    if( fclose( pf ) )
+        { printf("File write error: %s\n",Name); return(0); }
+    return(1);
+}
+
+
+/*
+// PutWord
+//
+// Writes a little endian word
+//
+// void
+*/
+static void PutWord( FILE *pf, unsigned int Word )
+{
+    unsigned char b[4];
+
+    b[0] = (unsigned char)Word;
+    b[1] = (unsigned char)(Word>>8);
+    b[2] = (unsigned char)(Word>>16);
+    b[3] = (unsigned char)(Word>>24);
+    fwrite( b, 1, 4, pf );
+}
+
+
+/*
+// SetLE32
+//
+// Stores a little endian word in a file record
+//
+// void
+*/
+static void SetLE32( unsigned char *p, unsigned int Word )
+{
+    p[0] = (unsigned char)Word;
+    p[1] = (unsigned char)(Word>>8);
+    p[2] = (unsigned char)(Word>>16);
+    p[3] = (unsigned char)(Word>>24);
+}
+
+
+/*
+// CompareLabels
+//
+// qsort() order for the size map: by module, then address, then file order
+*/
+static int CompareLabels( const void *a, const void *b )
+{
+    const MAPLABEL *pa = a, *pb = b;
+
+    if( pa->pModule != pb->pModule )
+        return( pa->pModule < pb->pModule ? -1 : 1 );
+    if( pa->Addr != pb->Addr )
+        return( pa->Addr < pb->Addr ? -1 : 1 );
+    return( pa->Order < pb->Order ? -1 : 1 );
+}
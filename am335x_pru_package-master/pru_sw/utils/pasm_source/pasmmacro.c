@@ -54,6 +54,7 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     18-Oct-26: 0.86 - Dot commands matched by token ID, appends tracked by index
 ============================================================================*/
 
 #include <stdio.h>
@@ -96,16 +97,13 @@ typedef struct _MACRO {
 
 
 /* Local Support Funtions */
-static int _strncat( char *dst, int len, char *src );
+static int _strnapp( char *dst, int *pidx, int len, char *src );
 static MACRO *MacroFind( char *Name );
 static MACRO *MacroCreate( SOURCEFILE *ps, char *Name );
 int MacroAddArg( SOURCEFILE *ps, MACRO *pm, char *ArgText );
 static void MacroDestroy( MACRO *pm );
 
-/* Local macro list */
-int   MacroId=0;
-MACRO *pMacroList=0;      /* List of declared structs */
-MACRO *pMacroCurrent=0;
+/* The macro list is kept in the assembler context (pasm.h) */
 
 
 /*===================================================================
@@ -127,7 +125,7 @@ int MacroEnter( SOURCEFILE *ps, char *Name )
     char    src[MAX_SOURCE_LINE];
     int     i;
 
-    if( Core == CORE_V0 )
+    if( pCtx->Core == CORE_V0 )
         { Report(ps,REP_ERROR,".macro illegal with specified core version"); return(-1); }
 
     /* Create the macro */
@@ -139,7 +137,7 @@ int MacroEnter( SOURCEFILE *ps, char *Name )
     for(;;)
     {
         /* Abort on a total disaster */
-        if( FatalError || Errors >= 25 )
+        if( pCtx->FatalError || pCtx->Errors >= 25 )
             return(-1);
 
         /* Get a line of source code */
@@ -167,7 +165,7 @@ int MacroEnter( SOURCEFILE *ps, char *Name )
         /* Check for a macro related dot command */
         if( sl.Terms && (sl.Flags & SRC_FLG_DOTCMD1) )
         {
-            if( !stricmp( sl.Term[0], ".mparam" ) )
+            if( sl.TermId == TOKID_DOTCMD+DOTCMD_MPARAM )
             {
                 if( sl.Terms==1 )
                     { Report(ps,REP_ERROR,"Expected at least 1 parameter on .mparam"); continue; }
@@ -175,9 +173,9 @@ int MacroEnter( SOURCEFILE *ps, char *Name )
                     MacroAddArg(ps,pm,sl.Term[i]);
                 continue;
             }
-            else if( !stricmp( sl.Term[0], ".macro" ) )
+            else if( sl.TermId == TOKID_DOTCMD+DOTCMD_MACRO )
                 { Report(ps,REP_ERROR,"Macro definitions may not be nested"); continue; }
-            else if( !stricmp( sl.Term[0], ".endm" ) )
+            else if( sl.TermId == TOKID_DOTCMD+DOTCMD_ENDM )
             {
                 pm->InUse = 0;
                 return(0);
@@ -209,9 +207,11 @@ int MacroEnter( SOURCEFILE *ps, char *Name )
 int ProcessMacro( SOURCEFILE *ps, int TermCnt, char **pTerms )
 {
     MACRO   *pm;
-    int     cidx,sidx,nidx,i;
+    int     cidx,sidx,nidx,didx,i;
+    char    *pSub;
     char    src[MAX_SOURCE_LINE];
     char    namebuf[MACRO_NAME_LEN];
+    char    labeltext[TOKEN_MAX_LEN+32];
     char    c;
 
     pm = MacroFind(pTerms[0]);
@@ -236,7 +236,7 @@ int ProcessMacro( SOURCEFILE *ps, int TermCnt, char **pTerms )
         /* Build the assembly statement */
         sidx=0;
         nidx=0;
-        src[0] = 0;
+        didx=0;
         for(;;)
         {
             c=pm->Code[cidx][sidx++];
@@ -271,9 +271,9 @@ int ProcessMacro( SOURCEFILE *ps, int TermCnt, char **pTerms )
                     {
                         /* Match! */
                         if( (i+1)>=TermCnt )
-                            _strncat( src, MAX_SOURCE_LINE, pm->ArgDefault[i] );
+                            pSub = pm->ArgDefault[i];
                         else
-                            _strncat( src, MAX_SOURCE_LINE, pTerms[i+1] );
+                            pSub = pTerms[i+1];
                         goto SUBTEXTDONE;
                     }
                 }
@@ -283,31 +283,30 @@ int ProcessMacro( SOURCEFILE *ps, int TermCnt, char **pTerms )
                 {
                     if(!strcmp(namebuf,pm->LableName[i]))
                     {
-                        char labeltext[TOKEN_MAX_LEN+32];
-
                         /* Match! */
                         sprintf(labeltext,"_%s_%d_%d_", pm->LableName[i],pm->Id,pm->Expands);
-                        _strncat( src, MAX_SOURCE_LINE, labeltext );
+                        pSub = labeltext;
                         goto SUBTEXTDONE;
                     }
                 }
 
                 /* Sub in the original text */
-                _strncat( src, MAX_SOURCE_LINE, namebuf );
+                pSub = namebuf;
 SUBTEXTDONE:
+                if( _strnapp( src, &didx, MAX_SOURCE_LINE, pSub )<0 )
+                    { Report(ps,REP_ERROR,"Macro expansion too long"); pm->InUse=0; return(0); }
                 nidx = 0;
             }
             /* Check for text too long */
-            i=strlen(src);
-            if( i==(MAX_SOURCE_LINE-1) )
+            if( didx==(MAX_SOURCE_LINE-1) )
                 { Report(ps,REP_ERROR,"Macro expansion too long"); pm->InUse=0; return(0); }
-            src[i++]=c;
-            src[i]=0;
+            src[didx]=c;
             if( !c )
                 break;
+            didx++;
         }
 
-        i=strlen(src);
+        i=didx;
         if(i)
         {
             if( !ProcessSourceLine(ps, i, src, MAX_SOURCE_LINE) )
@@ -330,9 +329,9 @@ SUBTEXTDONE:
 */
 void MacroCleanup()
 {
-    while( pMacroList )
-        MacroDestroy( pMacroList );
-    MacroId = 0;
+    while( pCtx->pMacroList )
+        MacroDestroy( pCtx->pMacroList );
+    pCtx->MacroId = 0;
 }
 
 /*
@@ -357,26 +356,26 @@ int CheckMacro( char *name )
 //
 ====================================================================*/
 
-static int _strncat( char *dst, int len, char *src )
+/*
+// _strnapp
+//
+// Appends src to dst at index *pidx, leaving room for a terminator. The
+// running index saves rescanning the destination on every append.
+//
+// Returns the new length, or -1 if src does not fit
+*/
+static int _strnapp( char *dst, int *pidx, int len, char *src )
 {
-    int sidx,didx;
+    int didx;
 
-    didx = 0;
-    while( didx<len && dst[didx] )
-        didx++;
-    if( didx>(len-1) )
-        return(-1);
-    sidx = 0;
-    while( src[sidx] )
+    didx = *pidx;
+    while( *src )
     {
-        if( didx>(len-1) )
-        {
-            dst[didx] = 0;
+        if( didx>=(len-1) )
             return(-1);
-        }
-        dst[didx++] = src[sidx++];
+        dst[didx++] = *src++;
     }
-    dst[didx] = 0;
+    *pidx = didx;
     return(didx);
 }
 
@@ -390,16 +389,7 @@ static int _strncat( char *dst, int len, char *src )
 */
 static MACRO *MacroFind( char *Name )
 {
-    MACRO *pm;
-
-    pm = pMacroList;
-    while( pm )
-    {
-        if( !strcmp( Name, pm->Name ) )
-            break;
-        pm = pm->pNext;
-    }
-    return(pm);
+    return( (MACRO *)SymLookup( SYMKIND_MACRO, 0, Name ) );
 }
 
 
@@ -429,19 +419,23 @@ static MACRO *MacroCreate( SOURCEFILE *ps, char *Name )
 
     strcpy( pm->Name, Name );
     pm->InUse     = 1;
-    pm->Id        = MacroId++;
+    pm->Id        = pCtx->MacroId++;
     pm->Arguments = 0;
     pm->Required  = 0;
     pm->CodeLines = 0;
     pm->Labels    = 0;
     pm->Expands   = 0;
 
+    /* Index it by name */
+    if( SymInsert( SYMKIND_MACRO, 0, pm->Name, pm ) )
+        { free(pm); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     /* Put this equate in the master list */
     pm->pPrev  = 0;
-    pm->pNext  = pMacroList;
-    pMacroList = pm;
+    pm->pNext  = pCtx->pMacroList;
+    pCtx->pMacroList = pm;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Macro '%s' declared\n",
                             ps->SourceName,ps->CurrentLine,pm->Name);
 
@@ -460,7 +454,7 @@ int MacroAddArg( SOURCEFILE *ps, MACRO *pm, char *ArgText )
 {
     int  i,sidx;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Macro Parameter '%s' declared\n",
                          ps->SourceName,ps->CurrentLine,ArgText);
 
@@ -548,13 +542,14 @@ MARG_SYNTAX:
 static void MacroDestroy( MACRO *pm )
 {
     if( !pm->pPrev )
-        pMacroList = pm->pNext;
+        pCtx->pMacroList = pm->pNext;
     else
         pm->pPrev->pNext = pm->pNext;
 
     if( pm->pNext )
         pm->pNext->pPrev = pm->pPrev;
 
+    SymRemove( SYMKIND_MACRO, 0, pm->Name, pm );
     free(pm);
 }
 
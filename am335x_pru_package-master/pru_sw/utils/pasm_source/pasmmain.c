@@ -0,0 +1,1080 @@
+/*
+ * pasmmain.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmmain.c
+//
+// Description:
+//     Command line front end
+//         - Processes command line and flags
+//         - Runs the assembler engine in pasm.c
+//         - Handles output file generation
+//         - Assembles many files on a thread pool (-j)
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Split from pasm.c for the library build
+//     17-Oct-26: 0.86 - Added the -j parallel driver and shared source text
+//     17-Oct-26: 0.86 - Code images are written by pasmout.c, or to stdout
+============================================================================*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#if defined(_MSC_VER)
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "pasm.h"
+#include "pasmdbg.h"
+#include "path_utils.h"
+
+
+/* ---------- Local Macro Definitions ----------- */
+
+#define PROCESSOR_NAME_STRING ("PRU")
+#define VERSION_STRING        ("0.86")
+
+#define MAXFILE               (256)     /* Max file length for output files */
+
+#define RET_ERROR             (1)
+#define RET_SUCCESS           (0)
+
+#define MAX_JOB_THREADS       (64)      /* Max threads of the -j driver */
+#define SOURCE_TEXT_HASH      (256)     /* Must be a power of 2 */
+
+/* Threads and locks of the -j driver */
+#if defined(_MSC_VER)
+typedef HANDLE              JOB_THREAD;
+typedef CRITICAL_SECTION    JOB_LOCK;
+#define JOB_THREAD_RETURN   unsigned __stdcall
+#define JobLockInit(pl)     InitializeCriticalSection(pl)
+#define JobLock(pl)         EnterCriticalSection(pl)
+#define JobUnlock(pl)       LeaveCriticalSection(pl)
+#else
+typedef pthread_t           JOB_THREAD;
+typedef pthread_mutex_t     JOB_LOCK;
+#define JOB_THREAD_RETURN   void *
+#define JobLockInit(pl)     pthread_mutex_init(pl,0)
+#define JobLock(pl)         pthread_mutex_lock(pl)
+#define JobUnlock(pl)       pthread_mutex_unlock(pl)
+#endif
+
+/* Local Structure Types */
+
+/* Assembly Job (one input file) */
+typedef struct _JOB {
+    char            *InFile;        /* Source file */
+    char            *OutFile;       /* Output file base (or 0) */
+    int             fBuffered;      /* Console text is kept in Text */
+    char            *Text;          /* Console text (driver mode) */
+    uint            TextLength;
+    uint            TextSize;
+    int             Result;         /* RET_SUCCESS or RET_ERROR */
+} JOB;
+
+/* Job Driver */
+typedef struct _DRIVER {
+    JOB_LOCK        Lock;
+    JOB             *pJobs;
+    int             JobCount;
+    int             NextJob;        /* Next job to hand out */
+    PASMCTX         *pTemplate;     /* Options from the command line */
+} DRIVER;
+
+/* Shared Source Text Record */
+typedef struct _SOURCETEXT {
+    struct _SOURCETEXT *pNext;      /* Next in hash chain */
+    char            *pText;
+    uint            Length;
+    char            Path[1];        /* Path as given (allocated to length) */
+} SOURCETEXT;
+
+char nameCArray[EQUATE_DATA_LEN];
+int  nameCArraySet = 0;
+
+static SOURCETEXT *SourceTextHash[SOURCE_TEXT_HASH];
+static JOB_LOCK   SourceTextLock;
+
+/* Local Support Funtions */
+static int AssembleJob( JOB *pj );
+static int RunJobs( char **ppInFile, int InCount, int Threads );
+static JOB_THREAD_RETURN JobThread( void *pArg );
+static int JobThreadStart( JOB_THREAD *pThread, void *pArg );
+static void JobThreadWait( JOB_THREAD Thread );
+static int CpuCount();
+static void JobPrint( JOB *pj, char *fmt, ... );
+static void JobMessage( void *pArg, int Level, const char *File, unsigned int Line, const char *Text );
+static int SourceTextRead( void *pArg, const char *Path, const char **ppText, uint *pLength );
+static int PrintLine( FILE *pfOut, SOURCEFILE *ps );
+static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, uint *pCodeWord );
+static int ListFile( FILE *pfOut, SOURCEFILE *ps );
+
+/*
+// Main Assembler Entry Point
+//
+*/
+int main(int argc, char *argv[])
+{
+    int i,j;
+    char *flags;
+    char **ppInFile;
+    int InCount, Threads, fStdout;
+    JOB job;
+
+    /* Writing the code image to stdout moves the console text to stderr */
+    fStdout = 0;
+    for( i=1; i<argc; i++ )
+    {
+        if( !strcmp( argv[i], "-" ) )
+            fStdout = 1;
+    }
+
+    fprintf(fStdout ? stderr : stdout,"\n\n%s Assembler Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
+    fprintf(fStdout ? stderr : stdout,"Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+
+    /* Create the assembler context */
+    if( !(pCtx = ContextCreate()) )
+        { printf("Memory allocation failed\n"); return(RET_ERROR); }
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    /*
+    // Process command line
+    */
+    flags=0;
+    InCount=0;
+    Threads=0;
+
+    if( argc<2 )
+    {
+USAGE:
+        printf("Usage: %s [-V#EBbcmLldMOrsz] [-Idir] [-Dname=value] [-Cname] [-T[from:to]] InFile [OutFileBase|-]\n",argv[0]);
+        printf("       %s -j[#] [flags] InFile [InFile ...]\n\n",argv[0]);
+        printf("    V# - Specify core version (V0,V1,V2,V3). (Default is V1)\n");
+        printf("    E  - Assemble for big endian core\n");
+        printf("    B  - Create big endian binary output (*.bib)\n");
+        printf("    b  - Create little endian binary output (*.bin)\n");
+        printf("    c  - Create 'C array' binary output (*_bin.h)\n");
+        printf("    m  - Create 'image' binary output (*.img)\n");
+        printf("    L  - Create annotated source file style listing (*.txt)\n");
+        printf("    l  - Create raw listing file (*.lst)\n");
+        printf("    d  - Create pView debug file (*.dbg)\n");
+        printf("    M  - Create make dependency file (*.d)\n");
+        printf("    O  - Optimize the code (listings show it before optimizing)\n");
+        printf("    r  - Create relocatable object for pasmlink (*.pobj)\n");
+        printf("    s  - Single pass assembly (forward references are fixed up)\n");
+        printf("    z  - Enable debug messages\n");
+        printf("    I  - Add the directory dir to search path for \n"
+               "         #include <filename> type of directives (where \n"
+               "         angled brackets are used instead of quotes).\n");
+        printf("\n    D  - Set equate 'name' to 1 using '-Dname', or to any\n");
+        printf("         value using '-Dname=value'\n");
+        printf("    C  - Name the C array in 'C array' binary output\n");
+        printf("         to 'name' using '-Cname'\n");
+        printf("    T  - Create timing report (*.tim) of the cycles between\n");
+        printf("         labels. Add a path with '-Tfrom:to', where each end\n");
+        printf("         is a label, label+N, or address. Set the cost of a\n");
+        printf("         load or store outside PRU local memory with\n");
+        printf("         '-Tload=cycles' or '-Tstore=cycles' (default %d, %d)\n",
+               PRUSIM_COST_SYSTEM_LOAD, PRUSIM_COST_SYSTEM_STORE);
+        printf("    j  - Assemble each InFile to its own outputs on # threads\n");
+        printf("         (default is one per CPU) using '-j#'\n");
+        printf("\n    Use '-' as OutFileBase to write the code image to stdout\n");
+        printf("\n");
+        return(RET_ERROR);
+    }
+
+    /* Get all non-flag arguments */
+    if( !(ppInFile = malloc(argc*sizeof(char *))) )
+        { printf("Memory allocation failed\n"); return(RET_ERROR); }
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' || !argv[i][1] )
+            ppInFile[InCount++] = argv[i];
+    }
+
+    /* Get all flag arguments */
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] == '-' && argv[i][1] )
+        {
+            flags = argv[i];
+            flags++;
+            while( *flags )
+            {
+                if( *flags == 'I' )
+                {
+                    add_include_dir(++flags);
+                    break;
+                }
+                else if( *flags == 'j' )
+                {
+                    flags++;
+                    Threads = *flags ? atoi(flags) : CpuCount();
+                    if( Threads<1 || Threads>MAX_JOB_THREADS )
+                    {
+                        printf("\nExpected a thread count (1-%d) after option 'j'\n\n",MAX_JOB_THREADS);
+                        goto USAGE;
+                    }
+                    break;
+                }
+                else if( *flags == 'T' )
+                {
+                    flags++;
+                    pCtx->Options |= OPTION_TIMING;
+                    if( !strncmp( flags, "load=", 5 ) )
+                        pCtx->TimingCosts.SystemLoad = (uint)strtoul( flags+5, 0, 0 );
+                    else if( !strncmp( flags, "store=", 6 ) )
+                        pCtx->TimingCosts.SystemStore = (uint)strtoul( flags+6, 0, 0 );
+                    else if( *flags )
+                    {
+                        if( pCtx->TimingQueries==MAX_TIMING_QUERY || !strchr( flags, ':' ) )
+                        {
+                            printf("\nExpected 'from:to' after option 'T' (at most %d)\n\n",
+                                   MAX_TIMING_QUERY);
+                            goto USAGE;
+                        }
+                        pCtx->TimingQuery[pCtx->TimingQueries++] = flags;
+                    }
+                    break;
+                }
+                else if( *flags == 'D' )
+                {
+                    flags++;
+                    if( pCtx->cmdLineEquates==MAX_CMD_EQUATE )
+                    {
+                        printf("\nToo many command line equates\n\n");
+                        goto USAGE;
+                    }
+                    j=0;
+                    while( j<EQUATE_NAME_LEN && *flags && *flags!='=' )
+                        pCtx->cmdLineName[pCtx->cmdLineEquates][j++]=*flags++;
+                    if( j==EQUATE_NAME_LEN )
+                    {
+                        printf("\nCommand line equate name too long\n\n");
+                        goto USAGE;
+                    }
+                    strcpy( pCtx->cmdLineData[pCtx->cmdLineEquates], "1" );
+                    if( *flags=='=' )
+                    {
+                        flags++;
+                        j=0;
+                        while( j<EQUATE_DATA_LEN && *flags )
+                            pCtx->cmdLineData[pCtx->cmdLineEquates][j++]=*flags++;
+                        if( j==EQUATE_DATA_LEN )
+                        {
+                            printf("\nCommand line equate data too long\n\n");
+                            goto USAGE;
+                        }
+                    }
+                    pCtx->cmdLineEquates++;
+                    break;
+                }
+                else if( *flags == 'C' )
+                {
+                    flags++;
+                    j = 0;
+                    while( j<EQUATE_DATA_LEN && *flags )
+                    {
+                        nameCArray[j++]=*flags++;
+                    }
+                    if( j==EQUATE_DATA_LEN )
+                    {
+                        printf("\nCArray name too long\n\n");
+                        goto USAGE;
+                    }
+                    nameCArraySet = 1;
+                    break;
+                }
+                else if( *flags == 'V' )
+                {
+                    flags++;
+                    if( *flags<'0' || *flags>'3' )
+                    {
+                        printf("\nExpected a number (0-3) after option 'V'\n\n");
+                        goto USAGE;
+                    }
+                    if( pCtx->Core != CORE_NONE )
+                    {
+                        printf("\nDo not specify more than one core version or use -V with -X or -x\n\n");
+                        goto USAGE;
+                    }
+                    pCtx->Core = CORE_V0 + *flags - '0';
+                }
+                else if( *flags == 'x' )
+                {
+                    if( pCtx->Core != CORE_NONE )
+                    {
+                        printf("\nDo not use -x with -X or -V\n\n");
+                        goto USAGE;
+                    }
+                    pCtx->Core = CORE_V0;
+                }
+                else if( *flags == 'X' )
+                {
+                    if( pCtx->Core != CORE_NONE )
+                    {
+                        printf("\nDo not use -X with -x or -V\n\n");
+                        goto USAGE;
+                    }
+                    pCtx->Core = CORE_V2;
+                }
+                else if( *flags == 'E' )
+                    pCtx->Options |= OPTION_BIGENDIAN;
+                else if( *flags == 'b' )
+                    pCtx->Options |= OPTION_BINARY;
+                else if( *flags == 'B' )
+                    pCtx->Options |= OPTION_BINARYBIG;
+                else if( *flags == 'c' )
+                    pCtx->Options |= OPTION_CARRAY;
+                else if( *flags == 'm' )
+                    pCtx->Options |= OPTION_IMGFILE;
+                else if( *flags == 'l' )
+                    pCtx->Options |= OPTION_LISTING;
+                else if( *flags == 'L' )
+                    pCtx->Options |= OPTION_SOURCELISTING;
+                else if( *flags == 'd' )
+                    pCtx->Options |= OPTION_DBGFILE;
+                else if( *flags == 'M' )
+                    pCtx->Options |= OPTION_DEPEND;
+                else if( *flags == 'O' )
+                    pCtx->Options |= OPTION_OPTIMIZE;
+                else if( *flags == 'r' )
+                    pCtx->Options |= OPTION_RELOC;
+                else if( *flags == 's' )
+                    pCtx->Options |= OPTION_SINGLEPASS;
+                else if( *flags == 'z' )
+                    pCtx->Options |= OPTION_DEBUG;
+                else
+                {
+                    printf("\nUnknown flag '%c'\n\n",*flags);
+                    goto USAGE;
+                }
+                flags++;
+            }
+        }
+    }
+
+    if( pCtx->Core==CORE_NONE )
+        pCtx->Core = CORE_V1;
+
+    /* An object is only code to link, its addresses are not final */
+    if( (pCtx->Options & OPTION_RELOC) &&
+        (pCtx->Options & (OPTION_BINARY|OPTION_CARRAY|OPTION_BINARYBIG|OPTION_IMGFILE|OPTION_DBGFILE|
+                          OPTION_BIGENDIAN|OPTION_OPTIMIZE|OPTION_SINGLEPASS|OPTION_TIMING)) )
+    {
+        printf("\nOption 'r' can not be used with options 'bBcmdEOsT'\n\n");
+        goto USAGE;
+    }
+
+    /* Check input file(s) */
+    if( !InCount )
+        goto USAGE;
+    if( !Threads && InCount>2 )
+        goto USAGE;
+
+    /* Only one code image can go to stdout, and nothing else */
+    if( fStdout )
+    {
+        uint fmt = pCtx->Options & (OPTION_BINARY|OPTION_CARRAY|OPTION_BINARYBIG|OPTION_IMGFILE|OPTION_DBGFILE);
+
+        if( Threads || InCount!=2 || strcmp( ppInFile[1], "-" ) || !fmt || (fmt & (fmt-1)) ||
+            (pCtx->Options & (OPTION_LISTING|OPTION_SOURCELISTING|OPTION_DEPEND|OPTION_OPTIMIZE|
+                              OPTION_RELOC|OPTION_TIMING)) )
+        {
+            printf("\nOutput base '-' needs exactly one of options 'bBcmd', and none of 'jlLMOrT'\n\n");
+            goto USAGE;
+        }
+    }
+
+    /* If no output specified, default to 'C' array */
+    if( !(pCtx->Options & (OPTION_BINARY|OPTION_CARRAY|OPTION_BINARYBIG|OPTION_IMGFILE|OPTION_DBGFILE|OPTION_RELOC)) )
+    {
+        printf("Note: Using default output '-c' (C array *_bin.h)\n\n");
+        pCtx->Options |= OPTION_CARRAY;
+    }
+
+    /* Source text is read once and shared by both passes and all jobs */
+    JobLockInit( &SourceTextLock );
+    pCtx->pfnReadSource = SourceTextRead;
+
+    if( Threads )
+        return( RunJobs( ppInFile, InCount, Threads ) );
+
+    memset( &job, 0, sizeof(JOB) );
+    job.InFile   = ppInFile[0];
+    job.OutFile  = InCount>1 ? ppInFile[1] : 0;
+    if( fStdout )
+    {
+        job.fBuffered     = 1;
+        pCtx->pfnMessage  = JobMessage;
+        pCtx->pMessageArg = &job;
+    }
+    i = AssembleJob( &job );
+    if( job.Text )
+    {
+        fwrite( job.Text, 1, job.TextLength, stderr );
+        free( job.Text );
+    }
+
+    /* Assember label cleanup */
+    ContextDestroy( pCtx );
+    return(i);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// AssembleJob
+//
+// Assembles one input file in the current context and writes its
+// outputs. In driver mode the console text is kept in the job.
+//
+// Returns RET_SUCCESS or RET_ERROR
+*/
+static int AssembleJob( JOB *pj )
+{
+    int i;
+    char *infile = pj->InFile, *outfile = pj->OutFile;
+    SOURCEFILE *mainsource;
+    char outbase[MAXFILE],outfilename[MAXFILE];
+
+    /* Check output file base - make sure no '.' */
+    if( outfile )
+    {
+        if( strlen(outfile) > (MAXFILE-5) )
+            { Report(0,REP_ERROR,"Outfile name too long"); return(RET_ERROR); }
+        i=0;
+        while( outfile[i] )
+        {
+            if( outfile[i]=='.' )
+            {
+                if( outfile[i+1]=='.' )
+                    i++;
+                else
+                    { Report(0,REP_ERROR,"Outfile should be basename only - no '.'"); return(RET_ERROR); }
+            }
+            i++;
+        }
+        strcpy( outbase, outfile );
+    }
+
+    /* Test opening the main source file */
+    if( !(mainsource=InitSourceFile(0,infile,0)) )
+        return(RET_ERROR);
+
+    /* Setup outfile base */
+    if( !outfile )
+    {
+        for(i=0; mainsource->SourceName[i] && mainsource->SourceName[i]!='.'; i++ )
+            outbase[i]=mainsource->SourceName[i];
+        outbase[i] = 0;
+    }
+    if( pCtx->Options & OPTION_DEBUG )
+        JobPrint(pj,"Output base filename: '%s'\n",outbase);
+
+    /* Close the source file for now */
+    CloseSourceFile( mainsource );
+
+    /* Open listing file */
+    if( pCtx->Options & OPTION_LISTING )
+    {
+        strcpy( outfilename, outbase );
+        strcat( outfilename, ".lst" );
+        if (!(pCtx->ListingFile = fopen(outfilename,"wb")))
+            { Report(0,REP_ERROR,"Unable to open output file: %s",outfilename); return(RET_ERROR); }
+    }
+
+    /* Run the assembler */
+    Assemble( infile, 0, 0 );
+
+    /* Close the listing file */
+    if( pCtx->ListingFile )
+        fclose( pCtx->ListingFile );
+
+    /* Process the results */
+    if( pj->fBuffered )
+        JobPrint(pj,"%s : Pass %d : %d Error(s), %d Warning(s), %d word(s)\n",
+                 infile,pCtx->Pass,pCtx->Errors,pCtx->Warnings,pCtx->CodeOffset);
+    else
+        printf("\nPass %d : %d Error(s), %d Warning(s)\n\n",pCtx->Pass,pCtx->Errors,pCtx->Warnings);
+    if( pCtx->Errors || pCtx->CodeOffset<=0 )
+        pCtx->Options = 0;
+    else
+    {
+        if( pCtx->Options & OPTION_OPTIMIZE )
+            OptimizeImage();
+        if( !pj->fBuffered )
+            printf("Writing Code Image of %d word(s)\n\n",pCtx->CodeOffset);
+    }
+
+    /* Create the output files */
+    if( pCtx->Options & (OPTION_CARRAY|OPTION_IMGFILE|OPTION_DBGFILE|OPTION_BINARY|OPTION_BINARYBIG) )
+        OutputWrite( outbase, nameCArraySet ? nameCArray : 0 );
+    if( pCtx->Options & OPTION_SOURCELISTING )
+    {
+        FILE *Outfile;
+
+        strcpy( outfilename, outbase );
+        strcat( outfilename, ".txt" );
+        if (!(Outfile = fopen(outfilename,"wb")))
+            Report(0,REP_ERROR,"Unable to open output file: %s",outfilename);
+        else
+        {
+            char FullPath[SOURCE_BASE_DIR+SOURCE_NAME];
+
+            for( i=0; i<(int)pCtx->sfIndex; i++ )
+            {
+                fprintf(Outfile, "Source File %d : '%s' ", i+1, pCtx->sfArray[i].SourceName);
+                strcpy(FullPath,pCtx->sfArray[i].SourceBaseDir);
+                strcat(FullPath, "/");
+                strcat(FullPath,pCtx->sfArray[i].SourceName);
+                pCtx->sfArray[i].FilePtr=fopen(FullPath,"rb");
+                if( pCtx->sfArray[i].FilePtr!=0 )
+                {
+                    pCtx->sfArray[i].CurrentLine   = 1;
+                    pCtx->sfArray[i].CurrentColumn = 1;
+                    pCtx->sfArray[i].LastChar      = 0;
+                    ListFile(Outfile,&pCtx->sfArray[i]);
+                    fclose(pCtx->sfArray[i].FilePtr);
+                    fprintf(Outfile, "\n\n");
+                }
+                else
+                    fprintf(Outfile, "(File Not Found '%s')\n\n",FullPath);
+            }
+
+            fclose(Outfile);
+        }
+    }
+    if( pCtx->Options & OPTION_RELOC )
+        ObjectWrite( outbase );
+    if( pCtx->Options & OPTION_TIMING )
+        TimingWrite( outbase );
+    if( pCtx->Options & OPTION_DEPEND )
+        DependWrite( outbase );
+
+    if( pCtx->Errors || pCtx->CodeOffset<=0 )
+        return(RET_ERROR);
+    return(RET_SUCCESS);
+}
+
+
+/*
+// RunJobs
+//
+// Assembles each input file to its own outputs on a pool of threads.
+// Each job has its own context, set up from the command line options
+// in the current context. The console text of each job is printed in
+// input order once all jobs are done.
+//
+// Returns RET_SUCCESS when all jobs succeed, RET_ERROR otherwise
+*/
+static int RunJobs( char **ppInFile, int InCount, int Threads )
+{
+    DRIVER     drv;
+    JOB_THREAD thread[MAX_JOB_THREADS];
+    char       base[MAXFILE], other[MAXFILE];
+    int        i, j, started, failed;
+
+    /* Two inputs with the same base name would write the same outputs */
+    for( i=0; i<InCount; i++ )
+    {
+        get_basename( ppInFile[i], base, MAXFILE );
+        base[strcspn(base,".")] = 0;
+        for( j=i+1; j<InCount; j++ )
+        {
+            get_basename( ppInFile[j], other, MAXFILE );
+            other[strcspn(other,".")] = 0;
+            if( !strcmp( base, other ) )
+            {
+                Report(0,REP_ERROR,"'%s' and '%s' would write the same outputs",ppInFile[i],ppInFile[j]);
+                return(RET_ERROR);
+            }
+        }
+    }
+
+    memset( &drv, 0, sizeof(DRIVER) );
+    drv.pJobs     = calloc( InCount, sizeof(JOB) );
+    if( !drv.pJobs )
+        { Report(0,REP_ERROR,"Memory allocation failed"); return(RET_ERROR); }
+    drv.JobCount  = InCount;
+    drv.pTemplate = pCtx;
+    JobLockInit( &drv.Lock );
+
+    for( i=0; i<InCount; i++ )
+    {
+        drv.pJobs[i].InFile    = ppInFile[i];
+        drv.pJobs[i].fBuffered = 1;
+    }
+
+    /* Run the jobs */
+    if( Threads > InCount )
+        Threads = InCount;
+    for( started=0; started<Threads; started++ )
+    {
+        if( JobThreadStart( &thread[started], &drv ) )
+            break;
+    }
+    if( !started )
+        JobThread( &drv );
+    for( i=0; i<started; i++ )
+        JobThreadWait( thread[i] );
+
+    /* Report the results in input order */
+    failed = 0;
+    for( i=0; i<InCount; i++ )
+    {
+        if( drv.pJobs[i].Text )
+            fwrite( drv.pJobs[i].Text, 1, drv.pJobs[i].TextLength, stdout );
+        if( drv.pJobs[i].Result != RET_SUCCESS )
+            failed++;
+        free( drv.pJobs[i].Text );
+    }
+    printf("\n%d file(s) on %d thread(s) : %d failed\n\n",InCount,started ? started : 1,failed);
+
+    free( drv.pJobs );
+    ContextDestroy( drv.pTemplate );
+    return( failed ? RET_ERROR : RET_SUCCESS );
+}
+
+
+/*
+// JobThread
+//
+// Takes jobs from the driver until none are left
+//
+// Returns 0
+*/
+static JOB_THREAD_RETURN JobThread( void *pArg )
+{
+    DRIVER  *pd = (DRIVER *)pArg;
+    PASMCTX *pt = pd->pTemplate;
+    JOB     *pj;
+    int     idx;
+
+    for(;;)
+    {
+        JobLock( &pd->Lock );
+        idx = pd->NextJob++;
+        JobUnlock( &pd->Lock );
+        if( idx >= pd->JobCount )
+            break;
+        pj = &pd->pJobs[idx];
+
+        if( !(pCtx = ContextCreate()) )
+        {
+            JobPrint(pj,"%s : Memory allocation failed\n",pj->InFile);
+            pj->Result = RET_ERROR;
+            continue;
+        }
+        pCtx->Options        = pt->Options;
+        pCtx->Core           = pt->Core;
+        pCtx->cmdLineEquates = pt->cmdLineEquates;
+        memcpy( pCtx->cmdLineName, pt->cmdLineName, sizeof(pt->cmdLineName) );
+        memcpy( pCtx->cmdLineData, pt->cmdLineData, sizeof(pt->cmdLineData) );
+        pCtx->TimingCosts    = pt->TimingCosts;
+        pCtx->TimingQueries  = pt->TimingQueries;
+        memcpy( pCtx->TimingQuery, pt->TimingQuery, sizeof(pt->TimingQuery) );
+        pCtx->pfnReadSource  = pt->pfnReadSource;
+        pCtx->pfnMessage     = JobMessage;
+        pCtx->pMessageArg    = pj;
+
+        pj->Result = AssembleJob( pj );
+        ContextDestroy( pCtx );
+    }
+    return(0);
+}
+
+
+/*
+// JobThreadStart
+//
+// Starts a thread running JobThread()
+//
+// Returns 0 on success, -1 on error
+*/
+static int JobThreadStart( JOB_THREAD *pThread, void *pArg )
+{
+#if defined(_MSC_VER)
+    *pThread = (HANDLE)_beginthreadex( 0, 0, JobThread, pArg, 0, 0 );
+    return( *pThread ? 0 : -1 );
+#else
+    return( pthread_create( pThread, 0, JobThread, pArg ) ? -1 : 0 );
+#endif
+}
+
+
+/*
+// JobThreadWait
+//
+// Waits for a thread started by JobThreadStart() to finish
+//
+// void
+*/
+static void JobThreadWait( JOB_THREAD Thread )
+{
+#if defined(_MSC_VER)
+    WaitForSingleObject( Thread, INFINITE );
+    CloseHandle( Thread );
+#else
+    pthread_join( Thread, 0 );
+#endif
+}
+
+
+/*
+// CpuCount
+//
+// Returns the number of online CPUs (at most MAX_JOB_THREADS)
+*/
+static int CpuCount()
+{
+    long count;
+
+#if defined(_MSC_VER)
+    SYSTEM_INFO si;
+
+    GetSystemInfo( &si );
+    count = si.dwNumberOfProcessors;
+#else
+    count = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+    if( count < 1 )
+        count = 1;
+    if( count > MAX_JOB_THREADS )
+        count = MAX_JOB_THREADS;
+    return( (int)count );
+}
+
+
+/*
+// JobPrint
+//
+// Prints console text for a job, or keeps it in the job in driver mode
+//
+// void
+*/
+static void JobPrint( JOB *pj, char *fmt, ... )
+{
+    va_list arg_ptr;
+    char    Text[REPORT_TEXT_MAX+SOURCE_NAME+32];
+    char    *pNew;
+    uint    len;
+
+    va_start( arg_ptr, fmt );
+    if( !pj->fBuffered )
+    {
+        vprintf( fmt, arg_ptr );
+        va_end( arg_ptr );
+        return;
+    }
+    vsnprintf( Text, sizeof(Text), fmt, arg_ptr );
+    va_end( arg_ptr );
+    Text[sizeof(Text)-1] = 0;
+
+    len = strlen(Text);
+    if( pj->TextLength+len+1 > pj->TextSize )
+    {
+        pNew = realloc( pj->Text, pj->TextSize+len+1024 );
+        if( !pNew )
+            return;
+        pj->Text = pNew;
+        pj->TextSize += len+1024;
+    }
+    memcpy( pj->Text+pj->TextLength, Text, len+1 );
+    pj->TextLength += len;
+}
+
+
+/*
+// JobMessage
+//
+// Keeps the Report() text of a job, in the same form Report() prints it
+//
+// void
+*/
+static void JobMessage( void *pArg, int Level, const char *File, unsigned int Line, const char *Text )
+{
+    JOB  *pj = (JOB *)pArg;
+    char *Type;
+
+    if( Level == REP_FATAL )
+        Type = "Fatal Error: ";
+    else if( Level == REP_ERROR )
+        Type = "Error: ";
+    else if( Level==REP_WARN1 || Level==REP_WARN2 )
+        Type = "Warning: ";
+    else
+        Type = "Note: ";
+
+    if( File )
+        JobPrint(pj,"%s(%d) %s%s\n",File,Line,Type,Text);
+    else
+        JobPrint(pj,"%s%s\n\n",Type,Text);
+}
+
+
+/*
+// SourceTextRead
+//
+// Source reader for the engine. Each file is read once and its text is
+// kept until the program exits, so the second pass and other jobs that
+// include the same file do not read it again. Only the raw text is
+// shared, as the result of preprocessing depends on the defines of the
+// file that includes it.
+//
+// Returns 0 on success, -1 if the file can not be read
+*/
+static int SourceTextRead( void *pArg, const char *Path, const char **ppText, uint *pLength )
+{
+    SOURCETEXT *pst, *pNew;
+    FILE       *pf;
+    uint       hash;
+    long       size;
+    const char *p;
+
+    hash = 2166136261u;
+    for( p=Path; *p; p++ )
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    hash &= SOURCE_TEXT_HASH-1;
+
+    JobLock( &SourceTextLock );
+    for( pst=SourceTextHash[hash]; pst && strcmp( pst->Path, Path ); pst=pst->pNext );
+    JobUnlock( &SourceTextLock );
+    if( pst )
+    {
+        *ppText  = pst->pText;
+        *pLength = pst->Length;
+        return(0);
+    }
+
+    /* Read the file outside the lock */
+    if( !(pf = fopen(Path,"rb")) )
+        return(-1);
+    pNew = 0;
+    if( !fseek( pf, 0, SEEK_END ) && (size = ftell(pf)) >= 0 && !fseek( pf, 0, SEEK_SET ) &&
+        (pNew = malloc(sizeof(SOURCETEXT)+strlen(Path))) != 0 )
+    {
+        strcpy( pNew->Path, Path );
+        pNew->Length = (uint)size;
+        if( !(pNew->pText = malloc(size+1)) || fread( pNew->pText, 1, size, pf ) != (size_t)size )
+        {
+            free( pNew->pText );
+            free( pNew );
+            pNew = 0;
+        }
+    }
+    fclose( pf );
+    if( !pNew )
+        return(-1);
+
+    /* Another job may have read it first */
+    JobLock( &SourceTextLock );
+    for( pst=SourceTextHash[hash]; pst && strcmp( pst->Path, Path ); pst=pst->pNext );
+    if( !pst )
+    {
+        pNew->pNext = SourceTextHash[hash];
+        SourceTextHash[hash] = pNew;
+        pst = pNew;
+        pNew = 0;
+    }
+    JobUnlock( &SourceTextLock );
+    if( pNew )
+    {
+        free( pNew->pText );
+        free( pNew );
+    }
+
+    *ppText  = pst->pText;
+    *pLength = pst->Length;
+    return(0);
+}
+
+
+/*
+// PrintLine
+//
+// Prints out a line of the source file for source listings
+//
+// Returns 1 on success, 0 on EOF
+*/
+static int PrintLine( FILE *pfOut, SOURCEFILE *ps )
+{
+    int i;
+    char c;
+
+AGAIN:
+    i = fread( &c, 1, 1, ps->FilePtr );
+    if( i != 1 )
+        return(0);
+    if( c == 0xd )
+        goto AGAIN;
+    if( c == 0xa )
+    {
+        ps->CurrentLine++;
+        fprintf(pfOut,"\n");
+        return(1);
+    }
+    fprintf(pfOut,"%c",c);
+    goto AGAIN;
+}
+
+/*
+// GetInfoFromAddr
+//
+// Returns the SourceFileIndex, Line Number, and CodeWord for a given address offset
+//
+// Returns 0 on success, -1 on error
+*/
+static int GetInfoFromAddr( uint address, uint *pIndex, uint *pLineNo, uint *pCodeWord )
+{
+    // Return data if within written portion of array and entry has been set
+    if (address < pCtx->CodeOffset && pCtx->ProgramImage[address].AddrOffset == address) {
+       *pIndex = pCtx->ProgramImage[address].FileIndex;
+       *pLineNo = pCtx->ProgramImage[address].Line;
+       *pCodeWord = pCtx->ProgramImage[address].CodeWord;
+       return 0;
+    }
+    return -1;
+}
+
+/*
+// ListFile
+//
+// Prints out an object code annotated listing of an original source file
+//
+// Returns 1 on success
+*/
+static int ListFile( FILE *pfOut, SOURCEFILE *ps )
+{
+    uint addr, index, line, code, count, output, cline;
+
+    count = 0;
+    for( addr=0; addr<(uint)pCtx->CodeOffset; addr++ )
+    {
+        if( GetInfoFromAddr( addr, &index, &line, &code ) >= 0 )
+        {
+            if( index == ps->FileIndex )
+                count++;
+        }
+    }
+
+    if( !count )
+    {
+        // No code section
+        fprintf(pfOut,"(No Output Generated)\n\n");
+
+        for(;;)
+        {
+            fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
+            if( !PrintLine(pfOut,ps) )
+                return(1);
+        }
+    }
+    else
+    {
+        fprintf(pfOut,"(%d Instructions Generated)\n\n",count);
+
+        for(;;)
+        {
+            output = 0;
+            cline = ps->CurrentLine;
+
+            for( addr=0; addr<(uint)pCtx->CodeOffset; addr++ )
+            {
+                if( (GetInfoFromAddr( addr, &index, &line, &code ) < 0) || index!=ps->FileIndex || line<cline )
+                    continue;
+
+                if( line == cline )
+                {
+                    if( !output )
+                    {
+                        fprintf(pfOut,"%5d : 0x%04x 0x%08x : ",line,addr,code );
+                        if( !PrintLine(pfOut,ps) )
+                            return(1);
+                        output = 1;
+                    }
+                    else
+                    {
+                        fprintf(pfOut,"      : 0x%04x 0x%08x : \n",addr,code );
+                    }
+                }
+            }
+
+            if( !output )
+            {
+                fprintf(pfOut,"%5d :                   : ",ps->CurrentLine );
+                if( !PrintLine(pfOut,ps) )
+                    return(1);
+            }
+        }
+    }
+    return(1);
+}
@@ -0,0 +1,246 @@
+/*
+ * pasmobj.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmobj.c
+//
+// Description:
+//     Relocatable object file output (-r, *.pobj)
+//         - Writes the code, labels, and source lines as in a debug file
+//         - Adds the .global and .extern symbols
+//         - Adds the relocations noted while assembling
+//
+//     The object is assembled at address 0. pasmlink gives it a load
+//     address, resolves the .extern symbols against the .global symbols
+//     of the other objects, and patches each relocated word. See
+//     pasmdbg.h for the layout.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added relocatable objects
+//     18-Oct-26: 0.86 - Name the source files through OutSourceName()
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#endif
+#include <stdlib.h>
+#include "pasm.h"
+#include "pasmdbg.h"
+
+/* Local Support Funtions */
+static void PutWord( FILE *pf, uint Word );
+static void PutName( FILE *pf, char *Name );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// ObjectWrite
+//
+// Writes the relocatable object file (*.pobj) for pasmlink: the debug
+// file records, plus the .global and .extern symbols and relocations.
+//
+// Returns 1 on success, 0 on error
+*/
+int ObjectWrite( char *outbase )
+{
+    FILE  *pf;
+    LABEL *pl;
+    char  Name[256], Source[DBGFILE_NAMELEN_SHORT];
+    uint  labels = 0, symbols = 0, off, sym;
+    int   i;
+
+    /* Every name must fit the fixed file records */
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+    {
+        if( strlen(pl->Name) >= DBGFILE_NAMELEN_SHORT )
+            { Report(0,REP_ERROR,"Label '%s' is too long for the object file",pl->Name); return(0); }
+        if( !(pl->Flags & LABEL_FLG_EXTERN) )
+            labels++;
+        if( pl->Flags & (LABEL_FLG_EXTERN|LABEL_FLG_GLOBAL) )
+            symbols++;
+    }
+
+    if( strlen(outbase) > sizeof(Name)-6 )
+        { Report(0,REP_ERROR,"Outfile name too long"); return(0); }
+    strcpy( Name, outbase );
+    strcat( Name, ".pobj" );
+    if( !(pf = fopen( Name, "wb" )) )
+        { Report(0,REP_ERROR,"Unable to open output file: %s",Name); return(0); }
+
+    off = sizeof(OBJFILE_HEADER);
+    PutWord( pf, OBJFILE_FILEID_VER1 );
+    PutWord( pf, labels );
+    PutWord( pf, off );
+    off += labels*sizeof(DBGFILE_LABEL);
+    PutWord( pf, pCtx->sfIndex );
+    PutWord( pf, off );
+    off += pCtx->sfIndex*sizeof(DBGFILE_FILE);
+    PutWord( pf, pCtx->CodeOffset );
+    PutWord( pf, off );
+    off += pCtx->CodeOffset*sizeof(DBGFILE_CODE);
+    PutWord( pf, pCtx->EntryPoint<0 ? 0 : pCtx->EntryPoint );
+    PutWord( pf, 0 );
+    PutWord( pf, symbols );
+    PutWord( pf, off );
+    off += symbols*sizeof(OBJFILE_SYMBOL);
+    PutWord( pf, pCtx->RelocCount );
+    PutWord( pf, off );
+
+    /* Labels (for the map and debugger) */
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+    {
+        if( pl->Flags & LABEL_FLG_EXTERN )
+            continue;
+        PutWord( pf, pl->Offset );
+        PutName( pf, pl->Name );
+    }
+
+    /* Source files, named as in the debug file */
+    for( i=0; i<(int)pCtx->sfIndex; i++ )
+    {
+        OutSourceName( i, Source );
+        PutName( pf, Source );
+    }
+
+    /* Code */
+    for( i=0; i<pCtx->CodeOffset; i++ )
+    {
+        PutWord( pf, (pCtx->ProgramImage[i].Flags & (DBGFILE_CODE_FLG_FILEINFO|DBGFILE_CODE_FLG_CANMAP)) |
+                     (pCtx->ProgramImage[i].Resv8<<8) | (pCtx->ProgramImage[i].FileIndex<<16) );
+        PutWord( pf, pCtx->ProgramImage[i].Line );
+        PutWord( pf, pCtx->ProgramImage[i].AddrOffset );
+        PutWord( pf, pCtx->ProgramImage[i].CodeWord );
+    }
+
+    /* Symbols, in label list order */
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+    {
+        if( pl->Flags & LABEL_FLG_EXTERN )
+        {
+            PutWord( pf, OBJFILE_SYM_FLG_EXTERN );
+            PutWord( pf, 0 );
+        }
+        else if( pl->Flags & LABEL_FLG_GLOBAL )
+        {
+            PutWord( pf, OBJFILE_SYM_FLG_GLOBAL );
+            PutWord( pf, pl->Offset );
+        }
+        else
+            continue;
+        PutName( pf, pl->Name );
+    }
+
+    /* Relocations, with the index of their symbol */
+    for( i=0; i<pCtx->RelocCount; i++ )
+    {
+        sym = OBJFILE_RELOC_LOCAL;
+        if( pCtx->pRelocList[i].pExtern )
+        {
+            sym = 0;
+            for( pl=pCtx->pLabelList; pl!=pCtx->pRelocList[i].pExtern; pl=pl->pNext )
+                if( pl->Flags & (LABEL_FLG_EXTERN|LABEL_FLG_GLOBAL) )
+                    sym++;
+        }
+        PutWord( pf, pCtx->pRelocList[i].Type );
+        PutWord( pf, pCtx->pRelocList[i].AddrOffset );
+        PutWord( pf, sym );
+    }
+
+    if( fclose( pf ) )
+        { Report(0,REP_ERROR,"File write error: %s",Name); return(0); }
+    return(1);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// PutWord
+//
+// Writes a little endian word
+//
+// void
+*/
+static void PutWord( FILE *pf, uint Word )
+{
+    unsigned char b[4];
+
+    b[0] = (unsigned char)Word;
+    b[1] = (unsigned char)(Word>>8);
+    b[2] = (unsigned char)(Word>>16);
+    b[3] = (unsigned char)(Word>>24);
+    fwrite( b, 1, 4, pf );
+}
+
+
+/*
+// PutName
+//
+// Writes a name as a fixed length, zero filled field
+//
+// void
+*/
+static void PutName( FILE *pf, char *Name )
+{
+    char buf[DBGFILE_NAMELEN_SHORT];
+
+    memset( buf, 0, sizeof(buf) );
+    strncpy( buf, Name, sizeof(buf)-1 );
+    fwrite( buf, 1, sizeof(buf), pf );
+}
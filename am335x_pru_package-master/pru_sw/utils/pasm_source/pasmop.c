@@ -57,6 +57,8 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     18-Oct-26: 0.86 - Opcodes found through the keyword table
+//     18-Oct-26: 0.86 - Registers and constants found through the name tables
 ============================================================================*/
 
 #include <stdio.h>
@@ -97,13 +99,10 @@ static int Offset2Reg( SOURCEFILE *ps, int num, PRU_ARG *pa, uint addr, uint siz
 */
 int CheckOpcode( char *word )
 {
-    int i;
+    int id = KeywordFind(word);
 
-    for(i=1; i<=OP_MAXIDX; i++)
-    {
-        if( !stricmp( word, OpText[i] ) )
-            return(i);
-    }
+    if( TOKID_KIND(id) == TOKID_OPCODE )
+        return(id - TOKID_OPCODE);
     return(0);
 }
 
@@ -304,9 +303,9 @@ int ProcessOp( SOURCEFILE *ps, int TermCnt, char **pTerms )
         // Instruction in the form of:
         //     OPCODE  Rdst, Rsrc, OP(255)
         */
-        if( inst.Op==OP_LMBD && Core<CORE_V1 )
+        if( inst.Op==OP_LMBD && pCtx->Core<CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
-        if( inst.Op>=OP_NOP0 && inst.Op<=OP_NOPF && Core<CORE_V3 )
+        if( inst.Op>=OP_NOP0 && inst.Op<=OP_NOPF && pCtx->Core<CORE_V3 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt!=4  )
             { Report(ps,REP_ERROR,"Expected 3 operands"); return(0); }
@@ -524,7 +523,7 @@ CODE_ARITHMETIC:
         // Instruction in the form of:
         //     SCAN  Rdst, OP(255)
         */
-        if( Core!=CORE_V1 )
+        if( pCtx->Core!=CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt!=3  )
             { Report(ps,REP_ERROR,"Expected 2 operands"); return(0); }
@@ -566,7 +565,7 @@ CODE_ARITHMETIC:
         */
         utmp = 4;
 CODE_MVI:
-        if( Core<CORE_V1 )
+        if( pCtx->Core<CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt==4 )
             { Report(ps,REP_ERROR,"3 operand mode not supported on this core"); return(0); }
@@ -628,7 +627,7 @@ CODE_MVI:
         }
 
 CODE_MVI_PLUS:
-        if( Core<CORE_V2 )
+        if( pCtx->Core<CORE_V2 )
             { Report(ps,REP_ERROR,"This form of MVIx illegal with specified core version"); return(0); }
         else
         {
@@ -733,7 +732,7 @@ CODE_MVI_PLUS:
         return(1);
 
     case OP_HALT:
-        if( Core<CORE_V1 )
+        if( pCtx->Core<CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 1 )
             { Report(ps,REP_ERROR,"Expected no operands"); return(0); }
@@ -742,7 +741,7 @@ CODE_MVI_PLUS:
         return(1);
 
     case OP_SLP:
-        if( Core<CORE_V1 )
+        if( pCtx->Core<CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 2 )
             { Report(ps,REP_ERROR,"Expected 1 operand"); return(0); }
@@ -751,7 +750,7 @@ CODE_MVI_PLUS:
             return(0);
         opcode |= inst.Arg[0].Value << 23;
         GenOp( ps, TermCnt, pTerms, opcode );
-        if( Core<CORE_V3 )
+        if( pCtx->Core<CORE_V3 )
         {
             opcode = 0x8 << 25;
             GenOp( ps, TermCnt, pTerms, opcode );
@@ -830,7 +829,7 @@ BURST_OPCODE:
         {
             opcode |= inst.Arg[0].Value;
 
-            if( !(Options & OPTION_BIGENDIAN) )
+            if( !(pCtx->Options & OPTION_BIGENDIAN) )
             {
                 /*
                 // ** Little Endian Version **
@@ -920,7 +919,7 @@ BURST_OPCODE:
         goto CODE_XFR;
 
 CODE_XFR_V3:
-        if( Core<CORE_V3 )
+        if( pCtx->Core<CORE_V3 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
 CODE_XFR:
         /*
@@ -928,7 +927,7 @@ CODE_XFR:
         //     OPCODE IM(511), Rdst, OP(124), n    -or-
         //     OPCODE IM(511), Rdst, bn
         */
-        if( Core<CORE_V2 )
+        if( pCtx->Core<CORE_V2 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 4 )
             { Report(ps,REP_ERROR,"Expected 3 operands"); return(0); }
@@ -966,7 +965,7 @@ CODE_XFR:
         {
             opcode |= inst.Arg[1].Value;
 
-            if( !(Options & OPTION_BIGENDIAN) )
+            if( !(pCtx->Options & OPTION_BIGENDIAN) )
             {
                 /*
                 // ** Little Endian Version **
@@ -1025,7 +1024,7 @@ CODE_XFR:
         // Instruction in the form of:
         //     LFC Rdst, #Im255
         */
-        if( Core!=CORE_V0 )
+        if( pCtx->Core!=CORE_V0 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 3 )
             { Report(ps,REP_ERROR,"Expected 2 operands"); return(0); }
@@ -1049,7 +1048,7 @@ CODE_XFR:
         //     STC Rsrc, #Im255
         //     STC Rsrc, #Im255, OP(255)
         */
-        if( Core!=CORE_V0 )
+        if( pCtx->Core!=CORE_V0 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt!=3 && TermCnt!=4 )
             { Report(ps,REP_ERROR,"Expected 2 or 3 operands"); return(0); }
@@ -1147,8 +1146,8 @@ CODE_JAL:
         if( TermCnt != 1 )
             { Report(ps,REP_ERROR,"Expected no operands"); return(0); }
         inst.Arg[1].Type  = ARGTYPE_REGISTER;
-        inst.Arg[1].Value = RetRegValue;
-        inst.Arg[1].Field = RetRegField;
+        inst.Arg[1].Value = pCtx->RetRegValue;
+        inst.Arg[1].Field = pCtx->RetRegField;
         goto CODE_JMP;
 
     case OP_JMP:
@@ -1174,8 +1173,8 @@ CODE_JAL:
         if( inst.Op==OP_CALL )
         {
             inst.Arg[0].Type  = ARGTYPE_REGISTER;
-            inst.Arg[0].Value = RetRegValue;
-            inst.Arg[0].Field = RetRegField;
+            inst.Arg[0].Value = pCtx->RetRegValue;
+            inst.Arg[0].Field = pCtx->RetRegField;
             goto CODE_JAL;
         }
 
@@ -1205,7 +1204,7 @@ CODE_LOOP:
         // Instruction in the form of:
         //     LOOP LoopDest, OP(255)
         */
-        if( Core<CORE_V3 )
+        if( pCtx->Core<CORE_V3 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 3 )
             { Report(ps,REP_ERROR,"Expected 2 operands"); return(0); }
@@ -1422,7 +1421,7 @@ WAITBIT_OPCODE:
         //     FILL  &Rdst,  #Im124
         //     FILL  #Im123, #Im124
         */
-        if( Core<CORE_V2 )
+        if( pCtx->Core<CORE_V2 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 3 )
             { Report(ps,REP_ERROR,"Expected 2 operands"); return(0); }
@@ -1453,7 +1452,7 @@ WAITBIT_OPCODE:
         //     ZERO  &Rdst,  #Im124
         //     ZERO  #Im123, #Im124
         */
-        if( Core<CORE_V1 )
+        if( pCtx->Core<CORE_V1 )
             { Report(ps,REP_ERROR,"Instruction illegal with specified core version"); return(0); }
         if( TermCnt != 3 )
             { Report(ps,REP_ERROR,"Expected 2 operands"); return(0); }
@@ -1467,7 +1466,7 @@ WAITBIT_OPCODE:
         if( !inst.Arg[1].Value )
             { Report(ps,REP_ERROR,"Zero length clear"); return(0); }
 
-        if( Core>=CORE_V2 )
+        if( pCtx->Core>=CORE_V2 )
         {
             /* Implement with XIN */
             opcode = 0x5D << 23;
@@ -1486,7 +1485,7 @@ WAITBIT_OPCODE:
 
             reg = inst.Arg[0].Value/4;
 
-            if( !(Options & OPTION_BIGENDIAN) )
+            if( !(pCtx->Options & OPTION_BIGENDIAN) )
             {
                 /*
                 // Little Endian Version
@@ -1643,9 +1642,7 @@ WAITBIT_OPCODE:
 */
 int GetRegister( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, int fBitOk, char termC )
 {
-    uint idx;
-    char c,field;
-    int  val,reg,width,offset,bit;
+    int rc;
 
     /*
     // The following register syntaxes are valid:
@@ -1657,125 +1654,17 @@ int GetRegister( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, int fBitOk, ch
     //   Raa.Wb.Tff     aa=(0-31) b=(0-2) ff=(0-15)
     //   Raa.Bc.Tgg     aa=(0-31) c=(0-3) gg=(0-7)
     //   Raa.Wb.Be.Tgg  aa=(0-31) b=(0-2) e=(0-1) gg=(0-7)
+    //
+    // Only one modifier is allowed on CORE_V0.
     */
-
-    idx=0;
-    c = src[idx++];
-
-    /* Get initial 'R##' */
-    if( toupper(c) != 'R' )
-        goto INVALID_REG;
-    c = src[idx++];
-    if( !isdigit(c) )
-        goto INVALID_REG;
-    val = 0;
-    while( isdigit(c) )
-    {
-        val *= 10;
-        val += c-'0';
-        c = src[idx++];
-    }
-    if( val>31 )
-        goto INVALID_REG;
-
-    reg    = val;
-    width  = 32;
-    offset = 0;
-    bit    = -1;
-
-    for(;;)
-    {
-        /* This char must be '.', or terminator */
-
-        /* If terminated, we're done */
-        if( c==termC )
-            break;
-        if( c != '.' )
-            goto INVALID_REG;
-
-        c = src[idx++];
-
-        /* This char must be 'W', 'B', or 'T' */
-        c = toupper(c);
-        if( c!='T' && c!='W' && c!='B' )
-            goto INVALID_REG;
-        field=c;
-        c = src[idx++];
-        if( !isdigit(c) )
-            goto INVALID_REG;
-        val = 0;
-        while( isdigit(c) )
-        {
-            val *= 10;
-            val += c-'0';
-            c = src[idx++];
-        }
-        if( field=='W' )
-        {
-            if( ((val*8)+16)>width )
-                goto INVALID_REG;
-            width = 16;
-            offset += val;
-        }
-        if( field=='B' )
-        {
-            if( ((val*8)+8)>width )
-                goto INVALID_REG;
-            width = 8;
-            offset += val;
-        }
-        if( field=='T' )
-        {
-            if( !fBitOk )
-                { Report(ps,REP_ERROR,"Operand %d use of .T field not allowed here",num); return(0); }
-            if( val>=width )
-                goto INVALID_REG;
-            if(c!=termC)
-                goto INVALID_REG;
-            bit = val;
-        }
-
-        if( c!=termC && (Core==CORE_V0) )
-            goto INVALID_REG;
-    }
-
-    /* Build the record */
-    pa->Type  = ARGTYPE_REGISTER;
-    pa->Value = reg;
-
-    if( width==32 )
-        pa->Field = FIELDTYPE_31_0;
-    if( width==16 )
-    {
-        if( !offset )
-            pa->Field = FIELDTYPE_15_0;
-        else if( offset==1 )
-            pa->Field = FIELDTYPE_23_8;
-        else
-            pa->Field = FIELDTYPE_31_16;
-    }
-    if( width==8 )
-    {
-        if( !offset )
-            pa->Field = FIELDTYPE_7_0;
-        else if( offset==1 )
-            pa->Field = FIELDTYPE_15_8;
-        else if( offset==2 )
-            pa->Field = FIELDTYPE_23_16;
-        else
-            pa->Field = FIELDTYPE_31_24;
-    }
-    if( bit>=0 )
-    {
-        pa->Type = ARGTYPE_REGISTERBIT;
-        pa->Bit = bit;
-    }
+    rc = RegisterFind( src, termC, (fBitOk ? 0 : REGFIND_FLG_NOBIT) |
+                       (pCtx->Core==CORE_V0 ? REGFIND_FLG_SINGLE : 0), pa );
+    if( rc==REGFIND_ERR_BIT )
+        { Report(ps,REP_ERROR,"Operand %d use of .T field not allowed here",num); return(0); }
+    if( !rc )
+        { Report(ps,REP_ERROR,"Operand %d '%s' invalid register or register mode",num,src); return(0); }
 
     return(1);
-
-INVALID_REG:
-    Report(ps,REP_ERROR,"Operand %d '%s' invalid register or register mode",num,src);
-    return(0);
 }
 
 /*
@@ -1820,7 +1709,7 @@ static int GetImValue( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, uint min
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( PASS_CHECKING && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
     /* Setup the record */
@@ -1855,28 +1744,12 @@ static int GetImValue( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa, uint min
 */
 static int GetConstant( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
 {
-    uint idx;
-    char c;
-    int  val;
-
-    idx=0;
-    c = src[idx++];
+    int val;
 
     /* Get C## */
-    if( toupper(c) != 'C' )
-        goto INVALID_CONST;
-    c = src[idx++];
-    if( !isdigit(c) )
-        goto INVALID_CONST;
-    val = 0;
-    while( isdigit(c) )
-    {
-        val *= 10;
-        val += c-'0';
-        c = src[idx++];
-    }
-    if( c || val>31 )
-        goto INVALID_CONST;
+    val = ConstantFind( src );
+    if( val<0 )
+        { Report(ps,REP_ERROR,"Operand %d invalid constant table entry '%s'",num,src); return(0); }
 
     /* Setup the record */
     pa->Type  = ARGTYPE_CONSTANT;
@@ -1884,10 +1757,6 @@ static int GetConstant( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
     pa->Field = 0;
 
     return(1);
-
-INVALID_CONST:
-    Report(ps,REP_ERROR,"Operand %d invalid constant table entry '%s'",num,src);
-    return(0);
 }
 
 
@@ -1975,11 +1844,15 @@ static int GetJmpOffset( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( PASS_CHECKING && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
-    jmpoff = ((int)val) - CodeOffset;
-    if( Pass==2 && (jmpoff<-512 || jmpoff>511) )
+    /* To an external label, the offset holds the addend for the linker */
+    if( pCtx->Reloc==RELOC_EXTERN )
+        jmpoff = (int)val;
+    else
+        jmpoff = ((int)val) - pCtx->CodeOffset;
+    if( PASS_CHECKING && (jmpoff<-512 || jmpoff>511) )
         { Report(ps,REP_ERROR,"Operand %d relative jump out of range",num); return(0); }
 
     /* Setup the record */
@@ -2021,11 +1894,14 @@ static int GetLoopOffset( SOURCEFILE *ps, int num, char *src, PRU_ARG *pa )
         return(0);
     }
 
-    if( Pass==2 && (Options & OPTION_DEBUG) )
+    if( PASS_CHECKING && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : EXP    : '%s' = %d\n", ps->SourceName,ps->CurrentLine,src,val);
 
-    jmpoff = ((int)val) - CodeOffset;
-    if( Pass==2 && (jmpoff<2 || jmpoff>255) )
+    if( pCtx->Reloc==RELOC_EXTERN )
+        { Report(ps,REP_ERROR,"Operand %d loop end must be in this module",num); return(0); }
+
+    jmpoff = ((int)val) - pCtx->CodeOffset;
+    if( PASS_CHECKING && (jmpoff<2 || jmpoff>255) )
         { Report(ps,REP_ERROR,"Operand %d invalid loop termination point",num); return(0); }
 
     /* Setup the record */
@@ -2070,7 +1946,7 @@ static int Offset2Reg( SOURCEFILE *ps, int num, PRU_ARG *pa, uint addr, uint siz
     pa->Value = addr/4;
 
     /* Get field type */
-    if( !(Options & OPTION_BIGENDIAN) )
+    if( !(pCtx->Options & OPTION_BIGENDIAN) )
     {
         /*
         // Little Endian Version
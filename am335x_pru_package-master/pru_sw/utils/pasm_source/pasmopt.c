@@ -0,0 +1,837 @@
+/*
+ * pasmopt.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmopt.c
+//
+// Description:
+//     Peephole optimizer (-O), run on the final code image
+//         - Branch threading: a branch to an unconditional jump goes
+//           straight to where that jump goes
+//         - Removes branches to the next word, moves of a register to
+//           itself, and loads of a value the register already holds
+//         - Narrows LDI Rn.w2,0 plus LDI Rn.w0,x into one LDI Rn,x
+//         - Runs the old and new code in the simulator on the same
+//           inputs, and keeps the old code if their outputs differ
+//
+//     Values are only tracked within a straight run of code, so nothing
+//     is assumed about registers at a label or branch target. Words are
+//     only removed when no instruction uses a label as a value, no CALL
+//     links through R30, and the code is one .origin block, since code
+//     addresses then change.
+//     Loads are never moved out of loops, since PRU memory can change
+//     under the program (host, other PRU, and peripherals).
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added peephole optimizer
+//     18-Oct-26: 0.86 - Classify through the prudis.c decode table
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#endif
+#include <stdlib.h>
+#include "pasm.h"
+
+/* Local Structure Types */
+
+/* Word Flags */
+#define OPT_FIXED           (1<<0)  /* LOOP, its body, or its end */
+#define OPT_LEADER          (1<<1)  /* Reached other than from the word before */
+#define OPT_DELETE          (1<<2)
+#define OPT_LOOPEND         (1<<3)  /* Last word of a LOOP body (kept) */
+
+/* Optimizer State */
+typedef struct _OPTSTATE {
+    uint            Start;          /* First code word (after the .origin gap) */
+    uint            Count;          /* Code words */
+    int             fMove;          /* Words may be removed */
+    uint            *pOld;          /* Code words before optimizing */
+    unsigned char   *pFlags;        /* OPT_xxx, by word */
+    uint            *pHops;         /* Jumps skipped by a threaded branch */
+    uint            *pMap;          /* New address, by old address */
+    uint            Threaded;
+    uint            Removed;
+    uint            Narrowed;
+} OPTSTATE;
+
+/* Loop for the Report */
+typedef struct _OPTLOOP {
+    uint            Top;
+    uint            Bottom;
+    uint            Saved;          /* Cycles saved per pass */
+} OPTLOOP;
+
+#define OPT_CHECK_RUNS      2
+#define OPT_CHECK_LIMIT     262144  /* Instructions per check run */
+
+/* ALU Operations */
+#define ALU_LSL             0x4
+#define ALU_LSR             0x5
+#define ALU_AND             0x8
+#define ALU_OR              0x9
+#define ALU_XOR             0xA
+
+/* Register Fields */
+#define FIELD_W0            FIELDTYPE_15_0
+#define FIELD_W2            FIELDTYPE_31_16
+#define FIELD_ALL           FIELDTYPE_31_0
+
+
+/* Local Support Funtions */
+static int  IsBranch( uint op );
+static int  IsJump( uint op );
+static int  IsLoop( uint op );
+static int  IsLdi( uint op );
+static int  IsGoto( uint op );
+static int  IsControl( uint op );
+static int  GetTarget( uint pc, uint op, uint *pTarget );
+static int  SetTarget( uint pc, uint *pOp, uint target );
+static void FindLoops( OPTSTATE *po );
+static void ThreadBranches( OPTSTATE *po );
+static void FindLeaders( OPTSTATE *po );
+static int  IsNoOp( uint op );
+static void RemoveRedundant( OPTSTATE *po );
+static void Compact( OPTSTATE *po );
+static int  CheckRun( uint *pOld, uint OldCount, uint OldEntry,
+                      uint *pNew, uint NewCount, uint NewEntry, int fPattern );
+static void ReportLoops( OPTSTATE *po, LABEL **ppLabel, int *pOffset, uint LabelCount );
+static char *AddrName( LABEL **ppLabel, int *pOffset, uint LabelCount, uint addr, char *buf );
+static int  CompareLoops( const void *a, const void *b );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// OptimizeImage
+//
+// Runs the peephole optimizer on the code image of the current context,
+// moving the labels and entry point along with the code. The result is
+// checked in the simulator against the original code, which is kept if
+// the two do not match.
+//
+// Returns 1 if the code changed, 0 if not
+*/
+int OptimizeImage()
+{
+    OPTSTATE o, *po = &o;
+    CODEGEN  *pImage = 0;
+    LABEL    *pl, **ppLabel = 0;
+    int      *pOffset = 0, EntryPoint = pCtx->EntryPoint;
+    uint     *pNew = 0, i, n, LabelCount = 0, OldEntry, NewEntry;
+    int      rc = 0, fSame;
+
+    memset( po, 0, sizeof(OPTSTATE) );
+    n = po->Count = pCtx->CodeOffset;
+    po->fMove = 1;
+
+    po->pOld   = malloc( (n+1) * sizeof(uint) );
+    po->pFlags = calloc( n+1, 1 );
+    po->pHops  = calloc( n+1, sizeof(uint) );
+    po->pMap   = malloc( (n+1) * sizeof(uint) );
+    pNew       = malloc( (n+1) * sizeof(uint) );
+    pImage     = malloc( (n+1) * sizeof(CODEGEN) );
+    ppLabel    = malloc( (pCtx->LabelCount+1) * sizeof(LABEL *) );
+    pOffset    = malloc( (pCtx->LabelCount+1) * sizeof(int) );
+    if( !po->pOld || !po->pFlags || !po->pHops || !po->pMap || !pNew || !pImage ||
+        !ppLabel || !pOffset )
+        { Report(0,REP_FATAL,"Memory allocation failed"); goto CLEANUP; }
+
+    /* Save what the optimizer changes, in case it has to be put back */
+    memcpy( pImage, pCtx->ProgramImage, n*sizeof(CODEGEN) );
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+    {
+        ppLabel[LabelCount] = pl;
+        pOffset[LabelCount++] = pl->Offset;
+    }
+    for( i=0; i<n; i++ )
+        po->pOld[i] = pCtx->ProgramImage[i].CodeWord;
+
+    /* Words before the first .origin are not code, a later gap is */
+    for( po->Start=0; po->Start<n; po->Start++ )
+        if( pCtx->ProgramImage[po->Start].Flags & CODEGEN_FLG_FILEINFO )
+            break;
+    for( i=po->Start; i<n && po->fMove; i++ )
+    {
+        if( !(pCtx->ProgramImage[i].Flags & CODEGEN_FLG_FILEINFO) )
+        {
+            printf("Optimizer: code not moved, there is more than one .origin block\n");
+            po->fMove = 0;
+        }
+        else if( (pCtx->ProgramImage[i].Flags & CODEGEN_FLG_LABELREF) &&
+                 !IsBranch( po->pOld[i] ) && !IsJump( po->pOld[i] ) && !IsLoop( po->pOld[i] ) )
+        {
+            printf("Optimizer: code not moved, the word at 0x%04x uses a label as a value\n",i);
+            po->fMove = 0;
+        }
+        else if( (po->pOld[i]>>29)==1 && ((po->pOld[i]>>25) & 0xF)==1 && (po->pOld[i] & 0x1F)==30 )
+        {
+            /* The return address would show on the R30 output pins */
+            printf("Optimizer: code not moved, the call at 0x%04x links through R30\n",i);
+            po->fMove = 0;
+        }
+    }
+
+    FindLoops( po );
+    ThreadBranches( po );
+    if( po->fMove )
+    {
+        FindLeaders( po );
+        RemoveRedundant( po );
+    }
+    if( !po->Threaded && !po->Removed )
+    {
+        printf("Optimizer: no changes\n\n");
+        goto CLEANUP;
+    }
+    Compact( po );
+
+    /* Check the new code against the old */
+    OldEntry = EntryPoint>=0 ? (uint)EntryPoint : 0;
+    NewEntry = pCtx->EntryPoint>=0 ? (uint)pCtx->EntryPoint : 0;
+    for( i=0; i<(uint)pCtx->CodeOffset; i++ )
+        pNew[i] = pCtx->ProgramImage[i].CodeWord;
+    fSame = 1;
+    for( i=0; i<OPT_CHECK_RUNS && fSame; i++ )
+        fSame = CheckRun( po->pOld, n, OldEntry, pNew, pCtx->CodeOffset, NewEntry, i );
+    if( !fSame )
+    {
+        Report(0,REP_WARN2,"Optimized code does not match the original in simulation, not optimized");
+        memcpy( pCtx->ProgramImage, pImage, n*sizeof(CODEGEN) );
+        pCtx->CodeOffset = n;
+        pCtx->EntryPoint = EntryPoint;
+        for( i=0; i<LabelCount; i++ )
+            ppLabel[i]->Offset = pOffset[i];
+        goto CLEANUP;
+    }
+
+    printf("Optimizer: %u of %u word(s) removed, %u branch(es) threaded, %u load(s) narrowed\n",
+           po->Removed, n-po->Start, po->Threaded, po->Narrowed);
+    ReportLoops( po, ppLabel, pOffset, LabelCount );
+    printf("Optimizer: same outputs as the original code in %d simulated runs\n\n",
+           OPT_CHECK_RUNS);
+    rc = 1;
+
+CLEANUP:
+    free( po->pOld );
+    free( po->pFlags );
+    free( po->pHops );
+    free( po->pMap );
+    free( pNew );
+    free( pImage );
+    free( ppLabel );
+    free( pOffset );
+    return(rc);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// IsBranch
+//
+// Returns 1 for QBxx, QBA, QBBx, and WBx (PC relative), 0 otherwise
+*/
+static int IsBranch( uint op )
+{
+    switch( prudis_opcode( op ) )
+    {
+    case OP_QBGT:
+    case OP_QBLT:
+    case OP_QBEQ:
+    case OP_QBGE:
+    case OP_QBLE:
+    case OP_QBNE:
+    case OP_QBA:
+    case OP_QBBS:
+    case OP_QBBC:
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// IsJump
+//
+// Returns 1 for JMP and JAL to an immediate address, 0 otherwise
+*/
+static int IsJump( uint op )
+{
+    uint opc = prudis_opcode( op );
+
+    return( (opc==OP_JMP || opc==OP_JAL) && (op & (1<<24)) );
+}
+
+
+/*
+// IsLoop
+//
+// Returns 1 for LOOP and ILOOP, 0 otherwise
+*/
+static int IsLoop( uint op )
+{
+    uint opc = prudis_opcode( op );
+
+    return( opc==OP_LOOP || opc==OP_ILOOP );
+}
+
+
+/*
+// IsLdi
+//
+// Returns 1 for LDI, 0 otherwise
+*/
+static int IsLdi( uint op )
+{
+    return( prudis_opcode( op )==OP_LDI );
+}
+
+
+/*
+// IsGoto
+//
+// Returns 1 for QBA and JMP to an immediate address, 0 otherwise
+*/
+static int IsGoto( uint op )
+{
+    uint opc = prudis_opcode( op );
+
+    return( opc==OP_QBA || (opc==OP_JMP && (op & (1<<24))) );
+}
+
+
+/*
+// IsControl
+//
+// Returns 1 when the word after op is not (only) reached by falling
+// through: branches, jumps, calls, returns, HALT, SLP, and LOOP
+*/
+static int IsControl( uint op )
+{
+    switch( prudis_opcode( op ) )
+    {
+    case OP_JMP:
+    case OP_JAL:
+    case OP_HALT:
+    case OP_SLP:
+        return(1);
+    }
+    return( IsBranch( op ) || IsLoop( op ) );
+}
+
+
+/*
+// GetTarget
+//
+// Finds the code address a branch, JMP, or JAL goes to
+//
+// Returns 1 on success, 0 when op has no immediate target
+*/
+static int GetTarget( uint pc, uint op, uint *pTarget )
+{
+    int offset;
+
+    if( IsJump( op ) )
+    {
+        *pTarget = (op>>8) & 0xFFFF;
+        return(1);
+    }
+    if( !IsBranch( op ) )
+        return(0);
+    offset = (op & 0xFF) | ((op>>17) & 0x300);
+    if( offset & 0x200 )
+        offset -= 0x400;
+    *pTarget = pc + offset;
+    return(1);
+}
+
+
+/*
+// SetTarget
+//
+// Changes where a branch, JMP, or JAL at pc goes
+//
+// Returns 1 on success, 0 if the target is out of range
+*/
+static int SetTarget( uint pc, uint *pOp, uint target )
+{
+    int offset;
+
+    if( IsJump( *pOp ) )
+    {
+        if( target > 0xFFFF )
+            return(0);
+        *pOp = (*pOp & ~0x00FFFF00) | (target << 8);
+        return(1);
+    }
+    offset = (int)target - (int)pc;
+    if( offset < -512 || offset > 511 )
+        return(0);
+    *pOp = (*pOp & ~0x060000FF) | (offset & 0xFF) | ((offset & 0x300) << 17);
+    return(1);
+}
+
+
+/*
+// FindLoops
+//
+// Marks each LOOP, its body, and the word after it as fixed. Branches
+// there are left alone, as the loop hardware watches those addresses,
+// and the last word of the body is always kept.
+//
+// void
+*/
+static void FindLoops( OPTSTATE *po )
+{
+    uint pc, end, k;
+
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        if( !IsLoop( po->pOld[pc] ) )
+            continue;
+        end = pc + (po->pOld[pc] & 0xFF);
+        for( k=pc; k<=end && k<po->Count; k++ )
+            po->pFlags[k] |= OPT_FIXED;
+        if( end>pc+1 && end<=po->Count )
+            po->pFlags[end-1] |= OPT_LOOPEND;
+    }
+}
+
+
+/*
+// ThreadBranches
+//
+// Points each branch and jump to an unconditional jump (QBA or JMP)
+// at the end of the chain instead
+//
+// void
+*/
+static void ThreadBranches( OPTSTATE *po )
+{
+    uint pc, op, target, next, hops, saved, newop;
+    uint *pCode = po->pMap;         /* Scratch: words as threaded so far */
+
+    for( pc=0; pc<po->Count; pc++ )
+        pCode[pc] = po->pOld[pc];
+
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        op = pCode[pc];
+        if( (po->pFlags[pc] & OPT_FIXED) || !GetTarget( pc, op, &target ) )
+            continue;
+
+        /* A jump threaded earlier stands for the whole chain it skips */
+        for( hops=0, saved=0; hops<po->Count; hops++ )
+        {
+            if( target<po->Start || target>=po->Count || (po->pFlags[target] & OPT_FIXED) ||
+                !IsGoto( pCode[target] ) )
+                break;
+            GetTarget( target, pCode[target], &next );
+            if( next==target )
+                break;
+            saved += 1 + po->pHops[target];
+            target = next;
+        }
+        if( !hops || hops==po->Count )
+            continue;
+
+        newop = op;
+        if( SetTarget( pc, &newop, target ) )
+        {
+            pCode[pc] = newop;
+            po->pHops[pc] = saved;
+            po->Threaded++;
+        }
+    }
+
+    for( pc=0; pc<po->Count; pc++ )
+        pCtx->ProgramImage[pc].CodeWord = pCode[pc];
+}
+
+
+/*
+// FindLeaders
+//
+// Marks the words where known register values must be dropped: labels,
+// branch targets, the entry point, LOOP bodies, and the word after any
+// transfer of control
+//
+// void
+*/
+static void FindLeaders( OPTSTATE *po )
+{
+    LABEL *pl;
+    uint  pc, op, target;
+
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+        if( pl->Offset>=0 && (uint)pl->Offset<po->Count )
+            po->pFlags[pl->Offset] |= OPT_LEADER;
+    if( pCtx->EntryPoint>=0 && (uint)pCtx->EntryPoint<po->Count )
+        po->pFlags[pCtx->EntryPoint] |= OPT_LEADER;
+
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        op = pCtx->ProgramImage[pc].CodeWord;
+        if( GetTarget( pc, op, &target ) && target<po->Count )
+            po->pFlags[target] |= OPT_LEADER;
+        if( IsLoop( op ) )
+        {
+            target = pc + (op & 0xFF);
+            if( target<po->Count )
+                po->pFlags[target] |= OPT_LEADER;
+        }
+        if( IsControl( op ) && pc+1<po->Count )
+            po->pFlags[pc+1] |= OPT_LEADER;
+    }
+}
+
+
+/*
+// IsNoOp
+//
+// Returns 1 if an instruction never changes anything: MOV Rn,Rn (coded
+// as AND), and OR, XOR, LSL, or LSR of a register with 0 into itself.
+// ADD Rn,Rn,0 is not one, as it clears the carry.
+*/
+static int IsNoOp( uint op )
+{
+    uint alu = (op>>25) & 0xF, dst = op & 0xFF, src = (op>>8) & 0xFF;
+
+    if( (op>>29) || dst!=src || (dst & 0x1F)==31 )
+        return(0);
+    if( alu==ALU_AND && !(op & (1<<24)) && ((op>>16) & 0xFF)==src )
+        return(1);
+    if( (alu==ALU_OR || alu==ALU_XOR || alu==ALU_LSL || alu==ALU_LSR) &&
+        (op & (1<<24)) && !((op>>16) & 0xFF) )
+        return(1);
+    return(0);
+}
+
+
+/*
+// RemoveRedundant
+//
+// Marks words that can go: branches to the next word, no-ops, and
+// loads or ALU results (other than those that set the carry) that the
+// destination already holds. Also narrows an LDI pair that sets the
+// upper half of a register to zero into one LDI.
+//
+// void
+*/
+static void RemoveRedundant( OPTSTATE *po )
+{
+    KNOWNREGS known;
+    uint      pc, op, next, target, val, cur, alu;
+    int       fDelete;
+
+    memset( &known, 0, sizeof(known) );
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        op = pCtx->ProgramImage[pc].CodeWord;
+        if( po->pFlags[pc] & OPT_LEADER )
+            memset( known.Known, 0, sizeof(known.Known) );
+        if( po->pFlags[pc] & (OPT_DELETE|OPT_LOOPEND) )
+        {
+            KnownApply( &known, pc, op );
+            continue;
+        }
+
+        fDelete = 0;
+        alu = (op>>25) & 0xF;
+        if( GetTarget( pc, op, &target ) && target==pc+1 && !(po->pFlags[pc] & OPT_FIXED) &&
+            !((op>>29)==1 && (alu & 1)) )
+            fDelete = 1;            /* Branch or JMP (not JAL) to the next word */
+        else if( IsNoOp( op ) )
+            fDelete = 1;
+        else if( (IsLdi( op ) || (!(op>>29) && (alu==ALU_LSL || alu==ALU_LSR || alu>=ALU_AND))) &&
+                 (op & 0x1F)!=31 && KnownResult( &known, pc, op, &val ) &&
+                 KnownGet( &known, op&0x1F, (op>>5)&7, &cur ) && val==cur )
+            fDelete = 1;            /* The register already holds the value */
+
+        if( fDelete )
+        {
+            po->pFlags[pc] |= OPT_DELETE;
+            po->Removed++;
+            continue;
+        }
+
+        /* LDI Rn.w2,0 and LDI Rn.w0,x (either order) become LDI Rn,x */
+        if( pc+1<po->Count && IsLdi( op ) && !(po->pFlags[pc+1] & (OPT_LEADER|OPT_LOOPEND)) &&
+            (op & 0x1F)!=31 )
+        {
+            next = pCtx->ProgramImage[pc+1].CodeWord;
+            if( IsLdi( next ) && (next & 0x1F)==(op & 0x1F) )
+            {
+                uint lo = 0, fNarrow = 0;
+
+                if( ((op>>5) & 7)==FIELD_W2 && !((op>>8) & 0xFFFF) && ((next>>5) & 7)==FIELD_W0 )
+                    { lo = (next>>8) & 0xFFFF; fNarrow = 1; }
+                if( ((op>>5) & 7)==FIELD_W0 && ((next>>5) & 7)==FIELD_W2 && !((next>>8) & 0xFFFF) )
+                    { lo = (op>>8) & 0xFFFF; fNarrow = 1; }
+                if( fNarrow )
+                {
+                    op = (op & ~0x00FFFFE0) | (FIELD_ALL << 5) | (lo << 8);
+                    pCtx->ProgramImage[pc].CodeWord = op;
+                    po->pFlags[pc+1] |= OPT_DELETE;
+                    po->Removed++;
+                    po->Narrowed++;
+                }
+            }
+        }
+        KnownApply( &known, pc, op );
+    }
+}
+
+
+/*
+// Compact
+//
+// Removes the marked words, and moves the branch targets, LOOP ends,
+// labels, and entry point to match
+//
+// void
+*/
+static void Compact( OPTSTATE *po )
+{
+    LABEL *pl;
+    uint  pc, m, op, target, end;
+
+    /* A removed word maps to the word that followed it */
+    for( pc=0, m=0; pc<po->Count; pc++ )
+    {
+        po->pMap[pc] = m;
+        if( !(po->pFlags[pc] & OPT_DELETE) )
+            m++;
+    }
+    po->pMap[po->Count] = m;
+
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        if( po->pFlags[pc] & OPT_DELETE )
+            continue;
+        m  = po->pMap[pc];
+        op = pCtx->ProgramImage[pc].CodeWord;
+        if( GetTarget( pc, op, &target ) && target<=po->Count )
+            SetTarget( m, &op, po->pMap[target] );
+        if( IsLoop( op ) )
+        {
+            end = pc + (op & 0xFF);
+            if( end<=po->Count )
+                op = (op & ~0xFF) | ((po->pMap[end] - m) & 0xFF);
+        }
+        pCtx->ProgramImage[m] = pCtx->ProgramImage[pc];
+        pCtx->ProgramImage[m].AddrOffset = m;
+        pCtx->ProgramImage[m].CodeWord   = op;
+    }
+
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+        if( pl->Offset>=0 && (uint)pl->Offset<=po->Count )
+            pl->Offset = po->pMap[pl->Offset];
+    if( pCtx->EntryPoint>=0 && (uint)pCtx->EntryPoint<=po->Count )
+        pCtx->EntryPoint = po->pMap[pCtx->EntryPoint];
+
+    pCtx->CodeOffset = po->Count - po->Removed;
+    memset( &pCtx->ProgramImage[pCtx->CodeOffset], 0, po->Removed*sizeof(CODEGEN) );
+}
+
+
+/*
+// CheckRun
+//
+// Runs the old and new code in the simulator from the same state, with
+// local memory zero or (fPattern) filled with a pseudo random pattern.
+// The new code must write the same outputs in the same order and stop
+// the same way. When the old code does not stop within the limit, the
+// outputs are compared up to where it got to.
+//
+// Returns 1 if the runs match, 0 if not
+*/
+static int CheckRun( uint *pOld, uint OldCount, uint OldEntry,
+                     uint *pNew, uint NewCount, uint NewEntry, int fPattern )
+{
+    PRUSIM a, b;
+    uint   i, seed = 1;
+    int    rc;
+
+    if( prusim_init( &a, pOld, OldCount, OldEntry ) < 0 )
+        return(0);
+    if( prusim_init( &b, pNew, NewCount, NewEntry ) < 0 )
+        { prusim_free( &a ); return(0); }
+
+    for( i=0; fPattern && i<PRUSIM_LOCAL_SIZE; i++ )
+    {
+        seed = seed*1103515245 + 12345;
+        a.pMem[i] = b.pMem[i] = (unsigned char)(seed>>16);
+    }
+
+    while( a.Instructions<OPT_CHECK_LIMIT && prusim_step( &a )==PRUSIM_RUNNING );
+    while( b.Writes<a.Writes && b.Instructions<OPT_CHECK_LIMIT &&
+           prusim_step( &b )==PRUSIM_RUNNING );
+    if( a.Status != PRUSIM_RUNNING )
+        while( b.Instructions<OPT_CHECK_LIMIT && prusim_step( &b )==PRUSIM_RUNNING );
+
+    rc = a.Status==b.Status && a.Writes==b.Writes && a.WriteHash==b.WriteHash &&
+         !memcmp( a.pMem, b.pMem, PRUSIM_LOCAL_SIZE );
+
+    prusim_free( &a );
+    prusim_free( &b );
+    return(rc);
+}
+
+
+/*
+// ReportLoops
+//
+// Prints the cycles saved on each pass of each loop in the old code,
+// counting one for each removed word and each jump a branch no longer
+// goes through
+//
+// void
+*/
+static void ReportLoops( OPTSTATE *po, LABEL **ppLabel, int *pOffset, uint LabelCount )
+{
+    OPTLOOP *pLoop;
+    uint    pc, op, target, end, k, cnt = 0;
+    char    top[LABEL_NAME_LEN+16], bottom[LABEL_NAME_LEN+16];
+
+    pLoop = malloc( (po->Count+1) * sizeof(OPTLOOP) );
+    if( !pLoop )
+        return;
+
+    for( pc=po->Start; pc<po->Count; pc++ )
+    {
+        op = po->pOld[pc];
+        if( IsLoop( op ) )
+        {
+            target = pc+1;
+            end = pc + (op & 0xFF) - 1;
+        }
+        else if( GetTarget( pc, op, &target ) && target<pc && target>=po->Start )
+            end = pc;
+        else
+            continue;
+
+        pLoop[cnt].Top    = target;
+        pLoop[cnt].Bottom = end;
+        pLoop[cnt].Saved  = 0;
+        for( k=target; k<=end && k<po->Count; k++ )
+            pLoop[cnt].Saved += ((po->pFlags[k] & OPT_DELETE) ? 1 : 0) + po->pHops[k];
+        if( pLoop[cnt].Saved )
+            cnt++;
+    }
+
+    qsort( pLoop, cnt, sizeof(OPTLOOP), CompareLoops );
+    for( k=0; k<cnt; k++ )
+    {
+        if( k && pLoop[k].Top==pLoop[k-1].Top && pLoop[k].Bottom==pLoop[k-1].Bottom )
+            continue;
+        printf("    loop %s..%s : up to %u cycle(s) saved per pass\n",
+               AddrName( ppLabel, pOffset, LabelCount, pLoop[k].Top, top ),
+               AddrName( ppLabel, pOffset, LabelCount, pLoop[k].Bottom, bottom ),
+               pLoop[k].Saved);
+    }
+    free( pLoop );
+}
+
+
+/*
+// AddrName
+//
+// Writes an address of the old code as "label" or "label+N", using the
+// label offsets from before the optimizer ran
+//
+// Returns buf
+*/
+static char *AddrName( LABEL **ppLabel, int *pOffset, uint LabelCount, uint addr, char *buf )
+{
+    uint i, best = LabelCount;
+
+    for( i=0; i<LabelCount; i++ )
+    {
+        if( pOffset[i]<0 || (uint)pOffset[i]>addr )
+            continue;
+        if( best==LabelCount || pOffset[i]>pOffset[best] ||
+            (pOffset[i]==pOffset[best] && strcmp( ppLabel[i]->Name, ppLabel[best]->Name )<0) )
+            best = i;
+    }
+    if( best==LabelCount )
+        sprintf( buf, "0x%04x", addr );
+    else if( (uint)pOffset[best]==addr )
+        sprintf( buf, "%s", ppLabel[best]->Name );
+    else
+        sprintf( buf, "%s+%u", ppLabel[best]->Name, addr-pOffset[best] );
+    return(buf);
+}
+
+
+/*
+// CompareLoops
+//
+// qsort() compare of loops by top, then bottom
+*/
+static int CompareLoops( const void *a, const void *b )
+{
+    const OPTLOOP *pa = a, *pb = b;
+
+    if( pa->Top != pb->Top )
+        return( pa->Top < pb->Top ? -1 : 1 );
+    if( pa->Bottom != pb->Bottom )
+        return( pa->Bottom < pb->Bottom ? -1 : 1 );
+    return(0);
+}
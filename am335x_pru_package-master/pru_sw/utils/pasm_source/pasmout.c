@@ -0,0 +1,572 @@
+/*
+ * pasmout.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmout.c
+//
+// Description:
+//     Code image output
+//         - Buffered writers to a file, stdout, or memory
+//         - Serializes the code image to all the requested formats
+//           (*_bin.h, *.img, *.dbg, *.bin, *.bib) in one sweep
+//
+//     The bytes written are the same as those of the original per word
+//     writers. Debug file fields are always little endian.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added buffered output writers
+//     18-Oct-26: 0.86 - Join the source directory and name with a '/'
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#endif
+#include <stdlib.h>
+#include "pasm.h"
+#include "pasmdbg.h"
+
+/* Local Macro Definitions */
+#define PROCESSOR_NAME_STRING ("PRU")
+#define MAXFILE               (256)     /* Max file length for output files */
+
+/* Output File Suffix and Option of each OUTFMT_xxx */
+static const struct {
+    char    *Suffix;
+    uint    Option;
+} OutFormat[OUTFMT_MAX] = {
+    { "_bin.h", OPTION_CARRAY },
+    { ".img",   OPTION_IMGFILE },
+    { ".dbg",   OPTION_DBGFILE },
+    { ".bin",   OPTION_BINARY },
+    { ".bib",   OPTION_BINARYBIG },
+};
+
+static const char HexDigit[] = "0123456789abcdef";
+
+/* Local Support Funtions */
+static int OutFlush( OUTWRITER *pw );
+static unsigned char *OutReserve( OUTWRITER *pw, uint Length );
+static void OutText( OUTWRITER *pw, const char *Text );
+static void OutLE32( OUTWRITER *pw, uint Word );
+static void OutName( OUTWRITER *pw, const char *Name );
+static void PutHex8( unsigned char *p, uint Word );
+static void DbgPrologue( OUTWRITER *pw );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// OutOpen
+//
+// Opens a writer on the file Path, on stdout when Path is "-", or on
+// memory when Path is 0
+//
+// Returns 1 on success, 0 on error
+*/
+int OutOpen( OUTWRITER *pw, char *Path )
+{
+    pw->pFile     = 0;
+    pw->pMem      = 0;
+    pw->MemLength = 0;
+    pw->MemSize   = 0;
+    pw->Used      = 0;
+    pw->Error     = 0;
+
+    if( !Path )
+        return(1);
+    if( !strcmp( Path, "-" ) )
+        pw->pFile = stdout;
+    else if( !(pw->pFile = fopen( Path, "wb" )) )
+        return(0);
+    return(1);
+}
+
+
+/*
+// OutWrite
+//
+// Adds data to a writer
+//
+// void
+*/
+void OutWrite( OUTWRITER *pw, const void *pData, uint Length )
+{
+    unsigned char *p;
+
+    /* Data larger than the buffer goes straight out */
+    if( Length > OUTWRITER_BUFFER )
+    {
+        if( !OutFlush(pw) )
+            return;
+        if( pw->pFile )
+        {
+            if( fwrite( pData, 1, Length, pw->pFile ) != Length )
+                pw->Error = 1;
+            return;
+        }
+    }
+    while( Length )
+    {
+        uint len = Length < OUTWRITER_BUFFER ? Length : OUTWRITER_BUFFER;
+
+        if( !(p = OutReserve( pw, len )) )
+            return;
+        memcpy( p, pData, len );
+        pData = (const unsigned char *)pData + len;
+        Length -= len;
+    }
+}
+
+
+/*
+// OutClose
+//
+// Writes out the buffered data and closes the writer. The file is not
+// closed when it is stdout. A memory writer leaves its data in pMem and
+// MemLength, to be freed by the caller.
+//
+// Returns 1 when all the data was written, 0 on error
+*/
+int OutClose( OUTWRITER *pw )
+{
+    OutFlush( pw );
+    if( pw->pFile && pw->pFile!=stdout )
+    {
+        if( fclose( pw->pFile ) )
+            pw->Error = 1;
+    }
+    else if( pw->pFile && fflush( pw->pFile ) )
+        pw->Error = 1;
+    pw->pFile = 0;
+    return( !pw->Error );
+}
+
+
+/*
+// ImageWrite
+//
+// Serializes the code image to each writer in ppWriter[OUTFMT_MAX] that
+// is set, in one sweep over the image. ArrayName names the C array (0
+// for the default name).
+//
+// Returns 1 on success, 0 on error
+*/
+int ImageWrite( OUTWRITER *ppWriter[OUTFMT_MAX], char *ArrayName )
+{
+    CODEGEN       *pc;
+    OUTWRITER     *pw;
+    unsigned char *p;
+    uint          word;
+    int           i, count = pCtx->CodeOffset;
+
+    if( count <= 0 )
+        return(0);
+
+    /* Headers */
+    if( (pw = ppWriter[OUTFMT_CARRAY]) != 0 )
+    {
+        char Line[EQUATE_DATA_LEN+320];
+
+        sprintf( Line, "\n\n"
+                "/* This file contains the %s instructions in a C array which are to  */\n"
+                "/* be downloaded from the host CPU to the %s instruction memory.     */\n"
+                "/* This file is generated by the %s assembler.                       */\n",
+                PROCESSOR_NAME_STRING, PROCESSOR_NAME_STRING, PROCESSOR_NAME_STRING);
+        OutText( pw, Line );
+        if( !ArrayName )
+            sprintf( Line, "\nconst unsigned int %scode[] =  {\n", PROCESSOR_NAME_STRING );
+        else
+            sprintf( Line, "\nconst unsigned int %.*s[] =  {\n", EQUATE_DATA_LEN, ArrayName );
+        OutText( pw, Line );
+    }
+    if( ppWriter[OUTFMT_DBG] )
+        DbgPrologue( ppWriter[OUTFMT_DBG] );
+
+    /* Code words */
+    for( i=0, pc=pCtx->ProgramImage; i<count; i++, pc++ )
+    {
+        word = pc->CodeWord;
+
+        if( (pw = ppWriter[OUTFMT_CARRAY]) != 0 && (p = OutReserve( pw, 17 )) != 0 )
+        {
+            /* "     0x%08x,\n", the last word is closed below */
+            memset( p, ' ', 5 );
+            p[5] = '0';
+            p[6] = 'x';
+            PutHex8( p+7, word );
+            p[15] = ',';
+            p[16] = '\n';
+            if( i == count-1 )
+                pw->Used -= 2;
+        }
+        if( (pw = ppWriter[OUTFMT_IMG]) != 0 && (p = OutReserve( pw, 9 )) != 0 )
+        {
+            PutHex8( p, word );
+            p[8] = '\n';
+        }
+        if( (pw = ppWriter[OUTFMT_DBG]) != 0 && (p = OutReserve( pw, 16 )) != 0 )
+        {
+            p[0]  = pc->Flags & (DBGFILE_CODE_FLG_FILEINFO|DBGFILE_CODE_FLG_CANMAP);
+            p[1]  = pc->Resv8;
+            p[2]  = (unsigned char)pc->FileIndex;
+            p[3]  = (unsigned char)(pc->FileIndex>>8);
+            p[4]  = (unsigned char)pc->Line;
+            p[5]  = (unsigned char)(pc->Line>>8);
+            p[6]  = (unsigned char)(pc->Line>>16);
+            p[7]  = (unsigned char)(pc->Line>>24);
+            p[8]  = (unsigned char)pc->AddrOffset;
+            p[9]  = (unsigned char)(pc->AddrOffset>>8);
+            p[10] = (unsigned char)(pc->AddrOffset>>16);
+            p[11] = (unsigned char)(pc->AddrOffset>>24);
+            p[12] = (unsigned char)word;
+            p[13] = (unsigned char)(word>>8);
+            p[14] = (unsigned char)(word>>16);
+            p[15] = (unsigned char)(word>>24);
+        }
+        if( (pw = ppWriter[OUTFMT_BIN]) != 0 && (p = OutReserve( pw, 4 )) != 0 )
+        {
+            p[0] = (unsigned char)word;
+            p[1] = (unsigned char)(word>>8);
+            p[2] = (unsigned char)(word>>16);
+            p[3] = (unsigned char)(word>>24);
+        }
+        if( (pw = ppWriter[OUTFMT_BIB]) != 0 && (p = OutReserve( pw, 4 )) != 0 )
+        {
+            p[0] = (unsigned char)(word>>24);
+            p[1] = (unsigned char)(word>>16);
+            p[2] = (unsigned char)(word>>8);
+            p[3] = (unsigned char)word;
+        }
+    }
+
+    /* Trailers */
+    if( ppWriter[OUTFMT_CARRAY] )
+        OutText( ppWriter[OUTFMT_CARRAY], " };\n\n" );
+
+    for( i=0; i<OUTFMT_MAX; i++ )
+        if( ppWriter[i] && ppWriter[i]->Error )
+            return(0);
+    return(1);
+}
+
+
+/*
+// OutputWrite
+//
+// Writes the code image files requested in the options. When outbase is
+// "-", the one requested format is written to stdout. ArrayName is as
+// for ImageWrite().
+//
+// Returns 1 on success, 0 on error
+*/
+int OutputWrite( char *outbase, char *ArrayName )
+{
+    OUTWRITER *ppWriter[OUTFMT_MAX];
+    char      Name[MAXFILE+8];
+    int       i, ret = 1;
+
+    if( strlen(outbase) > MAXFILE )
+        { Report(0,REP_ERROR,"Outfile name too long"); return(0); }
+
+    for( i=0; i<OUTFMT_MAX; i++ )
+    {
+        ppWriter[i] = 0;
+        if( !(pCtx->Options & OutFormat[i].Option) )
+            continue;
+
+        if( !strcmp( outbase, "-" ) )
+            strcpy( Name, "-" );
+        else
+        {
+            strcpy( Name, outbase );
+            strcat( Name, OutFormat[i].Suffix );
+        }
+        if( !(ppWriter[i] = malloc(sizeof(OUTWRITER))) )
+            { Report(0,REP_ERROR,"Memory allocation failed"); ret = 0; continue; }
+        if( !OutOpen( ppWriter[i], Name ) )
+        {
+            Report(0,REP_ERROR,"Unable to open output file: %s",Name);
+            free( ppWriter[i] );
+            ppWriter[i] = 0;
+            ret = 0;
+        }
+    }
+
+    ImageWrite( ppWriter, ArrayName );
+
+    for( i=0; i<OUTFMT_MAX; i++ )
+    {
+        if( !ppWriter[i] )
+            continue;
+        if( !OutClose( ppWriter[i] ) )
+            { Report(0,REP_ERROR,"File write error"); ret = 0; }
+        free( ppWriter[i] );
+    }
+    return(ret);
+}
+
+
+/*
+// OutSourceName
+//
+// Gets the name of a source file as the debug and object files record it:
+// the path it was opened by, or the bare name when the path does not fit
+// in DBGFILE_NAMELEN_SHORT characters
+//
+// void
+*/
+void OutSourceName( uint FileIndex, char *Name )
+{
+    SOURCEFILE *sf = &pCtx->sfArray[FileIndex];
+    uint len = strlen(sf->SourceBaseDir);
+
+    /* The base directory is as dirname() returns it, with no separator */
+    if( !len || !strcmp( sf->SourceBaseDir, "." ) || !strcmp( sf->SourceBaseDir, "./" ) ||
+        len+1+strlen(sf->SourceName) >= DBGFILE_NAMELEN_SHORT )
+        strcpy( Name, sf->SourceName );
+    else if( sf->SourceBaseDir[len-1]=='/' || sf->SourceBaseDir[len-1]=='\\' )
+        sprintf( Name, "%s%s", sf->SourceBaseDir, sf->SourceName );
+    else
+        sprintf( Name, "%s/%s", sf->SourceBaseDir, sf->SourceName );
+}
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// OutFlush
+//
+// Moves the buffered data to the file or memory
+//
+// Returns 1 on success, 0 on error
+*/
+static int OutFlush( OUTWRITER *pw )
+{
+    if( pw->Error )
+        return(0);
+    if( !pw->Used )
+        return(1);
+
+    if( pw->pFile )
+    {
+        if( fwrite( pw->Buffer, 1, pw->Used, pw->pFile ) != pw->Used )
+            pw->Error = 1;
+    }
+    else
+    {
+        if( pw->MemLength+pw->Used > pw->MemSize )
+        {
+            uint          size = pw->MemSize ? pw->MemSize*2 : OUTWRITER_BUFFER;
+            unsigned char *pMem;
+
+            while( size < pw->MemLength+pw->Used )
+                size *= 2;
+            if( !(pMem = realloc( pw->pMem, size )) )
+                { pw->Error = 1; return(0); }
+            pw->pMem    = pMem;
+            pw->MemSize = size;
+        }
+        memcpy( pw->pMem+pw->MemLength, pw->Buffer, pw->Used );
+        pw->MemLength += pw->Used;
+    }
+    pw->Used = 0;
+    return( !pw->Error );
+}
+
+
+/*
+// OutReserve
+//
+// Makes room for Length bytes (at most OUTWRITER_BUFFER) in the buffer
+//
+// Returns the place to store them on success, 0 on error
+*/
+static unsigned char *OutReserve( OUTWRITER *pw, uint Length )
+{
+    unsigned char *p;
+
+    if( pw->Used+Length > OUTWRITER_BUFFER && !OutFlush(pw) )
+        return(0);
+    p = pw->Buffer+pw->Used;
+    pw->Used += Length;
+    return(p);
+}
+
+
+/*
+// OutText
+//
+// Adds a string to a writer
+//
+// void
+*/
+static void OutText( OUTWRITER *pw, const char *Text )
+{
+    OutWrite( pw, Text, strlen(Text) );
+}
+
+
+/*
+// OutLE32
+//
+// Adds a little endian word to a writer
+//
+// void
+*/
+static void OutLE32( OUTWRITER *pw, uint Word )
+{
+    unsigned char *p;
+
+    if( (p = OutReserve( pw, 4 )) != 0 )
+    {
+        p[0] = (unsigned char)Word;
+        p[1] = (unsigned char)(Word>>8);
+        p[2] = (unsigned char)(Word>>16);
+        p[3] = (unsigned char)(Word>>24);
+    }
+}
+
+
+/*
+// OutName
+//
+// Adds a name as a fixed, zero filled debug file name field
+//
+// void
+*/
+static void OutName( OUTWRITER *pw, const char *Name )
+{
+    unsigned char *p;
+    uint          len = strlen(Name);
+
+    if( len > DBGFILE_NAMELEN_SHORT-1 )
+        len = DBGFILE_NAMELEN_SHORT-1;
+    if( (p = OutReserve( pw, DBGFILE_NAMELEN_SHORT )) != 0 )
+    {
+        memcpy( p, Name, len );
+        memset( p+len, 0, DBGFILE_NAMELEN_SHORT-len );
+    }
+}
+
+
+/*
+// PutHex8
+//
+// Stores a word as 8 lower case hex digits
+//
+// void
+*/
+static void PutHex8( unsigned char *p, uint Word )
+{
+    int i;
+
+    for( i=7; i>=0; i-- )
+    {
+        p[i] = HexDigit[Word & 0xf];
+        Word >>= 4;
+    }
+}
+
+
+/*
+// DbgPrologue
+//
+// Adds the debug file header, label records, and file records
+//
+// void
+*/
+static void DbgPrologue( OUTWRITER *pw )
+{
+    char  Name[DBGFILE_NAMELEN_SHORT];
+    LABEL *pLabel;
+    uint  off;
+    int   i;
+
+    off = sizeof(DBGFILE_HEADER);
+    OutLE32( pw, DBGFILE_FILEID_VER3 );
+    OutLE32( pw, pCtx->LabelCount );
+    OutLE32( pw, off );
+    off += pCtx->LabelCount*sizeof(DBGFILE_LABEL);
+    OutLE32( pw, pCtx->sfIndex );
+    OutLE32( pw, off );
+    off += pCtx->sfIndex*sizeof(DBGFILE_FILE);
+    OutLE32( pw, pCtx->CodeOffset );
+    OutLE32( pw, off );
+    OutLE32( pw, pCtx->EntryPoint );
+    OutLE32( pw, (pCtx->Options & OPTION_BIGENDIAN) ? DBGHDR_FLAGS_BIGENDIAN : 0 );
+
+    pLabel = pCtx->pLabelList;
+    for( i=0; i<pCtx->LabelCount; i++ )
+    {
+        if( !pLabel )
+        {
+            Report(0,REP_ERROR,"Fatal label tracking error");
+            OutLE32( pw, 0 );
+            OutName( pw, "" );
+            continue;
+        }
+        OutLE32( pw, pLabel->Offset );
+        OutName( pw, pLabel->Name );
+        pLabel = pLabel->pNext;
+    }
+
+    for( i=0; i<(int)pCtx->sfIndex; i++ )
+    {
+        OutSourceName( i, Name );
+        OutName( pw, Name );
+    }
+}
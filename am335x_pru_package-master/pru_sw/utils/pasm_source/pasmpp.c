@@ -60,6 +60,8 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     17-Oct-26: 0.86 - Added source text in memory and include resolver
+//     17-Oct-26: 0.86 - Source text can come from the front end
 ============================================================================*/
 
 #include <stdio.h>
@@ -110,6 +112,8 @@ static void reallocEQUATE( EQUATE * p, const size_t len )
 }
 
 /* Local Support Funtions */
+static SOURCEFILE *SourceFileAlloc( SOURCEFILE *pParent, char *filename,
+                                   char *SourceName, char *SourceBaseDir );
 static int ReadCharacter( SOURCEFILE *ps );
 static int GetTextLine( SOURCEFILE *ps, char *Dst, int MaxLen, int *pLength, int *pEOF );
 static int ParseSource( SOURCEFILE *ps, char *Src, char *Dst, int *pIdx, int MaxLen );
@@ -123,15 +127,6 @@ static int IfDefProcess( SOURCEFILE *ps, char *Src, int fTrue );
 static int ElseProcess( SOURCEFILE *ps, char *Src );
 static int EndifProcess( SOURCEFILE *ps, char *Src );
 
-int     OpenFiles=0;        /* Total number of open files */
-EQUATE  *pEqList=0;         /* List of installed equates */
-
-SOURCEFILE      sfArray[SOURCEFILE_MAX];
-unsigned int    sfIndex = 0;
-
-#define CC_MAX_DEPTH            8
-uint    ccDepth = 0;
-uint    ccStateFlags[CC_MAX_DEPTH];
 #define CCSTATEFLG_TRUE         1       // Currently accepting code
 #define CCSTATEFLG_ELSE         2       // Else has been used
 
@@ -154,12 +149,11 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
                             int use_include_path )
 {
     SOURCEFILE *ps;
-    int i;
     char SourceName[SOURCE_NAME];
     char SourceBaseDir[SOURCE_BASE_DIR];
 
     /* Put a reasonable cap on #include depth */
-    if( OpenFiles==15 )
+    if( pCtx->OpenFiles==15 )
     {
         Report(pParent,REP_FATAL,"Too many open files");
         return(0);
@@ -193,67 +187,76 @@ SOURCEFILE *InitSourceFile( SOURCEFILE *pParent, char *filename,
         goto FILEOP_ERROR;
     }
 
-    if( Options & OPTION_DEBUG )
+    if( pCtx->Options & OPTION_DEBUG )
         printf("Base source directory: '%s'\n",SourceBaseDir);
 
-    /*
-    // See if this file was used before, or allocate a new record
-    */
-    for( i=0; i<(int)sfIndex; i++ )
+    /* Get the file record */
+    if( !(ps=SourceFileAlloc(pParent, filename, SourceName, SourceBaseDir)) )
+        return(0);
+
+    /* Open the file, or get its text from the front end */
+    if( pCtx->pfnReadSource )
     {
-        if( !sfArray[i].InUse &&
-            !strcmp(SourceName, sfArray[i].SourceName) &&
-            !strcmp(SourceBaseDir, sfArray[i].SourceBaseDir) )
-            break;
+        if( pCtx->pfnReadSource( pCtx->pReadSourceArg, filename, &ps->pBuffer, &ps->BufferLength ) )
+        {
+            Report(pParent,REP_FATAL,"Can't open source file '%s'",filename);
+            goto FILEOP_ERROR;
+        }
     }
-
-    if( i<(int)sfIndex )
-        ps = &sfArray[i];
     else
     {
-        /* Allocate a new file */
-        if( sfIndex==SOURCEFILE_MAX )
-            { Report(pParent,REP_FATAL,"Max source files exceeded"); return(0); }
-
-        ps = &sfArray[sfIndex];
-        i = sfIndex++;
+        ps->FilePtr = fopen(filename,"rb");
+        if (!ps->FilePtr)
+        {
+            Report(pParent,REP_FATAL,"Can't open source file '%s'",filename);
+            goto FILEOP_ERROR;
+        }
     }
+    pCtx->OpenFiles++;
+    if( pCtx->OpenFiles > 10 )
+        Report(pParent,REP_WARN1,"%d open files - possible #include recursion",pCtx->OpenFiles);
+    return(ps);
 
-    /*
-    // Fill in file record
-    */
-    memset( ps, 0, sizeof(SOURCEFILE) );
-
-    if( Options & OPTION_DEBUG )
-        printf("New source file: '%s'\n",filename);
-
-    /* Init the base fields */
-    ps->pParent       = 0;
-    ps->LastChar      = 0;
-    ps->CurrentLine   = 1;
-    ps->CurrentColumn = 1;
-    ps->ccDepthIn     = ccDepth;
-    ps->InUse         = 1;
-    ps->FileIndex     = i;
+FILEOP_ERROR:
+    return(0);
+}
 
-    strcpy( ps->SourceName, SourceName );
-    strcpy( ps->SourceBaseDir, SourceBaseDir );
 
+/*
+// InitSourceBuffer
+//
+// Initializes all the fields in SOURCEFILE to read source text from
+// memory. The text must stay valid until the file is closed.
+//
+// Returns SOURCEFILE * on success, 0 on error
+*/
+SOURCEFILE *InitSourceBuffer( SOURCEFILE *pParent, char *name,
+                              const char *pText, uint Length )
+{
+    SOURCEFILE *ps;
 
-    /* Open the file */
-    ps->FilePtr = fopen(filename,"rb");
-    if (!ps->FilePtr)
+    /* Put a reasonable cap on #include depth */
+    if( pCtx->OpenFiles==15 )
     {
-        Report(pParent,REP_FATAL,"Can't open source file '%s'",filename);
-        goto FILEOP_ERROR;
+        Report(pParent,REP_FATAL,"Too many open files");
+        return(0);
     }
-    OpenFiles++;
-    if( OpenFiles > 10 )
-        Report(pParent,REP_WARN1,"%d open files - possible #include recursion",OpenFiles);
-    return(ps);
 
-FILEOP_ERROR:
-    return(0);
+    if( strlen(name) >= SOURCE_NAME )
+        { Report(pParent,REP_FATAL,"base filename too long in '%s'",name); return(0); }
+
+    /* Get the file record */
+    if( !(ps=SourceFileAlloc(pParent, name, name, "")) )
+        return(0);
+
+    ps->pBuffer      = pText;
+    ps->BufferLength = Length;
+    ps->BufferIndex  = 0;
+
+    pCtx->OpenFiles++;
+    if( pCtx->OpenFiles > 10 )
+        Report(pParent,REP_WARN1,"%d open files - possible #include recursion",pCtx->OpenFiles);
+    return(ps);
 }
 
 
@@ -266,9 +269,12 @@ FILEOP_ERROR:
 */
 void CloseSourceFile( SOURCEFILE *ps )
 {
-    OpenFiles--;
+    pCtx->OpenFiles--;
     ps->InUse = 0;
-    fclose( ps->FilePtr );
+    if( ps->FilePtr )
+        fclose( ps->FilePtr );
+    ps->FilePtr = 0;
+    ps->pBuffer = 0;
 }
 
 
@@ -302,7 +308,7 @@ NEXT_LINE:
 
     if( !len && eof )
     {
-        if( ps->ccDepthIn != ccDepth )
+        if( ps->ccDepthIn != pCtx->ccDepth )
             { Report(ps,REP_ERROR,"#endif mismatch in file"); _RETURN(0); }
         _RETURN(0);
     }
@@ -356,7 +362,7 @@ NEXT_LINE:
             goto NEXT_LINE;
         }
 
-        if( ccDepth && !(ccStateFlags[ccDepth-1]&CCSTATEFLG_TRUE) )
+        if( pCtx->ccDepth && !(pCtx->ccStateFlags[pCtx->ccDepth-1]&CCSTATEFLG_TRUE) )
             goto NEXT_LINE;
 
         if( !stricmp( word, "error" ) )
@@ -398,7 +404,7 @@ NEXT_LINE:
     // Not '#' directive, process as string
     */
 
-    if( ccDepth && !(ccStateFlags[ccDepth-1]&CCSTATEFLG_TRUE) )
+    if( pCtx->ccDepth && !(pCtx->ccStateFlags[pCtx->ccDepth-1]&CCSTATEFLG_TRUE) )
         goto NEXT_LINE;
 
     idx = 0;
@@ -419,9 +425,9 @@ NEXT_LINE:
 */
 void ppCleanup()
 {
-    ccDepth = 0;
-    while( pEqList )
-        EquateDestroy( pEqList );
+    pCtx->ccDepth = 0;
+    while( pCtx->pEqList )
+        EquateDestroy( pCtx->pEqList );
 }
 
 
@@ -455,15 +461,19 @@ int EquateCreate( SOURCEFILE *ps, char *Name, char *Value )
     strcpy( pd->name, Name );
     strcpy( pd->data, Value );
 
+    /* Index it by name */
+    if( SymInsert( SYMKIND_EQUATE, 0, pd->name, pd ) )
+        { freeEQUATE(pd); Report(ps,REP_ERROR,"Memory allocation failed"); return(-1); }
+
     /* Put this equate in the master list */
     pd->Busy  = 0;
     pd->pPrev = 0;
-    pd->pNext = pEqList;
-    if( pEqList )
-        pEqList->pPrev = pd;
-    pEqList   = pd;
+    pd->pNext = pCtx->pEqList;
+    if( pCtx->pEqList )
+        pCtx->pEqList->pPrev = pd;
+    pCtx->pEqList   = pd;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DEFINE : '%s' = '%s'\n",
                             ps->SourceName,ps->CurrentLine,pd->name,pd->data);
 
@@ -492,6 +502,67 @@ int CheckEquate( char *name )
 //
 ====================================================================*/
 
+/*
+// SourceFileAlloc
+//
+// Gets the record of a source file that was used before, or allocates a
+// new one, and initializes the base fields.
+//
+// Returns SOURCEFILE * on success, 0 on error
+*/
+static SOURCEFILE *SourceFileAlloc( SOURCEFILE *pParent, char *filename,
+                                   char *SourceName, char *SourceBaseDir )
+{
+    SOURCEFILE *ps;
+    int i;
+
+    /*
+    // See if this file was used before, or allocate a new record
+    */
+    for( i=0; i<(int)pCtx->sfIndex; i++ )
+    {
+        if( !pCtx->sfArray[i].InUse &&
+            !strcmp(SourceName, pCtx->sfArray[i].SourceName) &&
+            !strcmp(SourceBaseDir, pCtx->sfArray[i].SourceBaseDir) )
+            break;
+    }
+
+    if( i<(int)pCtx->sfIndex )
+        ps = &pCtx->sfArray[i];
+    else
+    {
+        /* Allocate a new file */
+        if( pCtx->sfIndex==SOURCEFILE_MAX )
+            { Report(pParent,REP_FATAL,"Max source files exceeded"); return(0); }
+
+        ps = &pCtx->sfArray[pCtx->sfIndex];
+        i = pCtx->sfIndex++;
+    }
+
+    /*
+    // Fill in file record
+    */
+    memset( ps, 0, sizeof(SOURCEFILE) );
+
+    if( pCtx->Options & OPTION_DEBUG )
+        printf("New source file: '%s'\n",filename);
+
+    /* Init the base fields */
+    ps->pParent       = 0;
+    ps->LastChar      = 0;
+    ps->CurrentLine   = 1;
+    ps->CurrentColumn = 1;
+    ps->ccDepthIn     = pCtx->ccDepth;
+    ps->InUse         = 1;
+    ps->FileIndex     = i;
+
+    strcpy( ps->SourceName, SourceName );
+    strcpy( ps->SourceBaseDir, SourceBaseDir );
+
+    return(ps);
+}
+
+
 /*
 // ReadCharacter
 //
@@ -505,9 +576,18 @@ static int ReadCharacter( SOURCEFILE *ps )
     char c;
 
 AGAIN:
-    i = fread( &c, 1, 1, ps->FilePtr );
-    if( i != 1 )
-        return(-1);
+    if( ps->pBuffer )
+    {
+        if( ps->BufferIndex >= ps->BufferLength )
+            return(-1);
+        c = ps->pBuffer[ps->BufferIndex++];
+    }
+    else
+    {
+        i = fread( &c, 1, 1, ps->FilePtr );
+        if( i != 1 )
+            return(-1);
+    }
     if( c == 0xd )
         goto AGAIN;
     if( ps->LastChar == 0xa )
@@ -837,8 +917,19 @@ static int LoadInclude( SOURCEFILE *ps, char *Src )
     if( idx == oldidx )
         { Report(ps,REP_ERROR,"Null filename in #include"); return(0); }
 
-    /* Open the new file */
-    if( !(psNew=InitSourceFile(ps, NewFileName, term == '>')) )
+    /* Open the new file, or get its text from the library caller */
+    if( pCtx->pfnInclude )
+    {
+        const char *pText;
+        uint       Length;
+
+        if( pCtx->pfnInclude( pCtx->pIncludeArg, NewFileName+oldidx, term == '>', &pText, &Length ) )
+            { Report(ps,REP_FATAL,"Can't open source file '%s'",NewFileName+oldidx); return(0); }
+        psNew = InitSourceBuffer(ps, NewFileName+oldidx, pText, Length);
+    }
+    else
+        psNew = InitSourceFile(ps, NewFileName, term == '>');
+    if( !psNew )
         return(0);
 
     /* Process the new file */
@@ -847,7 +938,7 @@ static int LoadInclude( SOURCEFILE *ps, char *Src )
     /* Free the file block */
     CloseSourceFile( psNew );
 
-    if( !rc && Pass==2 )
+    if( !rc && pCtx->Pass==2 )
         return(0);
     else
         return(1);
@@ -936,15 +1027,19 @@ static int EquateProcess( SOURCEFILE *ps, char *Src )
         Report(ps,REP_WARN1,"Redefinition of equate '%s'",pd->name);
     }
 
+    /* Index it by name */
+    if( SymInsert( SYMKIND_EQUATE, 0, pd->name, pd ) )
+        { Report(ps,REP_ERROR,"Memory allocation failed"); freeEQUATE(pd); return(0); }
+
     /* Put this equate in the master list */
     pd->Busy  = 0;
     pd->pPrev = 0;
-    pd->pNext = pEqList;
-    if( pEqList )
-        pEqList->pPrev = pd;
-    pEqList   = pd;
+    pd->pNext = pCtx->pEqList;
+    if( pCtx->pEqList )
+        pCtx->pEqList->pPrev = pd;
+    pCtx->pEqList   = pd;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DEFINE : '%s' = '%s'\n",
                             ps->SourceName,ps->CurrentLine,pd->name,pd->data);
 
@@ -1000,7 +1095,7 @@ static int UndefProcess( SOURCEFILE *ps, char *Src )
 
     EquateDestroy(pdTmp);
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : UNDEF  : '%s'\n",
                             ps->SourceName,ps->CurrentLine,name);
 
@@ -1017,16 +1112,7 @@ static int UndefProcess( SOURCEFILE *ps, char *Src )
 */
 static EQUATE *EquateFind( char *name )
 {
-    EQUATE *peq;
-
-    peq = pEqList;
-    while( peq )
-    {
-        if( !strcmp( name, peq->name ) )
-            break;
-        peq = peq->pNext;
-    }
-    return(peq);
+    return( (EQUATE *)SymLookup( SYMKIND_EQUATE, 0, name ) );
 }
 
 
@@ -1040,13 +1126,14 @@ static EQUATE *EquateFind( char *name )
 static void EquateDestroy( EQUATE *peq )
 {
     if( !peq->pPrev )
-        pEqList = peq->pNext;
+        pCtx->pEqList = peq->pNext;
     else
         peq->pPrev->pNext = peq->pNext;
 
     if( peq->pNext )
         peq->pNext->pPrev = peq->pPrev;
 
+    SymRemove( SYMKIND_EQUATE, 0, peq->name, peq );
     freeEQUATE(peq);
 }
 
@@ -1064,15 +1151,15 @@ static int IfDefProcess( SOURCEFILE *ps, char *Src, int fTrue )
     int  idx,srcIdx;
 
     /* Check depth */
-    if( ccDepth==CC_MAX_DEPTH )
+    if( pCtx->ccDepth==CC_MAX_DEPTH )
         { Report(ps,REP_ERROR,"Conditional nesting limit exceeded"); return(0); }
 
     /* If we are already in a false if, just create another false here to track nesting */
-    if( ccDepth && !(ccStateFlags[ccDepth-1]&CCSTATEFLG_TRUE) )
+    if( pCtx->ccDepth && !(pCtx->ccStateFlags[pCtx->ccDepth-1]&CCSTATEFLG_TRUE) )
     {
-        ccStateFlags[ccDepth++] = 0;
+        pCtx->ccStateFlags[pCtx->ccDepth++] = 0;
 
-        if( Pass==1 && (Options & OPTION_DEBUG) )
+        if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
             printf("%s(%5d) : IFDEF  : <skipped>\n",ps->SourceName,ps->CurrentLine);
 
         return(1);
@@ -1107,26 +1194,26 @@ static int IfDefProcess( SOURCEFILE *ps, char *Src, int fTrue )
     }
     name[idx]=0;
 
-    ccStateFlags[ccDepth] = 0;
+    pCtx->ccStateFlags[pCtx->ccDepth] = 0;
 
     /* Check for dedefinition */
     if( EquateFind(name) )
-        ccStateFlags[ccDepth] = CCSTATEFLG_TRUE;
+        pCtx->ccStateFlags[pCtx->ccDepth] = CCSTATEFLG_TRUE;
 
     /* Toggle the state for ifndef */
     if( !fTrue )
-        ccStateFlags[ccDepth] ^= CCSTATEFLG_TRUE;
+        pCtx->ccStateFlags[pCtx->ccDepth] ^= CCSTATEFLG_TRUE;
 
-    ccDepth++;
+    pCtx->ccDepth++;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
     {
         if( fTrue )
             printf("%s(%5d) : IFDEF  : '%s' (Result=%d)\n",
-                                ps->SourceName,ps->CurrentLine,name,ccStateFlags[ccDepth-1]);
+                                ps->SourceName,ps->CurrentLine,name,pCtx->ccStateFlags[pCtx->ccDepth-1]);
         else
             printf("%s(%5d) : IFNDEF : '%s' (Result=%d)\n",
-                                ps->SourceName,ps->CurrentLine,name,ccStateFlags[ccDepth-1]);
+                                ps->SourceName,ps->CurrentLine,name,pCtx->ccStateFlags[pCtx->ccDepth-1]);
     }
 
     return(1);
@@ -1148,23 +1235,23 @@ static int ElseProcess( SOURCEFILE *ps, char *Src )
         { Report(ps,REP_ERROR,"Unexpected additional characters on line"); return(0); }
 
     /* Make sure #else is legal here */
-    if( !ccDepth || (ccStateFlags[ccDepth-1]&CCSTATEFLG_ELSE) )
+    if( !pCtx->ccDepth || (pCtx->ccStateFlags[pCtx->ccDepth-1]&CCSTATEFLG_ELSE) )
         { Report(ps,REP_ERROR,"Multiple #else or use without corresponding #if"); return(0); }
 
     /* Mark it as used */
-    ccStateFlags[ccDepth-1] |= CCSTATEFLG_ELSE;
+    pCtx->ccStateFlags[pCtx->ccDepth-1] |= CCSTATEFLG_ELSE;
 
     /* Toggle the TRUE state */
-    ccStateFlags[ccDepth-1] ^= CCSTATEFLG_TRUE;
+    pCtx->ccStateFlags[pCtx->ccDepth-1] ^= CCSTATEFLG_TRUE;
 
     /* If we are already in a nested false if, keep expession false */
-    for( i=0; i<(int)(ccDepth-1); i++ )
-        if( !(ccStateFlags[i]&CCSTATEFLG_TRUE) )
-            ccStateFlags[ccDepth-1] &= ~CCSTATEFLG_TRUE;
+    for( i=0; i<(int)(pCtx->ccDepth-1); i++ )
+        if( !(pCtx->ccStateFlags[i]&CCSTATEFLG_TRUE) )
+            pCtx->ccStateFlags[pCtx->ccDepth-1] &= ~CCSTATEFLG_TRUE;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : ELSE   : (Result=%d)\n",
-                            ps->SourceName,ps->CurrentLine,ccStateFlags[ccDepth-1]&CCSTATEFLG_TRUE);
+                            ps->SourceName,ps->CurrentLine,pCtx->ccStateFlags[pCtx->ccDepth-1]&CCSTATEFLG_TRUE);
 
     return(1);
 }
@@ -1183,12 +1270,12 @@ static int EndifProcess( SOURCEFILE *ps, char *Src )
         { Report(ps,REP_ERROR,"Unexpected additional characters on line"); return(0); }
 
     /* Make sure #else is legal here */
-    if( !ccDepth  )
+    if( !pCtx->ccDepth  )
         { Report(ps,REP_ERROR,"#endif without corresponding #if"); return(0); }
 
-    ccDepth--;
+    pCtx->ccDepth--;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : ENDIF  :\n",
                             ps->SourceName,ps->CurrentLine);
 
@@ -54,6 +54,7 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     17-Oct-26: 0.86 - Struct parameters are only copied when rewritten
 ============================================================================*/
 
 #include <stdio.h>
@@ -116,8 +117,8 @@ static STRUCT *StructCreate( SOURCEFILE *ps, char *Name );
 static void StructDestroy( STRUCT *pst );
 static int GetRegname( SOURCEFILE *ps, uint element, char *str, uint off, uint size );
 static ASSIGN *AssignFind( char *Name );
-static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name );
-static void AssignDestroy( ASSIGN **pList, ASSIGN *pas );
+static ASSIGN *AssignCreate( SOURCEFILE *ps, SCOPE *psc, char *Name );
+static void AssignDestroy( SCOPE *psc, ASSIGN *pas );
 static char *StructNameCheck( char *source );
 static int StructValueOperand( char *source, int CmdType, uint *pValue );
 #define SVO_SIZEOF  0
@@ -130,12 +131,8 @@ static void ScopeClose( SCOPE *psc );
 static SCOPE *ScopeFind( char *Name );
 
 
-/* Local structure lists */
-STRUCT *pStructList=0;      /* List of declared structs */
-STRUCT *pStructCurrent=0;
+/* The structure and scope lists are kept in the assembler context (pasm.h) */
 
-SCOPE  *pScopeList=0;       /* List of desclared scopes */
-SCOPE  *pScopeCurrent=0;
 
 /*===================================================================
 //
@@ -152,7 +149,7 @@ SCOPE  *pScopeCurrent=0;
 */
 int ScopeEnter( SOURCEFILE *ps, char *Name )
 {
-    if( Core == CORE_V0 )
+    if( pCtx->Core == CORE_V0 )
         { Report(ps,REP_ERROR,".enter illegal with specified core version"); return(-1); }
     if( !ScopeCreate(ps, Name) )
         return(-1);
@@ -198,7 +195,7 @@ int ScopeUsing( SOURCEFILE *ps, char *Name )
     if( psc->Flags&SCOPE_FLG_OPEN )
         { Report(ps,REP_ERROR,"Scope is already open"); return(-1); }
     psc->Flags |= SCOPE_FLG_OPEN;
-    pScopeCurrent = psc;
+    pCtx->pScopeCurrent = psc;
     return(0);
 }
 
@@ -221,10 +218,10 @@ void StructInit()
 */
 void StructCleanup()
 {
-    while( pScopeList )
-        ScopeDestroy( pScopeList );
-    while( pStructList )
-        StructDestroy( pStructList );
+    while( pCtx->pScopeList )
+        ScopeDestroy( pCtx->pScopeList );
+    while( pCtx->pStructList )
+        StructDestroy( pCtx->pStructList );
 }
 
 
@@ -237,12 +234,12 @@ void StructCleanup()
 */
 int StructNew( SOURCEFILE *ps, char *Name )
 {
-    if( pStructCurrent )
+    if( pCtx->pStructCurrent )
         { Report(ps,REP_ERROR,"Structure can not be nested"); return(-1); }
-    if( Core == CORE_V0 )
+    if( pCtx->Core == CORE_V0 )
         { Report(ps,REP_ERROR,".struct illegal with specified core version"); return(-1); }
-    pStructCurrent=StructCreate(ps, Name);
-    if( !pStructCurrent )
+    pCtx->pStructCurrent=StructCreate(ps, Name);
+    if( !pCtx->pStructCurrent )
         return(-1);
     return(0);
 }
@@ -257,11 +254,11 @@ int StructNew( SOURCEFILE *ps, char *Name )
 */
 int StructEnd(SOURCEFILE *ps)
 {
-    if( !pStructCurrent )
+    if( !pCtx->pStructCurrent )
         { Report(ps,REP_ERROR,"Structure .struct/.ends mismatch"); return(-1); }
-    if( !pStructCurrent->Elements )
-        { Report(ps,REP_ERROR,"Structure must have at least 1 element"); pStructCurrent=0; return(-1); }
-    pStructCurrent = 0;
+    if( !pCtx->pStructCurrent->Elements )
+        { Report(ps,REP_ERROR,"Structure must have at least 1 element"); pCtx->pStructCurrent=0; return(-1); }
+    pCtx->pStructCurrent = 0;
     return(0);
 }
 
@@ -275,7 +272,7 @@ int StructEnd(SOURCEFILE *ps)
 */
 int StructAddElement( SOURCEFILE *ps, char *Name, uint size )
 {
-    STRUCT *pst = pStructCurrent;
+    STRUCT *pst = pCtx->pStructCurrent;
     int i;
 
     if( !pst )
@@ -306,7 +303,7 @@ int StructAddElement( SOURCEFILE *ps, char *Name, uint size )
     pst->Size[pst->Elements] = size;
     pst->TotalSize += size;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Element '%s' declared, offset=%d, size=%d\n",
                             ps->SourceName,ps->CurrentLine,pst->ElemName[pst->Elements],
                             pst->Offset[pst->Elements],pst->Size[pst->Elements]);
@@ -334,9 +331,9 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
     uint     startOff,endOff,tmp,rangeCheck;
     int      i;
 
-    if( pStructCurrent )
+    if( pCtx->pStructCurrent )
         { Report(ps,REP_ERROR,"Cannot assign while defining a structure"); return(-1); }
-    if( !pScopeCurrent )
+    if( !pCtx->pScopeCurrent )
         { Report(ps,REP_ERROR,"Cannot assign outside of a scope"); return(-1); }
 
     if( strcmp( reName, "*" ) )
@@ -356,7 +353,7 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
         { Report(ps,REP_ERROR,"Structure '%s' not defined",structName); return(-1); }
 
 
-    if( !(Options & OPTION_BIGENDIAN) )
+    if( !(pCtx->Options & OPTION_BIGENDIAN) )
     {
         /*
         // ** Little Endian Version **
@@ -484,7 +481,7 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
         tmp += pst->Size[i];
     }
 
-    if( !(pas = AssignCreate( ps, &pScopeCurrent->pAssignList, defName )) )
+    if( !(pas = AssignCreate( ps, pCtx->pScopeCurrent, defName )) )
         return(-1);
 
     pas->Elements = pst->Elements;
@@ -517,21 +514,23 @@ int StructAssign( SOURCEFILE *ps, char *structName, char *rsName,
 // operations. When found, the structure definition is used to substitute
 // in the proper register or numeric value.
 //
-// The string 'source' is assumed to be be able to hold a length of
-// at least 'TOKEN_MAX_LEN' bytes.
+// The rewritten argument is written to 'dest', which must be able to
+// hold 'TOKEN_MAX_LEN' bytes. It is only written when something was
+// substituted.
 //
-// Returns 0 for OK, or -1 for Fatal Error
+// Returns 1 if rewritten, 0 if unchanged, or -1 for Fatal Error
 //
 */
-int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source )
+int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source, char *dest )
 {
     char substr[TOKEN_MAX_LEN*2];
     int  subidx,srcidx;
     char tmpname[STRUCT_NAME_LEN],*pNewName;
-    int i,j,onedot;
+    int i,j,onedot,changed;
 
     srcidx=0;
     subidx=0;
+    changed=0;
     while(source[srcidx])
     {
         /* Scan past any number constants */
@@ -618,6 +617,7 @@ int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source )
                 sprintf(tmpname," %d ",value);
                 for( i=0; tmpname[i]; i++ )
                     substr[subidx++] = tmpname[i];
+                changed=1;
             }
             else
             {
@@ -635,6 +635,7 @@ int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source )
                     srcidx += i;
                     while( *pNewName )
                         substr[subidx++] = *pNewName++;
+                    changed=1;
                 }
 
                 /* Any more '.' are just register field modifiers */
@@ -648,12 +649,14 @@ int StructParamProcess( SOURCEFILE *ps, int ParamIdx, char *source )
             }
         }
     }
+    if( !changed )
+        return(0);
     substr[subidx++] = 0;
     if( subidx >= TOKEN_MAX_LEN )
         return -1;
-    strcpy( source, substr );
+    strcpy( dest, substr );
 
-    return(0);
+    return(1);
 }
 
 
@@ -687,16 +690,7 @@ int CheckStruct( char *name )
 */
 static STRUCT *StructFind( char *Name )
 {
-    STRUCT *pst;
-
-    pst = pStructList;
-    while( pst )
-    {
-        if( !strcmp( Name, pst->Name ) )
-            break;
-        pst = pst->pNext;
-    }
-    return(pst);
+    return( (STRUCT *)SymLookup( SYMKIND_STRUCT, 0, Name ) );
 }
 
 
@@ -728,12 +722,16 @@ static STRUCT *StructCreate( SOURCEFILE *ps, char *Name )
     pst->Elements  = 0;
     pst->TotalSize = 0;
 
+    /* Index it by name */
+    if( SymInsert( SYMKIND_STRUCT, 0, pst->Name, pst ) )
+        { free(pst); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     /* Put this equate in the master list */
     pst->pPrev  = 0;
-    pst->pNext  = pStructList;
-    pStructList = pst;
+    pst->pNext  = pCtx->pStructList;
+    pCtx->pStructList = pst;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Structure '%s' declared\n",
                             ps->SourceName,ps->CurrentLine,pst->Name);
 
@@ -751,13 +749,14 @@ static STRUCT *StructCreate( SOURCEFILE *ps, char *Name )
 static void StructDestroy( STRUCT *pst )
 {
     if( !pst->pPrev )
-        pStructList = pst->pNext;
+        pCtx->pStructList = pst->pNext;
     else
         pst->pPrev->pNext = pst->pNext;
 
     if( pst->pNext )
         pst->pNext->pPrev = pst->pPrev;
 
+    SymRemove( SYMKIND_STRUCT, 0, pst->Name, pst );
     free(pst);
 }
 
@@ -775,7 +774,7 @@ static int GetRegname( SOURCEFILE *ps, uint element, char *str, uint off, uint s
     if( ((off%4)+size) > 4 )
         { Report(ps,REP_ERROR,"Register alignment error on element %d",element); return(-1); }
 
-    if( !(Options & OPTION_BIGENDIAN) )
+    if( !(pCtx->Options & OPTION_BIGENDIAN) )
     {
         /*
         // ** Little Endian Version **
@@ -807,6 +806,7 @@ static int GetRegname( SOURCEFILE *ps, uint element, char *str, uint off, uint s
 // AssignFind
 //
 // Searches for an assignment record by name. If found, returns the record pointer.
+// Each open scope is searched in turn, most recently declared first.
 //
 // Returns STRUCT * on success, 0 on error
 */
@@ -815,18 +815,14 @@ static ASSIGN *AssignFind( char *Name )
     SCOPE  *psc;
     ASSIGN *pas;
 
-    psc = pScopeList;
+    psc = pCtx->pScopeList;
     while( psc )
     {
         if( psc->Flags&SCOPE_FLG_OPEN )
         {
-            pas = psc->pAssignList;
-            while( pas )
-            {
-                if( !strcmp( Name, pas->Name ) )
-                    return(pas);
-                pas = pas->pNext;
-            }
+            pas = SymLookup( SYMKIND_ASSIGN, psc, Name );
+            if( pas )
+                return(pas);
         }
         psc = psc->pNext;
     }
@@ -841,7 +837,7 @@ static ASSIGN *AssignFind( char *Name )
 //
 // Returns STRUCT * on success, 0 on error
 */
-static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
+static ASSIGN *AssignCreate( SOURCEFILE *ps, SCOPE *psc, char *Name )
 {
     ASSIGN *pas;
 
@@ -860,12 +856,16 @@ static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
 
     strcpy( pas->Name, Name );
 
+    /* Index it by scope and name */
+    if( SymInsert( SYMKIND_ASSIGN, psc, pas->Name, pas ) )
+        { free(pas); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     /* Put this equate in the master list */
     pas->pPrev  = 0;
-    pas->pNext  = *pList;
-    *pList = pas;
+    pas->pNext  = psc->pAssignList;
+    psc->pAssignList = pas;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
         printf("%s(%5d) : DOTCMD : Assignment '%s' declared\n",
                             ps->SourceName,ps->CurrentLine,pas->Name);
 
@@ -880,16 +880,17 @@ static ASSIGN *AssignCreate( SOURCEFILE *ps, ASSIGN **pList, char *Name )
 //
 // void
 */
-static void AssignDestroy( ASSIGN **pList, ASSIGN *pas )
+static void AssignDestroy( SCOPE *psc, ASSIGN *pas )
 {
     if( !pas->pPrev )
-        *pList = pas->pNext;
+        psc->pAssignList = pas->pNext;
     else
         pas->pPrev->pNext = pas->pNext;
 
     if( pas->pNext )
         pas->pNext->pPrev = pas->pPrev;
 
+    SymRemove( SYMKIND_ASSIGN, psc, pas->Name, pas );
     free(pas);
 }
 
@@ -1122,14 +1123,14 @@ static int GetFinalOffset( char *ext, uint Size, uint Offset, uint *pValue )
     case 'B':
         if( (val+1)>Size )
             return -1;
-        if( Options & OPTION_BIGENDIAN )
+        if( pCtx->Options & OPTION_BIGENDIAN )
             val = Size-val-1;
         *pValue = Offset+val;
         return(0);
     case 'W':
         if( (val+2)>Size )
             return -1;
-        if( Options & OPTION_BIGENDIAN )
+        if( pCtx->Options & OPTION_BIGENDIAN )
             val = Size-val-2;
         *pValue = Offset+val;
         return(0);
@@ -1164,16 +1165,20 @@ static SCOPE *ScopeCreate( SOURCEFILE *ps, char *Name )
 
     strcpy( psc->Name, Name );
     psc->Flags = SCOPE_FLG_OPEN;
-    psc->pParent = pScopeCurrent;
+    psc->pParent = pCtx->pScopeCurrent;
     psc->pAssignList = 0;
 
+    /* Index it by name */
+    if( SymInsert( SYMKIND_SCOPE, 0, psc->Name, psc ) )
+        { free(psc); Report(ps,REP_ERROR,"Memory allocation failed"); return(0); }
+
     /* Put this equate in the master list */
     psc->pPrev = 0;
-    psc->pNext = pScopeList;
-    pScopeList = psc;
-    pScopeCurrent = psc;
+    psc->pNext = pCtx->pScopeList;
+    pCtx->pScopeList = psc;
+    pCtx->pScopeCurrent = psc;
 
-    if( Pass==1 && (Options & OPTION_DEBUG) )
+    if( pCtx->Pass==1 && (pCtx->Options & OPTION_DEBUG) )
     {
         if(ps)
             printf("%s(%5d) : ",ps->SourceName,ps->CurrentLine);
@@ -1197,16 +1202,17 @@ static void ScopeDestroy( SCOPE *psc )
         ScopeClose( psc );
 
     while( psc->pAssignList )
-        AssignDestroy( &psc->pAssignList, psc->pAssignList );
+        AssignDestroy( psc, psc->pAssignList );
 
     if( !psc->pPrev )
-        pScopeList = psc->pNext;
+        pCtx->pScopeList = psc->pNext;
     else
         psc->pPrev->pNext = psc->pNext;
 
     if( psc->pNext )
         psc->pNext->pPrev = psc->pPrev;
 
+    SymRemove( SYMKIND_SCOPE, 0, psc->Name, psc );
     free(psc);
 }
 
@@ -1222,8 +1228,8 @@ static void ScopeClose( SCOPE *psc )
 {
     psc->Flags &= ~SCOPE_FLG_OPEN;
 
-    while( pScopeCurrent && !(pScopeCurrent->Flags&SCOPE_FLG_OPEN) )
-        pScopeCurrent = pScopeCurrent->pParent;
+    while( pCtx->pScopeCurrent && !(pCtx->pScopeCurrent->Flags&SCOPE_FLG_OPEN) )
+        pCtx->pScopeCurrent = pCtx->pScopeCurrent->pParent;
 }
 
 
@@ -1236,16 +1242,7 @@ static void ScopeClose( SCOPE *psc )
 */
 static SCOPE *ScopeFind( char *Name )
 {
-    SCOPE *psc;
-
-    psc = pScopeList;
-    while( psc )
-    {
-        if( !strcmp( Name, psc->Name ) )
-            break;
-        psc = psc->pNext;
-    }
-    return(psc);
+    return( (SCOPE *)SymLookup( SYMKIND_SCOPE, 0, Name ) );
 }
 
 
@@ -0,0 +1,435 @@
+/*
+ * pasmsym.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmsym.c
+//
+// Description:
+//     Shared symbol table
+//         - Interned symbol names
+//         - Hash index of labels, equates, macros, structs, scopes,
+//           and assignments, one namespace per symbol kind
+//
+//     The records themselves are still owned (and listed) by the module
+//     that creates them. This table only indexes them by name so that
+//     lookups do not have to walk the lists.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added hashed symbol table
+//     17-Oct-26: 0.86 - Added keyword token IDs
+//     18-Oct-26: 0.86 - Keywords moved to the name tables (pasmhash.c)
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "pasm.h"
+
+/* Local Structure Types */
+
+/* Interned Name Record */
+typedef struct _SYMNAME {
+    struct _SYMNAME *pHashNext;     /* Next in hash chain */
+    uint            Hash;           /* Hash of the name text */
+    char            Text[1];        /* Name text (allocated to length) */
+} SYMNAME;
+
+/* Symbol Record */
+typedef struct _SYMBOL {
+    struct _SYMBOL  *pHashNext;     /* Next in hash chain */
+    uint            Hash;           /* Hash of name and scope */
+    SYMNAME         *pName;         /* Interned name */
+    void            *pScope;        /* Owning scope (or 0) */
+    void            *pData;         /* Record owned by the caller */
+} SYMBOL;
+
+/* Hash Table (SYMTABLE is in pasm.h) */
+#define SYM_HASH_INITIAL    256     /* Must be a power of 2 */
+
+
+/* Local Support Funtions */
+static uint SymHashText( char *Name );
+static uint SymHashScope( uint Hash, void *pScope );
+static SYMNAME *SymNameFind( char *Name, uint Hash );
+static SYMNAME *SymNameCreate( char *Name );
+static int SymTableGrow( SYMTABLE *pt, int fName );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// SymIntern
+//
+// Returns the unique copy of the supplied name, creating it if needed.
+// Interned names are kept until SymCleanup().
+//
+// Returns char * on success, 0 on error
+*/
+char *SymIntern( char *Name )
+{
+    SYMNAME *pn;
+
+    pn = SymNameCreate(Name);
+    if( !pn )
+        return(0);
+    return(pn->Text);
+}
+
+
+/*
+// SymInsert
+//
+// Indexes a record under the supplied kind, scope, and name. A record
+// inserted later hides an earlier one with the same key until removed.
+//
+// Returns 0 on success, -1 on error
+*/
+int SymInsert( int Kind, void *pScope, char *Name, void *pData )
+{
+    SYMTABLE *pt = &pCtx->KindTable[Kind];
+    SYMNAME  *pn;
+    SYMBOL   *psym;
+    uint     idx;
+
+    pn = SymNameCreate(Name);
+    if( !pn )
+        return(-1);
+
+    if( pt->Count >= pt->Size && !SymTableGrow(pt,0) )
+        return(-1);
+
+    psym = malloc(sizeof(SYMBOL));
+    if( !psym )
+        return(-1);
+
+    psym->pName  = pn;
+    psym->pScope = pScope;
+    psym->pData  = pData;
+    psym->Hash   = SymHashScope(pn->Hash, pScope);
+
+    idx = psym->Hash & (pt->Size-1);
+    psym->pHashNext = pt->pBucket[idx];
+    pt->pBucket[idx] = psym;
+    pt->Count++;
+
+    return(0);
+}
+
+
+/*
+// SymLookup
+//
+// Searches for a record by kind, scope, and name.
+//
+// Returns the record pointer on success, 0 if not found
+*/
+void *SymLookup( int Kind, void *pScope, char *Name )
+{
+    SYMTABLE *pt = &pCtx->KindTable[Kind];
+    SYMNAME  *pn;
+    SYMBOL   *psym;
+    uint     hash;
+
+    if( !pt->Count )
+        return(0);
+
+    /* A name that was never interned can not be in any namespace */
+    pn = SymNameFind(Name, SymHashText(Name));
+    if( !pn )
+        return(0);
+
+    hash = SymHashScope(pn->Hash, pScope);
+    psym = pt->pBucket[hash & (pt->Size-1)];
+    while( psym )
+    {
+        if( psym->pName==pn && psym->pScope==pScope )
+            return(psym->pData);
+        psym = psym->pHashNext;
+    }
+    return(0);
+}
+
+
+/*
+// SymRemove
+//
+// Removes the index entry for the supplied record.
+//
+// void
+*/
+void SymRemove( int Kind, void *pScope, char *Name, void *pData )
+{
+    SYMTABLE *pt = &pCtx->KindTable[Kind];
+    SYMNAME  *pn;
+    SYMBOL   *psym, **ppsym;
+    uint     hash;
+
+    if( !pt->Count )
+        return;
+
+    pn = SymNameFind(Name, SymHashText(Name));
+    if( !pn )
+        return;
+
+    hash = SymHashScope(pn->Hash, pScope);
+    ppsym = (SYMBOL **)&pt->pBucket[hash & (pt->Size-1)];
+    while( (psym = *ppsym) != 0 )
+    {
+        if( psym->pData==pData && psym->pName==pn && psym->pScope==pScope )
+        {
+            *ppsym = psym->pHashNext;
+            pt->Count--;
+            free(psym);
+            return;
+        }
+        ppsym = &psym->pHashNext;
+    }
+}
+
+
+/*
+// SymCleanup
+//
+// Frees all index entries and interned names. The caller must have
+// destroyed the indexed records first.
+//
+// void
+*/
+void SymCleanup()
+{
+    SYMNAME *pn;
+    SYMBOL  *psym;
+    uint    i, k;
+
+    for( k=0; k<SYMKIND_MAX; k++ )
+    {
+        for( i=0; i<pCtx->KindTable[k].Size; i++ )
+        {
+            while( (psym = pCtx->KindTable[k].pBucket[i]) != 0 )
+            {
+                pCtx->KindTable[k].pBucket[i] = psym->pHashNext;
+                free(psym);
+            }
+        }
+        free(pCtx->KindTable[k].pBucket);
+        memset( &pCtx->KindTable[k], 0, sizeof(SYMTABLE) );
+    }
+
+    for( i=0; i<pCtx->NameTable.Size; i++ )
+    {
+        while( (pn = pCtx->NameTable.pBucket[i]) != 0 )
+        {
+            pCtx->NameTable.pBucket[i] = pn->pHashNext;
+            free(pn);
+        }
+    }
+    free(pCtx->NameTable.pBucket);
+    memset( &pCtx->NameTable, 0, sizeof(SYMTABLE) );
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// SymHashText
+//
+// Returns the FNV-1a hash of a name
+*/
+static uint SymHashText( char *Name )
+{
+    uint hash = 2166136261u;
+
+    while( *Name )
+    {
+        hash ^= (unsigned char)*Name++;
+        hash *= 16777619u;
+    }
+    return(hash);
+}
+
+
+/*
+// SymHashScope
+//
+// Mixes the scope pointer into a name hash
+*/
+static uint SymHashScope( uint Hash, void *pScope )
+{
+    return( Hash ^ ((uint)((size_t)pScope >> 4) * 2654435761u) );
+}
+
+
+/*
+// SymNameFind
+//
+// Searches for an interned name
+//
+// Returns SYMNAME * on success, 0 if not found
+*/
+static SYMNAME *SymNameFind( char *Name, uint Hash )
+{
+    SYMNAME *pn;
+
+    if( !pCtx->NameTable.Count )
+        return(0);
+
+    pn = pCtx->NameTable.pBucket[Hash & (pCtx->NameTable.Size-1)];
+    while( pn )
+    {
+        if( pn->Hash==Hash && !strcmp( Name, pn->Text ) )
+            break;
+        pn = pn->pHashNext;
+    }
+    return(pn);
+}
+
+
+/*
+// SymNameCreate
+//
+// Searches for an interned name, creating it if not found
+//
+// Returns SYMNAME * on success, 0 on error
+*/
+static SYMNAME *SymNameCreate( char *Name )
+{
+    SYMNAME *pn;
+    uint    hash, len;
+
+    hash = SymHashText(Name);
+    pn = SymNameFind(Name, hash);
+    if( pn )
+        return(pn);
+
+    if( pCtx->NameTable.Count >= pCtx->NameTable.Size && !SymTableGrow(&pCtx->NameTable,1) )
+        return(0);
+
+    len = strlen(Name);
+    pn = malloc(sizeof(SYMNAME)+len);
+    if( !pn )
+        return(0);
+    memcpy( pn->Text, Name, len+1 );
+    pn->Hash = hash;
+
+    pn->pHashNext = pCtx->NameTable.pBucket[hash & (pCtx->NameTable.Size-1)];
+    pCtx->NameTable.pBucket[hash & (pCtx->NameTable.Size-1)] = pn;
+    pCtx->NameTable.Count++;
+
+    return(pn);
+}
+
+
+/*
+// SymTableGrow
+//
+// Doubles the bucket count of a table and rehashes its entries.
+// Set fName when the table holds SYMNAME records.
+//
+// Returns 1 on success, 0 on error
+*/
+static int SymTableGrow( SYMTABLE *pt, int fName )
+{
+    void **pBucket;
+    uint newSize, i, idx;
+
+    newSize = pt->Size ? pt->Size*2 : SYM_HASH_INITIAL;
+    pBucket = calloc( newSize, sizeof(void *) );
+    if( !pBucket )
+        return(0);
+
+    for( i=0; i<pt->Size; i++ )
+    {
+        if( fName )
+        {
+            SYMNAME *pn, *pnNext;
+
+            for( pn=pt->pBucket[i]; pn; pn=pnNext )
+            {
+                pnNext = pn->pHashNext;
+                idx = pn->Hash & (newSize-1);
+                pn->pHashNext = pBucket[idx];
+                pBucket[idx] = pn;
+            }
+        }
+        else
+        {
+            SYMBOL *psym, *psymNext;
+
+            /* Keep chain order so newer records still hide older ones */
+            for( psym=pt->pBucket[i]; psym; psym=psymNext )
+            {
+                SYMBOL **ppTail;
+
+                psymNext = psym->pHashNext;
+                idx = psym->Hash & (newSize-1);
+                ppTail = (SYMBOL **)&pBucket[idx];
+                while( *ppTail )
+                    ppTail = &(*ppTail)->pHashNext;
+                psym->pHashNext = 0;
+                *ppTail = psym;
+            }
+        }
+    }
+
+    free(pt->pBucket);
+    pt->pBucket = pBucket;
+    pt->Size = newSize;
+    return(1);
+}
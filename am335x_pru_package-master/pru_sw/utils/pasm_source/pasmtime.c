@@ -0,0 +1,1510 @@
+/*
+ * pasmtime.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pasmtime.c
+//
+// Description:
+//     Static timing analysis (*.tim)
+//         - Builds the control flow graph of the assembled code
+//         - Tracks register values that are known at each instruction,
+//           to tell local memory transfers from system bus transfers
+//         - Reports the best and worst case cycles between labels
+//
+//     The costs are the ones of the simulator (see prusim.h). A path
+//     that can go around a loop any number of times has no worst case;
+//     the report names the loop and its cycles per pass instead. LOOP
+//     with a known count is treated as a bounded loop.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added timing analysis
+//     18-Oct-26: 0.86 - Classify through the prudis.c decode table
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+#include <malloc.h>
+#endif
+#include <stdlib.h>
+#include "pasm.h"
+
+/* Local Structure Types */
+
+typedef unsigned long long TIMEVAL;
+#define TIME_UNBOUNDED      (~0ULL)
+
+/* Instruction Classes */
+#define INS_OTHER           0
+#define INS_ALU             1
+#define INS_LDI             2
+#define INS_JMP             3
+#define INS_JAL             4
+#define INS_HALT            5
+#define INS_SLP             6
+#define INS_LOOP            7
+#define INS_BRANCH          8       /* QBxx, QBBx, WBx */
+#define INS_QBA             9
+#define INS_LOAD            10      /* LBBO, LBCO */
+#define INS_STORE           11      /* SBBO, SBCO */
+#define INS_XFR             12      /* XIN, XOUT, XCHG */
+#define INS_MVI             13
+
+/* Successor Flags (see Flow) */
+#define FLOW_CALL           (1u<<30)
+#define FLOW_RETURN         (1u<<31)
+#define FLOW_ADDR(x)        ((x) & ~(FLOW_CALL|FLOW_RETURN))
+
+/* Flow Edge */
+typedef struct _TEDGE {
+    uint            To;             /* Code address */
+    uint            Flags;
+#define TEDGE_FLG_CALL      (1<<0)  /* Into a subroutine from JAL */
+    TIMEVAL         Best;
+    TIMEVAL         Worst;
+} TEDGE;
+
+/* Instruction Node */
+#define TNODE_EDGES         4
+typedef struct _TNODE {
+    uint            Word;
+    uint            Class;
+    uint            Flags;
+#define TNODE_FLG_RETURN    (1<<0)  /* JMP through a register */
+#define TNODE_FLG_INDIRECT  (1<<1)  /* JAL through a register */
+#define TNODE_FLG_RANGE     (1<<2)  /* Transfer cost depends on unknown values */
+#define TNODE_FLG_TARGET    (1<<3)  /* Search target (per search) */
+#define TNODE_FLG_STOP      (1<<4)  /* Search stops here (per search) */
+#define TNODE_FLG_LABEL     (1<<5)
+    uint            Best;           /* Instruction cost */
+    uint            Worst;
+    uint            LoopBack;       /* LOOP top to branch to after this one (or ~0) */
+    uint            EdgeCount;
+    TEDGE           Edge[TNODE_EDGES];
+} TNODE;
+
+/* Known Register Values on Entry to an Instruction */
+typedef struct _TREGS {
+    KNOWNREGS       Regs;
+    uint            Reached;
+} TREGS;
+
+/* Search Stack Frame */
+typedef struct _TFRAME {
+    uint            Node;
+    uint            EdgeIdx;
+    TIMEVAL         InWorst;        /* Worst cost of the edge into Node */
+} TFRAME;
+
+/* Search Result */
+typedef struct _TRESULT {
+    TIMEVAL         Best;           /* TIME_UNBOUNDED when there is no path */
+    TIMEVAL         Worst;          /* TIME_UNBOUNDED when there is no bound */
+    int             fLoop;          /* Set when a loop makes Worst unbounded */
+    uint            LoopTop;
+    uint            LoopBottom;
+    TIMEVAL         LoopCycles;     /* Worst cycles per pass */
+} TRESULT;
+
+/* Label (sorted by address) */
+typedef struct _TLABEL {
+    uint            Offset;
+    char            *Name;
+} TLABEL;
+
+/* Analysis State */
+typedef struct _TIMING {
+    uint            Count;          /* Code words (the sink node is Count) */
+    TNODE           *pNode;
+    TREGS           *pRegs;
+    TLABEL          *pLabel;
+    uint            LabelCount;
+    uint            Const[32];
+    PRUSIM_COSTS    Costs;
+
+    /* Search scratch, sized for Count+1 nodes */
+    unsigned char   *pReach;
+    unsigned char   *pColor;
+    TIMEVAL         *pLong;
+    TIMEVAL         *pDist;
+    TFRAME          *pStack;
+    uint            *pList;
+    TIMEVAL         *pHeapKey;
+    uint            *pHeapNode;
+    uint            HeapCount;
+
+    /* Call summaries, by target address */
+    unsigned char   *pCallState;
+    TIMEVAL         *pCallBest;
+    TIMEVAL         *pCallWorst;
+} TIMING;
+
+#define CALL_NONE           0
+#define CALL_BUSY           1
+#define CALL_DONE           2
+
+/* Register Fields (in FIELDTYPE order) */
+static const uint FieldShift[8] = { 0, 8, 16, 24, 0, 8, 16, 0 };
+static const uint FieldMask[8]  = { 0xFF, 0xFF, 0xFF, 0xFF,
+                                    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFFFFFF };
+static const uint ConstDefault[32] = PRUSIM_CONST_TABLE;
+
+
+/* Local Support Funtions */
+static uint Classify( uint op );
+static uint BranchTarget( uint pc, uint op );
+static uint Flow( TIMING *pt, uint pc, uint *pSucc );
+static void KnownSet( KNOWNREGS *pk, uint reg, uint field, uint val, int fKnown );
+static void KnownForget( KNOWNREGS *pk, uint idx, uint len );
+static int  KnownOp2( KNOWNREGS *pk, uint op, uint *pVal );
+static void Propagate( TIMING *pt );
+static void Cost( TIMING *pt, uint pc );
+static void AddEdge( TNODE *pn, uint to, uint flags, TIMEVAL best, TIMEVAL worst );
+static void BuildEdges( TIMING *pt );
+static void CollapseLoops( TIMING *pt );
+static void CallSummary( TIMING *pt, uint target );
+static void ReturnEdge( TIMING *pt, uint pc );
+static void ReturnEdges( TIMING *pt );
+static int  PathTimes( TIMING *pt, uint from, int fCalls, TRESULT *pr );
+static void HeapPush( TIMING *pt, TIMEVAL key, uint node );
+static uint HeapPop( TIMING *pt, TIMEVAL *pKey );
+static TIMEVAL TimeAdd( TIMEVAL a, TIMEVAL b );
+static char *AddrName( TIMING *pt, uint addr, char *buf );
+static int  ParseAddr( TIMING *pt, char *text, uint *pAddr );
+static void PrintResult( TIMING *pt, FILE *pf, char *from, char *to, TRESULT *pr );
+static int  CompareLabels( const void *a, const void *b );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// TimingWrite
+//
+// Writes the timing report (*.tim) of the code in the current context:
+// the cycles from each label to the labels it reaches without passing
+// through another label, and the cycles of every path requested with
+// -Tfrom:to.
+//
+// Returns 1 on success, 0 on error
+*/
+int TimingWrite( char *outbase )
+{
+    TIMING  t, *pt = &t;
+    TRESULT res;
+    LABEL   *pl;
+    FILE    *pf;
+    char    Path[256], from[TOKEN_MAX_LEN+16], to[TOKEN_MAX_LEN+16];
+    char    *pColon;
+    uint    i, j, k, n, a, b, cnt;
+    int     rc = 0;
+
+    memset( pt, 0, sizeof(TIMING) );
+    n = pt->Count = pCtx->CodeOffset;
+    pt->Costs = pCtx->TimingCosts;
+    memcpy( pt->Const, ConstDefault, sizeof(pt->Const) );
+
+    pt->pNode      = calloc( n+1, sizeof(TNODE) );
+    pt->pRegs      = calloc( n+1, sizeof(TREGS) );
+    pt->pLabel     = calloc( pCtx->LabelCount+1, sizeof(TLABEL) );
+    pt->pReach     = calloc( n+1, 1 );
+    pt->pColor     = calloc( n+1, 1 );
+    pt->pLong      = calloc( n+1, sizeof(TIMEVAL) );
+    pt->pDist      = calloc( n+1, sizeof(TIMEVAL) );
+    pt->pStack     = calloc( n+1, sizeof(TFRAME) );
+    pt->pList      = calloc( n+1, sizeof(uint) );
+    pt->pHeapKey   = calloc( (n+1)*TNODE_EDGES+1, sizeof(TIMEVAL) );
+    pt->pHeapNode  = calloc( (n+1)*TNODE_EDGES+1, sizeof(uint) );
+    pt->pCallState = calloc( n+1, 1 );
+    pt->pCallBest  = calloc( n+1, sizeof(TIMEVAL) );
+    pt->pCallWorst = calloc( n+1, sizeof(TIMEVAL) );
+    if( !pt->pNode || !pt->pRegs || !pt->pLabel || !pt->pReach || !pt->pColor || !pt->pLong ||
+        !pt->pDist || !pt->pStack || !pt->pList || !pt->pHeapKey || !pt->pHeapNode ||
+        !pt->pCallState || !pt->pCallBest || !pt->pCallWorst )
+        { Report(0,REP_FATAL,"Memory allocation failed"); goto CLEANUP; }
+
+    /* Labels in address order */
+    for( pl=pCtx->pLabelList; pl; pl=pl->pNext )
+    {
+        pt->pLabel[pt->LabelCount].Offset = pl->Offset;
+        pt->pLabel[pt->LabelCount].Name   = pl->Name;
+        pt->LabelCount++;
+    }
+    qsort( pt->pLabel, pt->LabelCount, sizeof(TLABEL), CompareLabels );
+
+    /* Graph, known values, and costs */
+    for( i=0; i<n; i++ )
+    {
+        pt->pNode[i].Word     = pCtx->ProgramImage[i].CodeWord;
+        pt->pNode[i].Class    = Classify( pt->pNode[i].Word );
+        pt->pNode[i].LoopBack = ~0u;
+    }
+    for( i=0; i<n; i++ )
+    {
+        if( pt->pNode[i].Class == INS_LOOP )
+        {
+            a = i + (pt->pNode[i].Word & 0xFF);
+            if( a>i+1 && a<=n )
+                pt->pNode[a-1].LoopBack = i+1;
+        }
+    }
+    for( i=0; i<pt->LabelCount; i++ )
+        if( pt->pLabel[i].Offset < n )
+            pt->pNode[pt->pLabel[i].Offset].Flags |= TNODE_FLG_LABEL;
+
+    Propagate( pt );
+    for( i=0; i<n; i++ )
+        Cost( pt, i );
+    BuildEdges( pt );
+    CollapseLoops( pt );
+    ReturnEdges( pt );
+
+    /* Write the report */
+    sprintf( Path, "%s.tim", outbase );
+    if( !(pf = fopen(Path,"wb")) )
+        { Report(0,REP_ERROR,"Unable to open output file: %s",Path); goto CLEANUP; }
+
+    fprintf(pf,"Cycles from the start of one instruction to the start of another\n");
+    fprintf(pf,"Transfers cost 1 cycle per word plus: local load %u, local store %u,\n",
+            pt->Costs.LocalLoad, pt->Costs.LocalStore);
+    fprintf(pf,"system load %u, system store %u\n", pt->Costs.SystemLoad, pt->Costs.SystemStore);
+
+    fprintf(pf,"\n%-28s %-28s %10s %10s\n","From","To","Best","Worst");
+    for( i=0; i<pt->LabelCount; i++ )
+    {
+        a = pt->pLabel[i].Offset;
+        if( a>=n || (i && pt->pLabel[i-1].Offset==a) )
+            continue;
+
+        /* Find the labels reached from here without passing another one */
+        for( j=0; j<n; j++ )
+            pt->pReach[j] = 0;
+        cnt = 0;
+        pt->pList[cnt++] = a;
+        pt->pReach[a] = 1;
+        for( k=0; k<cnt; k++ )
+        {
+            TNODE *pn = &pt->pNode[pt->pList[k]];
+
+            if( k && (pn->Flags & TNODE_FLG_LABEL) )
+                continue;
+            for( j=0; j<pn->EdgeCount; j++ )
+            {
+                b = pn->Edge[j].To;
+                if( b==a && !(pt->pReach[a] & 2) )
+                    pt->pReach[a] |= 2;
+                else if( !pt->pReach[b] )
+                {
+                    pt->pReach[b] = 1;
+                    pt->pList[cnt++] = b;
+                }
+            }
+        }
+
+        /* The start itself first when it loops back, then in address order */
+        for( j=0; j<pt->LabelCount; j++ )
+        {
+            b = pt->pLabel[j].Offset;
+            if( b>=n || (j && pt->pLabel[j-1].Offset==b) )
+                continue;
+            if( b==a ? !(pt->pReach[a] & 2) : !pt->pReach[b] )
+                continue;
+
+            for( k=0; k<n; k++ )
+            {
+                pt->pNode[k].Flags &= ~(TNODE_FLG_TARGET|TNODE_FLG_STOP);
+                if( pt->pNode[k].Flags & TNODE_FLG_LABEL )
+                    pt->pNode[k].Flags |= TNODE_FLG_STOP;
+            }
+            pt->pNode[b].Flags |= TNODE_FLG_TARGET;
+            if( PathTimes( pt, a, 1, &res ) )
+                PrintResult( pt, pf, pt->pLabel[i].Name, pt->pLabel[j].Name, &res );
+        }
+    }
+
+    /* Requested paths */
+    if( pCtx->TimingQueries )
+        fprintf(pf,"\n%-28s %-28s %10s %10s\n","From","To","Best","Worst");
+    for( i=0; i<(uint)pCtx->TimingQueries; i++ )
+    {
+        strncpy( from, pCtx->TimingQuery[i], sizeof(from)-1 );
+        from[sizeof(from)-1] = 0;
+        pColon = strchr( from, ':' );
+        if( !pColon )
+            { Report(0,REP_ERROR,"Timing path '%s' is not 'from:to'",from); continue; }
+        *pColon = 0;
+        strcpy( to, pColon+1 );
+        if( !ParseAddr( pt, from, &a ) || !ParseAddr( pt, to, &b ) )
+            continue;
+
+        for( k=0; k<n; k++ )
+            pt->pNode[k].Flags &= ~(TNODE_FLG_TARGET|TNODE_FLG_STOP);
+        pt->pNode[b].Flags |= TNODE_FLG_TARGET;
+        if( !PathTimes( pt, a, 1, &res ) )
+            fprintf(pf,"%-28s %-28s %10s %10s\n",from,to,"no path","-");
+        else
+            PrintResult( pt, pf, from, to, &res );
+    }
+
+    /* Instructions whose cost or flow is not known exactly */
+    cnt = 0;
+    for( i=0; i<n; i++ )
+    {
+        TNODE *pn = &pt->pNode[i];
+
+        if( !(pn->Flags & (TNODE_FLG_RANGE|TNODE_FLG_RETURN|TNODE_FLG_INDIRECT)) )
+            continue;
+        if( !cnt++ )
+            fprintf(pf,"\nNotes\n");
+        fprintf(pf,"0x%04x %-28s ",i,AddrName( pt, i, from ));
+        if( pn->Flags & TNODE_FLG_RANGE )
+            fprintf(pf,"%s address or length not known, %u to %u cycles\n",
+                    pn->Class==INS_LOAD ? "load" : "store", pn->Best, pn->Worst);
+        else if( pn->Flags & TNODE_FLG_RETURN )
+            fprintf(pf,"jump through a register, paths end here\n");
+        else
+            fprintf(pf,"call through a register, paths end here\n");
+    }
+
+    fclose( pf );
+    rc = 1;
+
+CLEANUP:
+    free( pt->pNode );
+    free( pt->pRegs );
+    free( pt->pLabel );
+    free( pt->pReach );
+    free( pt->pColor );
+    free( pt->pLong );
+    free( pt->pDist );
+    free( pt->pStack );
+    free( pt->pList );
+    free( pt->pHeapKey );
+    free( pt->pHeapNode );
+    free( pt->pCallState );
+    free( pt->pCallBest );
+    free( pt->pCallWorst );
+    return(rc);
+}
+
+
+/*
+// KnownGet
+//
+// Reads a register field from a set of known register values
+//
+// Returns 1 if the value is known, 0 if not
+*/
+int KnownGet( KNOWNREGS *pk, uint reg, uint field, uint *pVal )
+{
+    uint mask = FieldMask[field] << FieldShift[field];
+
+    *pVal = (pk->Val[reg] >> FieldShift[field]) & FieldMask[field];
+    return( (pk->Known[reg] & mask) == mask );
+}
+
+
+/*
+// KnownResult
+//
+// Finds the value an ALU instruction, LDI, or JAL at address pc writes
+// to its destination field
+//
+// Returns 1 if the value is known, 0 if not (or nothing is written)
+*/
+int KnownResult( KNOWNREGS *pk, uint pc, uint op, uint *pVal )
+{
+    uint s1, s2;
+    int  fKnown;
+
+    *pVal = 0;
+    switch( Classify( op ) )
+    {
+    case INS_ALU:
+        if( (op>>29) )
+            return(0);              /* LMBD */
+        fKnown = KnownGet( pk, (op>>8)&0x1F, (op>>13)&7, &s1 );
+        fKnown &= KnownOp2( pk, op, &s2 );
+        switch( (op>>25) & 0xF )
+        {
+        case 0x0: *pVal = s1 + s2;                      break;
+        case 0x2: *pVal = s1 - s2;                      break;
+        case 0x4: *pVal = s1 << (s2 & 0x1F);            break;
+        case 0x5: *pVal = s1 >> (s2 & 0x1F);            break;
+        case 0x6: *pVal = s2 - s1;                      break;
+        case 0x8: *pVal = s1 & s2;                      break;
+        case 0x9: *pVal = s1 | s2;                      break;
+        case 0xA: *pVal = s1 ^ s2;                      break;
+        case 0xB: *pVal = ~s1;                          break;
+        case 0xC: *pVal = s1 < s2 ? s1 : s2;            break;
+        case 0xD: *pVal = s1 > s2 ? s1 : s2;            break;
+        case 0xE: *pVal = s1 & ~(1u << (s2 & 0x1F));    break;
+        case 0xF: *pVal = s1 | (1u << (s2 & 0x1F));     break;
+        default:  fKnown = 0;                           break;  /* Uses the carry */
+        }
+        *pVal &= FieldMask[(op>>5)&7];
+        return(fKnown);
+
+    case INS_LDI:
+        *pVal = (op>>8) & 0xFFFF;
+        return(1);
+
+    case INS_JAL:
+        *pVal = (pc+1) & FieldMask[(op>>5)&7];
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// KnownApply
+//
+// Applies the instruction at address pc to a set of known register values
+//
+// void
+*/
+void KnownApply( KNOWNREGS *pk, uint pc, uint op )
+{
+    uint r, len, code;
+    int  fKnown;
+
+    switch( Classify( op ) )
+    {
+    case INS_ALU:
+    case INS_LDI:
+    case INS_JAL:
+        fKnown = KnownResult( pk, pc, op, &r );
+        KnownSet( pk, op&0x1F, (op>>5)&7, r, fKnown );
+        break;
+
+    case INS_MVI:
+        memset( pk->Known, 0, sizeof(pk->Known) );
+        break;
+
+    case INS_XFR:
+        if( ((op>>23) & 3) == 2 )
+            break;                  /* XOUT */
+        code = (op>>7) & 0x7F;
+        len = code>=124 ? 128 : code+1;
+        KnownForget( pk, (op & 0x1F)*4 + ((op>>5) & 3), len );
+        break;
+
+    case INS_LOAD:
+        code = ((op>>21) & 0x70) | ((op>>12) & 0x0E) | ((op>>7) & 1);
+        len = code>=124 ? 128 : code+1;
+        KnownForget( pk, (op & 0x1F)*4 + ((op>>5) & 3), len );
+        break;
+
+    case INS_OTHER:
+        if( (op>>29)==1 && ((op>>25) & 0xF)==0x4 )
+            KnownSet( pk, op&0x1F, (op>>5)&7, 0, 0 );   /* SCAN */
+        break;
+    }
+    pk->Known[31] = 0;
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// Classify
+//
+// Returns the instruction class (INS_xxx) of a code word
+*/
+static uint Classify( uint op )
+{
+    switch( prudis_opcode( op ) )
+    {
+    case OP_ADD:
+    case OP_ADC:
+    case OP_SUB:
+    case OP_SUC:
+    case OP_LSL:
+    case OP_LSR:
+    case OP_RSB:
+    case OP_RSC:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_NOT:
+    case OP_MIN:
+    case OP_MAX:
+    case OP_CLR:
+    case OP_SET:
+    case OP_LMBD:
+        return(INS_ALU);
+
+    case OP_JMP:    return(INS_JMP);
+    case OP_JAL:    return(INS_JAL);
+    case OP_LDI:    return(INS_LDI);
+    case OP_HALT:   return(INS_HALT);
+    case OP_SLP:    return(INS_SLP);
+    case OP_QBA:    return(INS_QBA);
+
+    case OP_MVIB:
+    case OP_MVIW:
+    case OP_MVID:
+        return(INS_MVI);
+
+    case OP_XIN:
+    case OP_XOUT:
+    case OP_XCHG:
+    case OP_SXIN:
+    case OP_SXOUT:
+    case OP_SXCHG:
+        return(INS_XFR);
+
+    case OP_LOOP:
+    case OP_ILOOP:
+        return(INS_LOOP);
+
+    case OP_QBGT:
+    case OP_QBLT:
+    case OP_QBEQ:
+    case OP_QBGE:
+    case OP_QBLE:
+    case OP_QBNE:
+    case OP_QBBS:
+    case OP_QBBC:
+        return(INS_BRANCH);
+
+    case OP_LBBO:
+    case OP_LBCO:
+        return(INS_LOAD);
+
+    case OP_SBBO:
+    case OP_SBCO:
+        return(INS_STORE);
+    }
+    return(INS_OTHER);
+}
+
+
+/*
+// BranchTarget
+//
+// Returns the target of a QBxx, QBBx, or WBx instruction
+*/
+static uint BranchTarget( uint pc, uint op )
+{
+    int offset;
+
+    offset = (op & 0xFF) | ((op>>17) & 0x300);
+    if( offset & 0x200 )
+        offset -= 0x400;
+    return( pc + offset );
+}
+
+
+/*
+// Flow
+//
+// Finds where execution can go after an instruction. A hardware loop
+// sends the fall through of its last instruction back to the top as
+// well as on. The place a JAL returns to is flagged with FLOW_RETURN in
+// the upper bits of the entry, and the JAL target with FLOW_CALL.
+//
+// Returns the number of successors written to pSucc (at most TNODE_EDGES)
+*/
+static uint Flow( TIMING *pt, uint pc, uint *pSucc )
+{
+    TNODE *pn = &pt->pNode[pc];
+    uint  op = pn->Word, cnt = 0, fNext = 0, i, j;
+
+    switch( pn->Class )
+    {
+    case INS_JMP:
+        if( op & (1<<24) )
+            pSucc[cnt++] = (op>>8) & 0xFFFF;
+        break;
+
+    case INS_JAL:
+        if( op & (1<<24) )
+            pSucc[cnt++] = ((op>>8) & 0xFFFF) | FLOW_CALL;
+        pSucc[cnt++] = (pc+1) | FLOW_RETURN;
+        break;
+
+    case INS_HALT:
+        break;
+
+    case INS_SLP:
+        pSucc[cnt++] = pc;
+        fNext = 1;
+        break;
+
+    case INS_BRANCH:
+        pSucc[cnt++] = BranchTarget( pc, op );
+        fNext = 1;
+        break;
+
+    case INS_QBA:
+        pSucc[cnt++] = BranchTarget( pc, op );
+        break;
+
+    case INS_LOOP:
+        pSucc[cnt++] = pc + (op & 0xFF);
+        fNext = 1;
+        break;
+
+    default:
+        fNext = 1;
+        break;
+    }
+
+    if( fNext )
+    {
+        if( pn->LoopBack != ~0u )
+            pSucc[cnt++] = pn->LoopBack;
+        pSucc[cnt++] = pc+1;
+    }
+
+    /* Drop duplicates and anything outside the code */
+    for( i=j=0; i<cnt; i++ )
+    {
+        uint k;
+
+        if( FLOW_ADDR(pSucc[i]) >= pt->Count )
+            continue;
+        for( k=0; k<j; k++ )
+            if( pSucc[k]==pSucc[i] )
+                break;
+        if( k==j )
+            pSucc[j++] = pSucc[i];
+    }
+    return(j);
+}
+
+
+/*
+// KnownSet
+//
+// Writes a register field, known or not. R31 never holds a known value
+// since it reads back the inputs.
+//
+// void
+*/
+static void KnownSet( KNOWNREGS *pk, uint reg, uint field, uint val, int fKnown )
+{
+    uint mask = FieldMask[field] << FieldShift[field];
+
+    pk->Val[reg] = (pk->Val[reg] & ~mask) | ((val << FieldShift[field]) & mask);
+    if( fKnown && reg!=31 )
+        pk->Known[reg] |= mask;
+    else
+        pk->Known[reg] &= ~mask;
+}
+
+
+/*
+// KnownForget
+//
+// Marks a run of register bytes as unknown, by register byte address
+//
+// void
+*/
+static void KnownForget( KNOWNREGS *pk, uint idx, uint len )
+{
+    while( len-- && idx<128 )
+    {
+        pk->Known[idx>>2] &= ~(0xFFu << ((idx&3)*8));
+        idx++;
+    }
+}
+
+
+/*
+// KnownOp2
+//
+// Reads the OP(255) operand in bits 16-24
+//
+// Returns 1 if the value is known, 0 if not
+*/
+static int KnownOp2( KNOWNREGS *pk, uint op, uint *pVal )
+{
+    if( op & (1<<24) )
+    {
+        *pVal = (op>>16) & 0xFF;
+        return(1);
+    }
+    return( KnownGet( pk, (op>>16)&0x1F, (op>>21)&7, pVal ) );
+}
+
+
+/*
+// Propagate
+//
+// Finds the register values known on entry to each instruction. Nothing
+// is known at the entry point, at the start of code that is not reached
+// from it, or where a JAL returns to (the callee may change anything).
+//
+// void
+*/
+static void Propagate( TIMING *pt )
+{
+    TREGS  out, *pin;
+    uint   succ[TNODE_EDGES], cnt, head, tail, pc, to, i, k, known, seed;
+    uint   *pQueue = pt->pList;
+    unsigned char *pQueued = pt->pColor;
+
+    memset( pQueued, 0, pt->Count );
+    head = tail = 0;
+    seed = pCtx->EntryPoint>=0 && (uint)pCtx->EntryPoint<pt->Count ? pCtx->EntryPoint : 0;
+
+    for(;;)
+    {
+        if( head==tail )
+        {
+            /* Start the next piece of code nothing has reached yet */
+            for( ; seed<pt->Count && pt->pRegs[seed].Reached; seed++ );
+            if( seed>=pt->Count )
+            {
+                seed = 0;
+                for( ; seed<pt->Count && pt->pRegs[seed].Reached; seed++ );
+                if( seed>=pt->Count )
+                    break;
+            }
+            pt->pRegs[seed].Reached = 1;
+            pQueue[tail] = seed;
+            tail = (tail+1) % (pt->Count+1);
+            pQueued[seed] = 1;
+        }
+
+        pc = pQueue[head];
+        head = (head+1) % (pt->Count+1);
+        pQueued[pc] = 0;
+
+        out = pt->pRegs[pc];
+        KnownApply( &out.Regs, pc, pt->pNode[pc].Word );
+
+        cnt = Flow( pt, pc, succ );
+        for( i=0; i<cnt; i++ )
+        {
+            to  = FLOW_ADDR(succ[i]);
+            pin = &pt->pRegs[to];
+            if( !pin->Reached )
+            {
+                *pin = out;
+                if( succ[i] & FLOW_RETURN )
+                    memset( pin->Regs.Known, 0, sizeof(pin->Regs.Known) );
+                pin->Reached = 1;
+            }
+            else
+            {
+                int fChanged = 0;
+
+                for( k=0; k<32; k++ )
+                {
+                    known = pin->Regs.Known[k] & out.Regs.Known[k] &
+                            ~(pin->Regs.Val[k] ^ out.Regs.Val[k]);
+                    if( succ[i] & FLOW_RETURN )
+                        known = 0;
+                    if( known != pin->Regs.Known[k] )
+                    {
+                        pin->Regs.Known[k] = known;
+                        fChanged = 1;
+                    }
+                }
+                if( !fChanged )
+                    continue;
+            }
+            if( !pQueued[to] )
+            {
+                pQueue[tail] = to;
+                tail = (tail+1) % (pt->Count+1);
+                pQueued[to] = 1;
+            }
+        }
+    }
+}
+
+
+/*
+// Cost
+//
+// Sets the best and worst cycles of an instruction. A transfer whose
+// address is not known may be local or system, and one whose length
+// comes from an unknown R0 byte may be 1 to 124 bytes.
+//
+// void
+*/
+static void Cost( TIMING *pt, uint pc )
+{
+    TNODE *pn = &pt->pNode[pc];
+    KNOWNREGS *pk = &pt->pRegs[pc].Regs;
+    uint  op = pn->Word, base, off, code, len, minWords, maxWords, local, system;
+    int   fAddr, fLoad = pn->Class==INS_LOAD;
+
+    pn->Best = pn->Worst = 1;
+    if( pn->Class!=INS_LOAD && pn->Class!=INS_STORE )
+        return;
+
+    if( (op>>29)==4 )
+    {
+        base  = pt->Const[(op>>8)&0x1F];
+        fAddr = 1;
+    }
+    else
+        fAddr = KnownGet( pk, (op>>8)&0x1F, 7, &base );
+    fAddr &= KnownOp2( pk, op, &off );
+
+    code = ((op>>21) & 0x70) | ((op>>12) & 0x0E) | ((op>>7) & 1);
+    if( code < 124 )
+        minWords = maxWords = (code+1+3)/4;
+    else if( KnownGet( pk, 0, code-124, &len ) )
+        minWords = maxWords = (len+3)/4;
+    else
+    {
+        minWords = 1;
+        maxWords = 31;
+    }
+
+    local  = fLoad ? pt->Costs.LocalLoad  : pt->Costs.LocalStore;
+    system = fLoad ? pt->Costs.SystemLoad : pt->Costs.SystemStore;
+    if( fAddr )
+        local = system = (base+off < PRUSIM_LOCAL_SIZE) ? local : system;
+
+    pn->Best  = minWords + (local<system ? local : system);
+    pn->Worst = maxWords + (local<system ? system : local);
+    if( pn->Best != pn->Worst )
+        pn->Flags |= TNODE_FLG_RANGE;
+}
+
+
+/*
+// AddEdge
+//
+// Adds a flow edge to an instruction
+//
+// void
+*/
+static void AddEdge( TNODE *pn, uint to, uint flags, TIMEVAL best, TIMEVAL worst )
+{
+    TEDGE *pe = &pn->Edge[pn->EdgeCount++];
+
+    pe->To    = to;
+    pe->Flags = flags;
+    pe->Best  = best;
+    pe->Worst = worst;
+}
+
+
+/*
+// BuildEdges
+//
+// Builds the flow graph, with the cost of each instruction on the edges
+// leaving it. The edge from a JAL to its return is added later, once
+// the cost of the call is known.
+//
+// void
+*/
+static void BuildEdges( TIMING *pt )
+{
+    TNODE *pn;
+    uint  succ[TNODE_EDGES], cnt, pc, i;
+
+    for( pc=0; pc<pt->Count; pc++ )
+    {
+        pn = &pt->pNode[pc];
+        if( pn->Class==INS_JMP && !(pn->Word & (1<<24)) )
+            pn->Flags |= TNODE_FLG_RETURN;
+        if( pn->Class==INS_JAL && !(pn->Word & (1<<24)) )
+            pn->Flags |= TNODE_FLG_INDIRECT;
+
+        cnt = Flow( pt, pc, succ );
+        for( i=0; i<cnt; i++ )
+        {
+            if( succ[i] & FLOW_RETURN )
+                continue;
+            AddEdge( pn, FLOW_ADDR(succ[i]), (succ[i] & FLOW_CALL) ? TEDGE_FLG_CALL : 0,
+                     pn->Best, pn->Worst );
+        }
+    }
+}
+
+
+/*
+// CollapseLoops
+//
+// Replaces a hardware LOOP whose count is known and whose body is a
+// simple block (forward branches only, no calls, returns, or nested
+// loops) with one edge to the end of the loop, costing the count times
+// the body.
+//
+// void
+*/
+static void CollapseLoops( TIMING *pt )
+{
+    TNODE   *pn, *pb;
+    TIMEVAL *pBest = pt->pDist, *pWorst = pt->pLong;
+    uint    pc, top, end, count, k, i, to;
+    int     fSimple;
+
+    for( pc=0; pc<pt->Count; pc++ )
+    {
+        pn = &pt->pNode[pc];
+        if( pn->Class != INS_LOOP )
+            continue;
+
+        top = pc+1;
+        end = pc + (pn->Word & 0xFF);
+        if( end<=top || end>pt->Count )
+            continue;
+        if( pn->Word & (1<<24) )
+            count = ((pn->Word>>16) & 0xFF) + 1;
+        else if( !KnownGet( &pt->pRegs[pc].Regs, (pn->Word>>16)&0x1F, (pn->Word>>21)&7, &count ) )
+            continue;
+
+        fSimple = 1;
+        for( k=top; k<end && fSimple; k++ )
+        {
+            pb = &pt->pNode[k];
+            if( pb->Class==INS_JMP || pb->Class==INS_JAL || pb->Class==INS_HALT ||
+                pb->Class==INS_SLP || pb->Class==INS_LOOP )
+                fSimple = 0;
+            for( i=0; i<pb->EdgeCount && fSimple; i++ )
+            {
+                to = pb->Edge[i].To;
+                if( k==end-1 && to==top )
+                    continue;
+                if( to<=k || to>end )
+                    fSimple = 0;
+            }
+        }
+        if( !fSimple )
+            continue;
+
+        /* Shortest and longest pass through the body */
+        for( k=top; k<=end; k++ )
+        {
+            pBest[k]  = TIME_UNBOUNDED;
+            pWorst[k] = 0;
+        }
+        pBest[top] = 0;
+        for( k=top; k<end; k++ )
+        {
+            pb = &pt->pNode[k];
+            if( pBest[k]==TIME_UNBOUNDED )
+                continue;
+            for( i=0; i<pb->EdgeCount; i++ )
+            {
+                to = pb->Edge[i].To;
+                if( k==end-1 && to==top )
+                    continue;
+                if( pBest[k]+pb->Edge[i].Best < pBest[to] )
+                    pBest[to] = pBest[k]+pb->Edge[i].Best;
+                if( pWorst[k]+pb->Edge[i].Worst > pWorst[to] )
+                    pWorst[to] = pWorst[k]+pb->Edge[i].Worst;
+            }
+        }
+        if( pBest[end]==TIME_UNBOUNDED )
+            continue;
+
+        pn->EdgeCount = 0;
+        AddEdge( pn, end, 0, pn->Best + count*pBest[end], pn->Worst + count*pWorst[end] );
+    }
+}
+
+
+/*
+// CallSummary
+//
+// Finds the best and worst cycles of a call to the supplied address,
+// from the JAL up to the instruction after its return. Calls made by
+// the subroutine are summarized first. A recursive call has no bound.
+//
+// void
+*/
+static void CallSummary( TIMING *pt, uint target )
+{
+    TRESULT res;
+    TNODE   *pn;
+    uint    *pWork, cnt, k, i, pc;
+
+    if( pt->pCallState[target] != CALL_NONE )
+    {
+        if( pt->pCallState[target] == CALL_BUSY )
+            pt->pCallWorst[target] = TIME_UNBOUNDED;
+        return;
+    }
+    pt->pCallState[target] = CALL_BUSY;
+    pt->pCallBest[target]  = TIME_UNBOUNDED;
+    pt->pCallWorst[target] = 0;
+
+    /* Find the calls made from the subroutine */
+    pWork = malloc( (pt->Count+1) * sizeof(uint) );
+    if( !pWork )
+        { Report(0,REP_FATAL,"Memory allocation failed"); return; }
+    memset( pt->pColor, 0, pt->Count );
+    cnt = 0;
+    pWork[cnt++] = target;
+    pt->pColor[target] = 1;
+    for( k=0; k<cnt; k++ )
+    {
+        pn = &pt->pNode[pWork[k]];
+        for( i=0; i<pn->EdgeCount; i++ )
+        {
+            if( (pn->Edge[i].Flags & TEDGE_FLG_CALL) || pt->pColor[pn->Edge[i].To] )
+                continue;
+            pt->pColor[pn->Edge[i].To] = 1;
+            pWork[cnt++] = pn->Edge[i].To;
+        }
+    }
+    for( k=0; k<cnt; k++ )
+    {
+        pc = pWork[k];
+        if( pt->pNode[pc].Class==INS_JAL && (pt->pNode[pc].Word & (1<<24)) )
+            ReturnEdge( pt, pc );
+    }
+    free( pWork );
+
+    /* Then the paths to a return */
+    for( k=0; k<pt->Count; k++ )
+    {
+        pt->pNode[k].Flags &= ~(TNODE_FLG_TARGET|TNODE_FLG_STOP);
+        if( pt->pNode[k].Flags & TNODE_FLG_RETURN )
+            pt->pNode[k].Flags |= TNODE_FLG_TARGET;
+    }
+    if( PathTimes( pt, target, 0, &res ) )
+    {
+        pt->pCallBest[target] = res.Best + 1;
+        if( res.Worst==TIME_UNBOUNDED || pt->pCallWorst[target]==TIME_UNBOUNDED )
+            pt->pCallWorst[target] = TIME_UNBOUNDED;
+        else
+            pt->pCallWorst[target] = res.Worst + 1;
+    }
+    pt->pCallState[target] = CALL_DONE;
+}
+
+
+/*
+// ReturnEdge
+//
+// Adds the edge from a JAL to the instruction after it, costing the
+// whole call. A subroutine that never returns gets no edge.
+//
+// void
+*/
+static void ReturnEdge( TIMING *pt, uint pc )
+{
+    TNODE *pn = &pt->pNode[pc];
+    uint  target = (pn->Word>>8) & 0xFFFF, i;
+
+    for( i=0; i<pn->EdgeCount; i++ )
+        if( !(pn->Edge[i].Flags & TEDGE_FLG_CALL) )
+            return;
+    if( target>=pt->Count || pc+1>=pt->Count )
+        return;
+
+    CallSummary( pt, target );
+    if( pt->pCallBest[target]==TIME_UNBOUNDED || pt->pCallState[target]!=CALL_DONE )
+        return;
+    AddEdge( pn, pc+1, 0, TimeAdd( pn->Best, pt->pCallBest[target] ),
+             TimeAdd( pn->Worst, pt->pCallWorst[target] ) );
+}
+
+
+/*
+// ReturnEdges
+//
+// Adds the return edge of every JAL
+//
+// void
+*/
+static void ReturnEdges( TIMING *pt )
+{
+    uint pc;
+
+    for( pc=0; pc<pt->Count; pc++ )
+        if( pt->pNode[pc].Class==INS_JAL && (pt->pNode[pc].Word & (1<<24)) )
+            ReturnEdge( pt, pc );
+}
+
+
+/*
+// PathTimes
+//
+// Finds the best and worst cycles from an instruction to the start of
+// any instruction flagged TNODE_FLG_TARGET, not passing through those
+// flagged TNODE_FLG_STOP. The starting instruction itself is always
+// left. Clear fCalls to stay out of subroutines.
+//
+// Returns 1 if there is a path, 0 if not
+*/
+static int PathTimes( TIMING *pt, uint from, int fCalls, TRESULT *pr )
+{
+    TNODE   *pn;
+    TEDGE   *pe;
+    TFRAME  *pf;
+    TIMEVAL key, w;
+    uint    sink = pt->Count, u, v, i, sp, depth;
+
+#define EDGE_SKIP(pe) ( (!fCalls && ((pe)->Flags & TEDGE_FLG_CALL)) || \
+                        ((pt->pNode[(pe)->To].Flags & (TNODE_FLG_STOP|TNODE_FLG_TARGET)) == TNODE_FLG_STOP) )
+#define EDGE_TO(pe)   ( (pt->pNode[(pe)->To].Flags & TNODE_FLG_TARGET) ? sink : (pe)->To )
+
+    memset( pr, 0, sizeof(TRESULT) );
+
+    /* Best case (Dijkstra) */
+    for( i=0; i<=sink; i++ )
+        pt->pDist[i] = TIME_UNBOUNDED;
+    pt->pDist[from] = 0;
+    pt->HeapCount = 0;
+    HeapPush( pt, 0, from );
+    while( pt->HeapCount )
+    {
+        u = HeapPop( pt, &key );
+        if( key != pt->pDist[u] )
+            continue;
+        if( u==sink )
+            break;
+        pn = &pt->pNode[u];
+        for( i=0; i<pn->EdgeCount; i++ )
+        {
+            pe = &pn->Edge[i];
+            if( EDGE_SKIP(pe) )
+                continue;
+            v = EDGE_TO(pe);
+            w = TimeAdd( key, pe->Best );
+            if( w < pt->pDist[v] )
+            {
+                pt->pDist[v] = w;
+                HeapPush( pt, w, v );
+            }
+        }
+    }
+    pr->Best = pt->pDist[sink];
+    if( pr->Best==TIME_UNBOUNDED )
+        return(0);
+
+    /* Worst case (longest path, depth first). A loop that can still
+       reach the target has no bound. */
+#define COLOR_OPEN      1
+#define COLOR_DONE      2
+#define COLOR_LOOP      4           /* pList and pDist hold a loop found here */
+#define COLOR_REACH     8           /* Reaches the target */
+    memset( pt->pColor, 0, sink+1 );
+    pt->pLong[from] = 0;
+    pt->pColor[from] = COLOR_OPEN;
+    sp = 0;
+    pt->pStack[sp].Node = from;
+    pt->pStack[sp].EdgeIdx = 0;
+    pt->pStack[sp].InWorst = 0;
+    sp++;
+    while( sp )
+    {
+        pf = &pt->pStack[sp-1];
+        u  = pf->Node;
+        pn = &pt->pNode[u];
+        if( pf->EdgeIdx < pn->EdgeCount )
+        {
+            pe = &pn->Edge[pf->EdgeIdx++];
+            if( EDGE_SKIP(pe) )
+                continue;
+            v = EDGE_TO(pe);
+            if( v==sink )
+            {
+                pt->pColor[u] |= COLOR_REACH;
+                if( pe->Worst > pt->pLong[u] )
+                    pt->pLong[u] = pe->Worst;
+            }
+            else if( pt->pColor[v] & COLOR_OPEN )
+            {
+                if( !(pt->pColor[v] & COLOR_LOOP) )
+                {
+                    /* Cycles once around, following the stack from v */
+                    w = pe->Worst;
+                    for( depth=sp-1; pt->pStack[depth].Node!=v; depth-- )
+                        w = TimeAdd( w, pt->pStack[depth].InWorst );
+                    pt->pColor[v] |= COLOR_LOOP;
+                    pt->pList[v] = u;
+                    pt->pDist[v] = w;
+                }
+            }
+            else if( pt->pColor[v] & COLOR_DONE )
+            {
+                if( (pt->pColor[v] & COLOR_REACH) )
+                {
+                    pt->pColor[u] |= COLOR_REACH;
+                    w = TimeAdd( pe->Worst, pt->pLong[v] );
+                    if( w > pt->pLong[u] )
+                        pt->pLong[u] = w;
+                }
+            }
+            else
+            {
+                pt->pColor[v] = COLOR_OPEN;
+                pt->pLong[v] = 0;
+                pf = &pt->pStack[sp++];
+                pf->Node    = v;
+                pf->EdgeIdx = 0;
+                pf->InWorst = pe->Worst;
+            }
+            continue;
+        }
+
+        /* Done with u */
+        pt->pColor[u] = (pt->pColor[u] & ~COLOR_OPEN) | COLOR_DONE;
+        sp--;
+        if( sp && (pt->pColor[u] & COLOR_REACH) )
+        {
+            v = pt->pStack[sp-1].Node;
+            pt->pColor[v] |= COLOR_REACH;
+            w = TimeAdd( pf->InWorst, pt->pLong[u] );
+            if( w > pt->pLong[v] )
+                pt->pLong[v] = w;
+        }
+    }
+
+    pr->Worst = pt->pLong[from];
+    for( i=0; i<sink; i++ )
+    {
+        if( (pt->pColor[i] & (COLOR_LOOP|COLOR_REACH)) == (COLOR_LOOP|COLOR_REACH) )
+        {
+            pr->Worst      = TIME_UNBOUNDED;
+            pr->fLoop      = 1;
+            pr->LoopTop    = i;
+            pr->LoopBottom = pt->pList[i];
+            pr->LoopCycles = pt->pDist[i];
+            break;
+        }
+    }
+    return(1);
+}
+
+
+/*
+// HeapPush
+//
+// Adds a node to the search heap
+//
+// void
+*/
+static void HeapPush( TIMING *pt, TIMEVAL key, uint node )
+{
+    uint i = pt->HeapCount++, parent;
+
+    while( i )
+    {
+        parent = (i-1)/2;
+        if( pt->pHeapKey[parent] <= key )
+            break;
+        pt->pHeapKey[i]  = pt->pHeapKey[parent];
+        pt->pHeapNode[i] = pt->pHeapNode[parent];
+        i = parent;
+    }
+    pt->pHeapKey[i]  = key;
+    pt->pHeapNode[i] = node;
+}
+
+
+/*
+// HeapPop
+//
+// Removes the node with the smallest key from the search heap
+//
+// Returns the node
+*/
+static uint HeapPop( TIMING *pt, TIMEVAL *pKey )
+{
+    uint    node = pt->pHeapNode[0], i = 0, child;
+    TIMEVAL key;
+
+    *pKey = pt->pHeapKey[0];
+    pt->HeapCount--;
+    key = pt->pHeapKey[pt->HeapCount];
+    for(;;)
+    {
+        child = i*2+1;
+        if( child >= pt->HeapCount )
+            break;
+        if( child+1 < pt->HeapCount && pt->pHeapKey[child+1] < pt->pHeapKey[child] )
+            child++;
+        if( key <= pt->pHeapKey[child] )
+            break;
+        pt->pHeapKey[i]  = pt->pHeapKey[child];
+        pt->pHeapNode[i] = pt->pHeapNode[child];
+        i = child;
+    }
+    pt->pHeapKey[i]  = key;
+    pt->pHeapNode[i] = pt->pHeapNode[pt->HeapCount];
+    return(node);
+}
+
+
+/*
+// TimeAdd
+//
+// Returns the sum of two cycle counts, where TIME_UNBOUNDED absorbs
+*/
+static TIMEVAL TimeAdd( TIMEVAL a, TIMEVAL b )
+{
+    if( a==TIME_UNBOUNDED || b==TIME_UNBOUNDED )
+        return(TIME_UNBOUNDED);
+    return(a+b);
+}
+
+
+/*
+// AddrName
+//
+// Writes a code address as "label", "label+N", or a number when there
+// is no label before it
+//
+// Returns buf
+*/
+static char *AddrName( TIMING *pt, uint addr, char *buf )
+{
+    TLABEL *pl = 0;
+    uint   i;
+
+    for( i=0; i<pt->LabelCount && pt->pLabel[i].Offset<=addr; i++ )
+        if( !pl || pt->pLabel[i].Offset!=pl->Offset )
+            pl = &pt->pLabel[i];
+
+    if( !pl )
+        sprintf( buf, "0x%04x", addr );
+    else if( pl->Offset==addr )
+        sprintf( buf, "%s", pl->Name );
+    else
+        sprintf( buf, "%s+%u", pl->Name, addr-pl->Offset );
+    return(buf);
+}
+
+
+/*
+// ParseAddr
+//
+// Reads a code address given as "label", "label+N", "label-N", or a
+// number
+//
+// Returns 1 on success, 0 on error
+*/
+static int ParseAddr( TIMING *pt, char *text, uint *pAddr )
+{
+    char name[TOKEN_MAX_LEN+16], *pOff, *pEnd;
+    uint i, off = 0;
+    int  sign = 0;
+
+    strcpy( name, text );
+    if( name[0]>='0' && name[0]<='9' )
+    {
+        *pAddr = (uint)strtoul( name, &pEnd, 0 );
+        if( *pEnd )
+            { Report(0,REP_ERROR,"Bad timing address '%s'",text); return(0); }
+    }
+    else
+    {
+        pOff = strpbrk( name, "+-" );
+        if( pOff )
+        {
+            sign = *pOff=='-' ? -1 : 1;
+            *pOff++ = 0;
+            off = (uint)strtoul( pOff, &pEnd, 0 );
+            if( *pEnd || pEnd==pOff )
+                { Report(0,REP_ERROR,"Bad timing address '%s'",text); return(0); }
+        }
+        for( i=0; i<pt->LabelCount; i++ )
+            if( !strcmp( pt->pLabel[i].Name, name ) )
+                break;
+        if( i==pt->LabelCount )
+            { Report(0,REP_ERROR,"Unknown timing label '%s'",name); return(0); }
+        *pAddr = pt->pLabel[i].Offset + sign*(int)off;
+    }
+    if( *pAddr >= pt->Count )
+        { Report(0,REP_ERROR,"Timing address '%s' is outside the code",text); return(0); }
+    return(1);
+}
+
+
+/*
+// PrintResult
+//
+// Writes one line of the timing table, and the loop that leaves the
+// worst case without a bound
+//
+// void
+*/
+static void PrintResult( TIMING *pt, FILE *pf, char *from, char *to, TRESULT *pr )
+{
+    char top[TOKEN_MAX_LEN+16], bottom[TOKEN_MAX_LEN+16];
+
+    if( pr->Worst != TIME_UNBOUNDED )
+    {
+        fprintf(pf,"%-28s %-28s %10llu %10llu\n",from,to,pr->Best,pr->Worst);
+        return;
+    }
+    fprintf(pf,"%-28s %-28s %10llu %10s\n",from,to,pr->Best,"unbounded");
+    if( pr->fLoop )
+        fprintf(pf,"    loop %s..%s, %llu cycles per pass\n",AddrName( pt, pr->LoopTop, top ),
+                AddrName( pt, pr->LoopBottom, bottom ), pr->LoopCycles);
+    else
+        fprintf(pf,"    through a call that has no bound\n");
+}
+
+
+/*
+// CompareLabels
+//
+// qsort() compare of labels by address, then name
+*/
+static int CompareLabels( const void *a, const void *b )
+{
+    const TLABEL *pa = a, *pb = b;
+
+    if( pa->Offset != pb->Offset )
+        return( pa->Offset < pb->Offset ? -1 : 1 );
+    return( strcmp( pa->Name, pb->Name ) );
+}
@@ -55,6 +55,7 @@
 //---------------------------------------------------------------------------
 // Revision:
 //     21-Jun-13: 0.84 - Open source version
+//     18-Oct-26: 0.86 - Added field offset and width macros
 ============================================================================*/
 
 typedef struct _PRU_ARG {
@@ -85,6 +86,10 @@ typedef struct _PRU_ARG {
 #define FIELDTYPE_31_16             6   /* Bits 31:16 */
 #define FIELDTYPE_31_0              7   /* Bits 31:0 */
 
+/* Byte offset and byte width of a register field */
+#define FIELD_OFFSET(f)             ((f)<4 ? (f) : (f)<7 ? (f)-4 : 0)
+#define FIELD_BYTES(f)              ((f)<4 ? 1 : (f)<7 ? 2 : 4)
+
 #define FIELDTYPE_OFF_0             0   /* Offset bit 0 */
 #define FIELDTYPE_OFF_8             1   /* Offset bit 8 */
 #define FIELDTYPE_OFF_16            2   /* Offset bit 16 */
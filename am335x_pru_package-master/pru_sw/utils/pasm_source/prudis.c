@@ -0,0 +1,755 @@
+/*
+ * prudis.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prudis.c
+//
+// Description:
+//     PRU disassembler (see prudis.h)
+//         - Decode table for all code words
+//         - Operand decode into PRU_INST records
+//         - pasm source text for instructions and whole images
+//         - Round trip check through the assembler library
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added disassembler
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+
+/* Operand Formats */
+#define FMT_NONE        0       /* Not an instruction */
+#define FMT_ALU         1       /* OPCODE Rdst, Rsrc, OP(255) */
+#define FMT_JMP         2       /* JMP OP(65535), JAL Rdst, OP(65535) */
+#define FMT_LDI         3       /* LDI Rdst, IM(65535) */
+#define FMT_HALT        4       /* HALT */
+#define FMT_MVI         5       /* MVIx [*][--]Rdst[++], [*][--]Rsrc[++] */
+#define FMT_XFR         6       /* OPCODE IM(253), Rdst, OP(124) */
+#define FMT_LOOP        7       /* OPCODE LoopDest, OP(256) */
+#define FMT_SLP         8       /* SLP IM(1) */
+#define FMT_QB          9       /* OPCODE JmpDest, Rsrc, OP(255) */
+#define FMT_QBA         10      /* QBA JmpDest */
+#define FMT_QBIT        11      /* OPCODE JmpDest, Rsrc, OP(31) */
+#define FMT_BURST       12      /* OPCODE Rdst, Rbase/Cbase, OP(255), OP(124) */
+
+/* Decode Table Entry */
+typedef struct _DECODE {
+    unsigned char   Op;         /* OP_xxx (first of the group for MVI, XFR, LOOP) */
+    unsigned char   Format;     /* FMT_xxx */
+} DECODE;
+
+#define D1(op,fmt)      { op, fmt }
+#define D4(op,fmt)      D1(op,fmt), D1(op,fmt), D1(op,fmt), D1(op,fmt)
+#define D8(op,fmt)      D4(op,fmt), D4(op,fmt)
+#define NONE            D1(0,FMT_NONE)
+
+/*
+// Decode Table, indexed by bits 31:25 of the code word
+//
+// The quick branches keep their condition in bits 29:27, and the bursts
+// keep part of their length in bits 27:25, so they fill 4 or 8 entries.
+*/
+static const DECODE DecodeTable[128] = {
+    /* 0x00 */
+    D1(OP_ADD,FMT_ALU),  D1(OP_ADC,FMT_ALU),  D1(OP_SUB,FMT_ALU),  D1(OP_SUC,FMT_ALU),
+    D1(OP_LSL,FMT_ALU),  D1(OP_LSR,FMT_ALU),  D1(OP_RSB,FMT_ALU),  D1(OP_RSC,FMT_ALU),
+    D1(OP_AND,FMT_ALU),  D1(OP_OR,FMT_ALU),   D1(OP_XOR,FMT_ALU),  D1(OP_NOT,FMT_ALU),
+    D1(OP_MIN,FMT_ALU),  D1(OP_MAX,FMT_ALU),  D1(OP_CLR,FMT_ALU),  D1(OP_SET,FMT_ALU),
+    /* 0x10 (SCAN at 0x14 is V1 only) */
+    D1(OP_JMP,FMT_JMP),  D1(OP_JAL,FMT_JMP),  D1(OP_LDI,FMT_LDI),  D1(OP_LMBD,FMT_ALU),
+    NONE,                D1(OP_HALT,FMT_HALT),D1(OP_MVIB,FMT_MVI), D1(OP_XIN,FMT_XFR),
+    D1(OP_LOOP,FMT_LOOP),NONE,                NONE,                NONE,
+    NONE,                NONE,                NONE,                D1(OP_SLP,FMT_SLP),
+    /* 0x20 */
+    D4(0,FMT_NONE),      D4(OP_QBLT,FMT_QB),  D4(OP_QBEQ,FMT_QB),  D4(OP_QBLE,FMT_QB),
+    /* 0x30 */
+    D4(OP_QBGT,FMT_QB),  D4(OP_QBNE,FMT_QB),  D4(OP_QBGE,FMT_QB),  D4(OP_QBA,FMT_QBA),
+    /* 0x40 */
+    D8(OP_SBCO,FMT_BURST), D8(OP_LBCO,FMT_BURST),
+    /* 0x50 */
+    D1(OP_NOP0,FMT_ALU), D1(OP_NOP1,FMT_ALU), D1(OP_NOP2,FMT_ALU), D1(OP_NOP3,FMT_ALU),
+    D1(OP_NOP4,FMT_ALU), D1(OP_NOP5,FMT_ALU), D1(OP_NOP6,FMT_ALU), D1(OP_NOP7,FMT_ALU),
+    D1(OP_NOP8,FMT_ALU), D1(OP_NOP9,FMT_ALU), D1(OP_NOPA,FMT_ALU), D1(OP_NOPB,FMT_ALU),
+    D1(OP_NOPC,FMT_ALU), D1(OP_NOPD,FMT_ALU), D1(OP_NOPE,FMT_ALU), D1(OP_NOPF,FMT_ALU),
+    /* 0x60 */
+    D4(0,FMT_NONE),      D4(OP_QBBC,FMT_QBIT),D4(OP_QBBS,FMT_QBIT),D4(0,FMT_NONE),
+    /* 0x70 */
+    D8(OP_SBBO,FMT_BURST), D8(OP_LBBO,FMT_BURST),
+};
+
+/* Register field for each byte offset of a transfer or burst register */
+static const uint ByteField[4] = { FIELDTYPE_31_0, FIELDTYPE_15_8,
+                                   FIELDTYPE_23_16, FIELDTYPE_31_24 };
+
+/* Generated label names */
+#define GENNAME_LEN     12
+
+/* Local Support Funtions */
+static void SetReg( PRU_ARG *pa, uint word, int shift );
+static void SetRegOffset( PRU_ARG *pa, uint reg, uint offset );
+static void SetOp2( PRU_ARG *pa, uint word );
+static void SetLength( PRU_ARG *pa, uint code );
+static void SetValue( PRU_ARG *pa, uint type, uint value );
+static int  SetPointer( PRU_ARG *pa, uint mode );
+static int  IsRetReg( PRU_ARG *pa );
+static int  ArgTarget( const PRU_INST *inst, uint i, uint pc, int *pTarget );
+static int  Append( char **ppText, uint *pLen, uint *pSize, char *s );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// prudis_opcode
+//
+// Looks up the operation of a code word in the decode table. The
+// operation is the one the core performs, so MOV is OP_AND, CALL is
+// OP_JAL, and WBS is OP_QBBC. Unused bits are not checked.
+//
+// Returns the operation (OP_xxx), or 0 if the word is not an instruction
+*/
+int prudis_opcode( unsigned int word )
+{
+    const DECODE *pd = &DecodeTable[word>>25];
+
+    switch( pd->Format )
+    {
+    case FMT_MVI:       /* The size picks MVIB, MVIW, or MVID */
+        if( ((word>>16) & 3) == 3 )
+            return(0);
+        return( OP_MVIB + ((word>>16) & 3) );
+
+    case FMT_XFR:       /* XIN, XOUT, XCHG, then the scratch pad shift forms */
+        if( !((word>>23) & 3) )
+            return(0);
+        return( OP_XIN + ((word>>23) & 3) - 1 + ((word & (1<<14)) ? 3 : 0) );
+
+    case FMT_LOOP:
+        return( (word & (1<<15)) ? OP_ILOOP : OP_LOOP );
+    }
+    return( pd->Op );
+}
+
+
+/*
+// prudis_decode
+//
+// Decodes a code word into the operation and operands pasm would take
+// to write it, using MOV, CALL, RET, WBC, WBS, ZERO, and FILL where they
+// apply. The operands are in source order. Jump targets are ARGTYPE_IMMEDIATE
+// code addresses; branch and loop targets are ARGTYPE_OFFSET values
+// relative to the instruction.
+//
+// Returns 0 on success, or -1 if the word can not be written as an
+// instruction (.codeword is needed)
+*/
+int prudis_decode( unsigned int word, PRU_INST *inst )
+{
+    const DECODE *pd = &DecodeTable[word>>25];
+    uint reg, offset, code, dev, itype;
+    int  jmpoff;
+
+    memset( inst, 0, sizeof(PRU_INST) );
+    if( !(inst->Op = prudis_opcode( word )) )
+        return(-1);
+
+    switch( pd->Format )
+    {
+    case FMT_ALU:
+        SetReg( &inst->Arg[0], word, 0 );
+        SetReg( &inst->Arg[1], word, 8 );
+        SetOp2( &inst->Arg[2], word );
+        inst->ArgCnt = 3;
+
+        /* AND with both sources the same is how MOV is coded */
+        if( inst->Op==OP_AND && inst->Arg[2].Type==ARGTYPE_REGISTER &&
+                inst->Arg[2].Value==inst->Arg[1].Value &&
+                inst->Arg[2].Field==inst->Arg[1].Field )
+        {
+            inst->Op     = OP_MOV;
+            inst->ArgCnt = 2;
+        }
+        return(0);
+
+    case FMT_JMP:
+        /* Bits 15:8 are unused in the register form, and 7:0 in JMP */
+        if( inst->Op==OP_JMP && (word & 0xFF) )
+            return(-1);
+        SetReg( &inst->Arg[0], word, 0 );
+        if( word & (1<<24) )
+            SetValue( &inst->Arg[1], ARGTYPE_IMMEDIATE, (word>>8) & 0xFFFF );
+        else if( word & 0xFF00 )
+            return(-1);
+        else
+            SetReg( &inst->Arg[1], word, 16 );
+        inst->ArgCnt = 2;
+
+        /* CALL and RET go through the default return register */
+        if( inst->Op==OP_JAL && IsRetReg( &inst->Arg[0] ) )
+            inst->Op = OP_CALL;
+        else if( inst->Op==OP_JMP && IsRetReg( &inst->Arg[1] ) )
+            { inst->Op = OP_RET; inst->ArgCnt = 0; }
+        if( inst->Op==OP_JMP || inst->Op==OP_CALL )
+        {
+            inst->Arg[0] = inst->Arg[1];
+            inst->ArgCnt = 1;
+        }
+        return(0);
+
+    case FMT_LDI:
+        if( word & (1<<24) )
+            return(-1);
+        SetReg( &inst->Arg[0], word, 0 );
+        SetValue( &inst->Arg[1], ARGTYPE_IMMEDIATE, (word>>8) & 0xFFFF );
+        inst->ArgCnt = 2;
+        return(0);
+
+    case FMT_HALT:
+        if( word & 0x1FFFFFF )
+            return(-1);
+        return(0);
+
+    case FMT_SLP:
+        if( word & 0x17FFFFF )
+            return(-1);
+        SetValue( &inst->Arg[0], ARGTYPE_IMMEDIATE, (word>>23) & 1 );
+        inst->ArgCnt = 1;
+        return(0);
+
+    case FMT_MVI:
+        /* pasm does not write the R0 byte form (bits 20:18) */
+        itype = (word>>21) & 0xF;
+        if( (word & (7<<18)) || !itype )
+            return(-1);
+        SetReg( &inst->Arg[0], word, 0 );
+        SetReg( &inst->Arg[1], word, 8 );
+        if( !SetPointer( &inst->Arg[0], itype>>2 ) || !SetPointer( &inst->Arg[1], itype&3 ) )
+            return(-1);
+        inst->ArgCnt = 2;
+        return(0);
+
+    case FMT_XFR:
+        reg    = word & 0x1F;
+        offset = (word>>5) & 3;
+        code   = (word>>7) & 0x7F;
+        dev    = (word>>15) & 0xFF;
+
+        /* ZERO and FILL are XIN from devices 255 and 254 */
+        if( inst->Op==OP_XIN && dev>=254 )
+        {
+            if( code>=124 || reg*4+offset+code+1 > 124 )
+                return(-1);
+            inst->Op = (dev==255) ? OP_ZERO : OP_FILL;
+            SetValue( &inst->Arg[0], ARGTYPE_IMMEDIATE, reg*4+offset );
+            SetValue( &inst->Arg[1], ARGTYPE_IMMEDIATE, code+1 );
+            inst->ArgCnt = 2;
+            return(0);
+        }
+        if( dev>253 || reg==31 )
+            return(-1);
+        SetValue( &inst->Arg[0], ARGTYPE_IMMEDIATE, dev );
+        SetRegOffset( &inst->Arg[1], reg, offset );
+        SetLength( &inst->Arg[2], code );
+        inst->ArgCnt = 3;
+        return(0);
+
+    case FMT_LOOP:
+        /* The loop end must be past the first loop instruction */
+        if( (word & 0x7F00) || (word & 0xFF) < 2 )
+            return(-1);
+        SetValue( &inst->Arg[0], ARGTYPE_OFFSET, word & 0xFF );
+        if( word & (1<<24) )
+            SetValue( &inst->Arg[1], ARGTYPE_IMMEDIATE, ((word>>16) & 0xFF) + 1 );
+        else
+            SetReg( &inst->Arg[1], word, 16 );
+        inst->ArgCnt = 2;
+        return(0);
+
+    case FMT_QB:
+    case FMT_QBA:
+    case FMT_QBIT:
+        jmpoff = (word & 0xFF) | ((word>>17) & 0x300);
+        if( jmpoff & 0x200 )
+            jmpoff -= 0x400;
+        SetValue( &inst->Arg[0], ARGTYPE_OFFSET, (uint)jmpoff );
+        inst->ArgCnt = 1;
+        if( pd->Format==FMT_QBA )
+        {
+            if( (word & 0x1FFFF00) != (1<<24) )
+                return(-1);
+            return(0);
+        }
+        SetReg( &inst->Arg[1], word, 8 );
+        SetOp2( &inst->Arg[2], word );
+        inst->ArgCnt = 3;
+        if( pd->Format==FMT_QB )
+            return(0);
+
+        /* Bit tests take bit numbers, and a branch to self is a wait */
+        if( inst->Arg[2].Type==ARGTYPE_IMMEDIATE && inst->Arg[2].Value>31 )
+            return(-1);
+        if( !jmpoff )
+        {
+            inst->Op     = (inst->Op==OP_QBBC) ? OP_WBS : OP_WBC;
+            inst->Arg[0] = inst->Arg[1];
+            inst->Arg[1] = inst->Arg[2];
+            inst->ArgCnt = 2;
+        }
+        return(0);
+
+    case FMT_BURST:
+        code = ((word>>21) & 0x70) | ((word>>12) & 0x0E) | ((word>>7) & 1);
+        SetRegOffset( &inst->Arg[0], word & 0x1F, (word>>5) & 3 );
+        if( inst->Op==OP_SBCO || inst->Op==OP_LBCO )
+            SetValue( &inst->Arg[1], ARGTYPE_CONSTANT, (word>>8) & 0x1F );
+        else
+            SetRegOffset( &inst->Arg[1], (word>>8) & 0x1F, 0 );
+        SetOp2( &inst->Arg[2], word );
+        SetLength( &inst->Arg[3], code );
+        inst->ArgCnt = 4;
+        return(0);
+    }
+    return(-1);
+}
+
+
+/*
+// prudis_text
+//
+// Writes the pasm source text of a decoded instruction at code address
+// pc to buf, which must hold PRUDIS_TEXT_LEN characters. When names is
+// not 0, it holds count+1 entries, one for each code address from 0 to
+// count, and targets with a name are written by name.
+//
+// Returns buf
+*/
+char *prudis_text( const PRU_INST *inst, unsigned int pc, const char * const *names,
+                   unsigned int count, char *buf )
+{
+    const PRU_ARG *pa;
+    PRU_ARG reg;
+    char    *p;
+    uint    i;
+    int     target;
+
+    p = buf + sprintf( buf, inst->ArgCnt ? "%-7s " : "%s",
+                       KeywordText( TOKID_OPCODE+inst->Op ) );
+
+    for( i=0; i<inst->ArgCnt; i++ )
+    {
+        pa = &inst->Arg[i];
+        if( i )
+            p += sprintf( p, ", " );
+
+        if( ArgTarget( inst, i, pc, &target ) )
+        {
+            if( names && target>=0 && (uint)target<=count && names[target] )
+                p += sprintf( p, "%s", names[target] );
+            else
+                p += sprintf( p, "%d", target );
+            continue;
+        }
+
+        switch( pa->Type )
+        {
+        case ARGTYPE_REGISTER:
+            if( pa->Flags & PA_FLG_REGPOINTER )
+                *p++ = '*';
+            if( pa->Flags & PA_FLG_PREDEC )
+                p += sprintf( p, "--" );
+            RegisterText( (PRU_ARG *)pa, p );
+            p += strlen( p );
+            if( pa->Flags & PA_FLG_POSTINC )
+                p += sprintf( p, "++" );
+            break;
+
+        case ARGTYPE_IMMEDIATE:
+            /* ZERO and FILL start at a register file byte address */
+            if( i==0 && (inst->Op==OP_ZERO || inst->Op==OP_FILL) )
+            {
+                SetRegOffset( &reg, pa->Value/4, pa->Value%4 );
+                *p++ = '&';
+                RegisterText( &reg, p );
+                p += strlen( p );
+            }
+            else if( pa->Value < 256 )
+                p += sprintf( p, "%u", pa->Value );
+            else
+                p += sprintf( p, "0x%x", pa->Value );
+            break;
+
+        case ARGTYPE_CONSTANT:
+            p += sprintf( p, "%s", ConstantText( pa->Value ) );
+            break;
+
+        case ARGTYPE_R0BYTE:
+            p += sprintf( p, "b%u", pa->Value );
+            break;
+        }
+    }
+    *p = 0;
+    return(buf);
+}
+
+
+/*
+// prudis_source
+//
+// Disassembles an image into pasm source. Labels come from the image,
+// and every other branch, jump, and loop target inside the code gets a
+// generated name. Free the text with free().
+//
+// Returns the source text, or 0 on error
+*/
+char *prudis_source( const PASM_IMAGE *image, int flags )
+{
+    PRU_INST    inst;
+    const char  **ppNames;
+    char        *pGen, *pText, line[PRUDIS_TEXT_LEN+64], text[PRUDIS_TEXT_LEN];
+    uint        count, pc, i, len, size;
+    int         target, rc;
+
+    count   = image->CodeCount;
+    ppNames = calloc( count+1, sizeof(char *) );
+    pGen    = malloc( (count+1)*GENNAME_LEN );
+    pText   = 0;
+    len = size = 0;
+    if( !ppNames || !pGen )
+        goto DONE;
+
+    /* The first label at an address names it */
+    for( i=0; i<image->LabelCount; i++ )
+    {
+        if( image->pLabels[i].Offset<=count && !ppNames[image->pLabels[i].Offset] )
+            ppNames[image->pLabels[i].Offset] = image->pLabels[i].Name;
+    }
+
+    /* Name the other targets */
+    for( pc=0; pc<count; pc++ )
+    {
+        if( prudis_decode( image->pCode[pc], &inst )<0 )
+            continue;
+        for( i=0; i<inst.ArgCnt; i++ )
+        {
+            if( ArgTarget( &inst, i, pc, &target ) && target>=0 &&
+                    (uint)target<=count && !ppNames[target] )
+            {
+                sprintf( pGen+target*GENNAME_LEN, "L_%04x", target );
+                ppNames[target] = pGen+target*GENNAME_LEN;
+            }
+        }
+    }
+
+    sprintf( line, "// Disassembly of %u code words\n\n.origin 0\n", count );
+    rc = Append( &pText, &len, &size, line );
+    if( image->EntryPoint>=0 && (uint)image->EntryPoint<=count && ppNames[image->EntryPoint] )
+        sprintf( line, ".entrypoint %s\n\n", ppNames[image->EntryPoint] );
+    else if( image->EntryPoint>=0 )
+        sprintf( line, ".entrypoint %d\n\n", image->EntryPoint );
+    else
+        strcpy( line, "\n" );
+    rc &= Append( &pText, &len, &size, line );
+
+    for( pc=0; pc<=count && rc; pc++ )
+    {
+        if( ppNames[pc] )
+        {
+            sprintf( line, "%s:\n", ppNames[pc] );
+            rc &= Append( &pText, &len, &size, line );
+        }
+        if( pc==count )
+            break;
+
+        if( prudis_decode( image->pCode[pc], &inst )<0 )
+            sprintf( text, ".codeword 0x%08x", image->pCode[pc] );
+        else
+            prudis_text( &inst, pc, ppNames, count, text );
+        if( flags & PRUDIS_FLG_ADDRESS )
+            sprintf( line, "    %-44s // 0x%04x: 0x%08x\n", text, pc, image->pCode[pc] );
+        else
+            sprintf( line, "    %s\n", text );
+        rc &= Append( &pText, &len, &size, line );
+    }
+
+    if( !rc )
+    {
+        free( pText );
+        pText = 0;
+    }
+
+DONE:
+    free( ppNames );
+    free( pGen );
+    return(pText);
+}
+
+
+/*
+// prudis_verify
+//
+// Disassembles an image, assembles the source as V3 code, and compares
+// the code words. On a mismatch, *pAddr is set to the first code address
+// that differs (or to the shorter code count).
+//
+// Returns 0 if the words match, 1 if they differ, or -1 on error
+*/
+int prudis_verify( const PASM_IMAGE *image, unsigned int *pAddr )
+{
+    PASM_OPTIONS options;
+    PASM_IMAGE   result;
+    char *pText;
+    uint i;
+    int  rc;
+
+    if( !(pText = prudis_source( image, 0 )) )
+        return(-1);
+
+    memset( &options, 0, sizeof(options) );
+    options.Core = PASM_CORE_V3;
+    rc = pasm_assemble_buffer( pText, 0, &options, &result );
+    free( pText );
+    if( rc<0 )
+    {
+        pasm_free_image( &result );
+        return(-1);
+    }
+
+    for( i=0; i<image->CodeCount && i<result.CodeCount; i++ )
+    {
+        if( image->pCode[i] != result.pCode[i] )
+            break;
+    }
+    rc = 0;
+    if( i<image->CodeCount || i<result.CodeCount )
+    {
+        *pAddr = i;
+        rc = 1;
+    }
+
+    pasm_free_image( &result );
+    return(rc);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// SetReg
+//
+// Sets a register argument from the 5 bit register number at shift and
+// the field above it
+//
+// void
+*/
+static void SetReg( PRU_ARG *pa, uint word, int shift )
+{
+    pa->Type  = ARGTYPE_REGISTER;
+    pa->Value = (word>>shift) & 0x1F;
+    pa->Field = (word>>(shift+5)) & 7;
+}
+
+
+/*
+// SetRegOffset
+//
+// Sets a register argument from a register number and byte offset, as
+// used by the transfers and bursts
+//
+// void
+*/
+static void SetRegOffset( PRU_ARG *pa, uint reg, uint offset )
+{
+    memset( pa, 0, sizeof(PRU_ARG) );
+    pa->Type  = ARGTYPE_REGISTER;
+    pa->Value = reg;
+    pa->Field = ByteField[offset & 3];
+}
+
+
+/*
+// SetOp2
+//
+// Sets the OP(255) argument in bits 24:16 (a register or an immediate)
+//
+// void
+*/
+static void SetOp2( PRU_ARG *pa, uint word )
+{
+    if( word & (1<<24) )
+        SetValue( pa, ARGTYPE_IMMEDIATE, (word>>16) & 0xFF );
+    else
+        SetReg( pa, word, 16 );
+}
+
+
+/*
+// SetLength
+//
+// Sets a transfer length from its 7 bit code (1-124 bytes, or b0-b3)
+//
+// void
+*/
+static void SetLength( PRU_ARG *pa, uint code )
+{
+    if( code >= 124 )
+        SetValue( pa, ARGTYPE_R0BYTE, code-124 );
+    else
+        SetValue( pa, ARGTYPE_IMMEDIATE, code+1 );
+}
+
+
+/*
+// SetValue
+//
+// Sets an argument that is only a type and a value
+//
+// void
+*/
+static void SetValue( PRU_ARG *pa, uint type, uint value )
+{
+    memset( pa, 0, sizeof(PRU_ARG) );
+    pa->Type  = type;
+    pa->Value = value;
+}
+
+
+/*
+// SetPointer
+//
+// Marks an MVIx argument with its indirect mode (0 none, 1 *Rn, 2 *Rn++,
+// 3 *--Rn). Pointers must be R1.b0 through R1.b3.
+//
+// Returns 1 on success, 0 if the argument can not be a pointer
+*/
+static int SetPointer( PRU_ARG *pa, uint mode )
+{
+    if( !mode )
+        return(1);
+    if( pa->Value!=1 || pa->Field>FIELDTYPE_31_24 )
+        return(0);
+    pa->Flags = PA_FLG_REGPOINTER;
+    if( mode==2 )
+        pa->Flags |= PA_FLG_POSTINC;
+    else if( mode==3 )
+        pa->Flags |= PA_FLG_PREDEC;
+    return(1);
+}
+
+
+/*
+// IsRetReg
+//
+// Returns 1 if the argument is the default CALL return register
+*/
+static int IsRetReg( PRU_ARG *pa )
+{
+    return( pa->Type==ARGTYPE_REGISTER && pa->Value==DEFAULT_RETREGVAL &&
+            pa->Field==DEFAULT_RETREGFLD );
+}
+
+
+/*
+// ArgTarget
+//
+// Finds the code address an argument refers to, for the jump targets
+// and the branch and loop offsets
+//
+// Returns 1 if the argument is a code address, 0 if not
+*/
+static int ArgTarget( const PRU_INST *inst, uint i, uint pc, int *pTarget )
+{
+    const PRU_ARG *pa = &inst->Arg[i];
+
+    if( pa->Type==ARGTYPE_OFFSET )
+    {
+        *pTarget = (int)pc + (int)pa->Value;
+        return(1);
+    }
+    if( pa->Type==ARGTYPE_IMMEDIATE &&
+            (inst->Op==OP_JMP || inst->Op==OP_JAL || inst->Op==OP_CALL) )
+    {
+        *pTarget = (int)pa->Value;
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// Append
+//
+// Adds a string to the end of a growing text buffer
+//
+// Returns 1 on success, 0 on error
+*/
+static int Append( char **ppText, uint *pLen, uint *pSize, char *s )
+{
+    uint len = strlen(s);
+    char *pNew;
+
+    if( *pLen+len+1 > *pSize )
+    {
+        *pSize = (*pSize ? *pSize*2 : 4096) + len;
+        if( !(pNew = realloc( *ppText, *pSize )) )
+            return(0);
+        *ppText = pNew;
+    }
+    memcpy( *ppText+*pLen, s, len+1 );
+    *pLen += len;
+    return(1);
+}
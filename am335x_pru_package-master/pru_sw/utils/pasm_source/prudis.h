@@ -0,0 +1,146 @@
+/*
+ * prudis.h
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prudis.h
+//
+// Description:
+//     PRU disassembler
+//         - Decodes code words into PRU_INST records (pru_ins.h)
+//         - Writes pasm source that assembles back to the same words
+//         - Checks a disassembly by assembling it again
+//
+//     One decode table serves the disassembler, the simulator, and the
+//     timing analysis, so they always agree on what a code word is.
+//     Only little endian V3 (AM335x) code is decoded; anything else is
+//     written as .codeword. Include pasm.h for PRU_INST.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added disassembler
+============================================================================*/
+
+#ifndef _PRUDIS_H_
+#define _PRUDIS_H_
+
+#include "pasmlib.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Buffer size for prudis_text() */
+#define PRUDIS_TEXT_LEN     256
+
+/* prudis_source() flags */
+#define PRUDIS_FLG_ADDRESS  0x0001  /* Comment each line with its address and word */
+
+/*
+// prudis_opcode
+//
+// Looks up the operation of a code word in the decode table. The
+// operation is the one the core performs, so MOV is OP_AND, CALL is
+// OP_JAL, and WBS is OP_QBBC. Unused bits are not checked.
+//
+// Returns the operation (OP_xxx), or 0 if the word is not an instruction
+*/
+int prudis_opcode( unsigned int word );
+
+/*
+// prudis_decode
+//
+// Decodes a code word into the operation and operands pasm would take
+// to write it, using MOV, CALL, RET, WBC, WBS, ZERO, and FILL where they
+// apply. The operands are in source order. Jump targets are ARGTYPE_IMMEDIATE
+// code addresses; branch and loop targets are ARGTYPE_OFFSET values
+// relative to the instruction.
+//
+// Returns 0 on success, or -1 if the word can not be written as an
+// instruction (.codeword is needed)
+*/
+int prudis_decode( unsigned int word, PRU_INST *inst );
+
+/*
+// prudis_text
+//
+// Writes the pasm source text of a decoded instruction at code address
+// pc to buf, which must hold PRUDIS_TEXT_LEN characters. When names is
+// not 0, it holds count+1 entries, one for each code address from 0 to
+// count, and targets with a name are written by name.
+//
+// Returns buf
+*/
+char *prudis_text( const PRU_INST *inst, unsigned int pc, const char * const *names,
+                   unsigned int count, char *buf );
+
+/*
+// prudis_source
+//
+// Disassembles an image into pasm source. Labels come from the image,
+// and every other branch, jump, and loop target inside the code gets a
+// generated name. Free the text with free().
+//
+// Returns the source text, or 0 on error
+*/
+char *prudis_source( const PASM_IMAGE *image, int flags );
+
+/*
+// prudis_verify
+//
+// Disassembles an image, assembles the source as V3 code, and compares
+// the code words. On a mismatch, *pAddr is set to the first code address
+// that differs (or to the shorter code count).
+//
+// Returns 0 if the words match, 1 if they differ, or -1 on error
+*/
+int prudis_verify( const PASM_IMAGE *image, unsigned int *pAddr );
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * prudismain.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prudismain.c
+//
+// Description:
+//     Command line front end for the disassembler
+//         - Loads the code (and labels) from a .bin or .dbg file
+//         - Writes pasm source for it to stdout
+//         - Or checks that the source assembles back to the same words
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added disassembler
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+
+
+/* ---------- Local Macro Definitions ----------- */
+
+#define PROCESSOR_NAME_STRING ("PRU")
+#define VERSION_STRING        ("0.86")
+
+#define RET_ERROR             (1)
+#define RET_SUCCESS           (0)
+
+
+/*
+// Main Disassembler Entry Point
+//
+*/
+int main(int argc, char *argv[])
+{
+    PASM_IMAGE image;
+    PRU_INST inst;
+    char   *infile, *pText;
+    char   text[PRUDIS_TEXT_LEN];
+    unsigned int addr;
+    int    i, j, fVerify, flags, rc;
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    /*
+    // Process command line
+    */
+    infile  = 0;
+    fVerify = 0;
+    flags   = 0;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' )
+        {
+            if( infile )
+                goto USAGE;
+            infile = argv[i];
+        }
+        else if( !strcmp( argv[i], "-a" ) )
+            flags |= PRUDIS_FLG_ADDRESS;
+        else if( !strcmp( argv[i], "-r" ) )
+            fVerify = 1;
+        else
+        {
+            printf("\nUnknown flag '%s'\n",argv[i]);
+            goto USAGE;
+        }
+    }
+    if( !infile )
+    {
+USAGE:
+        printf("\n\n%s Disassembler Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
+        printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+        printf("Usage: %s [-a] [-r] InFile\n\n",argv[0]);
+        printf("    InFile is a pView debug file (*.dbg) or a little endian\n");
+        printf("    binary (*.bin). With no extension, InFile.dbg is used if it\n");
+        printf("    exists, and InFile.bin otherwise. Labels come from the .dbg.\n");
+        printf("    The pasm source is written to stdout.\n\n");
+        printf("    a  - Comment each line with its code address and word\n");
+        printf("    r  - Round trip: assemble the source again and compare the\n");
+        printf("         code words with InFile instead of writing the source\n");
+        printf("\n");
+        return(RET_ERROR);
+    }
+
+    if( pasm_load_image( infile, &image ) < 0 )
+        return(RET_ERROR);
+
+    if( !fVerify )
+    {
+        if( !(pText = prudis_source( &image, flags )) )
+            { printf("Memory allocation failed\n"); pasm_free_image( &image ); return(RET_ERROR); }
+        fputs( pText, stdout );
+        free( pText );
+        pasm_free_image( &image );
+        return(RET_SUCCESS);
+    }
+
+    rc = prudis_verify( &image, &addr );
+    if( rc < 0 )
+        printf("%s: the disassembly did not assemble\n",infile);
+    else if( rc )
+    {
+        printf("%s: round trip differs at code address 0x%04x\n",infile,addr);
+        if( addr < image.CodeCount )
+        {
+            if( prudis_decode( image.pCode[addr], &inst ) < 0 )
+                sprintf( text, ".codeword 0x%08x", image.pCode[addr] );
+            else
+                prudis_text( &inst, addr, 0, 0, text );
+            printf("    0x%08x  %s\n", image.pCode[addr], text);
+        }
+    }
+    else
+        printf("%s: round trip matches (%u code words)\n",infile,image.CodeCount);
+
+    pasm_free_image( &image );
+    return( rc ? RET_ERROR : RET_SUCCESS );
+}
@@ -0,0 +1,486 @@
+/*
+ * prudis.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pruprof.c
+//
+// Description:
+//     Source level PRU profiler (see pruprof.h)
+//         - Sample counts per code address
+//         - Simulated sampling through prusim.c
+//         - Grouping of the counts by label and source line
+//         - Tree and folded stack reports
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added profiler
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+#include "pasmdbg.h"
+#include "pruprof.h"
+
+/*
+// Profile Row
+//
+// The samples of one source line under one label. Code with no source
+// line gets a row per code address, with Line set to 0.
+*/
+typedef struct _ROW {
+    unsigned int    Label;          /* Index into the sorted labels (count for none) */
+    unsigned int    File;
+    unsigned int    Line;
+    unsigned int    Addr;           /* First code address of the row */
+    unsigned long long Samples;
+    unsigned long long LabelSamples;/* Samples of all the rows of the label */
+} ROW;
+
+/* Rows and the labels they refer to */
+typedef struct _ROWSET {
+    const PASM_LABEL **ppLabels;    /* Labels by address, one per address */
+    unsigned int    LabelCount;
+    ROW             *pRows;         /* Hottest label first, then hottest line */
+    unsigned int    RowCount;
+} ROWSET;
+
+/* Local Support Funtions */
+static int BuildRows( PRUPROF *prof, ROWSET *rs );
+static void FreeRows( ROWSET *rs );
+static char *RowName( PRUPROF *prof, ROW *row, char *buf );
+static void PrintRow( FILE *out, const char *name, unsigned int addr,
+                      unsigned long long samples, unsigned long long total );
+static int CompareLabels( const void *a, const void *b );
+static int CompareLines( const void *a, const void *b );
+static int CompareHeat( const void *a, const void *b );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// pruprof_init
+//
+// Sets up an empty profile of an image. The image is not copied and must
+// stay valid while the profile is used. Free the profile with
+// pruprof_free().
+//
+// Returns 0 on success, -1 on error
+*/
+int pruprof_init( PRUPROF *prof, const PASM_IMAGE *image )
+{
+    memset( prof, 0, sizeof(PRUPROF) );
+    prof->pImage   = image;
+    prof->pSamples = calloc( image->CodeCount+1, sizeof(unsigned long long) );
+    if( !prof->pSamples )
+        return(-1);
+    return(0);
+}
+
+
+/*
+// pruprof_free
+//
+// Frees the counts of a profile
+//
+// void
+*/
+void pruprof_free( PRUPROF *prof )
+{
+    free( prof->pSamples );
+    prof->pSamples = 0;
+}
+
+
+/*
+// pruprof_sample
+//
+// Adds one program counter sample. Running is 0 when the PRU was halted,
+// in which case the Pc is not counted against the code.
+//
+// void
+*/
+void pruprof_sample( PRUPROF *prof, unsigned int pc, int running )
+{
+    prof->Samples++;
+    if( !running )
+        prof->Halted++;
+    else if( pc >= prof->pImage->CodeCount )
+        prof->Outside++;
+    else
+        prof->pSamples[pc]++;
+}
+
+
+/*
+// pruprof_simulate
+//
+// Runs the simulator until the program stops or max_cycles have run,
+// taking a sample every interval cycles, starting with the first.
+// With an interval of 1, the samples per code address are the cycles
+// per code address.
+//
+// Returns the simulator status
+*/
+int pruprof_simulate( PRUPROF *prof, PRUSIM *sim, unsigned long long max_cycles,
+                      unsigned int interval )
+{
+    unsigned long long next;
+    unsigned int pc;
+    int status;
+
+    if( !interval )
+        interval = 1;
+    next = (sim->Cycles + interval - 1) / interval * interval;
+
+    for(;;)
+    {
+        /* Every sample point in the cycles of the step lands on its Pc */
+        pc = sim->Pc;
+        status = prusim_step( sim );
+        for( ; next < sim->Cycles; next += interval )
+            pruprof_sample( prof, pc, 1 );
+
+        if( status != PRUSIM_RUNNING )
+            return(status);
+        if( sim->Cycles >= max_cycles )
+            return( sim->Status = PRUSIM_LIMIT );
+    }
+}
+
+
+/*
+// pruprof_report
+//
+// Prints the sample totals, then one row per label with the rows of its
+// source lines below it, hottest first. A label covers the code from its
+// address up to the next label. Code with no source line is shown by
+// address.
+//
+// void
+*/
+void pruprof_report( PRUPROF *prof, FILE *out )
+{
+    ROWSET rs;
+    ROW    *row;
+    char   name[PRUDIS_TEXT_LEN+DBGFILE_NAMELEN_SHORT];
+    unsigned long long total;
+    unsigned int i;
+
+    total = prof->Samples - prof->Halted - prof->Outside;
+    fprintf(out,"Samples   : %llu\n", prof->Samples);
+    fprintf(out,"Halted    : %llu\n", prof->Halted);
+    fprintf(out,"Outside   : %llu\n", prof->Outside);
+
+    if( !total )
+        return;
+    if( !BuildRows( prof, &rs ) )
+        { fprintf(out,"Memory allocation failed\n"); return; }
+
+    fprintf(out,"\n%-32s %6s %10s %7s\n","Label / Line","Addr","Samples","%");
+    for( i=0; i<rs.RowCount; i++ )
+    {
+        row = &rs.pRows[i];
+        if( !i || row->Label != row[-1].Label )
+        {
+            if( row->Label < rs.LabelCount )
+                PrintRow( out, rs.ppLabels[row->Label]->Name,
+                          rs.ppLabels[row->Label]->Offset, row->LabelSamples, total );
+            else
+                PrintRow( out, "-", row->Addr, row->LabelSamples, total );
+        }
+        name[0] = name[1] = ' ';
+        RowName( prof, row, name+2 );
+        PrintRow( out, name, row->Addr, row->Samples, total );
+    }
+
+    FreeRows( &rs );
+}
+
+
+/*
+// pruprof_folded
+//
+// Prints one "label;file:line samples" row per source line, the folded
+// stack format read by flame graph tools
+//
+// void
+*/
+void pruprof_folded( PRUPROF *prof, FILE *out )
+{
+    ROWSET rs;
+    ROW    *row;
+    char   name[PRUDIS_TEXT_LEN+DBGFILE_NAMELEN_SHORT];
+    unsigned int i;
+
+    if( !BuildRows( prof, &rs ) )
+        { fprintf(stderr,"Memory allocation failed\n"); return; }
+
+    for( i=0; i<rs.RowCount; i++ )
+    {
+        row = &rs.pRows[i];
+        fprintf(out,"%s;%s %llu\n",
+                row->Label < rs.LabelCount ? rs.ppLabels[row->Label]->Name : "-",
+                RowName( prof, row, name ), row->Samples);
+    }
+
+    FreeRows( &rs );
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// BuildRows
+//
+// Groups the sampled code addresses into rows by label and source line,
+// and orders them for the reports
+//
+// Returns 1 on success, 0 on error
+*/
+static int BuildRows( PRUPROF *prof, ROWSET *rs )
+{
+    const PASM_IMAGE *image = prof->pImage;
+    unsigned long long *pTotals;
+    unsigned int addr, label, i, j;
+    ROW *row;
+
+    memset( rs, 0, sizeof(ROWSET) );
+    rs->ppLabels = malloc( image->LabelCount*sizeof(PASM_LABEL *) + 1 );
+    rs->pRows    = malloc( image->CodeCount*sizeof(ROW) + 1 );
+    pTotals      = calloc( image->LabelCount+1, sizeof(unsigned long long) );
+    if( !rs->ppLabels || !rs->pRows || !pTotals )
+        { free( pTotals ); FreeRows( rs ); return(0); }
+
+    /* Labels inside the code by address, keeping the first name of each */
+    for( i=0; i<image->LabelCount; i++ )
+        if( image->pLabels[i].Offset < image->CodeCount )
+            rs->ppLabels[rs->LabelCount++] = &image->pLabels[i];
+    qsort( rs->ppLabels, rs->LabelCount, sizeof(PASM_LABEL *), CompareLabels );
+    for( i=j=0; i<rs->LabelCount; i++ )
+        if( !j || rs->ppLabels[i]->Offset != rs->ppLabels[j-1]->Offset )
+            rs->ppLabels[j++] = rs->ppLabels[i];
+    rs->LabelCount = j;
+
+    /* One row per sampled code address */
+    label = rs->LabelCount;
+    for( addr=0, j=0; addr<image->CodeCount; addr++ )
+    {
+        while( j<rs->LabelCount && rs->ppLabels[j]->Offset <= addr )
+            label = j++;
+        if( !prof->pSamples[addr] )
+            continue;
+
+        row = &rs->pRows[rs->RowCount++];
+        memset( row, 0, sizeof(ROW) );
+        row->Label   = label;
+        row->Addr    = addr;
+        row->Samples = prof->pSamples[addr];
+        if( image->pLines && image->pLines[addr].Line )
+        {
+            row->File = image->pLines[addr].File;
+            row->Line = image->pLines[addr].Line;
+        }
+    }
+
+    /* Merge the addresses of each source line */
+    qsort( rs->pRows, rs->RowCount, sizeof(ROW), CompareLines );
+    for( i=j=0; i<rs->RowCount; i++ )
+    {
+        row = &rs->pRows[i];
+        if( j && row->Line && row->Label == rs->pRows[j-1].Label &&
+                row->File == rs->pRows[j-1].File && row->Line == rs->pRows[j-1].Line )
+            rs->pRows[j-1].Samples += row->Samples;
+        else
+            rs->pRows[j++] = *row;
+    }
+    rs->RowCount = j;
+
+    for( i=0; i<rs->RowCount; i++ )
+        pTotals[rs->pRows[i].Label] += rs->pRows[i].Samples;
+    for( i=0; i<rs->RowCount; i++ )
+        rs->pRows[i].LabelSamples = pTotals[rs->pRows[i].Label];
+    qsort( rs->pRows, rs->RowCount, sizeof(ROW), CompareHeat );
+
+    free( pTotals );
+    return(1);
+}
+
+
+/*
+// FreeRows
+//
+// Frees the rows and labels built by BuildRows()
+//
+// void
+*/
+static void FreeRows( ROWSET *rs )
+{
+    free( rs->ppLabels );
+    free( rs->pRows );
+    memset( rs, 0, sizeof(ROWSET) );
+}
+
+
+/*
+// RowName
+//
+// Writes "file:line" for a row, or the address and instruction when it
+// has no source line. Buf must hold PRUDIS_TEXT_LEN+DBGFILE_NAMELEN_SHORT
+// characters.
+//
+// Returns buf
+*/
+static char *RowName( PRUPROF *prof, ROW *row, char *buf )
+{
+    const PASM_IMAGE *image = prof->pImage;
+    PRU_INST inst;
+
+    if( row->Line )
+        sprintf( buf, "%s:%u", row->File < image->FileCount ? image->ppFiles[row->File] : "?",
+                 row->Line );
+    else
+    {
+        sprintf( buf, "0x%04x: ", row->Addr );
+        if( prudis_decode( image->pCode[row->Addr], &inst ) < 0 )
+            sprintf( buf+8, ".codeword 0x%08x", image->pCode[row->Addr] );
+        else
+            prudis_text( &inst, row->Addr, 0, 0, buf+8 );
+    }
+    return(buf);
+}
+
+
+/*
+// PrintRow
+//
+// Prints one report row with its share of the samples as a bar
+//
+// void
+*/
+static void PrintRow( FILE *out, const char *name, unsigned int addr,
+                      unsigned long long samples, unsigned long long total )
+{
+    unsigned int len;
+
+    fprintf(out,"%-32s 0x%04x %10llu %6.2f%%",name,addr,samples,100.0*samples/total);
+    len = (unsigned int)((samples*PRUPROF_BAR_LEN+total/2)/total);
+    if( len )
+        fputs( "  ", out );
+    for( ; len; len-- )
+        fputc( '#', out );
+    fputc( '\n', out );
+}
+
+
+/*
+// CompareLabels
+//
+// qsort() callback to order labels by address
+*/
+static int CompareLabels( const void *a, const void *b )
+{
+    const PASM_LABEL *pa = *(const PASM_LABEL * const *)a;
+    const PASM_LABEL *pb = *(const PASM_LABEL * const *)b;
+
+    if( pa->Offset != pb->Offset )
+        return( pa->Offset < pb->Offset ? -1 : 1 );
+    return( strcmp( pa->Name, pb->Name ) );
+}
+
+
+/*
+// CompareLines
+//
+// qsort() callback to order rows by label, source line, and address
+*/
+static int CompareLines( const void *a, const void *b )
+{
+    const ROW *pa = (const ROW *)a;
+    const ROW *pb = (const ROW *)b;
+
+    if( pa->Label != pb->Label )
+        return( pa->Label < pb->Label ? -1 : 1 );
+    if( pa->File != pb->File )
+        return( pa->File < pb->File ? -1 : 1 );
+    if( pa->Line != pb->Line )
+        return( pa->Line < pb->Line ? -1 : 1 );
+    if( pa->Addr != pb->Addr )
+        return( pa->Addr < pb->Addr ? -1 : 1 );
+    return(0);
+}
+
+
+/*
+// CompareHeat
+//
+// qsort() callback to order rows by the samples of their label, then by
+// their own samples, both highest first
+*/
+static int CompareHeat( const void *a, const void *b )
+{
+    const ROW *pa = (const ROW *)a;
+    const ROW *pb = (const ROW *)b;
+
+    if( pa->LabelSamples != pb->LabelSamples )
+        return( pa->LabelSamples > pb->LabelSamples ? -1 : 1 );
+    if( pa->Label != pb->Label )
+        return( pa->Label < pb->Label ? -1 : 1 );
+    if( pa->Samples != pb->Samples )
+        return( pa->Samples > pb->Samples ? -1 : 1 );
+    if( pa->Addr != pb->Addr )
+        return( pa->Addr < pb->Addr ? -1 : 1 );
+    return(0);
+}
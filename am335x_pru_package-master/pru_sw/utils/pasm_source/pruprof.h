@@ -0,0 +1,158 @@
+/*
+ * pruprof.h
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pruprof.h
+//
+// Description:
+//     Source level PRU profiler
+//         - Counts program counter samples per code address, taken from
+//           the PRU STATUS register or from the simulator
+//         - Maps the samples to labels and source lines through the
+//           line table of a .dbg image
+//         - Prints a label and line tree with bars, or folded stacks
+//           for flame graph tools
+//
+//     A sample shows the instruction the PRU was executing, so with
+//     enough samples the counts are in proportion to cycles.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added profiler
+============================================================================*/
+
+#ifndef _PRUPROF_H_
+#define _PRUPROF_H_
+
+#include <stdio.h>
+#include "prusim.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Width of the bars in pruprof_report() */
+#define PRUPROF_BAR_LEN     40
+
+/* Profile */
+typedef struct _PRUPROF {
+    const PASM_IMAGE *pImage;       /* Code, labels, and source lines */
+    unsigned long long *pSamples;   /* Samples per code address */
+    unsigned long long Samples;     /* All samples taken */
+    unsigned long long Halted;      /* Samples taken with the PRU halted */
+    unsigned long long Outside;     /* Samples with the Pc outside the code */
+} PRUPROF;
+
+/*
+// pruprof_init
+//
+// Sets up an empty profile of an image. The image is not copied and must
+// stay valid while the profile is used. Free the profile with
+// pruprof_free().
+//
+// Returns 0 on success, -1 on error
+*/
+int pruprof_init( PRUPROF *prof, const PASM_IMAGE *image );
+
+/*
+// pruprof_free
+//
+// Frees the counts of a profile
+//
+// void
+*/
+void pruprof_free( PRUPROF *prof );
+
+/*
+// pruprof_sample
+//
+// Adds one program counter sample. Running is 0 when the PRU was halted,
+// in which case the Pc is not counted against the code.
+//
+// void
+*/
+void pruprof_sample( PRUPROF *prof, unsigned int pc, int running );
+
+/*
+// pruprof_simulate
+//
+// Runs the simulator until the program stops or max_cycles have run,
+// taking a sample every interval cycles, starting with the first.
+// With an interval of 1, the samples per code address are the cycles
+// per code address.
+//
+// Returns the simulator status
+*/
+int pruprof_simulate( PRUPROF *prof, PRUSIM *sim, unsigned long long max_cycles,
+                      unsigned int interval );
+
+/*
+// pruprof_report
+//
+// Prints the sample totals, then one row per label with the rows of its
+// source lines below it, hottest first. A label covers the code from its
+// address up to the next label. Code with no source line is shown by
+// address.
+//
+// void
+*/
+void pruprof_report( PRUPROF *prof, FILE *out );
+
+/*
+// pruprof_folded
+//
+// Prints one "label;file:line samples" row per source line, the folded
+// stack format read by flame graph tools
+//
+// void
+*/
+void pruprof_folded( PRUPROF *prof, FILE *out );
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * pruprofmain.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : pruprofmain.c
+//
+// Description:
+//     Command line front end for the profiler
+//         - Loads the code, labels, and source lines from a .dbg file
+//         - Samples the program counter of a running PRU through
+//           prussdrv, or runs the program in the simulator
+//         - Prints the profile report or folded stacks
+//
+//     Sampling the PRU needs prussdrv, so it is only built in when
+//     PRUPROF_PRUSSDRV is defined (see linuxbuild). The simulated
+//     profile is always available.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     18-Oct-26: 0.86 - Added profiler
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+#include "pruprof.h"
+#ifdef PRUPROF_PRUSSDRV
+#include <unistd.h>
+#include <prussdrv.h>
+#endif
+
+
+/* ---------- Local Macro Definitions ----------- */
+
+#define PROCESSOR_NAME_STRING ("PRU")
+#define VERSION_STRING        ("0.86")
+
+#define DEFAULT_MAX_CYCLES    (100000000ULL)
+#define DEFAULT_SAMPLES       (100000)
+#define DEFAULT_INTERVAL_US   (10)
+#define DEFAULT_INTERVAL_CYC  (1)
+
+#define RET_ERROR             (1)
+#define RET_SUCCESS           (0)
+
+/* Local Support Funtions */
+static int SamplePru( PRUPROF *prof, unsigned int pru, unsigned int count,
+                      unsigned int interval );
+
+/*
+// Main Profiler Entry Point
+//
+*/
+int main(int argc, char *argv[])
+{
+    PRUPROF prof;
+    PRUSIM sim;
+    PASM_IMAGE image;
+    char   *infile, *flags;
+    unsigned long long maxcycles;
+    unsigned int interval, count, pru;
+    int    i, j, fSim, fFolded, fInterval, rc;
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    /*
+    // Process command line
+    */
+    infile    = 0;
+    fSim      = 0;
+    fFolded   = 0;
+    fInterval = 0;
+    interval  = 0;
+    count     = DEFAULT_SAMPLES;
+    pru       = 0;
+    maxcycles = DEFAULT_MAX_CYCLES;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' )
+        {
+            if( infile )
+                goto USAGE;
+            infile = argv[i];
+            continue;
+        }
+        flags = argv[i]+1;
+        if( *flags == 's' && !flags[1] )
+            fSim = 1;
+        else if( *flags == 'f' && !flags[1] )
+            fFolded = 1;
+        else if( *flags == 'i' && flags[1] )
+            { interval = strtoul( flags+1, 0, 0 ); fInterval = 1; }
+        else if( *flags == 'n' && flags[1] )
+            count = strtoul( flags+1, 0, 0 );
+        else if( *flags == 'P' && flags[1] )
+            pru = strtoul( flags+1, 0, 0 );
+        else if( *flags == 'c' && flags[1] )
+            maxcycles = strtoull( flags+1, 0, 0 );
+        else if( *flags == 'p' )
+            continue;
+        else
+        {
+            printf("\nUnknown flag '%s'\n",argv[i]);
+            goto USAGE;
+        }
+    }
+    if( !infile )
+    {
+USAGE:
+        printf("\n\n%s Profiler Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
+        printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+        printf("Usage: %s [-s] [-f] [-i#] [-n#] [-P#] [-c#] [-paddr:bit:low:high] InFile\n\n",argv[0]);
+        printf("    InFile is the pView debug file (*.dbg) of the program on the\n");
+        printf("    PRU. With no extension, InFile.dbg is used if it exists, and\n");
+        printf("    InFile.bin otherwise (with no labels or source lines).\n\n");
+        printf("    s  - Run the program in the simulator instead of sampling the PRU\n");
+        printf("    f  - Print folded stacks for flame graph tools instead of the report\n");
+        printf("    i  - Sample every # microseconds (Default is %d), or with -s,\n",DEFAULT_INTERVAL_US);
+        printf("         every # cycles (Default is %d)\n",DEFAULT_INTERVAL_CYC);
+        printf("    n  - Take # samples from the PRU (Default is %d)\n",DEFAULT_SAMPLES);
+        printf("    P  - Sample PRU # (Default is 0)\n");
+        printf("    c  - With -s, stop after # cycles (Default is %llu)\n",DEFAULT_MAX_CYCLES);
+        printf("    p  - With -s, drive an input pin, as prusim does\n");
+#ifndef PRUPROF_PRUSSDRV
+        printf("\n    This build can not sample the PRU, so -s is required.\n");
+#endif
+        printf("\n");
+        return(RET_ERROR);
+    }
+
+    /* Load the program */
+    if( pasm_load_image( infile, &image ) < 0 )
+        return(RET_ERROR);
+    if( pruprof_init( &prof, &image ) < 0 )
+        { printf("Memory allocation failed\n"); pasm_free_image( &image ); return(RET_ERROR); }
+
+    rc = RET_SUCCESS;
+    if( fSim )
+    {
+        if( !fInterval )
+            interval = DEFAULT_INTERVAL_CYC;
+        if( prusim_init( &sim, image.pCode, image.CodeCount,
+                         image.EntryPoint<0 ? 0 : image.EntryPoint ) < 0 )
+            { printf("Memory allocation failed\n"); rc = RET_ERROR; goto DONE; }
+        for( i=1; i<argc; i++ )
+        {
+            if( argv[i][0] == '-' && argv[i][1] == 'p' && prusim_parse_pin( &sim, argv[i]+2 ) < 0 )
+            {
+                printf("\nBad pin '%s'\n\n",argv[i]+2);
+                prusim_free( &sim );
+                rc = RET_ERROR;
+                goto DONE;
+            }
+        }
+        pruprof_simulate( &prof, &sim, maxcycles, interval );
+        if( !fFolded )
+            printf("Source    : simulator, a sample every %u cycle(s)\nCycles    : %llu\n",
+                   interval ? interval : 1, sim.Cycles);
+        prusim_free( &sim );
+    }
+    else
+    {
+        if( !fInterval )
+            interval = DEFAULT_INTERVAL_US;
+        if( !SamplePru( &prof, pru, count, interval ) )
+            { rc = RET_ERROR; goto DONE; }
+        if( !fFolded )
+            printf("Source    : PRU%u, a sample every %u us\n", pru, interval);
+    }
+
+    if( fFolded )
+        pruprof_folded( &prof, stdout );
+    else
+        pruprof_report( &prof, stdout );
+
+DONE:
+    pruprof_free( &prof );
+    pasm_free_image( &image );
+    return(rc);
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// SamplePru
+//
+// Takes count samples of the program counter of a running PRU, interval
+// microseconds apart (or as fast as the registers can be read when it
+// is 0). The PRU is not stopped or reloaded.
+//
+// Returns 1 on success, 0 on error
+*/
+static int SamplePru( PRUPROF *prof, unsigned int pru, unsigned int count,
+                      unsigned int interval )
+{
+#ifdef PRUPROF_PRUSSDRV
+    unsigned int pc, i;
+    int running;
+
+    if( prussdrv_init() < 0 || prussdrv_open( PRU_EVTOUT_0 ) < 0 )
+        { printf("Unable to open the PRUSS (is uio_pruss loaded?)\n"); return(0); }
+
+    for( i=0; i<count; i++ )
+    {
+        if( (running = prussdrv_pru_read_pc( pru, &pc )) < 0 )
+            { printf("No PRU%u\n",pru); prussdrv_exit(); return(0); }
+        pruprof_sample( prof, pc, running );
+        if( interval )
+            usleep( interval );
+    }
+
+    prussdrv_exit();
+    return(1);
+#else
+    printf("This build can not sample the PRU, use -s to profile in the simulator\n");
+    return(0);
+#endif
+}
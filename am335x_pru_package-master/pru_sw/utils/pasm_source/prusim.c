@@ -0,0 +1,985 @@
+/*
+ * prusim.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prusim.c
+//
+// Description:
+//     Cycle counting PRU instruction set simulator
+//         - Decodes and executes V3 code words
+//         - Models the register file, constant table, local memory,
+//           scratch pad, input pins, and the LOOP hardware
+//         - Keeps instruction and cycle counts per code address,
+//           and records every loop seen while running
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added simulator
+//     18-Oct-26: 0.86 - Decode through the prudis.c decode table
+//     18-Oct-26: 0.86 - Added prusim_parse_pin() (from prusimmain.c)
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+
+/* Register Fields (in FIELDTYPE order) */
+static const unsigned int FieldShift[8] = { 0, 8, 16, 24, 0, 8, 16, 0 };
+static const unsigned int FieldMask[8]  = { 0xFF, 0xFF, 0xFF, 0xFF,
+                                            0xFFFF, 0xFFFF, 0xFFFF, 0xFFFFFFFF };
+static const unsigned int FieldBits[8]  = { 8, 8, 8, 8, 16, 16, 16, 32 };
+
+/* AM335x Constant Table */
+static const unsigned int ConstDefault[32] = PRUSIM_CONST_TABLE;
+
+/* XIN/XOUT Device IDs */
+#define XFR_SCRATCH0        10
+#define XFR_SCRATCH2        12
+#define XFR_FILL            254
+#define XFR_ZERO            255
+
+/* Output Trace Tags (see TraceWrite) */
+#define TRACE_XOUT          0xFFFF0000      /* + device*128 + byte */
+#define TRACE_R30           0xFFFFFF1E
+#define TRACE_EVENT         0xFFFFFF1F
+
+
+/* Local Support Funtions */
+static unsigned int GetField( PRUSIM *sim, unsigned int reg, unsigned int field );
+static void SetField( PRUSIM *sim, unsigned int reg, unsigned int field, unsigned int val );
+static unsigned int GetOp2( PRUSIM *sim, unsigned int op );
+static unsigned int GetRegByte( PRUSIM *sim, unsigned int idx );
+static void SetRegByte( PRUSIM *sim, unsigned int idx, unsigned int val );
+static unsigned int GetLength( PRUSIM *sim, unsigned int code );
+static unsigned int GetPin( PRUSIM *sim, PRUSIM_PIN *pin );
+static unsigned int ReadByte( PRUSIM *sim, unsigned int addr );
+static void WriteByte( PRUSIM *sim, unsigned int addr, unsigned int val );
+static void TraceWrite( PRUSIM *sim, unsigned int addr, unsigned int val );
+static unsigned int Arithmetic( PRUSIM *sim, unsigned int op );
+static unsigned int Burst( PRUSIM *sim, unsigned int op, unsigned int addr );
+static int Transfer( PRUSIM *sim, unsigned int op );
+static void MoveIndirect( PRUSIM *sim, unsigned int op );
+static void RecordLoop( PRUSIM *sim, unsigned int top, unsigned int bottom );
+static int CompareLabels( const void *a, const void *b );
+
+
+/*===================================================================
+//
+// Public Functions
+//
+====================================================================*/
+
+/*
+// prusim_init
+//
+// Sets up a simulator for the supplied code words, starting at EntryPoint.
+// The code is not copied and must stay valid while the simulator is used.
+// The registers and memory start at zero, and the constant table and costs
+// start at their AM335x defaults. Free the simulator with prusim_free().
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_init( PRUSIM *sim, const unsigned int *code, unsigned int count,
+                 unsigned int entry_point )
+{
+    memset( sim, 0, sizeof(PRUSIM) );
+    sim->pCode     = code;
+    sim->CodeCount = count;
+    sim->Pc        = entry_point;
+    memcpy( sim->Const, ConstDefault, sizeof(sim->Const) );
+
+    sim->Costs.LocalLoad   = PRUSIM_COST_LOCAL_LOAD;
+    sim->Costs.LocalStore  = PRUSIM_COST_LOCAL_STORE;
+    sim->Costs.SystemLoad  = PRUSIM_COST_SYSTEM_LOAD;
+    sim->Costs.SystemStore = PRUSIM_COST_SYSTEM_STORE;
+
+    sim->pMem        = calloc( PRUSIM_LOCAL_SIZE, 1 );
+    sim->pExecCount  = calloc( count+1, sizeof(unsigned long long) );
+    sim->pCycleCount = calloc( count+1, sizeof(unsigned long long) );
+    if( !sim->pMem || !sim->pExecCount || !sim->pCycleCount )
+    {
+        prusim_free( sim );
+        return(-1);
+    }
+    return(0);
+}
+
+
+/*
+// prusim_free
+//
+// Frees the memory and counters of a simulator
+//
+// void
+*/
+void prusim_free( PRUSIM *sim )
+{
+    free( sim->pMem );
+    free( sim->pExecCount );
+    free( sim->pCycleCount );
+    sim->pMem        = 0;
+    sim->pExecCount  = 0;
+    sim->pCycleCount = 0;
+}
+
+
+/*
+// prusim_add_pin
+//
+// Adds an input pin wave form (see PRUSIM_PIN)
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_add_pin( PRUSIM *sim, unsigned int addr, unsigned int bit,
+                    unsigned int low, unsigned int high )
+{
+    PRUSIM_PIN *pin;
+
+    if( sim->PinCount==PRUSIM_MAX_PINS || bit>31 || !(low+high) )
+        return(-1);
+    if( addr!=PRUSIM_PIN_R31 && (addr & 3) )
+        return(-1);
+
+    pin = &sim->Pins[sim->PinCount++];
+    pin->Addr = addr;
+    pin->Bit  = bit;
+    pin->Low  = low;
+    pin->High = high;
+    return(0);
+}
+
+
+/*
+// prusim_parse_pin
+//
+// Adds an input pin written as "addr:bit:low:high", where addr may also
+// be r31 (the prusim -p flag)
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_parse_pin( PRUSIM *sim, const char *arg )
+{
+    unsigned int val[4];
+    char *pEnd;
+    int  i;
+
+    if( !strncmp( arg, "r31", 3 ) || !strncmp( arg, "R31", 3 ) )
+    {
+        val[0] = PRUSIM_PIN_R31;
+        pEnd = (char *)arg+3;
+    }
+    else
+        val[0] = strtoul( arg, &pEnd, 0 );
+
+    for( i=1; i<4; i++ )
+    {
+        if( *pEnd != ':' )
+            return(-1);
+        val[i] = strtoul( pEnd+1, &pEnd, 0 );
+    }
+    if( *pEnd )
+        return(-1);
+
+    return( prusim_add_pin( sim, val[0], val[1], val[2], val[3] ) );
+}
+
+
+/*
+// prusim_step
+//
+// Executes one instruction
+//
+// Returns the simulator status (PRUSIM_RUNNING while it can continue)
+*/
+int prusim_step( PRUSIM *sim )
+{
+    unsigned int pc, op, next, cycles, i, take, r, op2;
+    int offset, fReturn = 0;
+
+    if( sim->Status != PRUSIM_RUNNING )
+        return(sim->Status);
+    if( sim->Pc >= sim->CodeCount )
+        return( sim->Status = PRUSIM_BADPC );
+
+    pc     = sim->Pc;
+    op     = sim->pCode[pc];
+    next   = pc+1;
+    cycles = 1;
+
+    /* R31 reads back the input pins */
+    for( i=0; i<sim->PinCount; i++ )
+    {
+        if( sim->Pins[i].Addr == PRUSIM_PIN_R31 )
+        {
+            sim->R[31] &= ~(1u << sim->Pins[i].Bit);
+            sim->R[31] |= GetPin( sim, &sim->Pins[i] ) << sim->Pins[i].Bit;
+        }
+    }
+
+    switch( prudis_opcode( op ) )
+    {
+    case OP_ADD:
+    case OP_ADC:
+    case OP_SUB:
+    case OP_SUC:
+    case OP_LSL:
+    case OP_LSR:
+    case OP_RSB:
+    case OP_RSC:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_NOT:
+    case OP_MIN:
+    case OP_MAX:
+    case OP_CLR:
+    case OP_SET:
+    case OP_LMBD:
+        cycles = Arithmetic( sim, op );
+        break;
+
+    case OP_JMP:
+    case OP_JAL:
+        if( op & (1<<24) )
+            next = (op>>8) & 0xFFFF;
+        else
+        {
+            next = GetField( sim, (op>>16)&0x1F, (op>>21)&7 );
+            fReturn = 1;
+        }
+        if( (op>>25) & 1 )
+            SetField( sim, op&0x1F, (op>>5)&7, pc+1 );
+        break;
+
+    case OP_LDI:
+        SetField( sim, op&0x1F, (op>>5)&7, (op>>8)&0xFFFF );
+        break;
+
+    case OP_HALT:
+        sim->Status = PRUSIM_HALT;
+        next = pc;
+        break;
+
+    case OP_MVIB:
+    case OP_MVIW:
+    case OP_MVID:
+        MoveIndirect( sim, op );
+        break;
+
+    case OP_XIN:
+    case OP_XOUT:
+    case OP_XCHG:
+    case OP_SXIN:
+    case OP_SXOUT:
+    case OP_SXCHG:
+        if( !Transfer( sim, op ) )
+            return( sim->Status = PRUSIM_ILLEGAL );
+        break;
+
+    case OP_LOOP:
+    case OP_ILOOP:
+        if( op & (1<<24) )
+            r = ((op>>16) & 0xFF) + 1;
+        else
+            r = GetField( sim, (op>>16)&0x1F, (op>>21)&7 );
+        if( !r )
+            next = pc + (op & 0xFF);
+        else
+        {
+            sim->LoopTop   = pc+1;
+            sim->LoopEnd   = pc + (op & 0xFF);
+            sim->LoopCount = r;
+        }
+        break;
+
+    case OP_SLP:
+        sim->Status = PRUSIM_SLEEP;
+        next = pc;
+        break;
+
+    case OP_QBGT:   /* The condition bits are LT, EQ, GT of OP against Rn */
+    case OP_QBLT:
+    case OP_QBEQ:
+    case OP_QBGE:
+    case OP_QBLE:
+    case OP_QBNE:
+    case OP_QBA:
+        r   = GetField( sim, (op>>8)&0x1F, (op>>13)&7 );
+        op2 = GetOp2( sim, op );
+        take = (op>>27) & 7;
+        if( ((take & 1) && op2<r) || ((take & 2) && op2==r) || ((take & 4) && op2>r) )
+        {
+            offset = (op & 0xFF) | ((op>>17) & 0x300);
+            if( offset & 0x200 )
+                offset -= 0x400;
+            next = pc + offset;
+        }
+        break;
+
+    case OP_SBCO:
+    case OP_LBCO:
+        cycles = Burst( sim, op, sim->Const[(op>>8)&0x1F] + GetOp2( sim, op ) );
+        break;
+
+    case OP_NOP0:
+    case OP_NOP1:
+    case OP_NOP2:
+    case OP_NOP3:
+    case OP_NOP4:
+    case OP_NOP5:
+    case OP_NOP6:
+    case OP_NOP7:
+    case OP_NOP8:
+    case OP_NOP9:
+    case OP_NOPA:
+    case OP_NOPB:
+    case OP_NOPC:
+    case OP_NOPD:
+    case OP_NOPE:
+    case OP_NOPF:
+        break;
+
+    case OP_QBBC:   /* Also WBS */
+    case OP_QBBS:   /* Also WBC */
+        r    = GetField( sim, (op>>8)&0x1F, (op>>13)&7 );
+        take = (r >> (GetOp2( sim, op ) & 0x1F)) & 1;
+        if( ((op>>27) & 0x1F) == 0x19 )
+            take = !take;
+        if( take )
+        {
+            offset = (op & 0xFF) | ((op>>17) & 0x300);
+            if( offset & 0x200 )
+                offset -= 0x400;
+            next = pc + offset;
+        }
+        break;
+
+    case OP_SBBO:
+    case OP_LBBO:
+        cycles = Burst( sim, op, sim->R[(op>>8)&0x1F] + GetOp2( sim, op ) );
+        break;
+
+    default:        /* SCAN and the unused opcodes */
+        return( sim->Status = PRUSIM_ILLEGAL );
+    }
+
+    /* The LOOP hardware branches back at the end of the loop for free */
+    if( sim->LoopEnd )
+    {
+        if( next < sim->LoopTop || next > sim->LoopEnd )
+            sim->LoopEnd = 0;
+        else if( next == sim->LoopEnd && pc+1 == next )
+        {
+            if( --sim->LoopCount )
+                next = sim->LoopTop;
+            else
+                sim->LoopEnd = 0;
+        }
+    }
+    /* Jumps through a register (as RET) are not counted as loops */
+    if( next <= pc && !fReturn && sim->Status == PRUSIM_RUNNING )
+        RecordLoop( sim, next, pc );
+
+    sim->pExecCount[pc]++;
+    sim->pCycleCount[pc] += cycles;
+    sim->Instructions++;
+    sim->Cycles += cycles;
+    sim->Pc = next;
+
+    return(sim->Status);
+}
+
+
+/*
+// prusim_run
+//
+// Executes instructions until the program stops or max_cycles have run
+//
+// Returns the simulator status
+*/
+int prusim_run( PRUSIM *sim, unsigned long long max_cycles )
+{
+    while( prusim_step( sim ) == PRUSIM_RUNNING )
+    {
+        if( sim->Cycles >= max_cycles )
+            return( sim->Status = PRUSIM_LIMIT );
+    }
+    return(sim->Status);
+}
+
+
+/*
+// prusim_report
+//
+// Prints the totals, then the cycles spent under each label and in each
+// loop. A label covers the code from its address up to the next label.
+// Labels may be 0.
+//
+// void
+*/
+void prusim_report( PRUSIM *sim, const PASM_LABEL *labels, unsigned int label_count,
+                    FILE *out )
+{
+    static const char *StatusText[] = { "running", "HALT", "SLP", "cycle limit",
+                                        "code address out of range",
+                                        "instruction not simulated" };
+    const PASM_LABEL **ppSorted;
+    const char *name;
+    unsigned long long exec, cycles;
+    unsigned int i, j, k, end;
+
+    fprintf(out,"Stopped   : %s at 0x%04x\n", StatusText[sim->Status], sim->Pc);
+    fprintf(out,"Cycles    : %llu\n", sim->Cycles);
+    fprintf(out,"Instrs    : %llu\n", sim->Instructions);
+    if( sim->Events )
+        fprintf(out,"Events    : %u (last R31 write 0x%02x)\n", sim->Events, sim->LastEvent);
+
+    ppSorted = 0;
+    if( label_count )
+    {
+        ppSorted = malloc( label_count * sizeof(PASM_LABEL *) );
+        if( !ppSorted )
+            label_count = 0;
+        for( i=0; i<label_count; i++ )
+            ppSorted[i] = &labels[i];
+        if( label_count )
+            qsort( ppSorted, label_count, sizeof(PASM_LABEL *), CompareLabels );
+    }
+
+    if( label_count )
+    {
+        fprintf(out,"\n%-24s %6s %10s %12s %14s %10s\n",
+                "Label","Addr","Entries","Instrs","Cycles","Cyc/Entry");
+        for( i=0; i<label_count; i++ )
+        {
+            if( ppSorted[i]->Offset >= sim->CodeCount )
+                continue;
+            end = sim->CodeCount;
+            for( j=i+1; j<label_count; j++ )
+            {
+                if( ppSorted[j]->Offset > ppSorted[i]->Offset )
+                {
+                    end = ppSorted[j]->Offset;
+                    break;
+                }
+            }
+            if( end > sim->CodeCount )
+                end = sim->CodeCount;
+
+            exec = cycles = 0;
+            for( k=ppSorted[i]->Offset; k<end; k++ )
+            {
+                exec   += sim->pExecCount[k];
+                cycles += sim->pCycleCount[k];
+            }
+            fprintf(out,"%-24s 0x%04x %10llu %12llu %14llu",ppSorted[i]->Name,
+                    ppSorted[i]->Offset,sim->pExecCount[ppSorted[i]->Offset],exec,cycles);
+            if( sim->pExecCount[ppSorted[i]->Offset] )
+                fprintf(out," %10.2f\n",(double)cycles/sim->pExecCount[ppSorted[i]->Offset]);
+            else
+                fprintf(out," %10s\n","-");
+        }
+    }
+
+    if( sim->LoopCountSeen )
+    {
+        fprintf(out,"\n%-24s %13s %10s %10s %14s %10s\n",
+                "Loop","Range","Passes","Repeats","Cycles","Cyc/Pass");
+        for( i=0; i<sim->LoopCountSeen; i++ )
+        {
+            PRUSIM_LOOP *pl = &sim->Loops[i];
+
+            name = "-";
+            for( j=0; j<label_count; j++ )
+            {
+                if( ppSorted[j]->Offset == pl->Top )
+                {
+                    name = ppSorted[j]->Name;
+                    break;
+                }
+            }
+
+            cycles = 0;
+            for( k=pl->Top; k<=pl->Bottom; k++ )
+                cycles += sim->pCycleCount[k];
+            exec = sim->pExecCount[pl->Top];
+            fprintf(out,"%-24s 0x%04x-0x%04x %10llu %10llu %14llu",name,
+                    pl->Top,pl->Bottom,exec,pl->Repeats,cycles);
+            if( exec )
+                fprintf(out," %10.2f\n",(double)cycles/exec);
+            else
+                fprintf(out," %10s\n","-");
+        }
+    }
+
+    free( ppSorted );
+}
+
+
+/*===================================================================
+//
+// Private Functions
+//
+====================================================================*/
+
+/*
+// GetField
+//
+// Returns the value of a register field
+*/
+static unsigned int GetField( PRUSIM *sim, unsigned int reg, unsigned int field )
+{
+    return( (sim->R[reg] >> FieldShift[field]) & FieldMask[field] );
+}
+
+
+/*
+// SetField
+//
+// Writes a register field. A write to R31 sends an event instead of
+// changing the register, which reads back the inputs.
+//
+// void
+*/
+static void SetField( PRUSIM *sim, unsigned int reg, unsigned int field, unsigned int val )
+{
+    unsigned int old;
+
+    if( reg==31 )
+    {
+        sim->Events++;
+        sim->LastEvent = (val & FieldMask[field]) & 0xFF;
+        TraceWrite( sim, TRACE_EVENT, sim->LastEvent );
+        return;
+    }
+    old = sim->R[reg];
+    sim->R[reg] &= ~(FieldMask[field] << FieldShift[field]);
+    sim->R[reg] |= (val & FieldMask[field]) << FieldShift[field];
+    if( reg==30 && sim->R[30]!=old )
+        TraceWrite( sim, TRACE_R30, sim->R[30] );
+}
+
+
+/*
+// GetOp2
+//
+// Returns the value of the OP(255) operand in bits 16-24
+*/
+static unsigned int GetOp2( PRUSIM *sim, unsigned int op )
+{
+    if( op & (1<<24) )
+        return( (op>>16) & 0xFF );
+    return( GetField( sim, (op>>16)&0x1F, (op>>21)&7 ) );
+}
+
+
+/*
+// GetRegByte
+//
+// Returns a byte of the register file by its byte address (&Rn.bm)
+*/
+static unsigned int GetRegByte( PRUSIM *sim, unsigned int idx )
+{
+    idx &= 127;
+    return( (sim->R[idx>>2] >> ((idx&3)*8)) & 0xFF );
+}
+
+
+/*
+// SetRegByte
+//
+// Writes a byte of the register file by its byte address (&Rn.bm)
+//
+// void
+*/
+static void SetRegByte( PRUSIM *sim, unsigned int idx, unsigned int val )
+{
+    unsigned int old;
+
+    idx &= 127;
+    if( (idx>>2)==31 )
+        return;
+    old = sim->R[idx>>2];
+    sim->R[idx>>2] &= ~(0xFFu << ((idx&3)*8));
+    sim->R[idx>>2] |= (val & 0xFF) << ((idx&3)*8);
+    if( (idx>>2)==30 && sim->R[30]!=old )
+        TraceWrite( sim, TRACE_R30, sim->R[30] );
+}
+
+
+/*
+// GetLength
+//
+// Decodes a 7 bit transfer length, where 124-127 select R0.b0-R0.b3
+//
+// Returns the length in bytes
+*/
+static unsigned int GetLength( PRUSIM *sim, unsigned int code )
+{
+    if( code >= 124 )
+        return( GetRegByte( sim, code-124 ) );
+    return( code+1 );
+}
+
+
+/*
+// GetPin
+//
+// Returns the current level (0 or 1) of an input pin
+*/
+static unsigned int GetPin( PRUSIM *sim, PRUSIM_PIN *pin )
+{
+    return( (sim->Cycles % (pin->Low+pin->High)) >= pin->Low );
+}
+
+
+/*
+// ReadByte
+//
+// Reads a byte of the PRU address space
+//
+// Returns the byte
+*/
+static unsigned int ReadByte( PRUSIM *sim, unsigned int addr )
+{
+    unsigned int i, val;
+
+    if( addr < PRUSIM_LOCAL_SIZE )
+        return( sim->pMem[addr] );
+
+    val = 0;
+    for( i=0; i<sim->PinCount; i++ )
+    {
+        if( sim->Pins[i].Addr + sim->Pins[i].Bit/8 == addr )
+            val |= GetPin( sim, &sim->Pins[i] ) << (sim->Pins[i].Bit & 7);
+    }
+    return(val);
+}
+
+
+/*
+// WriteByte
+//
+// Writes a byte of the PRU address space. Writes outside the local
+// address space are dropped.
+//
+// void
+*/
+static void WriteByte( PRUSIM *sim, unsigned int addr, unsigned int val )
+{
+    TraceWrite( sim, addr, val & 0xFF );
+    if( addr < PRUSIM_LOCAL_SIZE )
+        sim->pMem[addr] = (unsigned char)val;
+}
+
+
+/*
+// TraceWrite
+//
+// Counts an output and folds it into the output hash, so that two runs
+// can be compared by what they wrote rather than how long they took.
+// R30 only counts when its value changes.
+// Stores use their address; R30, events, and XOUT use tags above the
+// PRU address space.
+//
+// void
+*/
+static void TraceWrite( PRUSIM *sim, unsigned int addr, unsigned int val )
+{
+    unsigned int h = sim->WriteHash ^ 2166136261u, i;
+
+    for( i=0; i<32; i+=8 )
+        h = (h ^ ((addr>>i) & 0xFF)) * 16777619u;
+    for( i=0; i<32; i+=8 )
+        h = (h ^ ((val>>i) & 0xFF)) * 16777619u;
+    sim->WriteHash = h;
+    sim->Writes++;
+}
+
+
+/*
+// Arithmetic
+//
+// Executes an instruction in the arithmetic format (including LMBD)
+//
+// Returns the cycle count
+*/
+static unsigned int Arithmetic( PRUSIM *sim, unsigned int op )
+{
+    unsigned long long r;
+    unsigned int s1, s2, width, i;
+    int fCarry = 0;
+
+    s1 = GetField( sim, (op>>8)&0x1F, (op>>13)&7 );
+    s2 = GetOp2( sim, op );
+    width = FieldBits[(op>>5)&7];
+
+    if( (op>>29) )
+    {
+        /* LMBD: number of the left most bit equal to OP bit 0, or 32 */
+        r = 32;
+        for( i=FieldBits[(op>>13)&7]; i>0; i-- )
+        {
+            if( ((s1>>(i-1)) & 1) == (s2 & 1) )
+            {
+                r = i-1;
+                break;
+            }
+        }
+        SetField( sim, op&0x1F, (op>>5)&7, (unsigned int)r );
+        return(1);
+    }
+
+    switch( (op>>25) & 0xF )
+    {
+    case 0x0: r = (unsigned long long)s1 + s2;              fCarry=1; break;
+    case 0x1: r = (unsigned long long)s1 + s2 + sim->Carry; fCarry=1; break;
+    case 0x2: r = (unsigned long long)s1 - s2;              fCarry=1; break;
+    case 0x3: r = (unsigned long long)s1 - s2 - sim->Carry; fCarry=1; break;
+    case 0x4: r = s1 << (s2 & 0x1F);                                  break;
+    case 0x5: r = s1 >> (s2 & 0x1F);                                  break;
+    case 0x6: r = (unsigned long long)s2 - s1;              fCarry=1; break;
+    case 0x7: r = (unsigned long long)s2 - s1 - sim->Carry; fCarry=1; break;
+    case 0x8: r = s1 & s2;                                            break;
+    case 0x9: r = s1 | s2;                                            break;
+    case 0xA: r = s1 ^ s2;                                            break;
+    case 0xB: r = ~s1;                                                break;
+    case 0xC: r = s1 < s2 ? s1 : s2;                                  break;
+    case 0xD: r = s1 > s2 ? s1 : s2;                                  break;
+    case 0xE: r = s1 & ~(1u << (s2 & 0x1F));                          break;
+    default:  r = s1 | (1u << (s2 & 0x1F));                           break;
+    }
+
+    if( fCarry )
+        sim->Carry = (unsigned int)(r >> width) & 1;
+    SetField( sim, op&0x1F, (op>>5)&7, (unsigned int)r );
+    return(1);
+}
+
+
+/*
+// Burst
+//
+// Executes LBBO, SBBO, LBCO, or SBCO at the supplied address
+//
+// Returns the cycle count
+*/
+static unsigned int Burst( PRUSIM *sim, unsigned int op, unsigned int addr )
+{
+    unsigned int reg, len, code, i, words;
+    int fLoad = (op>>28) & 1;
+
+    reg  = (op & 0x1F)*4 + ((op>>5) & 3);
+    code = ((op>>21) & 0x70) | ((op>>12) & 0x0E) | ((op>>7) & 1);
+    len  = GetLength( sim, code );
+
+    for( i=0; i<len; i++ )
+    {
+        if( fLoad )
+            SetRegByte( sim, reg+i, ReadByte( sim, addr+i ) );
+        else
+            WriteByte( sim, addr+i, GetRegByte( sim, reg+i ) );
+    }
+
+    words = (len+3)/4;
+    if( addr < PRUSIM_LOCAL_SIZE )
+        return( words + (fLoad ? sim->Costs.LocalLoad : sim->Costs.LocalStore) );
+    return( words + (fLoad ? sim->Costs.SystemLoad : sim->Costs.SystemStore) );
+}
+
+
+/*
+// Transfer
+//
+// Executes XIN, XOUT, or XCHG (including ZERO and FILL on V3). Only the
+// scratch pad banks are modelled; other devices read as zero.
+//
+// Returns 1 on success, 0 if the instruction is not simulated
+*/
+static int Transfer( PRUSIM *sim, unsigned int op )
+{
+    unsigned int dev, reg, len, i, t;
+    unsigned char *pBank = 0;
+
+    dev = (op>>15) & 0xFF;
+    reg = (op & 0x1F)*4 + ((op>>5) & 3);
+    len = GetLength( sim, (op>>7) & 0x7F );
+
+    if( dev>=XFR_SCRATCH0 && dev<=XFR_SCRATCH2 )
+        pBank = sim->Scratch[dev-XFR_SCRATCH0];
+
+    switch( (op>>23) & 3 )
+    {
+    case 1:     /* XIN */
+        for( i=0; i<len; i++ )
+        {
+            if( dev==XFR_FILL )
+                t = 0xFF;
+            else if( pBank )
+                t = pBank[(reg+i) & 127];
+            else
+                t = 0;
+            SetRegByte( sim, reg+i, t );
+        }
+        return(1);
+
+    case 2:     /* XOUT */
+        for( i=0; i<len; i++ )
+        {
+            t = GetRegByte( sim, reg+i );
+            TraceWrite( sim, TRACE_XOUT + dev*128 + ((reg+i) & 127), t );
+            if( pBank )
+                pBank[(reg+i) & 127] = (unsigned char)t;
+        }
+        return(1);
+
+    case 3:     /* XCHG */
+        for( i=0; pBank && i<len; i++ )
+        {
+            t = GetRegByte( sim, reg+i );
+            TraceWrite( sim, TRACE_XOUT + dev*128 + ((reg+i) & 127), t );
+            SetRegByte( sim, reg+i, pBank[(reg+i) & 127] );
+            pBank[(reg+i) & 127] = (unsigned char)t;
+        }
+        return(1);
+    }
+    return(0);
+}
+
+
+/*
+// MoveIndirect
+//
+// Executes MVIB, MVIW, or MVID. A pointer operand is a register byte
+// address held in R1.b0-R1.b3.
+//
+// void
+*/
+static void MoveIndirect( PRUSIM *sim, unsigned int op )
+{
+    unsigned int size, itype, mode, reg, field, ptr, i;
+    unsigned int addr[2];
+    int n;
+
+    size  = 1 << ((op>>16) & 3);
+    itype = (op>>21) & 0xF;
+
+    /* Operand 0 is the destination (bits 0-7), 1 the source (bits 8-15) */
+    for( n=1; n>=0; n-- )
+    {
+        mode  = n ? (itype & 3) : (itype >> 2);
+        reg   = (op >> (n*8)) & 0x1F;
+        field = (op >> (n*8+5)) & 7;
+
+        if( !mode )
+        {
+            addr[n] = reg*4 + FieldShift[field]/8;
+            continue;
+        }
+
+        ptr = GetField( sim, reg, field );
+        if( mode==3 )
+        {
+            ptr -= size;
+            SetField( sim, reg, field, ptr );
+        }
+        addr[n] = ptr;
+        if( op & (1<<20) )
+            addr[n] += GetRegByte( sim, (op>>18) & 3 );
+        if( mode==2 )
+            SetField( sim, reg, field, ptr+size );
+    }
+
+    for( i=0; i<size; i++ )
+        SetRegByte( sim, addr[0]+i, GetRegByte( sim, addr[1]+i ) );
+}
+
+
+/*
+// RecordLoop
+//
+// Counts a transfer back to the top of a loop
+//
+// void
+*/
+static void RecordLoop( PRUSIM *sim, unsigned int top, unsigned int bottom )
+{
+    unsigned int i;
+
+    for( i=0; i<sim->LoopCountSeen; i++ )
+    {
+        if( sim->Loops[i].Top==top && sim->Loops[i].Bottom==bottom )
+        {
+            sim->Loops[i].Repeats++;
+            return;
+        }
+    }
+    if( sim->LoopCountSeen < PRUSIM_MAX_LOOPS )
+    {
+        sim->Loops[sim->LoopCountSeen].Top     = top;
+        sim->Loops[sim->LoopCountSeen].Bottom  = bottom;
+        sim->Loops[sim->LoopCountSeen].Repeats = 1;
+        sim->LoopCountSeen++;
+    }
+}
+
+
+/*
+// CompareLabels
+//
+// qsort() callback to order labels by address
+*/
+static int CompareLabels( const void *a, const void *b )
+{
+    const PASM_LABEL *pa = *(const PASM_LABEL * const *)a;
+    const PASM_LABEL *pb = *(const PASM_LABEL * const *)b;
+
+    if( pa->Offset != pb->Offset )
+        return( pa->Offset < pb->Offset ? -1 : 1 );
+    return( strcmp( pa->Name, pb->Name ) );
+}
@@ -0,0 +1,248 @@
+/*
+ * prusim.h
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prusim.h
+//
+// Description:
+//     Cycle counting PRU instruction set simulator
+//         - Runs the code words of an assembled image (PASM_IMAGE,
+//           or the words of a .bin or .dbg file)
+//         - Models R0-R31, the constant table, the PRU local address
+//           space, scratch pad banks, and LOOP
+//         - Counts instructions and cycles for every code address
+//
+//     Only little endian V3 (AM335x) code is simulated. The cycle costs
+//     are a model of the core, not a measurement; see PRUSIM_COSTS.
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added simulator
+//     18-Oct-26: 0.86 - Added prusim_parse_pin()
+============================================================================*/
+
+#ifndef _PRUSIM_H_
+#define _PRUSIM_H_
+
+#include <stdio.h>
+#include "pasmlib.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Addresses below this are PRU local (data RAM, shared RAM, PRU-ICSS) */
+#define PRUSIM_LOCAL_SIZE   0x40000
+
+/*
+// Cycle Costs
+//
+// Every instruction takes one cycle, except the memory transfers. A
+// transfer of n bytes moves (n+3)/4 words, and costs the base cost for
+// its kind plus one cycle per word. Reads from outside the PRU local
+// address space go over the L3/L4 interconnect, and their base cost
+// stands in for the stall seen on real hardware.
+*/
+typedef struct _PRUSIM_COSTS {
+    unsigned int    LocalLoad;      /* LBBO/LBCO below PRUSIM_LOCAL_SIZE */
+    unsigned int    LocalStore;     /* SBBO/SBCO below PRUSIM_LOCAL_SIZE */
+    unsigned int    SystemLoad;     /* LBBO/LBCO elsewhere */
+    unsigned int    SystemStore;    /* SBBO/SBCO elsewhere */
+} PRUSIM_COSTS;
+#define PRUSIM_COST_LOCAL_LOAD      2
+#define PRUSIM_COST_LOCAL_STORE     1
+#define PRUSIM_COST_SYSTEM_LOAD     27
+#define PRUSIM_COST_SYSTEM_STORE    1
+
+/* AM335x Constant Table (C24-C31 are the programmable defaults) */
+#define PRUSIM_CONST_TABLE {                                \
+    0x00020000, 0x48040000, 0x4802A000, 0x00030000,         \
+    0x00026000, 0x48060000, 0x48030000, 0x00028000,         \
+    0x46000000, 0x4A100000, 0x48318000, 0x48022000,         \
+    0x48024000, 0x48310000, 0x481CC000, 0x481D0000,         \
+    0x481A0000, 0x4819C000, 0x48300000, 0x48302000,         \
+    0x48304000, 0x00032400, 0x480C8000, 0x480CA000,         \
+    0x00000000, 0x00002000, 0x0002E000, 0x00032000,         \
+    0x00000000, 0x49000000, 0x40000000, 0x80000000 }
+
+/*
+// Input Pin
+//
+// A square wave on one bit of an input. Addr is the word address the bit
+// is read from, or PRUSIM_PIN_R31 for the R31 input register. The bit
+// reads low for Low cycles, then high for High cycles, and repeats.
+// Reads from outside the local address space return 0 in every other bit.
+*/
+#define PRUSIM_PIN_R31      0xFFFFFFFF
+#define PRUSIM_MAX_PINS     8
+typedef struct _PRUSIM_PIN {
+    unsigned int    Addr;
+    unsigned int    Bit;
+    unsigned int    Low;
+    unsigned int    High;
+} PRUSIM_PIN;
+
+/* Loop Record (one per loop seen) */
+typedef struct _PRUSIM_LOOP {
+    unsigned int    Top;            /* First code address in the loop */
+    unsigned int    Bottom;         /* Last code address in the loop */
+    unsigned long long Repeats;     /* Times control went back to Top */
+} PRUSIM_LOOP;
+#define PRUSIM_MAX_LOOPS    64
+
+/* Simulator State */
+typedef struct _PRUSIM {
+    const unsigned int *pCode;      /* Code words (host byte order) */
+    unsigned int    CodeCount;
+    unsigned int    Pc;             /* Code address of the next instruction */
+    unsigned int    R[32];
+    unsigned int    Carry;
+    unsigned int    Const[32];      /* Constant table (C0-C31) */
+    unsigned char   *pMem;          /* PRU local address space */
+    unsigned char   Scratch[3][128];/* Scratch pad banks 10-12 */
+    unsigned int    LoopTop;        /* Active LOOP (LoopEnd is 0 when none) */
+    unsigned int    LoopEnd;
+    unsigned int    LoopCount;
+    PRUSIM_COSTS    Costs;
+    PRUSIM_PIN      Pins[PRUSIM_MAX_PINS];
+    unsigned int    PinCount;
+    unsigned int    Events;         /* Events sent through R31 */
+    unsigned int    LastEvent;
+    unsigned int    Writes;         /* Outputs: stores, XOUT, R30, and events */
+    unsigned int    WriteHash;      /* Hash of the outputs, in order */
+    int             Status;
+#define PRUSIM_RUNNING      0
+#define PRUSIM_HALT         1       /* HALT executed */
+#define PRUSIM_SLEEP        2       /* SLP executed */
+#define PRUSIM_LIMIT        3       /* Cycle limit reached */
+#define PRUSIM_BADPC        4       /* Pc left the code */
+#define PRUSIM_ILLEGAL      5       /* Instruction not simulated */
+    unsigned long long Cycles;
+    unsigned long long Instructions;
+    unsigned long long *pExecCount; /* Executions per code address */
+    unsigned long long *pCycleCount;/* Cycles per code address */
+    PRUSIM_LOOP     Loops[PRUSIM_MAX_LOOPS];
+    unsigned int    LoopCountSeen;
+} PRUSIM;
+
+/*
+// prusim_init
+//
+// Sets up a simulator for the supplied code words, starting at EntryPoint.
+// The code is not copied and must stay valid while the simulator is used.
+// The registers and memory start at zero, and the constant table and costs
+// start at their AM335x defaults. Free the simulator with prusim_free().
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_init( PRUSIM *sim, const unsigned int *code, unsigned int count,
+                 unsigned int entry_point );
+
+/*
+// prusim_free
+//
+// Frees the memory and counters of a simulator
+//
+// void
+*/
+void prusim_free( PRUSIM *sim );
+
+/*
+// prusim_add_pin
+//
+// Adds an input pin wave form (see PRUSIM_PIN)
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_add_pin( PRUSIM *sim, unsigned int addr, unsigned int bit,
+                    unsigned int low, unsigned int high );
+
+/*
+// prusim_parse_pin
+//
+// Adds an input pin written as "addr:bit:low:high", where addr may also
+// be r31 (the prusim -p flag)
+//
+// Returns 0 on success, -1 on error
+*/
+int prusim_parse_pin( PRUSIM *sim, const char *arg );
+
+/*
+// prusim_step
+//
+// Executes one instruction
+//
+// Returns the simulator status (PRUSIM_RUNNING while it can continue)
+*/
+int prusim_step( PRUSIM *sim );
+
+/*
+// prusim_run
+//
+// Executes instructions until the program stops or max_cycles have run
+//
+// Returns the simulator status
+*/
+int prusim_run( PRUSIM *sim, unsigned long long max_cycles );
+
+/*
+// prusim_report
+//
+// Prints the totals, then the cycles spent under each label and in each
+// loop. A label covers the code from its address up to the next label.
+// Labels may be 0.
+//
+// void
+*/
+void prusim_report( PRUSIM *sim, const PASM_LABEL *labels, unsigned int label_count,
+                    FILE *out );
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * prusimmain.c
+ *
+ * Copyright (C) 2012 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+/*===========================================================================
+ * Copyright (c) Texas Instruments Inc 2010-12
+ *
+ * Use of this software is controlled by the terms and conditions found in the
+ * license agreement under which this software has been supplied or provided.
+ * ============================================================================
+ */
+
+/*===========================================================================
+// PASM - PRU Assembler
+//---------------------------------------------------------------------------
+//
+// File     : prusimmain.c
+//
+// Description:
+//     Command line front end for the simulator
+//         - Loads the code (and labels) from pasm output
+//         - Runs the program in prusim.c
+//         - Prints the cycle report
+//
+//---------------------------------------------------------------------------
+// Revision:
+//     17-Oct-26: 0.86 - Added simulator
+//     18-Oct-26: 0.86 - Load through pasm_load_image(), and disassemble
+//                       an instruction that is not simulated
+//     18-Oct-26: 0.86 - Moved ParsePin() to prusim_parse_pin()
+============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pasm.h"
+
+
+/* ---------- Local Macro Definitions ----------- */
+
+#define PROCESSOR_NAME_STRING ("PRU")
+#define VERSION_STRING        ("0.86")
+
+#define DEFAULT_MAX_CYCLES    (100000000ULL)
+
+#define RET_ERROR             (1)
+#define RET_SUCCESS           (0)
+
+/*
+// Main Simulator Entry Point
+//
+*/
+int main(int argc, char *argv[])
+{
+    PRUSIM sim;
+    PASM_IMAGE image;
+    PRU_INST inst;
+    char   *infile, *flags;
+    char   text[PRUDIS_TEXT_LEN];
+    unsigned long long maxcycles;
+    int    i, j, fRegs, rc;
+
+    printf("\n\n%s Simulator Version %s\n",PROCESSOR_NAME_STRING, VERSION_STRING);
+    printf("Copyright (C) 2005-2013 by Texas Instruments Inc.\n\n");
+
+    /* Scan argv[0] to the final '/' in program name */
+    i=0;
+    j=-1;
+    while( argv[0][i] )
+    {
+        if( argv[0][i] == '/' || argv[0][i] == '\\')
+            j=i;
+        i++;
+    }
+    argv[0]+=(j+1);
+
+    /*
+    // Process command line
+    */
+    infile=0;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' )
+        {
+            if( infile )
+                goto USAGE;
+            infile = argv[i];
+        }
+    }
+    if( !infile )
+    {
+USAGE:
+        printf("Usage: %s [-r] [-c#] [-e#] [-s#] [-Cn=value] [-paddr:bit:low:high] InFile\n\n",argv[0]);
+        printf("    InFile is a pView debug file (*.dbg) or a little endian\n");
+        printf("    binary (*.bin). With no extension, InFile.dbg is used if it\n");
+        printf("    exists, and InFile.bin otherwise. Labels come from the .dbg.\n\n");
+        printf("    r  - Print the registers when the program stops\n");
+        printf("    c  - Stop after # cycles (Default is %llu)\n",DEFAULT_MAX_CYCLES);
+        printf("    e  - Start at code address # (Default is the .entrypoint)\n");
+        printf("    s  - Cycles for a load from outside the local memory (Default is %d)\n",PRUSIM_COST_SYSTEM_LOAD);
+        printf("    C  - Set constant table entry Cn to value\n");
+        printf("    p  - Drive bit 'bit' of the word at 'addr' (or of R31 when addr\n");
+        printf("         is 'r31') low for 'low' cycles, then high for 'high' cycles,\n");
+        printf("         repeating\n");
+        printf("\n");
+        return(RET_ERROR);
+    }
+
+    /* Load the program */
+    if( pasm_load_image( infile, &image ) < 0 )
+        return(RET_ERROR);
+
+    if( prusim_init( &sim, image.pCode, image.CodeCount,
+                     image.EntryPoint<0 ? 0 : image.EntryPoint ) < 0 )
+        { printf("Memory allocation failed\n"); return(RET_ERROR); }
+
+    /* Get all flag arguments */
+    maxcycles = DEFAULT_MAX_CYCLES;
+    fRegs = 0;
+    for( i=1; i<argc; i++ )
+    {
+        if( argv[i][0] != '-' )
+            continue;
+        flags = argv[i]+1;
+        if( *flags == 'r' && !flags[1] )
+            fRegs = 1;
+        else if( *flags == 'c' && flags[1] )
+            maxcycles = strtoull( flags+1, 0, 0 );
+        else if( *flags == 'e' && flags[1] )
+            sim.Pc = strtoul( flags+1, 0, 0 );
+        else if( *flags == 's' && flags[1] )
+            sim.Costs.SystemLoad = strtoul( flags+1, 0, 0 );
+        else if( *flags == 'C' && flags[1] )
+        {
+            char *pEnd;
+
+            j = strtoul( flags+1, &pEnd, 10 );
+            if( j>31 || *pEnd!='=' )
+                { printf("\nExpected 'Cn=value' with n from 0 to 31\n\n"); goto USAGE; }
+            sim.Const[j] = strtoul( pEnd+1, 0, 0 );
+        }
+        else if( *flags == 'p' )
+        {
+            if( prusim_parse_pin( &sim, flags+1 ) < 0 )
+                { printf("\nBad pin '%s'\n\n",flags+1); goto USAGE; }
+        }
+        else
+        {
+            printf("\nUnknown flag '%s'\n\n",argv[i]);
+            goto USAGE;
+        }
+    }
+
+    prusim_run( &sim, maxcycles );
+    prusim_report( &sim, image.pLabels, image.LabelCount, stdout );
+    if( sim.Status==PRUSIM_ILLEGAL )
+    {
+        if( prudis_decode( sim.pCode[sim.Pc], &inst ) < 0 )
+            sprintf( text, ".codeword 0x%08x", sim.pCode[sim.Pc] );
+        else
+            prudis_text( &inst, sim.Pc, 0, 0, text );
+        printf("            %s\n", text);
+    }
+
+    if( fRegs )
+    {
+        printf("\n");
+        for( i=0; i<32; i++ )
+            printf("R%-2d: 0x%08x%s", i, sim.R[i], (i%4)==3 ? "\n" : "    ");
+    }
+
+    rc = (sim.Status==PRUSIM_HALT || sim.Status==PRUSIM_SLEEP) ? RET_SUCCESS : RET_ERROR;
+    prusim_free( &sim );
+    pasm_free_image( &image );
+    return(rc);
+}
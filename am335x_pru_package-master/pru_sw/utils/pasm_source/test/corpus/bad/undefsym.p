@@ -0,0 +1,12 @@
+// Fails on an undefined symbol, after a good forward reference. Single
+// pass must stop where pass 2 does, with the same messages and listing.
+.origin 0
+.entrypoint START
+
+START:
+    QBA     NEXT
+    MOV     r1, 5
+NEXT:
+    MOV     r1, badsym
+    ADD     r2, r2, 1
+    QBA     START
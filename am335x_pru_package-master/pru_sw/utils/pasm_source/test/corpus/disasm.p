@@ -0,0 +1,80 @@
+// Disassembler test program. The distest script checks that prudis
+// writes each of these instructions back exactly as they are written
+// here, and that the listing assembles to the same code words. The
+// last two words are not instructions pasm can write.
+
+.origin 0
+.entrypoint START
+
+START:
+    add     r1, r2, r3.w1
+    adc     r1.b1, r2.b2, 255
+    sub     r1.w1, r2.w2, 16
+    suc     r4, r5, r6
+    lsl     r4, r5, 3
+    lsr     r4, r5, r6.b0
+    rsb     r7, r8, 1
+    rsc     r7, r8, r9
+    and     r10, r11, r12
+    or      r10, r11, 128
+    xor     r10.b3, r11.b3, r12.b3
+    not     r13, r14, 0
+    min     r13, r14, r15
+    max     r13, r14, 200
+    clr     r16, r16, 5
+    set     r16, r17, r18.b0
+    lmbd    r19, r20, 1
+    nop0    r0, r0, 0
+    nopf    r31, r31, r31
+    mov     r1, r2
+    mov     r1.b0, r2.b3
+    ldi     r1, 0x1234
+    ldi     r1.w2, 0xffff
+    ldi     r31.b0, 35
+LOOP1:
+    loop    LOOP1_END, 10
+    add     r1, r1, 1
+    sub     r2, r2, 1
+LOOP1_END:
+    iloop   LOOP2_END, r3.w0
+    add     r1, r1, 2
+LOOP2_END:
+    qbgt    START, r1, 5
+    qblt    LOOP1, r1.b0, r2.b1
+    qbeq    LOOP1_END, r1, 0
+    qbge    FORWARD, r1.w2, 128
+    qble    FORWARD, r1, r2
+    qbne    START, r1, 255
+    qba     FORWARD
+    qbbs    FORWARD, r1, 31
+    qbbc    START, r1.b2, r5.b0
+    wbs     r31, 30
+    wbc     r31, r4
+FORWARD:
+    sbbo    r2, r1, 0, 4
+    lbbo    r2.b1, r1, r3.w0, 124
+    sbco    r2.b2, c24, 8, b0
+    lbco    r2, c31, 255, b3
+    xin     10, r2, 4
+    xout    11, r2.b1, b2
+    xchg    12, r20, 124
+    sxin    10, r2, 4
+    sxout   11, r29.b3, 1
+    sxchg   12, r2, b1
+    zero    &r0, 32
+    zero    &r2.b1, 3
+    fill    &r20, 4
+    mvib    r7, *r1.b0
+    mviw    *r1.b1++, r2.w0
+    mvid    *--r1.b2, *r1.b3
+    jal     r29.w0, START
+    jal     r29, r3.w0
+    call    FORWARD
+    call    r5
+    jmp     START
+    jmp     r6.w2
+    ret
+    slp     1
+    halt
+    .codeword 0x2a000001
+    .codeword 0x25000000
@@ -0,0 +1,68 @@
+// Forward references of every kind, for comparing single pass (-s)
+// output against two pass output.
+
+.origin 0
+.entrypoint START
+
+#define COUNT   4
+
+.struct Pair
+    .u16    lo
+    .u16    hi
+.ends
+.assign Pair, r4, r4, pair
+
+.macro  WAITBIT
+.mparam reg, bit
+WAIT_LOOP:
+    qbbc    WAIT_LOOP, reg, bit
+    qba     WAIT_DONE
+WAIT_DONE:
+.endm
+
+.macro  SKIPTO
+.mparam target
+    qba     target
+.endm
+
+DATA:
+    .codeword   START
+    .codeword   END + 1
+
+START:
+    mov     r1, TABLE
+    ldi     r2, END
+    mov     pair.lo, ACCUM
+    mov     pair.hi, DATA
+    jmp     MAIN
+    qbeq    MAIN, r1, 0
+    qbne    MAIN, r1, r2
+    qbgt    MAIN, r1, COUNT
+    qblt    MAIN, r1, r2
+    qbge    MAIN, r1, 1
+    qble    MAIN, r1, r2
+    qbbs    MAIN, r1, 3
+    qbbc    MAIN, r1.b0, r2.b0
+    qba     MAIN
+    jal     r30.w0, ACCUM
+
+TABLE:
+    .codeword   0x12345678
+    .codeword   MAIN - START
+
+MAIN:
+    loop    LOOP_END, COUNT
+    add     r1, r1, 1
+    call    ACCUM
+LOOP_END:
+    WAITBIT r1, 5
+    SKIPTO  END
+    WAITBIT r2, 6
+    qba     START
+
+ACCUM:
+    add     r2, r2, r1
+    ret
+
+END:
+    halt
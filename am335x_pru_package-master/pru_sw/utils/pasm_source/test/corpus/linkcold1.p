@@ -0,0 +1,8 @@
+// Linker test program: overlay 0
+
+.origin 0x0400
+.entrypoint COLD1
+
+COLD1:
+    ldi     r2, 1
+    halt
@@ -0,0 +1,11 @@
+// Linker test program: overlay 1, the larger one
+
+.origin 0x0400
+.entrypoint COLD2
+
+COLD2:
+    ldi     r2, 2
+    add     r2, r2, r1
+COLD2_STORE:
+    sbco    r2, c24, 0, 4
+    halt
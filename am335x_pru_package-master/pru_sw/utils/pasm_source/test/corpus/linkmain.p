@@ -0,0 +1,13 @@
+// Linker test program: the resident main module. linktest links it with
+// linkutil.p and the overlays linkcold1.p and linkcold2.p.
+
+.setcallreg r29.w0
+.origin 0
+.entrypoint START
+
+#include "link.hp"
+
+START:
+    ldi     r1, 21
+    call    UTIL_DOUBLE
+    jmp     OVERLAY_WINDOW          // halts until an overlay is loaded
@@ -0,0 +1,10 @@
+// Linker test program: a resident routine at its own .origin
+
+.setcallreg r29.w0
+.origin 0x0100
+
+#include "link.hp"
+
+DOUBLE:
+    lsl     r1, r1, 1
+    ret
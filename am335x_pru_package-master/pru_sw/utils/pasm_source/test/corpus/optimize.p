@@ -0,0 +1,44 @@
+// Optimizer test program. The opttest script checks what pasm -O
+// removes from it, and that the result still runs the same way. CALL
+// links through R29, since a return address in R30 would show on the
+// output pins and stop the optimizer from moving code.
+
+.setcallreg r29.w0
+.origin 0
+.entrypoint START
+
+START:
+    ldi     r1.w0, 0x1234           // narrowed to one LDI
+    ldi     r1.w2, 0
+    mov     r2, 0x00010000
+    mov     r2.w2, 1                // already 1: removed
+    mov     r3, r3                  // no-op: removed
+    or      r4, r4, 0               // no-op: removed
+    add     r5, r5, 0               // clears the carry: kept
+    ldi     r6, 10
+    qba     NEXT                    // branch to the next word: removed
+NEXT:
+    call    DOUBLE
+    qbne    HOP1, r6, 0             // threaded to DONE
+    sbco    r6, c24, 0, 4
+HOP1:
+    qba     HOP2                    // threaded to DONE
+HOP2:
+    jmp     DONE
+OUTER:
+    sub     r6, r6, 1
+    sbco    r6, c24, 4, 4
+    mov     r7, 0x12
+    qbne    HOP1, r6, 0             // threaded to DONE: 2 jumps skipped
+    qba     OUTER
+DONE:
+    loop    LOOP_END, 3
+    add     r8, r8, 1
+    mov     r8, r8                  // last word of the LOOP body: kept
+LOOP_END:
+    sbco    r1, c24, 8, 16
+    halt
+
+DOUBLE:
+    lsl     r6, r6, 1
+    ret
@@ -0,0 +1,23 @@
+// Relocatable object test: calls, jumps, and branches into relocsum.p,
+// and a return address loaded from a label of this module.
+
+.setcallreg r29.w0
+.origin 0
+.entrypoint START
+.extern SUM, SUM_RET
+
+START:
+    ldi     r1, 10
+    call    SUM                     // r1 = 55
+    mov     r4, r1
+    ldi     r1, 4
+    ldi     r29.w0, BACK
+    jmp     SUM                     // r1 = 10, back at BACK
+BACK:
+    add     r4, r4, r1
+    ldi     r29.w0, DONE
+    qbeq    SUM_RET, r1, 10         // returns to DONE
+    ldi     r4, 0
+DONE:
+    mov     r1, r4                  // r1 = 65
+    halt
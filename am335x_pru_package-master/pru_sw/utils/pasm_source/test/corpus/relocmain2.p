@@ -0,0 +1,11 @@
+// Relocatable object test: a second program sharing relocsum.p
+
+.setcallreg r29.w0
+.origin 0
+.entrypoint START
+.extern SUM
+
+START:
+    ldi     r1, 100
+    call    SUM                     // r1 = 5050
+    halt
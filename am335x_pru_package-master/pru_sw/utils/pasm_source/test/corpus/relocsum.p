@@ -0,0 +1,18 @@
+// Relocatable object test: a shared routine. linktest assembles it once
+// with -r, and links it into both relocmain1.p and relocmain2.p.
+
+.setcallreg r29.w0
+.origin 0
+.global SUM, SUM_RET
+
+// r1 = r1 + (r1-1) + ... + 1
+SUM:
+    mov     r2, r1
+    ldi     r1, 0
+SUM_LOOP:
+    qbeq    SUM_RET, r2, 0
+    add     r1, r1, r2
+    sub     r2, r2, 1
+    qba     SUM_LOOP
+SUM_RET:
+    ret
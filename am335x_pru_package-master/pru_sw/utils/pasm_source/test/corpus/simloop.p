@@ -0,0 +1,75 @@
+// Simulator test program. The simtest script checks the cycle counts
+// and registers reported by prusim for each loop below, and timetest
+// checks the static timing report (pasm -T) against the same costs.
+
+.origin 0
+.entrypoint START
+
+#define GPIO1_DATAIN    0x4804c138
+#define PIN_BIT         16
+#define NUM_SAMPLES     4
+
+START:
+    zero    &r0, 32                 // XIN: 1 cycle
+    fill    &r20, 4                 // XIN: 1 cycle
+    mov     r2, 0x12345678          // LDI x2
+    sbco    r2, c24, 8, 4           // local store: 1+1
+    lbco    r17, c24, 8, 4          // local load: 2+1
+    xout    10, r2, 4               // save r2 in scratch pad bank 0
+    zero    &r2, 4
+    xin     10, r2, 4               // and restore it
+    ldi     r1, 8                   // r1.b0 -> &r2
+    mvib    r7, *r1.b0              // r7.b0 = r2.b0
+
+    ldi     r8, 0xFFFF
+    add     r8.w0, r8.w0, 1         // carry out of the 16 bit field
+    adc     r9, r9, 0               // r9 = carry
+    lmbd    r10, r2, 1              // left most 1 in 0x12345678 is bit 28
+
+    ldi     r11, 5
+    loop    LOOP_END, r11           // 5 passes of 2 cycles, no branch cost
+LOOP_TOP:
+    add     r12, r12, 3
+    lsl     r13, r12, 1
+LOOP_END:
+
+    ldi     r14, 6
+COUNT_DOWN:
+    sub     r14, r14, 1
+    qbne    COUNT_DOWN, r14, 0      // 6 passes of 2 cycles
+
+    call    SQUARE
+
+    // The samplecount loop: read GPIO1 until the pin goes high, then
+    // count cycles until it goes low, NUM_SAMPLES times
+    mov     r1, GPIO1_DATAIN
+    mov     r3, 1 << PIN_BIT
+    mov     r4, 0
+    mov     r6, NUM_SAMPLES * 4
+MAIN_LOOP:
+    mov     r5, 0
+INPUT_IS_LOW:
+    lbbo    r2, r1, 0, 4
+    and     r2, r2, r3
+    qbeq    INPUT_IS_LOW, r2, 0
+INPUT_IS_HIGH:
+    add     r5, r5, 1
+    lbbo    r2, r1, 0, 4
+    and     r2, r2, r3
+    qbne    INPUT_IS_HIGH, r2, 0
+    sbco    r5, c24, r4, 4
+    add     r4, r4, 4
+    qblt    MAIN_LOOP, r6, r4
+
+    wbs     r31.t30                 // wait for the R31 input pin
+    mov     r31.b0, 32 | 3
+    halt
+
+SQUARE:
+    mov     r15, r12
+    ldi     r16, 0
+SQUARE_LOOP:
+    add     r16, r16, r12
+    sub     r15, r15, 1
+    qbne    SQUARE_LOOP, r15, 0
+    ret
@@ -0,0 +1,146 @@
+#include "../pasm.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define LOOPS   200000
+
+static int errors;
+
+static void check( int ok, const char *what, const char *name )
+{
+    if ( !ok )
+    {
+        ++errors;
+        LOG("%s: '%s'\n", what, name);
+    }
+}
+
+/* The opcode search used before the name tables */
+static int linear_opcode( char *word )
+{
+    int i;
+
+    for ( i = 1; i <= OP_MAXIDX; i++ )
+        if ( !stricmp( word, OpText[i] ) )
+            return i;
+    return 0;
+}
+
+static double seconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void check_keywords( void )
+{
+    char name[32];
+    int i, j;
+
+    for ( i = 1; i <= OP_MAXIDX; i++ )
+    {
+        check( KeywordFind( OpText[i] ) == TOKID_OPCODE + i, "opcode not found", OpText[i] );
+        strcpy( name, KeywordText( TOKID_OPCODE + i ) );
+        check( !stricmp( name, OpText[i] ), "wrong opcode text", name );
+        name[0] = toupper( name[0] );
+        check( KeywordFind( name ) == TOKID_OPCODE + i, "mixed case opcode not found", name );
+    }
+    for ( i = 0; i <= DOTCMD_MAX; i++ )
+    {
+        check( KeywordFind( DotCmds[i] ) == TOKID_DOTCMD + i, "dot command not found", DotCmds[i] );
+        check( !strcmp( KeywordText( TOKID_DOTCMD + i ), DotCmds[i] ), "wrong dot command text", DotCmds[i] );
+        for ( j = 0; DotCmds[i][j]; j++ )
+            name[j] = toupper( DotCmds[i][j] );
+        name[j] = 0;
+        check( KeywordFind( name ) == TOKID_DOTCMD + i, "upper case dot command not found", name );
+    }
+    check( KeywordFind( "" ) == TOKID_NONE, "found", "" );
+    check( KeywordFind( "ad" ) == TOKID_NONE, "found", "ad" );
+    check( KeywordFind( "addx" ) == TOKID_NONE, "found", "addx" );
+    check( KeywordFind( "macro" ) == TOKID_NONE, "found", "macro" );
+    check( KeywordFind( "r1" ) == TOKID_NONE, "found", "r1" );
+    check( KeywordText( TOKID_OPCODE ) == 0, "text for", "opcode 0" );
+    check( KeywordText( TOKID_REGISTER ) == 0, "text for", "register" );
+}
+
+static void check_operands( void )
+{
+    static const int width[] = { 8, 8, 8, 8, 16, 16, 16, 32 };
+    char text[REGTEXT_LEN], name[32];
+    PRU_ARG arg, back;
+    int reg, field, bit;
+
+    for ( reg = 0; reg < 32; reg++ )
+    {
+        for ( field = 0; field <= FIELDTYPE_31_0; field++ )
+        {
+            for ( bit = -1; bit < width[field]; bit++ )
+            {
+                memset( &arg, 0, sizeof(arg) );
+                arg.Type = bit < 0 ? ARGTYPE_REGISTER : ARGTYPE_REGISTERBIT;
+                arg.Value = reg;
+                arg.Field = field;
+                arg.Bit = bit < 0 ? 0 : bit;
+                RegisterText( &arg, text );
+                memset( &back, 0, sizeof(back) );
+                check( RegisterFind( text, 0, 0, &back ) == 1 &&
+                       !memcmp( &arg, &back, sizeof(arg) ), "register does not round trip", text );
+            }
+        }
+        sprintf( name, "C%02d", reg );
+        check( ConstantFind( name ) == reg, "constant not found", name );
+        check( ConstantFind( ConstantText( reg ) ) == reg, "constant does not round trip", name );
+    }
+
+    /* Fields select within the field before them */
+    check( RegisterFind( "R8.w1.b1", 0, 0, &arg ) == 1 && arg.Field == FIELDTYPE_23_16, "wrong field", "R8.w1.b1" );
+    check( RegisterFind( "r8.b0.b0", 0, 0, &arg ) == 1 && arg.Field == FIELDTYPE_7_0, "wrong field", "r8.b0.b0" );
+    check( RegisterFind( "r8.w2.t15+", '+', 0, &arg ) == 1 && arg.Bit == 15, "wrong bit", "r8.w2.t15+" );
+    check( RegisterFind( "r8.w2.b2", 0, 0, &arg ) == 0, "found", "r8.w2.b2" );
+    check( RegisterFind( "r8.b1.t8", 0, 0, &arg ) == 0, "found", "r8.b1.t8" );
+    check( RegisterFind( "r8.w1.b0", 0, REGFIND_FLG_SINGLE, &arg ) == 0, "found", "r8.w1.b0 (single)" );
+    check( RegisterFind( "r8.t3", 0, REGFIND_FLG_NOBIT, &arg ) == REGFIND_ERR_BIT, "bit allowed", "r8.t3" );
+    check( RegisterFind( "r32", 0, 0, &arg ) == 0, "found", "r32" );
+    check( RegisterFind( "r1", '+', 0, &arg ) == 0, "found", "r1 without '+'" );
+    check( ConstantFind( "c32" ) < 0, "found", "c32" );
+    check( ConstantFind( "r1" ) < 0, "found", "r1" );
+}
+
+static void bench( void )
+{
+    volatile int sink = 0;
+    double t0, t1, t2;
+    int i, j;
+
+    t0 = seconds();
+    for ( i = 0; i < LOOPS; i++ )
+        for ( j = 1; j <= OP_MAXIDX; j += 7 )
+            sink += linear_opcode( OpText[j] );
+    t1 = seconds();
+    for ( i = 0; i < LOOPS; i++ )
+        for ( j = 1; j <= OP_MAXIDX; j += 7 )
+            sink += KeywordFind( OpText[j] );
+    t2 = seconds();
+
+    i = LOOPS * ((OP_MAXIDX + 6) / 7);
+    LOG("  mnemonic lookup : linear %.1f ns, perfect hash %.1f ns (%.1fx)\n",
+        (t1 - t0) * 1e9 / i, (t2 - t1) * 1e9 / i, (t1 - t0) / (t2 - t1));
+}
+
+int main( void )
+{
+    check_keywords();
+    check_operands();
+    if ( errors )
+        return 1;
+    bench();
+    LOG("name table test passed!\n");
+    return 0;
+}
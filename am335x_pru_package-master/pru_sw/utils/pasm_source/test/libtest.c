@@ -0,0 +1,162 @@
+#include "../pasmlib.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define THREADS 8
+#define LOOPS   50
+
+static const char *main_source =
+    "#include \"defs.h\"\n"
+    ".origin 0\n"
+    ".entrypoint START\n"
+    "START:\n"
+    "    ldi     r1, VALUE\n"
+    "    jmp     DONE\n"
+    "AGAIN:\n"
+    "    sub     r1, r1, 1\n"
+    "    qbne    AGAIN, r1, 0\n"
+    "DONE:\n"
+    "    halt\n";
+
+static const char *defs_source =
+    "#ifndef VALUE\n"
+    "#define VALUE 10\n"
+    "#endif\n";
+
+static int resolve( void *arg, const char *name, int system,
+                    const char **text, unsigned int *length )
+{
+    if ( system || strcmp( name, "defs.h" ) )
+        return -1;
+    *text = defs_source;
+    *length = strlen( defs_source );
+    return 0;
+}
+
+static void message( void *arg, int level, const char *file,
+                     unsigned int line, const char *text )
+{
+    ++*(int *)arg;
+    LOG("%s(%u) %s\n", file ? file : "", line, text);
+}
+
+/* Assemble with -DVALUE=<value> and check the result */
+static int assemble_and_check( int value, int single )
+{
+    char define[32];
+    const char *defines[2];
+    PASM_OPTIONS options;
+    PASM_IMAGE image;
+    int messages = 0;
+    int errors = 0;
+
+    sprintf( define, "VALUE=%d", value );
+    defines[0] = define;
+    defines[1] = 0;
+    memset( &options, 0, sizeof(options) );
+    options.Core = PASM_CORE_V3;
+    options.Flags = single ? PASM_FLG_SINGLEPASS : 0;
+    options.ppDefines = defines;
+    options.pfnMessage = message;
+    options.pMessageArg = &messages;
+
+    if ( pasm_assemble_buffer( main_source, resolve, &options, &image ) )
+    {
+        ++errors;
+        LOG("assembly failed with %d error(s)\n", image.Errors);
+    }
+    else
+    {
+        /* ldi r1, VALUE / jmp DONE(4) / sub / qbne AGAIN(2) / halt */
+        if ( image.CodeCount != 5 || image.EntryPoint != 0 ||
+             image.pCode[0] != (0x240000e1 | (value << 8)) ||
+             image.pCode[1] != 0x21000400 )
+        {
+            ++errors;
+            LOG("wrong code for VALUE=%d\n", value);
+        }
+        if ( image.LabelCount != 3 ||
+             strcmp( image.pLabels[0].Name, "START" ) || image.pLabels[0].Offset != 0 ||
+             strcmp( image.pLabels[1].Name, "AGAIN" ) || image.pLabels[1].Offset != 2 ||
+             strcmp( image.pLabels[2].Name, "DONE" ) || image.pLabels[2].Offset != 4 )
+        {
+            ++errors;
+            LOG("wrong label map for VALUE=%d\n", value);
+        }
+        if ( !image.pLines || image.FileCount != 2 ||
+             strcmp( image.ppFiles[image.pLines[0].File], "[Buffer]" ) ||
+             image.pLines[0].Line != 5 || image.pLines[4].Line != 11 )
+        {
+            ++errors;
+            LOG("wrong source lines for VALUE=%d\n", value);
+        }
+    }
+    if ( messages )
+        ++errors;
+    pasm_free_image( &image );
+    return errors;
+}
+
+static void *thread_main( void *arg )
+{
+    int id = (int)(size_t)arg;
+    int errors = 0;
+    int i;
+
+    for ( i = 0; i < LOOPS; ++i )
+        errors += assemble_and_check( id*100 + i, i & 1 );
+    return (void *)(size_t)errors;
+}
+
+int test_errors()
+{
+    PASM_OPTIONS options;
+    PASM_IMAGE image;
+    int messages = 0;
+    int errors = 0;
+
+    memset( &options, 0, sizeof(options) );
+    options.pfnMessage = message;
+    options.pMessageArg = &messages;
+
+    LOG("expect an error report:\n");
+    if ( !pasm_assemble_buffer( "#include <missing.h>\n", resolve, &options, &image ) ||
+         image.Errors != 1 || messages != 1 )
+    {
+        ++errors;
+        LOG("missing include not reported\n");
+    }
+    pasm_free_image( &image );
+    return errors;
+}
+
+int main()
+{
+    pthread_t threads[THREADS];
+    void *rc;
+    int errors = 0;
+    int i;
+
+    errors += assemble_and_check( 10, 0 );
+    errors += test_errors();
+
+    for ( i = 0; i < THREADS; ++i )
+        pthread_create( &threads[i], 0, thread_main, (void *)(size_t)(i+1) );
+    for ( i = 0; i < THREADS; ++i )
+    {
+        pthread_join( threads[i], &rc );
+        errors += (int)(size_t)rc;
+    }
+
+    if ( errors )
+    {
+        LOG("library test failed with %d error(s)\n", errors);
+        return 1;
+    }
+    LOG("library test passed!\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "../pasm.h"
+#include "../pasmdbg.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define LOG(FORMAT, ...) fprintf(stderr, FORMAT, ## __VA_ARGS__)
+
+#define ROUNDS  20
+#define SOURCE  "outbench.p"
+
+static const char *suffix[OUTFMT_MAX] = { "_bin.h", ".img", ".dbg", ".bin", ".bib" };
+
+static double now()
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, 0 );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static FILE *open_out( const char *base, const char *ext )
+{
+    char name[64];
+
+    sprintf( name, "%s%s", base, ext );
+    return fopen( name, "wb" );
+}
+
+/* The writers pasm used before: one fwrite per byte, one fprintf per word */
+static void old_write( const char *base )
+{
+    FILE *f;
+    unsigned char tmp;
+    int i;
+
+    f = open_out( base, "_bin.h" );
+    fprintf( f, "\n\n"
+            "/* This file contains the %s instructions in a C array which are to  */\n"
+            "/* be downloaded from the host CPU to the %s instruction memory.     */\n"
+            "/* This file is generated by the %s assembler.                       */\n",
+            "PRU", "PRU", "PRU" );
+    fprintf( f, "\nconst unsigned int %scode[] =  {\n", "PRU" );
+    for ( i = 0; i < pCtx->CodeOffset-1; i++ )
+        fprintf( f, "     0x%08x,\n", pCtx->ProgramImage[i].CodeWord );
+    fprintf( f, "     0x%08x };\n\n", pCtx->ProgramImage[pCtx->CodeOffset-1].CodeWord );
+    fclose( f );
+
+    f = open_out( base, ".img" );
+    for ( i = 0; i < pCtx->CodeOffset; i++ )
+        fprintf( f, "%08x\n", pCtx->ProgramImage[i].CodeWord );
+    fclose( f );
+
+    f = open_out( base, ".dbg" );
+    {
+        DBGFILE_HEADER hdr;
+        DBGFILE_LABEL lbl;
+        DBGFILE_FILE file;
+        DBGFILE_CODE code;
+        LABEL *label;
+        char *dir;
+        size_t len;
+
+        memset( &hdr, 0, sizeof(hdr) );
+        hdr.FileID = DBGFILE_FILEID_VER3;
+        hdr.LabelCount = pCtx->LabelCount;
+        hdr.LabelOffset = sizeof(DBGFILE_HEADER);
+        hdr.FileCount = pCtx->sfIndex;
+        hdr.FileOffset = hdr.LabelOffset + hdr.LabelCount * sizeof(DBGFILE_LABEL);
+        hdr.CodeCount = pCtx->CodeOffset;
+        hdr.CodeOffset = hdr.FileOffset + hdr.FileCount * sizeof(DBGFILE_FILE);
+        hdr.EntryPoint = pCtx->EntryPoint;
+        fwrite( &hdr, 1, sizeof(hdr), f );
+        for ( label = pCtx->pLabelList; label; label = label->pNext )
+        {
+            memset( &lbl, 0, sizeof(lbl) );
+            lbl.AddrOffset = label->Offset;
+            strcpy( lbl.Name, label->Name );
+            fwrite( &lbl, 1, sizeof(lbl), f );
+        }
+        for ( i = 0; i < (int)pCtx->sfIndex; i++ )
+        {
+            memset( &file, 0, sizeof(file) );
+            dir = pCtx->sfArray[i].SourceBaseDir;
+            len = strlen( dir );
+
+            /* The directory and name are joined with a '/', as OutSourceName() does */
+            if ( !len || !strcmp( dir, "." ) || !strcmp( dir, "./" ) ||
+                 len + 1 + strlen( pCtx->sfArray[i].SourceName ) >= DBGFILE_NAMELEN_SHORT )
+                strcpy( file.SourceName, pCtx->sfArray[i].SourceName );
+            else
+            {
+                strcpy( file.SourceName, dir );
+                if ( dir[len-1] != '/' && dir[len-1] != '\\' )
+                    strcat( file.SourceName, "/" );
+                strcat( file.SourceName, pCtx->sfArray[i].SourceName );
+            }
+            fwrite( &file, 1, sizeof(file), f );
+        }
+        for ( i = 0; i < pCtx->CodeOffset; i++ )
+        {
+            memset( &code, 0, sizeof(code) );
+            code.Flags = pCtx->ProgramImage[i].Flags &
+                         (DBGFILE_CODE_FLG_FILEINFO|DBGFILE_CODE_FLG_CANMAP);
+            code.Resv8 = pCtx->ProgramImage[i].Resv8;
+            code.FileIndex = pCtx->ProgramImage[i].FileIndex;
+            code.Line = pCtx->ProgramImage[i].Line;
+            code.AddrOffset = pCtx->ProgramImage[i].AddrOffset;
+            code.CodeWord = pCtx->ProgramImage[i].CodeWord;
+            fwrite( &code, 1, sizeof(code), f );
+        }
+    }
+    fclose( f );
+
+    f = open_out( base, ".bin" );
+    for ( i = 0; i < pCtx->CodeOffset; i++ )
+    {
+        tmp = (unsigned char)pCtx->ProgramImage[i].CodeWord;
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 8);
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 16);
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 24);
+        fwrite( &tmp, 1, 1, f );
+    }
+    fclose( f );
+
+    f = open_out( base, ".bib" );
+    for ( i = 0; i < pCtx->CodeOffset; i++ )
+    {
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 24);
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 16);
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)(pCtx->ProgramImage[i].CodeWord >> 8);
+        fwrite( &tmp, 1, 1, f );
+        tmp = (unsigned char)pCtx->ProgramImage[i].CodeWord;
+        fwrite( &tmp, 1, 1, f );
+    }
+    fclose( f );
+}
+
+/* Reads a whole file, returns its length or -1 */
+static long read_file( const char *base, const char *ext, unsigned char **data )
+{
+    FILE *f;
+    char name[64];
+    long len;
+
+    sprintf( name, "%s%s", base, ext );
+    if ( !(f = fopen( name, "rb" )) )
+        return -1;
+    fseek( f, 0, SEEK_END );
+    len = ftell( f );
+    fseek( f, 0, SEEK_SET );
+    *data = malloc( len );
+    if ( fread( *data, 1, len, f ) != (size_t)len )
+        len = -1;
+    fclose( f );
+    return len;
+}
+
+int main()
+{
+    OUTWRITER *writers[OUTFMT_MAX];
+    unsigned char *old_data, *new_data;
+    long old_len, new_len;
+    double start, t_old, t_new, t_mem;
+    double bytes = 0;
+    int errors = 0;
+    int i, r;
+
+    pCtx = ContextCreate();
+    pCtx->Core = CORE_V3;
+    pCtx->Options = OPTION_CARRAY | OPTION_IMGFILE | OPTION_DBGFILE | OPTION_BINARY | OPTION_BINARYBIG;
+    if ( !Assemble( SOURCE, 0, 0 ) || pCtx->Errors || pCtx->CodeOffset != MAX_PROGRAM )
+    {
+        LOG("could not assemble a full image from %s\n", SOURCE);
+        return 1;
+    }
+
+    start = now();
+    for ( r = 0; r < ROUNDS; r++ )
+        old_write( "old" );
+    t_old = now() - start;
+
+    start = now();
+    for ( r = 0; r < ROUNDS; r++ )
+        OutputWrite( "new", 0 );
+    t_new = now() - start;
+
+    for ( i = 0; i < OUTFMT_MAX; i++ )
+        writers[i] = malloc( sizeof(OUTWRITER) );
+    start = now();
+    for ( r = 0; r < ROUNDS; r++ )
+    {
+        for ( i = 0; i < OUTFMT_MAX; i++ )
+            OutOpen( writers[i], 0 );
+        ImageWrite( writers, 0 );
+        for ( i = 0; i < OUTFMT_MAX; i++ )
+        {
+            OutClose( writers[i] );
+            if ( r < ROUNDS-1 )
+                free( writers[i]->pMem );
+        }
+    }
+    t_mem = now() - start;
+
+    /* All three must produce the same bytes */
+    for ( i = 0; i < OUTFMT_MAX; i++ )
+    {
+        old_len = read_file( "old", suffix[i], &old_data );
+        new_len = read_file( "new", suffix[i], &new_data );
+        if ( old_len < 0 || old_len != new_len || memcmp( old_data, new_data, old_len ) )
+        {
+            ++errors;
+            LOG("%s file differs from the old writer\n", suffix[i]);
+        }
+        else if ( writers[i]->MemLength != (unsigned)old_len ||
+                  memcmp( writers[i]->pMem, old_data, old_len ) )
+        {
+            ++errors;
+            LOG("%s in memory differs from the old writer\n", suffix[i]);
+        }
+        bytes += old_len;
+        free( old_data );
+        free( new_data );
+        free( writers[i]->pMem );
+        free( writers[i] );
+    }
+
+    bytes *= ROUNDS;
+    LOG("%d writes of a %d word image in 5 formats (%.1f MB)\n", ROUNDS, pCtx->CodeOffset, bytes / 1e6);
+    LOG("  old writers    : %.3f s (%.1f MB/s)\n", t_old, bytes / 1e6 / t_old);
+    LOG("  buffered files : %.3f s (%.1f MB/s, %.1fx)\n", t_new, bytes / 1e6 / t_new, t_old / t_new);
+    LOG("  memory         : %.3f s (%.1f MB/s, %.1fx)\n", t_mem, bytes / 1e6 / t_mem, t_old / t_mem);
+    ContextDestroy( pCtx );
+    return errors ? 1 : 0;
+}
@@ -8,12 +8,14 @@
  *   It appears to be much easier to make a pthread that waits for the PRU
  *   interrupt than to make an interrupt handler that works under Linux.
  *   Hopefully this will not chew up the ARM CPU. prussdrv_pru_wait_event()
- *   appears to be implemented as a blocking read.
+ *   appears to be implemented as a blocking read. prussdrv_start_irqthread()
+ *   now runs that thread at real-time priority.
  *
  *   If the PRU generates interrupts as fast as it can, the ARM can't keep
  *   up. But this is OK: the missed interrupts don't block the PRU and
  *   they don't block calls to prussdrv_pru_wait_event() or
- *   prussdrv_pru_clear_event().
+ *   prussdrv_pru_clear_event(). prussdrv_pru_wait_events() now coalesces
+ *   them, reporting the count from data RAM once per wakeup.
  *
  * Based on Skeleton Application Code at:
  * http://processors.wiki.ti.com/index.php/PRU_Linux_Application_Loader_API_Guide
@@ -23,7 +25,7 @@
 
 #include <stdio.h>
 #include <unistd.h>
-#include <pthread.h>
+#include <sched.h>
 #include <prussdrv.h>
 #include <pruss_intc_mapping.h>
 
@@ -38,17 +40,27 @@ void enable_pru_interrupts() {
 }
 
 void *pruevtout0_thread(void *arg) {
+  // intp.p bumps the count in data RAM before each interrupt, so one wakeup
+  // per millisecond (or per 1000 events) covers every interrupt in between.
+  tprussdrv_coalesce coalesce = { 1000, 1000, (unsigned int*)pru0_data_ram };
+  tprussdrv_event_stats stats;
+  int events;
+
   printf("pruevtout0_thread started.\n");
   printf("count = %d\n", *pru0_data_ram);
-  do {
-    prussdrv_pru_wait_event(PRU_EVTOUT_0);
-    printf("count = %d\n", *pru0_data_ram);
-    // The Linux API documentation is wrong regarding the following function:
-    // the documentation has the arguments reversed. If you get this wrong,
-    // the above prussdrv_pru_wait_event() will wait forever even if
-    // an interrupt is pending.
-    prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
-  } while (1);
+  prussdrv_pru_set_coalesce(PRU_EVTOUT_0, &coalesce);
+  while (!prussdrv_irqthread_stopping(PRU_EVTOUT_0)) {
+    // Clears PRU0_ARM_INTERRUPT itself. (The Linux API documentation has
+    // the arguments of prussdrv_pru_clear_event() reversed; get them wrong
+    // and the next wait blocks forever even if an interrupt is pending.)
+    events = prussdrv_pru_wait_events(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT, -1);
+    if (events <= 0)
+      continue;
+    prussdrv_pru_event_stats(PRU_EVTOUT_0, &stats);
+    printf("count = %d (+%d, %llu interrupts missed)\n",
+      *pru0_data_ram, events, stats.missed);
+  }
+  return NULL;
 }
 
 int main(void) {
@@ -65,13 +77,10 @@ int main(void) {
     PRUSS0_PRU0_IRAM, 0, (unsigned int*)intp_bin, intp_bin_len
   );
 
-// Contra the ARM PRU Linux API documentation, this function does not exist!
-//  prussdrv_start_irqthread(
-//    PRU_EVTOUT_0, sched_get_priority_max(SCHED_FIFO) - 2, pruevtout0_thread
-//  );
-
-  pthread_t irqthread;
-  int iret = pthread_create(&irqthread, NULL, pruevtout0_thread, NULL);
+  // SCHED_FIFO with memory locked, so other processes can't hold it up
+  int iret = prussdrv_start_irqthread(
+    PRU_EVTOUT_0, sched_get_priority_max(SCHED_FIFO) - 2, pruevtout0_thread
+  );
   printf("iret = %d\n", iret);
   sleep(1);
 
@@ -84,5 +93,7 @@ int main(void) {
   prussdrv_pru_disable(PRU0);
   printf("PRU disabled\n");
   printf("count = %d\n", *pru0_data_ram);
+  prussdrv_stop_irqthread(PRU_EVTOUT_0);
+  prussdrv_exit();
 }
 
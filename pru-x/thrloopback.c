@@ -28,7 +28,7 @@
 #include <time.h>
 #include <errno.h>
 #include <string.h>
-#include <pthread.h>
+#include <sched.h>
 #include <prussdrv.h>
 #include <pruss_intc_mapping.h>
 #include "constants.h"
@@ -90,14 +90,16 @@ void sleep_millis(unsigned int millis) {  // milliseconds
  */
 
 void *measure_thread_func(void *arg) {
-  do {
-    prussdrv_pru_wait_event(PRU_EVTOUT_1);
+  while (!prussdrv_irqthread_stopping(PRU_EVTOUT_1)) {
+    if (!prussdrv_pru_wait_event(PRU_EVTOUT_1))
+      continue;
     signed int start = pru_measure->start;
     signed int end =   pru_measure->end;
     printf("pulse start=0x%08x end=0x%08x diff=%d time=%9.3f ms\n",
       start, end, end - start, 1000000.0 * (end - start) / 24000000.0);
     prussdrv_pru_clear_event(PRU_EVTOUT_1, PRU1_ARM_INTERRUPT);
-  } while (1);
+  }
+  return NULL;
 }
 
 int main(int argc, char **argv) {
@@ -156,9 +158,11 @@ int main(int argc, char **argv) {
   pru_measure->start = 99;
   pru_measure->end = 99;
 
-  pthread_t measure_thread;
-  int iret = pthread_create(&measure_thread, NULL, measure_thread_func, NULL);
-  if (iret != 0) {
+  // Real-time, so a busy ARM doesn't make us miss pulses
+  if (prussdrv_start_irqthread(
+        PRU_EVTOUT_1, sched_get_priority_max(SCHED_FIFO) - 2,
+        measure_thread_func
+     ) != 0) {
     perror("starting measure_thread");
     exit(1);
   }
@@ -181,6 +185,7 @@ int main(int argc, char **argv) {
 
   prussdrv_pru_disable(PRU0);
   prussdrv_pru_disable(PRU1);
+  prussdrv_stop_irqthread(PRU_EVTOUT_1);
   prussdrv_exit();
 
   return 0;